@@ -2,15 +2,20 @@
 #define _GRAPHICS_3DMATH_H
 
 #include <math.h>
+#include <stdint.h>
 #include <string.h>
 
 #include <retro_inline.h>
 #include <retro_miscellaneous.h>
 
+#include <boolean.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+struct SPLight;
+
 static INLINE float DotProduct(const float *v0, const float *v1)
 {
    return v0[0] * v1[0] + v0[1] * v1[1] + v0[2] * v1[2];
@@ -32,7 +37,33 @@ static INLINE void NormalizeVector(float *v)
    v[2] /= len;
 }
 
-void TransformVectorNormalize(float vec[3], float mtx[4][4]);
+/* Vertex math shared by the HLE plugins. The pointers below are set to a C
+ * version or, when built with SSE2 or NEON, a vec4f one; both do the same
+ * IEEE operations in the same order. Matrices are applied to row vectors:
+ * v' = v * mtx. */
+
+/* dest = m1 * m0, i.e. m1 then m0; dest may be either input */
+extern void (*MultMatrix)(float m0[4][4], float m1[4][4], float dest[4][4]);
+
+/* vtx = (x, y, z, 1) * mtx */
+extern void (*TransformVertex)(float vtx[4], float mtx[4][4]);
+
+/* vec = normalize(vec * mtx), with mtx's upper 3x3 */
+extern void (*TransformVectorNormalize)(float vec[3], float mtx[4][4]);
+
+/* color = lights[numLights] + sum of lights[i] * max(normal . lights[i], 0),
+ * each channel clamped to 1 */
+extern void (*ShadeVertex)(float color[3], const float normal[3],
+      const struct SPLight *lights, uint32_t numLights);
+
+/* Clip code of a transformed vertex: 0x01 x < -w, 0x02 x > w, 0x04 y < -w,
+ * 0x08 y > w and 0x10 w < wmin */
+uint32_t ClipVertexFlags(const float vtx[4], float wmin);
+
+/* Picks the vec4f versions if they are built and simd is set, the C ones
+ * otherwise; returns whether the vec4f ones are used. They are by default,
+ * and retro_init calls this with the CPU features the frontend reports. */
+bool MathInit(bool simd);
 
 #ifdef __cplusplus
 }
@@ -2,8 +2,45 @@
 #include <math.h>
 
 #include "3dmath.h"
+#include "vec4f.h"
+#include "RSP/gSP_state.h"
 
-void TransformVectorNormalize(float vec[3], float mtx[4][4])
+#if defined(VEC4F_SSE) || defined(VEC4F_NEON)
+#define MATH_SIMD 1
+#endif
+
+static void MultMatrixC(float m0[4][4], float m1[4][4], float dest[4][4])
+{
+   unsigned i, j;
+   float row[4][4];
+
+   memcpy(row, m0, sizeof(row));
+
+   for (i = 0; i < 4; i++)
+   {
+      float a0 = m1[i][0];
+      float a1 = m1[i][1];
+      float a2 = m1[i][2];
+      float a3 = m1[i][3];
+
+      for (j = 0; j < 4; j++)
+         dest[i][j] = a0 * row[0][j] + a1 * row[1][j] + a2 * row[2][j] + a3 * row[3][j];
+   }
+}
+
+static void TransformVertexC(float vtx[4], float mtx[4][4])
+{
+   float x = vtx[0];
+   float y = vtx[1];
+   float z = vtx[2];
+
+   vtx[0] = x * mtx[0][0] + y * mtx[1][0] + z * mtx[2][0] + mtx[3][0];
+   vtx[1] = x * mtx[0][1] + y * mtx[1][1] + z * mtx[2][1] + mtx[3][1];
+   vtx[2] = x * mtx[0][2] + y * mtx[1][2] + z * mtx[2][2] + mtx[3][2];
+   vtx[3] = x * mtx[0][3] + y * mtx[1][3] + z * mtx[2][3] + mtx[3][3];
+}
+
+static void TransformVectorNormalizeC(float vec[3], float mtx[4][4])
 {
    float len;
    float x   = vec[0];
@@ -32,3 +69,148 @@ void TransformVectorNormalize(float vec[3], float mtx[4][4])
       vec[2] /= len;
    }
 }
+
+static void ShadeVertexC(float color[3], const float normal[3],
+      const struct SPLight *lights, uint32_t numLights)
+{
+   uint32_t i;
+
+   color[0] = lights[numLights].r;
+   color[1] = lights[numLights].g;
+   color[2] = lights[numLights].b;
+
+   for (i = 0; i < numLights; i++)
+   {
+      float intensity = DotProduct(normal, &lights[i].x);
+      if (intensity < 0.0f)
+         intensity = 0.0f;
+      color[0] += lights[i].r * intensity;
+      color[1] += lights[i].g * intensity;
+      color[2] += lights[i].b * intensity;
+   }
+
+   color[0] = MIN(1.0f, color[0]);
+   color[1] = MIN(1.0f, color[1]);
+   color[2] = MIN(1.0f, color[2]);
+}
+
+/* Scalar on every CPU: vertices are written a component at a time just
+ * before, and a vector load of them stalls on store forwarding. */
+uint32_t ClipVertexFlags(const float vtx[4], float wmin)
+{
+   uint32_t clip = 0;
+   if (vtx[0] < -vtx[3])   clip |= 0x01;
+   if (vtx[0] > +vtx[3])   clip |= 0x02;
+   if (vtx[1] < -vtx[3])   clip |= 0x04;
+   if (vtx[1] > +vtx[3])   clip |= 0x08;
+   if (vtx[3] < wmin)      clip |= 0x10;
+   return clip;
+}
+
+#ifdef MATH_SIMD
+
+/* Rows of the result are sums of the rows of m0 scaled by m1's elements;
+ * m0 is loaded whole and each row of m1 read before its row of dest is
+ * written, so dest may alias either. */
+static void MultMatrixSIMD(float m0[4][4], float m1[4][4], float dest[4][4])
+{
+   unsigned i;
+   vec4f r0 = vec4f_load(m0[0]);
+   vec4f r1 = vec4f_load(m0[1]);
+   vec4f r2 = vec4f_load(m0[2]);
+   vec4f r3 = vec4f_load(m0[3]);
+
+   for (i = 0; i < 4; i++)
+   {
+      vec4f d = vec4f_mul(vec4f_set1(m1[i][0]), r0);
+      d = vec4f_add(d, vec4f_mul(vec4f_set1(m1[i][1]), r1));
+      d = vec4f_add(d, vec4f_mul(vec4f_set1(m1[i][2]), r2));
+      d = vec4f_add(d, vec4f_mul(vec4f_set1(m1[i][3]), r3));
+      vec4f_store(dest[i], d);
+   }
+}
+
+static void TransformVertexSIMD(float vtx[4], float mtx[4][4])
+{
+   vec4f v = vec4f_mul(vec4f_set1(vtx[0]), vec4f_load(mtx[0]));
+   v = vec4f_add(v, vec4f_mul(vec4f_set1(vtx[1]), vec4f_load(mtx[1])));
+   v = vec4f_add(v, vec4f_mul(vec4f_set1(vtx[2]), vec4f_load(mtx[2])));
+   v = vec4f_add(v, vec4f_load(mtx[3]));
+   vec4f_store(vtx, v);
+}
+
+static void TransformVectorNormalizeSIMD(float vec[3], float mtx[4][4])
+{
+   float t[4], len;
+   vec4f v = vec4f_mul(vec4f_load(mtx[0]), vec4f_set1(vec[0]));
+   v = vec4f_add(v, vec4f_mul(vec4f_load(mtx[1]), vec4f_set1(vec[1])));
+   v = vec4f_add(v, vec4f_mul(vec4f_load(mtx[2]), vec4f_set1(vec[2])));
+   vec4f_store(t, v);
+
+   len = t[0]*t[0] + t[1]*t[1] + t[2]*t[2];
+
+   if (len != 0.0)
+      vec4f_store(t, vec4f_div(v, vec4f_set1(sqrtf(len))));
+
+   vec[0] = t[0];
+   vec[1] = t[1];
+   vec[2] = t[2];
+}
+
+/* r, g, b in the first three lanes; the fourth carries the light's x along */
+static void ShadeVertexSIMD(float color[3], const float normal[3],
+      const struct SPLight *lights, uint32_t numLights)
+{
+   uint32_t i;
+   float t[4];
+   vec4f c = vec4f_load(&lights[numLights].r);
+
+   for (i = 0; i < numLights; i++)
+   {
+      float intensity = DotProduct(normal, &lights[i].x);
+      if (intensity < 0.0f)
+         intensity = 0.0f;
+      c = vec4f_add(c, vec4f_mul(vec4f_load(&lights[i].r), vec4f_set1(intensity)));
+   }
+
+   vec4f_store(t, vec4f_min(vec4f_set1(1.0f), c));
+   color[0] = t[0];
+   color[1] = t[1];
+   color[2] = t[2];
+}
+
+void (*MultMatrix)(float m0[4][4], float m1[4][4], float dest[4][4]) = MultMatrixSIMD;
+void (*TransformVertex)(float vtx[4], float mtx[4][4]) = TransformVertexSIMD;
+void (*TransformVectorNormalize)(float vec[3], float mtx[4][4]) = TransformVectorNormalizeSIMD;
+void (*ShadeVertex)(float color[3], const float normal[3],
+      const struct SPLight *lights, uint32_t numLights) = ShadeVertexSIMD;
+
+#else
+
+void (*MultMatrix)(float m0[4][4], float m1[4][4], float dest[4][4]) = MultMatrixC;
+void (*TransformVertex)(float vtx[4], float mtx[4][4]) = TransformVertexC;
+void (*TransformVectorNormalize)(float vec[3], float mtx[4][4]) = TransformVectorNormalizeC;
+void (*ShadeVertex)(float color[3], const float normal[3],
+      const struct SPLight *lights, uint32_t numLights) = ShadeVertexC;
+
+#endif
+
+bool MathInit(bool simd)
+{
+#ifdef MATH_SIMD
+   if (simd)
+   {
+      MultMatrix               = MultMatrixSIMD;
+      TransformVertex          = TransformVertexSIMD;
+      TransformVectorNormalize = TransformVectorNormalizeSIMD;
+      ShadeVertex              = ShadeVertexSIMD;
+      return true;
+   }
+#endif
+
+   MultMatrix               = MultMatrixC;
+   TransformVertex          = TransformVertexC;
+   TransformVectorNormalize = TransformVectorNormalizeC;
+   ShadeVertex              = ShadeVertexC;
+   return false;
+}
@@ -2,6 +2,8 @@
 #include "../plugin.h"
 #include "../RSP/RSP_state.h"
 
+/* The plugins keep their own matrices and vertices; the math behind these
+ * two is the shared MultMatrix and ClipVertexFlags from 3dmath.h. */
 void GSPCombineMatricesC(void)
 {
    switch (gfx_plugin)
@@ -0,0 +1,637 @@
+#include <stdint.h>
+#include <string.h>
+
+#include <retro_inline.h>
+
+#include "texture_convert.h"
+
+#if !defined(MSB_FIRST)
+#if defined(__SSE2__) || defined(ARCH_MIN_SSE2) || defined(_M_X64)
+#include <emmintrin.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+#define TC_SSE2 1
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TC_NEON 1
+#endif
+#endif
+
+/* Scalar texel decoders; these define the results the vector paths match. */
+
+static INLINE uint8_t tc_byte(const uint8_t *base, uint32_t addr, uint32_t swizzle)
+{
+   return base[addr ^ swizzle];
+}
+
+static INLINE uint32_t tc_pack(uint32_t r, uint32_t g, uint32_t b, uint32_t a, unsigned flags)
+{
+   if (flags & TC_BGRA)
+      return (a << 24) | (r << 16) | (g << 8) | b;
+   return (a << 24) | (b << 16) | (g << 8) | r;
+}
+
+static INLINE uint32_t tc_five2eight(uint32_t c, unsigned flags)
+{
+   if (flags & TC_5BIT_REPLICATE)
+      return (c << 3) | (c >> 2);
+   return (c * 527 + 23) >> 6;
+}
+
+static INLINE uint32_t tc_i4(uint32_t n)
+{
+   return (n * 17) * 0x01010101;
+}
+
+static INLINE uint32_t tc_ia31(uint32_t n)
+{
+   uint32_t t = n >> 1;
+   uint32_t i = (t << 5) | (t << 2) | (t >> 1);
+   uint32_t a = (n & 1) ? 0xFF : 0x00;
+   return (a << 24) | (i << 16) | (i << 8) | i;
+}
+
+static INLINE uint32_t tc_ia44(uint32_t b)
+{
+   uint32_t i = (b >> 4) * 17;
+   uint32_t a = (b & 0x0F) * 17;
+   return (a << 24) | (i << 16) | (i << 8) | i;
+}
+
+static INLINE uint32_t tc_5551(uint32_t c, unsigned flags)
+{
+   return tc_pack(tc_five2eight(c >> 11, flags),
+         tc_five2eight((c >> 6) & 0x1F, flags),
+         tc_five2eight((c >> 1) & 0x1F, flags),
+         (c & 1) ? 0xFF : 0x00, flags);
+}
+
+/* Same expression as YUVtoRGBA8888() in image_convert.h. */
+static INLINE uint32_t tc_yuv(uint8_t y, uint8_t u, uint8_t v)
+{
+   int32_t r = (int32_t)(y + (1.370705f * (v - 128)));
+   int32_t g = (int32_t)((y - (0.698001f * (v - 128)) - (0.337633f * (u - 128))));
+   int32_t b = (int32_t)(y + (1.732446f * (u - 128)));
+   if (r > 255) r = 255;
+   if (g > 255) g = 255;
+   if (b > 255) b = 255;
+   if (r < 0) r = 0;
+   if (g < 0) g = 0;
+   if (b < 0) b = 0;
+   return (0xffu << 24) | (b << 16) | (g << 8) | r;
+}
+
+/* Vector helpers. Every vector loop runs on qword aligned N64 addresses,
+ * where the swizzle only permutes bytes inside each 16-byte load. */
+
+#if defined(TC_SSE2)
+
+typedef __m128i tc_vec;
+
+static INLINE __m128i tc_load16(const uint8_t *p, uint32_t swizzle)
+{
+   __m128i v = _mm_loadu_si128((const __m128i*)p);
+   if (swizzle & 1)
+      v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+   if (swizzle & 2)
+      v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+   if (swizzle & 4)
+      v = _mm_shuffle_epi32(v, 0xB1);
+   return v;
+}
+
+/* 16 intensity and alpha bytes -> 16 texels of I, I, I, A */
+static INLINE void tc_store_iiia(uint32_t *dst, __m128i i, __m128i a)
+{
+   __m128i ii = _mm_unpacklo_epi8(i, i);
+   __m128i ia = _mm_unpacklo_epi8(i, a);
+   _mm_storeu_si128((__m128i*)(dst +  0), _mm_unpacklo_epi16(ii, ia));
+   _mm_storeu_si128((__m128i*)(dst +  4), _mm_unpackhi_epi16(ii, ia));
+   ii = _mm_unpackhi_epi8(i, i);
+   ia = _mm_unpackhi_epi8(i, a);
+   _mm_storeu_si128((__m128i*)(dst +  8), _mm_unpacklo_epi16(ii, ia));
+   _mm_storeu_si128((__m128i*)(dst + 12), _mm_unpackhi_epi16(ii, ia));
+}
+
+/* 8 texels of 16-bit channel values (0..255) -> memory order c0 c1 c2 c3 */
+static INLINE void tc_store_channels16(uint32_t *dst, __m128i c0, __m128i c1,
+      __m128i c2, __m128i c3)
+{
+   __m128i c02 = _mm_packus_epi16(c0, c2);
+   __m128i c13 = _mm_packus_epi16(c1, c3);
+   __m128i lo  = _mm_unpacklo_epi8(c02, c13);
+   __m128i hi  = _mm_unpackhi_epi8(c02, c13);
+   _mm_storeu_si128((__m128i*)(dst + 0), _mm_unpacklo_epi16(lo, hi));
+   _mm_storeu_si128((__m128i*)(dst + 4), _mm_unpackhi_epi16(lo, hi));
+}
+
+static INLINE __m128i tc_five2eight16(__m128i c, unsigned flags)
+{
+   if (flags & TC_5BIT_REPLICATE)
+      return _mm_or_si128(_mm_slli_epi16(c, 3), _mm_srli_epi16(c, 2));
+   return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(c, _mm_set1_epi16(527)),
+            _mm_set1_epi16(23)), 6);
+}
+
+/* 16 packed bytes -> 32 nibbles in texel order (high nibble first) */
+static INLINE void tc_nibbles(__m128i v, __m128i *n0, __m128i *n1)
+{
+   const __m128i mask = _mm_set1_epi8(0x0F);
+   __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+   __m128i lo = _mm_and_si128(v, mask);
+   *n0 = _mm_unpacklo_epi8(hi, lo);
+   *n1 = _mm_unpackhi_epi8(hi, lo);
+}
+
+static INLINE void tc_store_i4(uint32_t *dst, __m128i n)
+{
+   __m128i c = _mm_or_si128(n, _mm_slli_epi16(n, 4));
+   tc_store_iiia(dst, c, c);
+}
+
+static INLINE void tc_store_ia31(uint32_t *dst, __m128i n)
+{
+   __m128i t = _mm_and_si128(_mm_srli_epi16(n, 1), _mm_set1_epi8(0x07));
+   __m128i i = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(t, 5), _mm_slli_epi16(t, 2)),
+         _mm_and_si128(_mm_srli_epi16(t, 1), _mm_set1_epi8(0x03)));
+   __m128i a = _mm_cmpeq_epi8(_mm_and_si128(n, _mm_set1_epi8(1)), _mm_set1_epi8(1));
+   tc_store_iiia(dst, i, a);
+}
+
+#ifdef __SSSE3__
+struct tc_planes { __m128i p[4]; };
+
+static INLINE void tc_ci4_planes(struct tc_planes *planes, const uint32_t *palette)
+{
+   uint8_t bytes[4][16];
+   int k, c;
+   for (k = 0; k < 16; k++)
+      for (c = 0; c < 4; c++)
+         bytes[c][k] = (uint8_t)(palette[k] >> (c * 8));
+   for (c = 0; c < 4; c++)
+      planes->p[c] = _mm_loadu_si128((const __m128i*)bytes[c]);
+}
+
+static INLINE void tc_store_ci4(uint32_t *dst, __m128i n, const struct tc_planes *planes)
+{
+   __m128i b0 = _mm_shuffle_epi8(planes->p[0], n);
+   __m128i b1 = _mm_shuffle_epi8(planes->p[1], n);
+   __m128i b2 = _mm_shuffle_epi8(planes->p[2], n);
+   __m128i b3 = _mm_shuffle_epi8(planes->p[3], n);
+   __m128i lo01 = _mm_unpacklo_epi8(b0, b1), hi01 = _mm_unpackhi_epi8(b0, b1);
+   __m128i lo23 = _mm_unpacklo_epi8(b2, b3), hi23 = _mm_unpackhi_epi8(b2, b3);
+   _mm_storeu_si128((__m128i*)(dst +  0), _mm_unpacklo_epi16(lo01, lo23));
+   _mm_storeu_si128((__m128i*)(dst +  4), _mm_unpackhi_epi16(lo01, lo23));
+   _mm_storeu_si128((__m128i*)(dst +  8), _mm_unpacklo_epi16(hi01, hi23));
+   _mm_storeu_si128((__m128i*)(dst + 12), _mm_unpackhi_epi16(hi01, hi23));
+}
+#endif
+
+#elif defined(TC_NEON)
+
+typedef uint8x16_t tc_vec;
+
+static INLINE uint8x16_t tc_load16(const uint8_t *p, uint32_t swizzle)
+{
+   uint8x16_t v = vld1q_u8(p);
+   if (swizzle & 1)
+      v = vrev16q_u8(v);
+   if (swizzle & 2)
+      v = vreinterpretq_u8_u16(vrev32q_u16(vreinterpretq_u16_u8(v)));
+   if (swizzle & 4)
+      v = vreinterpretq_u8_u32(vrev64q_u32(vreinterpretq_u32_u8(v)));
+   return v;
+}
+
+static INLINE void tc_store_iiia(uint32_t *dst, uint8x16_t i, uint8x16_t a)
+{
+   uint8x16x4_t t;
+   t.val[0] = i;
+   t.val[1] = i;
+   t.val[2] = i;
+   t.val[3] = a;
+   vst4q_u8((uint8_t*)dst, t);
+}
+
+static INLINE void tc_nibbles(uint8x16_t v, uint8x16_t *n0, uint8x16_t *n1)
+{
+   uint8x16x2_t z = vzipq_u8(vshrq_n_u8(v, 4), vandq_u8(v, vdupq_n_u8(0x0F)));
+   *n0 = z.val[0];
+   *n1 = z.val[1];
+}
+
+static INLINE void tc_store_i4(uint32_t *dst, uint8x16_t n)
+{
+   uint8x16_t c = vorrq_u8(n, vshlq_n_u8(n, 4));
+   tc_store_iiia(dst, c, c);
+}
+
+static INLINE void tc_store_ia31(uint32_t *dst, uint8x16_t n)
+{
+   uint8x16_t t = vshrq_n_u8(n, 1);
+   uint8x16_t i = vorrq_u8(vorrq_u8(vshlq_n_u8(t, 5), vshlq_n_u8(t, 2)), vshrq_n_u8(t, 1));
+   uint8x16_t a = vtstq_u8(n, vdupq_n_u8(1));
+   tc_store_iiia(dst, i, a);
+}
+
+static INLINE uint16x8_t tc_five2eight16(uint16x8_t c, unsigned flags)
+{
+   if (flags & TC_5BIT_REPLICATE)
+      return vorrq_u16(vshlq_n_u16(c, 3), vshrq_n_u16(c, 2));
+   return vshrq_n_u16(vmlaq_n_u16(vdupq_n_u16(23), c, 527), 6);
+}
+
+static INLINE uint8x16_t tc_lookup16(uint8x16_t table, uint8x16_t idx)
+{
+#ifdef __aarch64__
+   return vqtbl1q_u8(table, idx);
+#else
+   uint8x8x2_t t;
+   t.val[0] = vget_low_u8(table);
+   t.val[1] = vget_high_u8(table);
+   return vcombine_u8(vtbl2_u8(t, vget_low_u8(idx)), vtbl2_u8(t, vget_high_u8(idx)));
+#endif
+}
+
+struct tc_planes { uint8x16_t p[4]; };
+
+static INLINE void tc_ci4_planes(struct tc_planes *planes, const uint32_t *palette)
+{
+   uint8_t bytes[4][16];
+   int k, c;
+   for (k = 0; k < 16; k++)
+      for (c = 0; c < 4; c++)
+         bytes[c][k] = (uint8_t)(palette[k] >> (c * 8));
+   for (c = 0; c < 4; c++)
+      planes->p[c] = vld1q_u8(bytes[c]);
+}
+
+static INLINE void tc_store_ci4(uint32_t *dst, uint8x16_t n, const struct tc_planes *planes)
+{
+   uint8x16x4_t t;
+   t.val[0] = tc_lookup16(planes->p[0], n);
+   t.val[1] = tc_lookup16(planes->p[1], n);
+   t.val[2] = tc_lookup16(planes->p[2], n);
+   t.val[3] = tc_lookup16(planes->p[3], n);
+   vst4q_u8((uint8_t*)dst, t);
+}
+
+#endif
+
+/* 4-bit rows: two texels per byte, high nibble first. Each loop below
+ * first walks to a qword boundary with the scalar decoder. */
+
+#define TC_ROW4_HEAD(decode) \
+   while (count && (offset & 7)) \
+   { \
+      uint8_t b = tc_byte(base, offset++, swizzle); \
+      *dst++ = decode(b >> 4); \
+      if (--count == 0) \
+         return; \
+      *dst++ = decode(b & 0x0F); \
+      count--; \
+   }
+
+#define TC_ROW4_TAIL(decode) \
+   while (count) \
+   { \
+      uint8_t b = tc_byte(base, offset++, swizzle); \
+      *dst++ = decode(b >> 4); \
+      if (--count == 0) \
+         return; \
+      *dst++ = decode(b & 0x0F); \
+      count--; \
+   }
+
+void tc_row_i4(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count)
+{
+   TC_ROW4_HEAD(tc_i4)
+#if defined(TC_SSE2) || defined(TC_NEON)
+   for (; count >= 32; count -= 32, offset += 16, dst += 32)
+   {
+      tc_vec n0, n1;
+      tc_nibbles(tc_load16(base + offset, swizzle), &n0, &n1);
+      tc_store_i4(dst, n0);
+      tc_store_i4(dst + 16, n1);
+   }
+#endif
+   TC_ROW4_TAIL(tc_i4)
+}
+
+void tc_row_ia31(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count)
+{
+   TC_ROW4_HEAD(tc_ia31)
+#if defined(TC_SSE2) || defined(TC_NEON)
+   for (; count >= 32; count -= 32, offset += 16, dst += 32)
+   {
+      tc_vec n0, n1;
+      tc_nibbles(tc_load16(base + offset, swizzle), &n0, &n1);
+      tc_store_ia31(dst, n0);
+      tc_store_ia31(dst + 16, n1);
+   }
+#endif
+   TC_ROW4_TAIL(tc_ia31)
+}
+
+void tc_row_ci4(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count, const uint32_t *palette)
+{
+#define TC_CI4(n) palette[n]
+   TC_ROW4_HEAD(TC_CI4)
+#if (defined(TC_SSE2) && defined(__SSSE3__)) || defined(TC_NEON)
+   if (count >= 32)
+   {
+      struct tc_planes planes;
+      tc_ci4_planes(&planes, palette);
+      for (; count >= 32; count -= 32, offset += 16, dst += 32)
+      {
+         tc_vec n0, n1;
+         tc_nibbles(tc_load16(base + offset, swizzle), &n0, &n1);
+         tc_store_ci4(dst, n0, &planes);
+         tc_store_ci4(dst + 16, n1, &planes);
+      }
+   }
+#endif
+   TC_ROW4_TAIL(TC_CI4)
+#undef TC_CI4
+}
+
+#undef TC_ROW4_HEAD
+#undef TC_ROW4_TAIL
+
+/* 8-bit rows */
+
+void tc_row_i8(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count)
+{
+   while (count && (offset & 7))
+   {
+      *dst++ = tc_byte(base, offset++, swizzle) * 0x01010101u;
+      count--;
+   }
+#if defined(TC_SSE2) || defined(TC_NEON)
+   for (; count >= 16; count -= 16, offset += 16, dst += 16)
+   {
+      tc_vec v = tc_load16(base + offset, swizzle);
+      tc_store_iiia(dst, v, v);
+   }
+#endif
+   while (count--)
+      *dst++ = tc_byte(base, offset++, swizzle) * 0x01010101u;
+}
+
+void tc_row_ia44(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count)
+{
+   while (count && (offset & 7))
+   {
+      *dst++ = tc_ia44(tc_byte(base, offset++, swizzle));
+      count--;
+   }
+#if defined(TC_SSE2)
+   for (; count >= 16; count -= 16, offset += 16, dst += 16)
+   {
+      const __m128i mask = _mm_set1_epi8(0x0F);
+      __m128i v = tc_load16(base + offset, swizzle);
+      __m128i i = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+      __m128i a = _mm_and_si128(v, mask);
+      tc_store_iiia(dst, _mm_or_si128(i, _mm_slli_epi16(i, 4)),
+            _mm_or_si128(a, _mm_slli_epi16(a, 4)));
+   }
+#elif defined(TC_NEON)
+   for (; count >= 16; count -= 16, offset += 16, dst += 16)
+   {
+      uint8x16_t v = tc_load16(base + offset, swizzle);
+      uint8x16_t i = vshrq_n_u8(v, 4);
+      uint8x16_t a = vandq_u8(v, vdupq_n_u8(0x0F));
+      tc_store_iiia(dst, vorrq_u8(i, vshlq_n_u8(i, 4)), vorrq_u8(a, vshlq_n_u8(a, 4)));
+   }
+#endif
+   while (count--)
+      *dst++ = tc_ia44(tc_byte(base, offset++, swizzle));
+}
+
+void tc_row_ci8(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count, const uint32_t *palette)
+{
+   /* A 256 entry table is beyond byte shuffles; unrolling keeps the
+    * loads independent. */
+   while (count && (offset & 7))
+   {
+      *dst++ = palette[tc_byte(base, offset++, swizzle)];
+      count--;
+   }
+   for (; count >= 8; count -= 8, offset += 8, dst += 8)
+   {
+      const uint8_t *p = base + offset;
+      dst[0] = palette[p[0 ^ swizzle]];
+      dst[1] = palette[p[1 ^ swizzle]];
+      dst[2] = palette[p[2 ^ swizzle]];
+      dst[3] = palette[p[3 ^ swizzle]];
+      dst[4] = palette[p[4 ^ swizzle]];
+      dst[5] = palette[p[5 ^ swizzle]];
+      dst[6] = palette[p[6 ^ swizzle]];
+      dst[7] = palette[p[7 ^ swizzle]];
+   }
+   while (count--)
+      *dst++ = palette[tc_byte(base, offset++, swizzle)];
+}
+
+/* 16-bit rows; texel x is the big-endian halfword at N64 byte 2x. */
+
+void tc_row_ia88(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count)
+{
+#define TC_IA88() \
+   { \
+      uint32_t i = tc_byte(base, offset, swizzle); \
+      uint32_t a = tc_byte(base, offset + 1, swizzle); \
+      *dst++ = (a << 24) | (i * 0x010101u); \
+      offset += 2; \
+   }
+   while (count && (offset & 7))
+   {
+      TC_IA88()
+      count--;
+   }
+#if defined(TC_SSE2)
+   for (; count >= 8; count -= 8, offset += 16, dst += 8)
+   {
+      __m128i v  = tc_load16(base + offset, swizzle);
+      __m128i i  = _mm_and_si128(v, _mm_set1_epi16(0xFF));
+      __m128i ii = _mm_or_si128(i, _mm_slli_epi16(i, 8));
+      _mm_storeu_si128((__m128i*)(dst + 0), _mm_unpacklo_epi16(ii, v));
+      _mm_storeu_si128((__m128i*)(dst + 4), _mm_unpackhi_epi16(ii, v));
+   }
+#elif defined(TC_NEON)
+   for (; count >= 8; count -= 8, offset += 16, dst += 8)
+   {
+      uint8x16_t v = tc_load16(base + offset, swizzle);
+      uint8x8x2_t ia = vuzp_u8(vget_low_u8(v), vget_high_u8(v));
+      uint8x8x4_t t;
+      t.val[0] = ia.val[0];
+      t.val[1] = ia.val[0];
+      t.val[2] = ia.val[0];
+      t.val[3] = ia.val[1];
+      vst4_u8((uint8_t*)dst, t);
+   }
+#endif
+   while (count--)
+      TC_IA88()
+#undef TC_IA88
+}
+
+void tc_row_rgba5551(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count, unsigned flags)
+{
+#define TC_5551() \
+   { \
+      uint32_t c = (tc_byte(base, offset, swizzle) << 8) | tc_byte(base, offset + 1, swizzle); \
+      *dst++ = tc_5551(c, flags); \
+      offset += 2; \
+   }
+   while (count && (offset & 7))
+   {
+      TC_5551()
+      count--;
+   }
+#if defined(TC_SSE2)
+   for (; count >= 8; count -= 8, offset += 16, dst += 8)
+   {
+      const __m128i mask = _mm_set1_epi16(0x1F);
+      /* big-endian halfwords */
+      __m128i v = tc_load16(base + offset, swizzle ^ 1);
+      __m128i r = tc_five2eight16(_mm_srli_epi16(v, 11), flags);
+      __m128i g = tc_five2eight16(_mm_and_si128(_mm_srli_epi16(v, 6), mask), flags);
+      __m128i b = tc_five2eight16(_mm_and_si128(_mm_srli_epi16(v, 1), mask), flags);
+      __m128i a = _mm_srli_epi16(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(1)),
+               _mm_set1_epi16(1)), 8);
+      if (flags & TC_BGRA)
+         tc_store_channels16(dst, b, g, r, a);
+      else
+         tc_store_channels16(dst, r, g, b, a);
+   }
+#elif defined(TC_NEON)
+   for (; count >= 8; count -= 8, offset += 16, dst += 8)
+   {
+      const uint16x8_t mask = vdupq_n_u16(0x1F);
+      uint16x8_t v = vreinterpretq_u16_u8(tc_load16(base + offset, swizzle ^ 1));
+      uint8x8_t r = vmovn_u16(tc_five2eight16(vshrq_n_u16(v, 11), flags));
+      uint8x8_t g = vmovn_u16(tc_five2eight16(vandq_u16(vshrq_n_u16(v, 6), mask), flags));
+      uint8x8_t b = vmovn_u16(tc_five2eight16(vandq_u16(vshrq_n_u16(v, 1), mask), flags));
+      uint8x8x4_t t;
+      t.val[0] = (flags & TC_BGRA) ? b : r;
+      t.val[1] = g;
+      t.val[2] = (flags & TC_BGRA) ? r : b;
+      t.val[3] = vmovn_u16(vtstq_u16(v, vdupq_n_u16(1)));
+      vst4_u8((uint8_t*)dst, t);
+   }
+#endif
+   while (count--)
+      TC_5551()
+#undef TC_5551
+}
+
+/* 32-bit rows: R, G, B, A bytes */
+
+void tc_row_rgba8888(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count, unsigned flags)
+{
+#define TC_8888() \
+   { \
+      *dst++ = tc_pack(tc_byte(base, offset, swizzle), tc_byte(base, offset + 1, swizzle), \
+            tc_byte(base, offset + 2, swizzle), tc_byte(base, offset + 3, swizzle), flags); \
+      offset += 4; \
+   }
+   while (count && (offset & 7))
+   {
+      TC_8888()
+      count--;
+   }
+#if defined(TC_SSE2)
+   for (; count >= 4; count -= 4, offset += 16, dst += 4)
+   {
+      __m128i v = tc_load16(base + offset, swizzle);
+      if (flags & TC_BGRA)
+      {
+         const __m128i lo = _mm_set1_epi32(0xFF);
+         v = _mm_or_si128(_mm_and_si128(v, _mm_set1_epi32(0xFF00FF00)),
+               _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), lo),
+                  _mm_slli_epi32(_mm_and_si128(v, lo), 16)));
+      }
+      _mm_storeu_si128((__m128i*)dst, v);
+   }
+#elif defined(TC_NEON)
+   for (; count >= 4; count -= 4, offset += 16, dst += 4)
+   {
+      uint32x4_t v = vreinterpretq_u32_u8(tc_load16(base + offset, swizzle));
+      if (flags & TC_BGRA)
+      {
+         const uint32x4_t lo = vdupq_n_u32(0xFF);
+         v = vorrq_u32(vandq_u32(v, vdupq_n_u32(0xFF00FF00)),
+               vorrq_u32(vandq_u32(vshrq_n_u32(v, 16), lo), vshlq_n_u32(vandq_u32(v, lo), 16)));
+      }
+      vst1q_u32(dst, v);
+   }
+#endif
+   while (count--)
+      TC_8888()
+#undef TC_8888
+}
+
+void tc_row_yuv(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count)
+{
+#define TC_YUV() \
+   { \
+      uint8_t u  = tc_byte(base, offset + 0, swizzle); \
+      uint8_t y0 = tc_byte(base, offset + 1, swizzle); \
+      uint8_t v  = tc_byte(base, offset + 2, swizzle); \
+      uint8_t y1 = tc_byte(base, offset + 3, swizzle); \
+      *dst++ = tc_yuv(y0, u, v); \
+      *dst++ = tc_yuv(y1, u, v); \
+      offset += 4; \
+   }
+   count >>= 1;
+   while (count && (offset & 7))
+   {
+      TC_YUV()
+      count--;
+   }
+#if defined(TC_SSE2)
+   /* Same single-rounding float ops in the same order as tc_yuv(). Not
+    * done for NEON: compilers there contract the scalar code into fused
+    * multiply-adds, which a vector path could not reproduce portably. */
+   for (; count >= 4; count -= 4, offset += 16, dst += 8)
+   {
+      const __m128i byte = _mm_set1_epi32(0xFF);
+      const __m128i bias = _mm_set1_epi32(128);
+      __m128i w  = tc_load16(base + offset, swizzle);
+      __m128  fu = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(w, byte), bias));
+      __m128  fv = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(w, 16), byte), bias));
+      __m128  y0 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(w, 8), byte));
+      __m128  y1 = _mm_cvtepi32_ps(_mm_srli_epi32(w, 24));
+      __m128  rv = _mm_mul_ps(_mm_set1_ps(1.370705f), fv);
+      __m128  gv = _mm_mul_ps(_mm_set1_ps(0.698001f), fv);
+      __m128  gu = _mm_mul_ps(_mm_set1_ps(0.337633f), fu);
+      __m128  bu = _mm_mul_ps(_mm_set1_ps(1.732446f), fu);
+      __m128i r0 = _mm_cvttps_epi32(_mm_add_ps(y0, rv));
+      __m128i r1 = _mm_cvttps_epi32(_mm_add_ps(y1, rv));
+      __m128i g0 = _mm_cvttps_epi32(_mm_sub_ps(_mm_sub_ps(y0, gv), gu));
+      __m128i g1 = _mm_cvttps_epi32(_mm_sub_ps(_mm_sub_ps(y1, gv), gu));
+      __m128i b0 = _mm_cvttps_epi32(_mm_add_ps(y0, bu));
+      __m128i b1 = _mm_cvttps_epi32(_mm_add_ps(y1, bu));
+      /* interleave Y0/Y1 texels and saturate to 0..255 on the way down */
+      __m128i r  = _mm_packs_epi32(_mm_unpacklo_epi32(r0, r1), _mm_unpackhi_epi32(r0, r1));
+      __m128i g  = _mm_packs_epi32(_mm_unpacklo_epi32(g0, g1), _mm_unpackhi_epi32(g0, g1));
+      __m128i b  = _mm_packs_epi32(_mm_unpacklo_epi32(b0, b1), _mm_unpackhi_epi32(b0, b1));
+      tc_store_channels16(dst, r, g, b, _mm_set1_epi16(0xFF));
+   }
+#endif
+   while (count--)
+      TC_YUV()
+#undef TC_YUV
+}
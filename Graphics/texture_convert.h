@@ -0,0 +1,62 @@
+#ifndef _GRAPHICS_TEXTURE_CONVERT_H
+#define _GRAPHICS_TEXTURE_CONVERT_H
+
+/* Row decoders from N64 texel formats to 32-bit RGBA, shared by the HLE
+ * plugins.
+ *
+ * A row is addressed in N64 byte order: byte n of the texture lives at
+ * base[n ^ swizzle]. TMEM rows use swizzle 0 (4 on odd lines), RDRAM uses
+ * 3 (7 on odd lines of swapped loads), and host arrays of 16-bit values
+ * use 1. offset is the N64 byte address of the first texel; 4-bit rows
+ * start on the high nibble.
+ *
+ * Outputs are bit-exact with the scalar per-texel code; the SSE2/NEON
+ * paths only handle whole qwords and leave heads and tails to it. */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Output uint32 as A<<24 | R<<16 | G<<8 | B instead of A<<24 | B<<16 | G<<8 | R */
+#define TC_BGRA              (1 << 0)
+/* Expand 5-bit channels as (c << 3) | (c >> 2) instead of round(c * 255 / 31) */
+#define TC_5BIT_REPLICATE    (1 << 1)
+
+/* I4: intensity in every channel, c * 17 */
+void tc_row_i4(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count);
+/* IA4 (3-bit intensity, 1-bit alpha) */
+void tc_row_ia31(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count);
+/* I8: the byte in every channel */
+void tc_row_i8(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count);
+/* IA8 (4-bit intensity, 4-bit alpha) */
+void tc_row_ia44(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count);
+/* IA16 (8-bit intensity, 8-bit alpha) */
+void tc_row_ia88(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count);
+/* RGBA16 (5551) */
+void tc_row_rgba5551(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count, unsigned flags);
+/* RGBA32 */
+void tc_row_rgba8888(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count, unsigned flags);
+/* YUV16: U Y0 V Y1 per texel pair, converted like YUVtoRGBA8888(). count is
+ * rounded down to whole pairs. */
+void tc_row_yuv(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count);
+/* CI4/CI8 through an already converted 16/256 entry palette */
+void tc_row_ci4(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count, const uint32_t *palette);
+void tc_row_ci8(uint32_t *dst, const uint8_t *base, uint32_t offset,
+      uint32_t swizzle, unsigned count, const uint32_t *palette);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef _GRAPHICS_VEC4F_H
+#define _GRAPHICS_VEC4F_H
+
+/* Four-wide float helpers shared by the HLE vertex pipelines.
+ *
+ * Every operation maps to exactly one IEEE operation per lane, so a
+ * SoA path written with these helpers produces the same bits as the
+ * scalar AoS code doing the same operations in the same order. */
+
+#include <math.h>
+#include <stdint.h>
+
+#include <retro_inline.h>
+
+#if defined(__SSE2__) || defined(ARCH_MIN_SSE2)
+#include <xmmintrin.h>
+#define VEC4F_SSE 1
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VEC4F_NEON 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(VEC4F_SSE)
+typedef __m128 vec4f;
+#elif defined(VEC4F_NEON)
+typedef float32x4_t vec4f;
+#else
+typedef struct { float v[4]; } vec4f;
+#endif
+
+#if defined(VEC4F_SSE)
+
+static INLINE vec4f vec4f_load(const float *p)  { return _mm_loadu_ps(p); }
+static INLINE void vec4f_store(float *p, vec4f a) { _mm_storeu_ps(p, a); }
+static INLINE vec4f vec4f_set1(float f) { return _mm_set1_ps(f); }
+static INLINE vec4f vec4f_add(vec4f a, vec4f b) { return _mm_add_ps(a, b); }
+static INLINE vec4f vec4f_sub(vec4f a, vec4f b) { return _mm_sub_ps(a, b); }
+static INLINE vec4f vec4f_mul(vec4f a, vec4f b) { return _mm_mul_ps(a, b); }
+static INLINE vec4f vec4f_div(vec4f a, vec4f b) { return _mm_div_ps(a, b); }
+static INLINE vec4f vec4f_sqrt(vec4f a) { return _mm_sqrt_ps(a); }
+static INLINE vec4f vec4f_neg(vec4f a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+/* a < b ? a : b, per lane (same NaN behaviour as std::min(b, a)) */
+static INLINE vec4f vec4f_min(vec4f a, vec4f b) { return _mm_min_ps(a, b); }
+/* a > b ? a : b, per lane */
+static INLINE vec4f vec4f_max(vec4f a, vec4f b) { return _mm_max_ps(a, b); }
+static INLINE vec4f vec4f_cmpgt(vec4f a, vec4f b) { return _mm_cmpgt_ps(a, b); }
+static INLINE vec4f vec4f_cmplt(vec4f a, vec4f b) { return _mm_cmplt_ps(a, b); }
+static INLINE vec4f vec4f_cmpneq(vec4f a, vec4f b) { return _mm_cmpneq_ps(a, b); }
+/* mask ? a : b, per lane */
+static INLINE vec4f vec4f_select(vec4f mask, vec4f a, vec4f b)
+{
+   return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+static INLINE int vec4f_movemask(vec4f mask) { return _mm_movemask_ps(mask); }
+static INLINE void vec4f_transpose(vec4f *r0, vec4f *r1, vec4f *r2, vec4f *r3)
+{
+   _MM_TRANSPOSE4_PS(*r0, *r1, *r2, *r3);
+}
+
+#elif defined(VEC4F_NEON)
+
+static INLINE vec4f vec4f_load(const float *p)  { return vld1q_f32(p); }
+static INLINE void vec4f_store(float *p, vec4f a) { vst1q_f32(p, a); }
+static INLINE vec4f vec4f_set1(float f) { return vdupq_n_f32(f); }
+static INLINE vec4f vec4f_add(vec4f a, vec4f b) { return vaddq_f32(a, b); }
+static INLINE vec4f vec4f_sub(vec4f a, vec4f b) { return vsubq_f32(a, b); }
+static INLINE vec4f vec4f_mul(vec4f a, vec4f b) { return vmulq_f32(a, b); }
+static INLINE vec4f vec4f_neg(vec4f a) { return vnegq_f32(a); }
+#ifdef __aarch64__
+static INLINE vec4f vec4f_div(vec4f a, vec4f b) { return vdivq_f32(a, b); }
+static INLINE vec4f vec4f_sqrt(vec4f a) { return vsqrtq_f32(a); }
+#else
+/* ARMv7 NEON has only reciprocal estimates; keep results exact. */
+static INLINE vec4f vec4f_div(vec4f a, vec4f b)
+{
+   float fa[4], fb[4];
+   vst1q_f32(fa, a);
+   vst1q_f32(fb, b);
+   fa[0] /= fb[0]; fa[1] /= fb[1]; fa[2] /= fb[2]; fa[3] /= fb[3];
+   return vld1q_f32(fa);
+}
+static INLINE vec4f vec4f_sqrt(vec4f a)
+{
+   float fa[4];
+   vst1q_f32(fa, a);
+   fa[0] = sqrtf(fa[0]); fa[1] = sqrtf(fa[1]);
+   fa[2] = sqrtf(fa[2]); fa[3] = sqrtf(fa[3]);
+   return vld1q_f32(fa);
+}
+#endif
+static INLINE vec4f vec4f_cmpgt(vec4f a, vec4f b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+static INLINE vec4f vec4f_cmplt(vec4f a, vec4f b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+static INLINE vec4f vec4f_cmpneq(vec4f a, vec4f b) { return vreinterpretq_f32_u32(vmvnq_u32(vceqq_f32(a, b))); }
+static INLINE vec4f vec4f_select(vec4f mask, vec4f a, vec4f b)
+{
+   return vbslq_f32(vreinterpretq_u32_f32(mask), a, b);
+}
+static INLINE vec4f vec4f_min(vec4f a, vec4f b) { return vec4f_select(vec4f_cmplt(a, b), a, b); }
+static INLINE vec4f vec4f_max(vec4f a, vec4f b) { return vec4f_select(vec4f_cmpgt(a, b), a, b); }
+static INLINE int vec4f_movemask(vec4f mask)
+{
+   uint32_t m[4];
+   vst1q_u32(m, vreinterpretq_u32_f32(mask));
+   return (m[0] >> 31) | ((m[1] >> 31) << 1) | ((m[2] >> 31) << 2) | ((m[3] >> 31) << 3);
+}
+static INLINE void vec4f_transpose(vec4f *r0, vec4f *r1, vec4f *r2, vec4f *r3)
+{
+   float32x4x2_t t01 = vtrnq_f32(*r0, *r1);
+   float32x4x2_t t23 = vtrnq_f32(*r2, *r3);
+   *r0 = vcombine_f32(vget_low_f32(t01.val[0]),  vget_low_f32(t23.val[0]));
+   *r1 = vcombine_f32(vget_low_f32(t01.val[1]),  vget_low_f32(t23.val[1]));
+   *r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+   *r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+
+#else
+
+#define VEC4F_OP(name, expr) \
+static INLINE vec4f name(vec4f a, vec4f b) \
+{ \
+   vec4f r; \
+   int i; \
+   for (i = 0; i < 4; i++) \
+      r.v[i] = expr; \
+   return r; \
+}
+
+static INLINE vec4f vec4f_load(const float *p)
+{
+   vec4f r;
+   r.v[0] = p[0]; r.v[1] = p[1]; r.v[2] = p[2]; r.v[3] = p[3];
+   return r;
+}
+static INLINE void vec4f_store(float *p, vec4f a)
+{
+   p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3];
+}
+static INLINE vec4f vec4f_set1(float f)
+{
+   vec4f r;
+   r.v[0] = r.v[1] = r.v[2] = r.v[3] = f;
+   return r;
+}
+VEC4F_OP(vec4f_add, a.v[i] + b.v[i])
+VEC4F_OP(vec4f_sub, a.v[i] - b.v[i])
+VEC4F_OP(vec4f_mul, a.v[i] * b.v[i])
+VEC4F_OP(vec4f_div, a.v[i] / b.v[i])
+VEC4F_OP(vec4f_min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+VEC4F_OP(vec4f_max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+/* masks are stored as +/-0.0f sign patterns: negative means set */
+VEC4F_OP(vec4f_cmpgt, a.v[i] > b.v[i] ? -1.0f : 0.0f)
+VEC4F_OP(vec4f_cmplt, a.v[i] < b.v[i] ? -1.0f : 0.0f)
+VEC4F_OP(vec4f_cmpneq, a.v[i] != b.v[i] ? -1.0f : 0.0f)
+#undef VEC4F_OP
+
+static INLINE vec4f vec4f_sqrt(vec4f a)
+{
+   vec4f r;
+   int i;
+   for (i = 0; i < 4; i++)
+      r.v[i] = sqrtf(a.v[i]);
+   return r;
+}
+static INLINE vec4f vec4f_neg(vec4f a)
+{
+   vec4f r;
+   int i;
+   for (i = 0; i < 4; i++)
+      r.v[i] = -a.v[i];
+   return r;
+}
+static INLINE vec4f vec4f_select(vec4f mask, vec4f a, vec4f b)
+{
+   vec4f r;
+   int i;
+   for (i = 0; i < 4; i++)
+      r.v[i] = mask.v[i] < 0.0f ? a.v[i] : b.v[i];
+   return r;
+}
+static INLINE int vec4f_movemask(vec4f mask)
+{
+   return (mask.v[0] < 0.0f) | ((mask.v[1] < 0.0f) << 1) |
+      ((mask.v[2] < 0.0f) << 2) | ((mask.v[3] < 0.0f) << 3);
+}
+static INLINE void vec4f_transpose(vec4f *r0, vec4f *r1, vec4f *r2, vec4f *r3)
+{
+   vec4f *r[4];
+   int i, j;
+   r[0] = r0; r[1] = r1; r[2] = r2; r[3] = r3;
+   for (i = 0; i < 4; i++)
+      for (j = i + 1; j < 4; j++)
+      {
+         float t    = r[i]->v[j];
+         r[i]->v[j] = r[j]->v[i];
+         r[j]->v[i] = t;
+      }
+}
+
+#endif
+
+/* a * b + c without fused rounding, so results match the scalar code. */
+static INLINE vec4f vec4f_madd(vec4f a, vec4f b, vec4f c)
+{
+   return vec4f_add(vec4f_mul(a, b), c);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,25 +0,0 @@
-#include <math.h>
-#include <string.h>
-
-void MultMatrix( float m0[4][4], float m1[4][4], float dest[4][4])
-{
-   dest[0][0] = m0[0][0]*m1[0][0] + m0[1][0]*m1[0][1] + m0[2][0]*m1[0][2] + m0[3][0]*m1[0][3];
-   dest[1][0] = m0[0][0]*m1[1][0] + m0[1][0]*m1[1][1] + m0[2][0]*m1[1][2] + m0[3][0]*m1[1][3];
-   dest[2][0] = m0[0][0]*m1[2][0] + m0[1][0]*m1[2][1] + m0[2][0]*m1[2][2] + m0[3][0]*m1[2][3];
-   dest[3][0] = m0[3][0]*m1[3][3] + m0[2][0]*m1[3][2] + m0[1][0]*m1[3][1] + m0[0][0]*m1[3][0];
-
-   dest[0][1] = m0[0][1]*m1[0][0] + m0[1][1]*m1[0][1] + m0[2][1]*m1[0][2] + m0[3][1]*m1[0][3];
-   dest[1][1] = m0[0][1]*m1[1][0] + m0[1][1]*m1[1][1] + m0[2][1]*m1[1][2] + m0[3][1]*m1[1][3];
-   dest[2][1] = m0[0][1]*m1[2][0] + m0[1][1]*m1[2][1] + m0[2][1]*m1[2][2] + m0[3][1]*m1[2][3];
-   dest[3][1] = m0[3][1]*m1[3][3] + m0[2][1]*m1[3][2] + m0[1][1]*m1[3][1] + m0[0][1]*m1[3][0];
-
-   dest[0][2] = m0[0][2]*m1[0][0] + m0[1][2]*m1[0][1] + m0[2][2]*m1[0][2] + m0[3][2]*m1[0][3];
-   dest[1][2] = m0[0][2]*m1[1][0] + m0[1][2]*m1[1][1] + m0[2][2]*m1[1][2] + m0[3][2]*m1[1][3];
-   dest[2][2] = m0[0][2]*m1[2][0] + m0[1][2]*m1[2][1] + m0[2][2]*m1[2][2] + m0[3][2]*m1[2][3];
-   dest[3][2] = m0[3][2]*m1[3][3] + m0[2][2]*m1[3][2] + m0[1][2]*m1[3][1] + m0[0][2]*m1[3][0];
-
-   dest[0][3] = m0[0][3]*m1[0][0] + m0[1][3]*m1[0][1] + m0[2][3]*m1[0][2] + m0[3][3]*m1[0][3];
-   dest[1][3] = m0[0][3]*m1[1][0] + m0[1][3]*m1[1][1] + m0[2][3]*m1[1][2] + m0[3][3]*m1[1][3];
-   dest[2][3] = m0[0][3]*m1[2][0] + m0[1][3]*m1[2][1] + m0[2][3]*m1[2][2] + m0[3][3]*m1[2][3];
-   dest[3][3] = m0[3][3]*m1[3][3] + m0[2][3]*m1[3][2] + m0[1][3]*m1[3][1] + m0[0][3]*m1[3][0];
-}
@@ -13,13 +13,9 @@
 extern "C" {
 #endif
 
-void MultMatrix( float m0[4][4], float m1[4][4], float dest[4][4]);
-
 static INLINE void MultMatrix2( float m0[4][4], float m1[4][4] )
 {
-    float dst[4][4];
-    MultMatrix(m0, m1, dst);
-    memcpy( m0, dst, sizeof(float) * 16 );
+    MultMatrix(m0, m1, m0);
 }
 
 static INLINE void Transpose3x3Matrix( float mtx[4][4] )
@@ -1,5 +1,8 @@
 #include <stdint.h>
 
+#include "CRC.h"
+#include "../../libretro/crc32_accel.h"
+
 uint32_t Hash_CalculatePalette(void *buffer, uint32_t count)
 {
    unsigned int i;
@@ -17,18 +20,9 @@ uint32_t Hash_CalculatePalette(void *buffer, uint32_t count)
    return hash;
 }
 
-uint32_t Hash_Calculate(uint32_t hash, void *buffer, uint32_t count)
+/* Texture cache keys only, never persisted, so this follows whatever
+ * CRC-32C path the CPU offers. */
+uint32_t Hash_Calculate(uint32_t hash, const void *buffer, uint32_t count)
 {
-   unsigned int i;
-   uint32_t *data = (uint32_t *) buffer;
-   count /= 4;
-   for(i = 0; i < count; ++i) {
-      hash += data[i];
-      hash += (hash << 10);
-      hash ^= (hash >> 6);
-   }
-   hash += (hash << 3);
-   hash ^= (hash >> 11);
-   hash += (hash << 15);
-   return hash;
+   return crc32_accel_c(hash, buffer, count & ~3);
 }
@@ -125,16 +125,7 @@ void gln64gSP4Triangles(const int32_t v00, const int32_t v01, const int32_t v02,
 
 static void gln64gSPTransformVertex_default(float vtx[4], float mtx[4][4])
 {
-   float x, y, z, w;
-   x = vtx[0];
-   y = vtx[1];
-   z = vtx[2];
-   w = vtx[3];
-
-   vtx[0] = x * mtx[0][0] + y * mtx[1][0] + z * mtx[2][0] + mtx[3][0];
-   vtx[1] = x * mtx[0][1] + y * mtx[1][1] + z * mtx[2][1] + mtx[3][1];
-   vtx[2] = x * mtx[0][2] + y * mtx[1][2] + z * mtx[2][2] + mtx[3][2];
-   vtx[3] = x * mtx[0][3] + y * mtx[1][3] + z * mtx[2][3] + mtx[3][3];
+   TransformVertex(vtx, mtx);
 }
 
 static void gln64gSPLightVertex_default(void *data)
@@ -142,26 +133,8 @@ static void gln64gSPLightVertex_default(void *data)
    struct SPVertex * _vtx = (struct SPVertex*)data;
 	if (!config.generalEmulation.enableHWLighting)
    {
-      unsigned i;
-
       _vtx->HWLight = 0;
-      _vtx->r = gSP.lights[gSP.numLights].r;
-      _vtx->g = gSP.lights[gSP.numLights].g;
-      _vtx->b = gSP.lights[gSP.numLights].b;
-
-      for (i = 0; i < gSP.numLights; i++)
-      {
-         float intensity = DotProduct( &_vtx->nx, &gSP.lights[i].x );
-         if (intensity < 0.0f)
-            intensity = 0.0f;
-         _vtx->r += gSP.lights[i].r * intensity;
-         _vtx->g += gSP.lights[i].g * intensity;
-         _vtx->b += gSP.lights[i].b * intensity;
-      }
-
-      _vtx->r = MIN(1.0f, _vtx->r);
-      _vtx->g = MIN(1.0f, _vtx->g);
-      _vtx->b = MIN(1.0f, _vtx->b);
+      ShadeVertex(&_vtx->r, &_vtx->nx, gSP.lights, gSP.numLights);
    }
    else
    {
@@ -314,12 +287,13 @@ static void gln64gSPBillboardVertex_default(uint32_t v, uint32_t i)
 void gln64gSPClipVertex(uint32_t v)
 {
    struct SPVertex *vtx = &OGL.triangles.vertices[v];
-   vtx->clip = 0;
-   if (vtx->x > +vtx->w)   vtx->clip |= CLIP_POSX;
-   if (vtx->x < -vtx->w)   vtx->clip |= CLIP_NEGX;
-   if (vtx->y > +vtx->w)   vtx->clip |= CLIP_POSY;
-   if (vtx->y < -vtx->w)   vtx->clip |= CLIP_NEGY;
-   if (vtx->w < 0.01f)      vtx->clip |= CLIP_Z;
+   float pos[4];
+
+   pos[0] = vtx->x;
+   pos[1] = vtx->y;
+   pos[2] = vtx->z;
+   pos[3] = vtx->w;
+   vtx->clip = ClipVertexFlags(pos, 0.01f);
 }
 
 void gln64gSPProcessVertex(uint32_t v)
@@ -21,6 +21,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "ConvertImage.h"
 #include "RenderBase.h"
 
+#include "../../Graphics/texture_convert.h"
+
 ConvertFunction     gConvertFunctions_FullTMEM[ 8 ][ 4 ] = 
 {
     // 4bpp             8bpp            16bpp               32bpp
@@ -65,63 +67,22 @@ void ConvertRGBA16(CTexture *pTexture, const TxtrInfo &tinfo)
 {
     DrawInfo dInfo;
 
-    // Copy of the base pointer
-    uint16_t * pSrc = (uint16_t*)(tinfo.pPhysicalAddress);
-
-    uint8_t * pByteSrc = (uint8_t *)pSrc;
+    uint8_t * pByteSrc = (uint8_t *)(tinfo.pPhysicalAddress);
     if (!pTexture->StartUpdate(&dInfo))
         return;
 
-    uint32_t nFiddle;
-
-    if (tinfo.bSwapped)
+    for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
     {
-        for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
-        {
-            if ((y&1) == 0)
-                nFiddle = 0x2;
-            else
-                nFiddle = 0x2 | 0x4;
-
-            // dwDst points to start of destination row
-            uint32_t * dwDst = (uint32_t *)((uint8_t *)dInfo.lpSurface + y*dInfo.lPitch);
+        // For odd lines of swapped loads, swap words too
+        uint32_t nFiddle = (tinfo.bSwapped && (y&1)) ? 0x7 : 0x3;
 
-            // DWordOffset points to the current dword we're looking at
-            // (process 2 pixels at a time). May be a problem if we don't start on even pixel
-            uint32_t dwWordOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + (tinfo.LeftToLoad * 2);
+        // dwDst points to start of destination row
+        uint32_t * dwDst = (uint32_t *)((uint8_t *)dInfo.lpSurface + y*dInfo.lPitch);
 
-            for (uint32_t x = 0; x < tinfo.WidthToLoad; x++)
-            {
-                uint16_t w = *(uint16_t *)&pByteSrc[dwWordOffset ^ nFiddle];
+        uint32_t dwWordOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + (tinfo.LeftToLoad * 2);
 
-                dwDst[x] = Convert555ToRGBA(w);
-                
-                // Increment word offset to point to the next two pixels
-                dwWordOffset += 2;
-            }
-        }
-    }
-    else
-    {
-        for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
-        {
-            // dwDst points to start of destination row
-            uint32_t * dwDst = (uint32_t *)((uint8_t *)dInfo.lpSurface + y*dInfo.lPitch);
-
-            // DWordOffset points to the current dword we're looking at
-            // (process 2 pixels at a time). May be a problem if we don't start on even pixel
-            uint32_t dwWordOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + (tinfo.LeftToLoad * 2);
-
-            for (uint32_t x = 0; x < tinfo.WidthToLoad; x++)
-            {
-                uint16_t w = *(uint16_t *)&pByteSrc[dwWordOffset ^ 0x2];
-
-                dwDst[x] = Convert555ToRGBA(w);
-                
-                // Increment word offset to point to the next two pixels
-                dwWordOffset += 2;
-            }
-        }
+        tc_row_rgba5551(dwDst, pByteSrc, dwWordOffset, nFiddle, tinfo.WidthToLoad,
+                TC_BGRA | TC_5BIT_REPLICATE);
     }
 
     pTexture->EndUpdate(&dInfo);
@@ -234,7 +195,6 @@ void ConvertRGBA32(CTexture *pTexture, const TxtrInfo &tinfo)
 void ConvertIA4(CTexture *pTexture, const TxtrInfo &tinfo)
 {
     DrawInfo dInfo;
-    uint32_t nFiddle;
 
     uint8_t * pSrc = (uint8_t*)(tinfo.pPhysicalAddress);
 
@@ -245,88 +205,19 @@ void ConvertIA4(CTexture *pTexture, const TxtrInfo &tinfo)
     if (!pTexture->StartUpdate(&dInfo))
         return;
 
-    if (tinfo.bSwapped)
-    {
-        for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
-        {
-            uint8_t *pDst = (uint8_t *)dInfo.lpSurface + y * dInfo.lPitch;
-
-            // For odd lines, swap words too
-            if ((y%2) == 0)
-                nFiddle = 0x3;
-            else
-                nFiddle = 0x7;
-
-
-            // This may not work if X is not even?
-            uint32_t dwByteOffset = (y+tinfo.TopToLoad) * tinfo.Pitch + (tinfo.LeftToLoad/2);
-
-            if (tinfo.WidthToLoad == 1)
-            {
-                // corner case
-                uint8_t b = pSrc[dwByteOffset ^ nFiddle];
-                *pDst++ = ThreeToEight[(b & 0xE0) >> 5];
-                *pDst++ = ThreeToEight[(b & 0xE0) >> 5];
-                *pDst++ = ThreeToEight[(b & 0xE0) >> 5];
-                *pDst++ = OneToEight[(b & 0x10) >> 4];  
-            }
-            else for (uint32_t x = 0; x < tinfo.WidthToLoad; x+=2)
-            {
-                // Do two pixels at a time
-                uint8_t b = pSrc[dwByteOffset ^ nFiddle];
-
-                // Even
-                *pDst++ = ThreeToEight[(b & 0xE0) >> 5];
-                *pDst++ = ThreeToEight[(b & 0xE0) >> 5];
-                *pDst++ = ThreeToEight[(b & 0xE0) >> 5];
-                *pDst++ = OneToEight[(b & 0x10) >> 4];  
-                // Odd
-                *pDst++ = ThreeToEight[(b & 0x0E) >> 1];
-                *pDst++ = ThreeToEight[(b & 0x0E) >> 1];
-                *pDst++ = ThreeToEight[(b & 0x0E) >> 1];
-                *pDst++ = OneToEight[(b & 0x01)     ];
-
-                dwByteOffset++;
-            }
-        }
-    }
-    else
+    for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
     {
-        for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
-        {
-            uint8_t *pDst = (uint8_t *)dInfo.lpSurface + (y * dInfo.lPitch);
+        uint32_t *pDst = (uint32_t *)((uint8_t *)dInfo.lpSurface + y * dInfo.lPitch);
 
-            // This may not work if X is not even?
-            uint32_t dwByteOffset = (y+tinfo.TopToLoad) * tinfo.Pitch + (tinfo.LeftToLoad/2);
-
-            if (tinfo.WidthToLoad == 1)
-            {
-                // corner case
-                uint8_t b = pSrc[dwByteOffset ^ 0x3];
-                *pDst++ = ThreeToEight[(b & 0xE0) >> 5];
-                *pDst++ = ThreeToEight[(b & 0xE0) >> 5];
-                *pDst++ = ThreeToEight[(b & 0xE0) >> 5];
-                *pDst++ = OneToEight[(b & 0x10) >> 4];  
-            }
-            else for (uint32_t x = 0; x < tinfo.WidthToLoad; x+=2)
-            {
-                // Do two pixels at a time
-                uint8_t b = pSrc[dwByteOffset ^ 0x3];
+        // For odd lines, swap words too
+        uint32_t nFiddle = (tinfo.bSwapped && (y&1)) ? 0x7 : 0x3;
 
-                // Even
-                *pDst++ = ThreeToEight[(b & 0xE0) >> 5];
-                *pDst++ = ThreeToEight[(b & 0xE0) >> 5];
-                *pDst++ = ThreeToEight[(b & 0xE0) >> 5];
-                *pDst++ = OneToEight[(b & 0x10) >> 4];  
-                // Odd
-                *pDst++ = ThreeToEight[(b & 0x0E) >> 1];
-                *pDst++ = ThreeToEight[(b & 0x0E) >> 1];
-                *pDst++ = ThreeToEight[(b & 0x0E) >> 1];
-                *pDst++ = OneToEight[(b & 0x01)     ];
+        // This may not work if X is not even?
+        uint32_t dwByteOffset = (y+tinfo.TopToLoad) * tinfo.Pitch + (tinfo.LeftToLoad/2);
 
-                dwByteOffset++;
-            }
-        }
+        // Two pixels per byte, so odd widths write the pair's second pixel too
+        tc_row_ia31(pDst, pSrc, dwByteOffset, nFiddle,
+                tinfo.WidthToLoad == 1 ? 1 : (tinfo.WidthToLoad + 1) & ~1);
     }
 
     pTexture->EndUpdate(&dInfo);
@@ -338,7 +229,6 @@ void ConvertIA4(CTexture *pTexture, const TxtrInfo &tinfo)
 void ConvertIA8(CTexture *pTexture, const TxtrInfo &tinfo)
 {
     DrawInfo dInfo;
-    uint32_t nFiddle;
 
     uint8_t * pSrc = (uint8_t*)(tinfo.pPhysicalAddress);
 
@@ -349,57 +239,18 @@ void ConvertIA8(CTexture *pTexture, const TxtrInfo &tinfo)
     if (!pTexture->StartUpdate(&dInfo))
         return;
 
-    if (tinfo.bSwapped)
+    for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
     {
-        for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
-        {
-            // For odd lines, swap words too
-            if ((y%2) == 0)
-                nFiddle = 0x3;
-            else
-                nFiddle = 0x7;
+        // For odd lines, swap words too
+        uint32_t nFiddle = (tinfo.bSwapped && (y&1)) ? 0x7 : 0x3;
 
-            uint8_t *pDst = (uint8_t *)dInfo.lpSurface + y * dInfo.lPitch;
-            // Points to current byte
-            uint32_t dwByteOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + tinfo.LeftToLoad;
-
-            for (uint32_t x = 0; x < tinfo.WidthToLoad; x++)
-            {
-                uint8_t b = pSrc[dwByteOffset ^ nFiddle];
-                uint8_t I = FourToEight[(b & 0xf0)>>4];
-
-                *pDst++ = I;
-                *pDst++ = I;
-                *pDst++ = I;
-                *pDst++ = FourToEight[(b & 0x0f)   ];
+        uint32_t *pDst = (uint32_t *)((uint8_t *)dInfo.lpSurface + y * dInfo.lPitch);
+        // Points to current byte
+        uint32_t dwByteOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + tinfo.LeftToLoad;
 
-                dwByteOffset++;
-            }
-        }
+        tc_row_ia44(pDst, pSrc, dwByteOffset, nFiddle, tinfo.WidthToLoad);
     }
-    else
-    {
-        const uint8_t* FourToEightArray = &FourToEight[0];
-        for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
-        {
-            uint8_t *pDst = (uint8_t *)dInfo.lpSurface + y * dInfo.lPitch;
 
-            // Points to current byte
-            uint32_t dwByteOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + tinfo.LeftToLoad;
-
-            for (uint32_t x = 0; x < tinfo.WidthToLoad; x++)
-            {
-                uint8_t b = pSrc[(dwByteOffset++) ^ 0x3];
-                uint8_t I = *(FourToEightArray+(b>>4));
-
-                *pDst++ = I;
-                *pDst++ = I;
-                *pDst++ = I;
-                *pDst++ = *(FourToEightArray+(b&0xF));
-            }
-        }
-    }   
-    
     pTexture->EndUpdate(&dInfo);
     pTexture->SetOthersVariables();
 
@@ -409,65 +260,24 @@ void ConvertIA8(CTexture *pTexture, const TxtrInfo &tinfo)
 void ConvertIA16(CTexture *pTexture, const TxtrInfo &tinfo)
 {
     DrawInfo dInfo;
-    uint32_t nFiddle;
 
-    uint16_t * pSrc = (uint16_t*)(tinfo.pPhysicalAddress);
-    uint8_t * pByteSrc = (uint8_t *)pSrc;
+    uint8_t * pByteSrc = (uint8_t *)(tinfo.pPhysicalAddress);
 
     if (!pTexture->StartUpdate(&dInfo))
         return;
 
-    if (tinfo.bSwapped)
-    {
-        for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
-        {
-            uint8_t *pDst = (uint8_t *)dInfo.lpSurface + y * dInfo.lPitch;
-
-            if ((y%2) == 0)
-                nFiddle = 0x2;
-            else
-                nFiddle = 0x4 | 0x2;
-
-            // Points to current word
-            uint32_t dwWordOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + (tinfo.LeftToLoad * 2);
-
-            for (uint32_t x = 0; x < tinfo.WidthToLoad; x++)
-            {
-                uint16_t w = *(uint16_t *)&pByteSrc[dwWordOffset^nFiddle];
-
-                *pDst++ = (uint8_t)(w >> 8);
-                *pDst++ = (uint8_t)(w >> 8);
-                *pDst++ = (uint8_t)(w >> 8);
-                *pDst++ = (uint8_t)(w & 0xFF);
-
-                dwWordOffset += 2;
-            }
-        }
-    }
-    else
+    for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
     {
-        for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
-        {
-            uint8_t *pDst = (uint8_t *)dInfo.lpSurface + y * dInfo.lPitch;
+        uint32_t *pDst = (uint32_t *)((uint8_t *)dInfo.lpSurface + y * dInfo.lPitch);
 
-            // Points to current word
-            uint32_t dwWordOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + (tinfo.LeftToLoad * 2);
+        uint32_t nFiddle = (tinfo.bSwapped && (y&1)) ? 0x7 : 0x3;
 
-            for (uint32_t x = 0; x < tinfo.WidthToLoad; x++)
-            {
-                uint16_t w = *(uint16_t *)&pByteSrc[dwWordOffset^0x2];
+        // Points to current word
+        uint32_t dwWordOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + (tinfo.LeftToLoad * 2);
 
-                *pDst++ = (uint8_t)(w >> 8);
-                *pDst++ = (uint8_t)(w >> 8);
-                *pDst++ = (uint8_t)(w >> 8);
-                *pDst++ = (uint8_t)(w & 0xFF);
-
-                dwWordOffset += 2;
-            }
-        }       
+        tc_row_ia88(pDst, pByteSrc, dwWordOffset, nFiddle, tinfo.WidthToLoad);
     }
 
-
     pTexture->EndUpdate(&dInfo);
     pTexture->SetOthersVariables();
 }
@@ -478,7 +288,6 @@ void ConvertIA16(CTexture *pTexture, const TxtrInfo &tinfo)
 void ConvertI4(CTexture *pTexture, const TxtrInfo &tinfo)
 {
     DrawInfo dInfo;
-    uint32_t nFiddle;
 
     uint8_t * pSrc = (uint8_t*)(tinfo.pPhysicalAddress);
 
@@ -489,100 +298,25 @@ void ConvertI4(CTexture *pTexture, const TxtrInfo &tinfo)
     if (!pTexture->StartUpdate(&dInfo))
         return;
 
-    if (tinfo.bSwapped)
+    for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
     {
-        for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
-        {
-            uint8_t *pDst = (uint8_t *)dInfo.lpSurface + y * dInfo.lPitch;
+        uint32_t *pDst = (uint32_t *)((uint8_t *)dInfo.lpSurface + y * dInfo.lPitch);
 
-            // Might not work with non-even starting X
-            uint32_t dwByteOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + (tinfo.LeftToLoad / 2);
+        // Might not work with non-even starting X
+        uint32_t dwByteOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + (tinfo.LeftToLoad / 2);
 
-            // For odd lines, swap words too
-            if( !conkerSwapHack || (y&4) == 0 )
-            {
-                if ((y%2) == 0)
-                    nFiddle = 0x3;
-                else
-                    nFiddle = 0x7;
-            }
-            else
-            {
-                if ((y%2) == 1)
-                    nFiddle = 0x3;
-                else
-                    nFiddle = 0x7;
-            }
+        // For odd lines, swap words too. Conker swaps the other lines
+        // of every second group of four.
+        uint32_t nFiddle = 0x3;
+        if (tinfo.bSwapped && ((y&1) ^ (conkerSwapHack && (y&4) != 0)))
+            nFiddle = 0x7;
 
-            if (tinfo.WidthToLoad == 1)
-            {
-                // corner case
-                uint8_t b = pSrc[dwByteOffset ^ nFiddle];
-                *pDst++ = FourToEight[(b & 0xF0)>>4];
-                *pDst++ = FourToEight[(b & 0xF0)>>4];
-                *pDst++ = FourToEight[(b & 0xF0)>>4];
-                *pDst++ = FourToEight[(b & 0xF0)>>4];   
-            }
-            else for (uint32_t x = 0; x < tinfo.WidthToLoad; x+=2)
-            {
-                // two pixels at a time
-                uint8_t b = pSrc[dwByteOffset ^ nFiddle];
-
-                // Even
-                *pDst++ = FourToEight[(b & 0xF0)>>4];   // Other implementations seem to or in (b&0xF0)>>4
-                *pDst++ = FourToEight[(b & 0xF0)>>4]; // why?
-                *pDst++ = FourToEight[(b & 0xF0)>>4];
-                *pDst++ = FourToEight[(b & 0xF0)>>4];   
-                // Odd
-                *pDst++ = FourToEight[(b & 0x0F)];
-                *pDst++ = FourToEight[(b & 0x0F)];
-                *pDst++ = FourToEight[(b & 0x0F)];
-                *pDst++ = FourToEight[(b & 0x0F)];
-
-                dwByteOffset++;
-            }
-        }
-
-        conkerSwapHack = false;
+        tc_row_i4(pDst, pSrc, dwByteOffset, nFiddle,
+                tinfo.WidthToLoad == 1 ? 1 : (tinfo.WidthToLoad + 1) & ~1);
     }
-    else
-    {
-        for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
-        {
-            uint8_t *pDst = (uint8_t *)dInfo.lpSurface + y * dInfo.lPitch;
-
-            // Might not work with non-even starting X
-            uint32_t dwByteOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + (tinfo.LeftToLoad / 2);
-
-            if (tinfo.WidthToLoad == 1)
-            {
-                // corner case
-                uint8_t b = pSrc[dwByteOffset ^ 0x3];
-                *pDst++ = FourToEight[(b & 0xF0)>>4];
-                *pDst++ = FourToEight[(b & 0xF0)>>4];
-                *pDst++ = FourToEight[(b & 0xF0)>>4];
-                *pDst++ = FourToEight[(b & 0xF0)>>4];   
-            }
-            else for (uint32_t x = 0; x < tinfo.WidthToLoad; x+=2)
-            {
-                // two pixels at a time
-                uint8_t b = pSrc[dwByteOffset ^ 0x3];
 
-                // Even
-                *pDst++ = FourToEight[(b & 0xF0)>>4];   // Other implementations seem to or in (b&0xF0)>>4
-                *pDst++ = FourToEight[(b & 0xF0)>>4]; // why?
-                *pDst++ = FourToEight[(b & 0xF0)>>4];
-                *pDst++ = FourToEight[(b & 0xF0)>>4];   
-                // Odd
-                *pDst++ = FourToEight[(b & 0x0F)];
-                *pDst++ = FourToEight[(b & 0x0F)];
-                *pDst++ = FourToEight[(b & 0x0F)];
-                *pDst++ = FourToEight[(b & 0x0F)];
-
-                dwByteOffset++;
-            }
-        }
-    }
+    if (tinfo.bSwapped)
+        conkerSwapHack = false;
 
     pTexture->EndUpdate(&dInfo);
     pTexture->SetOthersVariables();
@@ -592,58 +326,24 @@ void ConvertI4(CTexture *pTexture, const TxtrInfo &tinfo)
 void ConvertI8(CTexture *pTexture, const TxtrInfo &tinfo)
 {
     DrawInfo dInfo;
-    uint32_t nFiddle;
 
-    int64_t pSrc = (int64_t) tinfo.pPhysicalAddress;
+    // The fiddle applies to the absolute address here, so convert from
+    // the enclosing qword.
+    uintptr_t pSrc = (uintptr_t) tinfo.pPhysicalAddress;
+    const uint8_t *pBase = (const uint8_t *)(pSrc & ~(uintptr_t)7);
     if (!pTexture->StartUpdate(&dInfo))
         return;
 
-    if (tinfo.bSwapped)
-    {
-        for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
-        {
-            if ((y%2) == 0)
-                nFiddle = 0x3;
-            else
-                nFiddle = 0x7;
-
-            uint8_t *pDst = (uint8_t *)dInfo.lpSurface + y * dInfo.lPitch;
-
-            uint32_t dwByteOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + tinfo.LeftToLoad;
-
-            for (uint32_t x = 0; x < tinfo.WidthToLoad; x++)
-            {
-                uint8_t b = *(uint8_t*)((pSrc+dwByteOffset)^nFiddle);
-
-                *pDst++ = b;
-                *pDst++ = b;
-                *pDst++ = b;
-                *pDst++ = b;        // Alpha not 255?
-
-                dwByteOffset++;
-            }
-        }
-    }
-    else
+    for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
     {
-        for (uint32_t y = 0; y < tinfo.HeightToLoad; y++)
-        {
-            uint8_t *pDst = (uint8_t *)dInfo.lpSurface + y * dInfo.lPitch;
+        uint32_t nFiddle = (tinfo.bSwapped && (y&1)) ? 0x7 : 0x3;
 
-            uint32_t dwByteOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + tinfo.LeftToLoad;
+        uint32_t *pDst = (uint32_t *)((uint8_t *)dInfo.lpSurface + y * dInfo.lPitch);
 
-            for (uint32_t x = 0; x < tinfo.WidthToLoad; x++)
-            {
-                uint8_t b = *(uint8_t*)((pSrc+dwByteOffset)^0x3);
-
-                *pDst++ = b;
-                *pDst++ = b;
-                *pDst++ = b;
-                *pDst++ = b;        // Alpha not 255?
+        uint32_t dwByteOffset = ((y+tinfo.TopToLoad) * tinfo.Pitch) + tinfo.LeftToLoad;
 
-                dwByteOffset++;
-            }
-        }
+        // Alpha not 255?
+        tc_row_i8(pDst, pBase, (uint32_t)(pSrc & 7) + dwByteOffset, nFiddle, tinfo.WidthToLoad);
     }
 
     pTexture->EndUpdate(&dInfo);
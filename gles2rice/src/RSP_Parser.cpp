@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <time.h>
 
 #include "../../libretro/libretro_private.h"
+#include "../../libretro/crc32_accel.h"
 #include "../../Graphics/RDP/gDP_funcs_prot.h"
 #include "../../Graphics/RDP/gDP_state.h"
 #include "../../Graphics/RSP/RSP_state.h"
@@ -1330,65 +1331,13 @@ void RDP_TriShadeTxtrZ(Gfx *gfx)
 {
 }
 
-static int crc_table_empty = 1;
-static unsigned int crc_table[256];
-
-static void make_crc_table(void)
-{
-   unsigned n;
-   /* terms of polynomial defining this crc (except x^32): */
-   static const uint8_t p[] = {0,1,2,4,5,7,8,10,11,12,16,22,23,26};
-   /* make exclusive-or pattern from polynomial (0xedb88320L) */
-   unsigned int poly   = 0L;
-
-   for (n = 0; n < sizeof(p)/sizeof(uint8_t); n++)
-      poly |= 1L << (31 - p[n]);
-
-   for (unsigned int n = 0; n < 256; n++)
-   {
-      unsigned k;
-      unsigned int c = n;
-      for (k = 0; k < 8; k++)
-      {
-         c = (c & 1) ? (poly ^ (c >> 1)) : c >> 1;
-      }
-
-      crc_table[n] = c;
-   }
-   crc_table_empty = 0;
-}
-
-/* ========================================================================= */
-#define DO1(buf) crc = crc_table[((int)crc ^ (*buf++)) & 0xff] ^ (crc >> 8);
-#define DO2(buf)  DO1(buf); DO1(buf);
-#define DO4(buf)  DO2(buf); DO2(buf);
-#define DO8(buf)  DO4(buf); DO4(buf);
-
-/* ========================================================================= */
+/* zlib CRC-32, used for ucode detection; see libretro/crc32_accel.c */
 unsigned int ComputeCRC32(unsigned int crc, const uint8_t *buf, unsigned int len)
 {
     if (buf == NULL)
         return 0L;
 
-    if (crc_table_empty)
-        make_crc_table();
-
-    crc = crc ^ 0xffffffffL;
-    while (len >= 8)
-    {
-        DO8(buf);
-        len -= 8;
-    }
-
-    if (len)
-    {
-        do
-        {
-            DO1(buf);
-        } while (--len);
-    }
-
-    return crc ^ 0xffffffffL;
+    return ~crc32_accel_ieee(~crc, buf, len);
 }
 
 Matrix matToLoad;
@@ -29,6 +29,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Render.h"
 #include "Timing.h"
 
+#include "../../Graphics/vec4f.h"
+
 #include "../../Graphics/GBI.h"
 #include "../../Graphics/RDP/gDP_state.h"
 
@@ -655,6 +657,231 @@ void ReplaceAlphaWithFogFactor(int i)
 #define X_NEG  0x10
 #define X_POS  0x20
 
+/*
+ *  Vertex stages shared by the ProcessVertexData variants
+ *
+ *  A variant first reads its vertices into g_vtxNonTransformed, and their
+ *  normals into g_vtxNormal when lighting, then runs the position and the
+ *  lighting stage over the whole load before it sets colors and texture
+ *  coordinates per vertex. With status.isSIMDEnabled the stages work on
+ *  four vertices at a time; they do the same float operations in the same
+ *  order as the one-vertex versions, so as long as neither fuses multiplies
+ *  and adds (the Makefile builds this file and VectorMath.cpp with
+ *  -ffp-contract=off) the results are the same bits, which
+ *  tools/ricevertexcheck checks. What is left of a load after the groups
+ *  of four takes the one-vertex path.
+ */
+
+static ALIGN(16,XVECTOR4 g_vtxNormal[MAX_VERTS]);
+
+static void ProjectVertex(uint32_t i, const Matrix &m, const XVECTOR4 *base, bool primitiveDepth, bool fog)
+{
+    Vec3Transform(&g_vtxTransformed[i], (XVECTOR3*)&g_vtxNonTransformed[i], &m); // Convert to w=1
+
+    if( base )
+    {
+        g_vtxTransformed[i].x += base->x;
+        g_vtxTransformed[i].y += base->y;
+        g_vtxTransformed[i].z += base->z;
+        g_vtxTransformed[i].w  = base->w;
+    }
+
+    g_vecProjected[i].w = 1.0f / g_vtxTransformed[i].w;
+    g_vecProjected[i].x = g_vtxTransformed[i].x * g_vecProjected[i].w;
+    g_vecProjected[i].y = g_vtxTransformed[i].y * g_vecProjected[i].w;
+    if( primitiveDepth )
+    {
+        g_vecProjected[i].z = gRDP.fPrimitiveDepth;
+        g_vtxTransformed[i].z = gRDP.fPrimitiveDepth*g_vtxTransformed[i].w;
+    }
+    else
+    {
+        g_vecProjected[i].z = g_vtxTransformed[i].z * g_vecProjected[i].w;
+    }
+
+    if( fog )
+    {
+        g_fFogCoord[i] = g_vecProjected[i].z;
+        if( g_vecProjected[i].w < 0 || g_vecProjected[i].z < 0 || g_fFogCoord[i] < gRSPfFogMin )
+            g_fFogCoord[i] = gRSPfFogMin;
+    }
+
+    RSP_Vtx_Clipping(i);
+}
+
+// x*m1 + y*m2 + z*m3, added left to right like Vec3Transform
+static inline vec4f Dot3x4(vec4f x, vec4f y, vec4f z, float m1, float m2, float m3)
+{
+    return vec4f_madd(z, vec4f_set1(m3), vec4f_madd(y, vec4f_set1(m2), vec4f_mul(x, vec4f_set1(m1))));
+}
+
+static inline void LoadVertices4(const XVECTOR4 *v, vec4f &x, vec4f &y, vec4f &z, vec4f &w)
+{
+    x = vec4f_load(&v[0].x);
+    y = vec4f_load(&v[1].x);
+    z = vec4f_load(&v[2].x);
+    w = vec4f_load(&v[3].x);
+    vec4f_transpose(&x, &y, &z, &w);
+}
+
+static inline void StoreVertices4(XVECTOR4 *v, vec4f x, vec4f y, vec4f z, vec4f w)
+{
+    vec4f_transpose(&x, &y, &z, &w);
+    vec4f_store(&v[0].x, x);
+    vec4f_store(&v[1].x, y);
+    vec4f_store(&v[2].x, z);
+    vec4f_store(&v[3].x, w);
+}
+
+static void ProjectVertices4(uint32_t i, const Matrix &m, const XVECTOR4 *base, bool primitiveDepth, bool fog)
+{
+    const vec4f zero = vec4f_set1(0.0f);
+    vec4f x, y, z, w;
+
+    LoadVertices4(&g_vtxNonTransformed[i], x, y, z, w);
+
+    vec4f tx = vec4f_add(Dot3x4(x, y, z, m._11, m._21, m._31), vec4f_set1(m._41));
+    vec4f ty = vec4f_add(Dot3x4(x, y, z, m._12, m._22, m._32), vec4f_set1(m._42));
+    vec4f tz = vec4f_add(Dot3x4(x, y, z, m._13, m._23, m._33), vec4f_set1(m._43));
+    vec4f tw = vec4f_add(Dot3x4(x, y, z, m._14, m._24, m._34), vec4f_set1(m._44));
+
+    if( base )
+    {
+        tx = vec4f_add(tx, vec4f_set1(base->x));
+        ty = vec4f_add(ty, vec4f_set1(base->y));
+        tz = vec4f_add(tz, vec4f_set1(base->z));
+        tw = vec4f_set1(base->w);
+    }
+
+    vec4f pw = vec4f_div(vec4f_set1(1.0f), tw);
+    vec4f px = vec4f_mul(tx, pw);
+    vec4f py = vec4f_mul(ty, pw);
+    vec4f pz;
+    if( primitiveDepth )
+    {
+        pz = vec4f_set1(gRDP.fPrimitiveDepth);
+        tz = vec4f_mul(pz, tw);
+    }
+    else
+    {
+        pz = vec4f_mul(tz, pw);
+    }
+
+    if( fog )
+    {
+        vec4f fogMin = vec4f_set1(gRSPfFogMin);
+        vec4f f = vec4f_select(vec4f_cmplt(pz, fogMin), fogMin, pz);
+        f = vec4f_select(vec4f_cmplt(pz, zero), fogMin, f);
+        f = vec4f_select(vec4f_cmplt(pw, zero), fogMin, f);
+        vec4f_store(&g_fFogCoord[i], f);
+    }
+
+#ifdef ENABLE_CLIP_TRI
+    {
+        int front = vec4f_movemask(vec4f_cmpgt(pw, zero));
+        int xMax = vec4f_movemask(vec4f_cmpgt(px, vec4f_set1(1.0f))) & front;
+        int xMin = vec4f_movemask(vec4f_cmplt(px, vec4f_set1(-1.0f))) & front;
+        int yMax = vec4f_movemask(vec4f_cmpgt(py, vec4f_set1(1.0f))) & front;
+        int yMin = vec4f_movemask(vec4f_cmplt(py, vec4f_set1(-1.0f))) & front;
+
+        for (int k = 0; k < 4; k++)
+        {
+            g_clipFlag[i+k] = 0;
+            g_clipFlag2[i+k] = (((xMax>>k)&1) ? X_CLIP_MAX : 0) | (((xMin>>k)&1) ? X_CLIP_MIN : 0) |
+                               (((yMax>>k)&1) ? Y_CLIP_MAX : 0) | (((yMin>>k)&1) ? Y_CLIP_MIN : 0);
+        }
+    }
+#endif
+
+    StoreVertices4(&g_vtxTransformed[i], tx, ty, tz, tw);
+    StoreVertices4(&g_vecProjected[i], px, py, pz, pw);
+}
+
+static void ProjectVertices(uint32_t dwV0, uint32_t dwNum, const Matrix &m, const XVECTOR4 *base, bool primitiveDepth, bool fog)
+{
+    uint32_t i = dwV0;
+    uint32_t end = dwV0 + dwNum;
+
+    if( status.isSIMDEnabled )
+    {
+        for (; i + 4 <= end; i += 4)
+            ProjectVertices4(i, m, base, primitiveDepth, fog);
+    }
+    for (; i < end; i++)
+        ProjectVertex(i, m, base, primitiveDepth, fog);
+}
+
+static void LightVertex(uint32_t i, const Matrix &m)
+{
+    Vec3TransformNormal(g_vtxNormal[i], m);
+    g_dwVtxDifColor[i] = LightVert(g_vtxNormal[i], i);
+}
+
+static void LightVertices4(uint32_t i, const Matrix &m)
+{
+    const vec4f zero = vec4f_set1(0.0f);
+    vec4f nx, ny, nz, nw;
+
+    LoadVertices4(&g_vtxNormal[i], nx, ny, nz, nw);
+
+    // Vec3TransformNormal
+    vec4f tx = Dot3x4(nx, ny, nz, m._11, m._21, m._31);
+    vec4f ty = Dot3x4(nx, ny, nz, m._12, m._22, m._32);
+    vec4f tz = Dot3x4(nx, ny, nz, m._13, m._23, m._33);
+    vec4f norm = vec4f_sqrt(vec4f_madd(tz, tz, vec4f_madd(ty, ty, vec4f_mul(tx, tx))));
+    vec4f nonzero = vec4f_cmpneq(norm, zero);
+    nx = vec4f_select(nonzero, vec4f_div(tx, norm), zero);
+    ny = vec4f_select(nonzero, vec4f_div(ty, norm), zero);
+    nz = vec4f_select(nonzero, vec4f_div(tz, norm), zero);
+    StoreVertices4(&g_vtxNormal[i], nx, ny, nz, nw);
+
+    if( options.enableHackForGames == HACK_FOR_ZELDA_MM )
+    {
+        // point lights need the vertex in view space, leave them to LightVert
+        for (int k = 0; k < 4; k++)
+            g_dwVtxDifColor[i+k] = LightVert(g_vtxNormal[i+k], i+k);
+        return;
+    }
+
+    // LightVert
+    vec4f r = vec4f_set1(gRSP.fAmbientLightR);
+    vec4f g = vec4f_set1(gRSP.fAmbientLightG);
+    vec4f b = vec4f_set1(gRSP.fAmbientLightB);
+
+    for (unsigned int l=0; l < gSP.numLights; l++)
+    {
+        vec4f fCosT = Dot3x4(nx, ny, nz, gRSPlights[l].x, gRSPlights[l].y, gRSPlights[l].z);
+        vec4f lit = vec4f_cmpgt(fCosT, zero);
+
+        r = vec4f_select(lit, vec4f_madd(vec4f_set1(gRSPlights[l].fr), fCosT, r), r);
+        g = vec4f_select(lit, vec4f_madd(vec4f_set1(gRSPlights[l].fg), fCosT, g), g);
+        b = vec4f_select(lit, vec4f_madd(vec4f_set1(gRSPlights[l].fb), fCosT, b), b);
+    }
+
+    const vec4f full = vec4f_set1(255.0f);
+    float fr[4], fg[4], fb[4];
+    vec4f_store(fr, vec4f_select(vec4f_cmpgt(r, full), full, r));
+    vec4f_store(fg, vec4f_select(vec4f_cmpgt(g, full), full, g));
+    vec4f_store(fb, vec4f_select(vec4f_cmpgt(b, full), full, b));
+
+    for (int k = 0; k < 4; k++)
+        g_dwVtxDifColor[i+k] = ((0xff000000)|(((uint32_t)fr[k])<<16)|(((uint32_t)fg[k])<<8)|((uint32_t)fb[k]));
+}
+
+static void LightVertices(uint32_t dwV0, uint32_t dwNum, const Matrix &m)
+{
+    uint32_t i = dwV0;
+    uint32_t end = dwV0 + dwNum;
+
+    if( status.isSIMDEnabled )
+    {
+        for (; i + 4 <= end; i += 4)
+            LightVertices4(i, m);
+    }
+    for (; i < end; i++)
+        LightVertex(i, m);
+}
+
 // Assumes dwAddr has already been checked! 
 // Don't inline - it's too big with the transform macros
 
@@ -681,46 +908,38 @@ void ProcessVertexDataNoSSE(uint32_t dwAddr, uint32_t dwV0, uint32_t dwNum)
 
     for (uint32_t i = dwV0; i < dwV0 + dwNum; i++)
     {
-        SP_Timing(RSP_GBI0_Vtx);
-
         FiddledVtx & vert = pVtxBase[i - dwV0];
 
         g_vtxNonTransformed[i].x = (float)vert.x;
         g_vtxNonTransformed[i].y = (float)vert.y;
         g_vtxNonTransformed[i].z = (float)vert.z;
 
-        Vec3Transform(&g_vtxTransformed[i], (XVECTOR3*)&g_vtxNonTransformed[i], &gRSPworldProject); // Convert to w=1
-
-        g_vecProjected[i].w = 1.0f / g_vtxTransformed[i].w;
-        g_vecProjected[i].x = g_vtxTransformed[i].x * g_vecProjected[i].w;
-        g_vecProjected[i].y = g_vtxTransformed[i].y * g_vecProjected[i].w;
-        if ((g_curRomInfo.bPrimaryDepthHack || options.enableHackForGames == HACK_FOR_NASCAR ) && gRDP.otherMode.depth_source )
-        {
-            g_vecProjected[i].z = gRDP.fPrimitiveDepth;
-            g_vtxTransformed[i].z = gRDP.fPrimitiveDepth*g_vtxTransformed[i].w;
-        }
-        else
+        if( gRSP.bLightingEnable )
         {
-            g_vecProjected[i].z = g_vtxTransformed[i].z * g_vecProjected[i].w;
+            g_vtxNormal[i].x = (float)vert.norma.nx;
+            g_vtxNormal[i].y = (float)vert.norma.ny;
+            g_vtxNormal[i].z = (float)vert.norma.nz;
         }
+    }
 
-        if( gRSP.bFogEnabled )
-        {
-            g_fFogCoord[i] = g_vecProjected[i].z;
-            if( g_vecProjected[i].w < 0 || g_vecProjected[i].z < 0 || g_fFogCoord[i] < gRSPfFogMin )
-                g_fFogCoord[i] = gRSPfFogMin;
-        }
+    ProjectVertices(dwV0, dwNum, gRSPworldProject, NULL,
+        (g_curRomInfo.bPrimaryDepthHack || options.enableHackForGames == HACK_FOR_NASCAR ) && gRDP.otherMode.depth_source,
+        gRSP.bFogEnabled);
 
-        RSP_Vtx_Clipping(i);
+    if( gRSP.bLightingEnable )
+        LightVertices(dwV0, dwNum, gRSPmodelViewTop);
+
+    for (uint32_t i = dwV0; i < dwV0 + dwNum; i++)
+    {
+        SP_Timing(RSP_GBI0_Vtx);
+
+        FiddledVtx & vert = pVtxBase[i - dwV0];
 
         if( gRSP.bLightingEnable )
         {
-            g_normal.x = (float)vert.norma.nx;
-            g_normal.y = (float)vert.norma.ny;
-            g_normal.z = (float)vert.norma.nz;
-
-            Vec3TransformNormal(g_normal, gRSPmodelViewTop);
-            g_dwVtxDifColor[i] = LightVert(g_normal, i);
+            g_normal.x = g_vtxNormal[i].x; // for TexGen
+            g_normal.y = g_vtxNormal[i].y;
+            g_normal.z = g_vtxNormal[i].z;
             *(((uint8_t*)&(g_dwVtxDifColor[i]))+3) = vert.rgba.a; // still use alpha from the vertex
         }
         else
@@ -909,49 +1128,48 @@ void ProcessVertexDataDKR(uint32_t dwAddr, uint32_t dwV0, uint32_t dwNum)
     if( addbase && gRSP.DKRVtxCount == 0 && dwNum > 1 )
         gRSP.DKRVtxCount++;
 
+    // A single vertex loaded first is the billboard base, the ones after it are moved by it
+    bool setbase = gRSP.DKRVtxCount == 0 && dwNum == 1;
+
     int nOff = 0;
     uint32_t end = dwV0 + dwNum;
     for (uint32_t i = dwV0; i < end; i++)
     {
-        XVECTOR3 w;
-
         g_vtxNonTransformed[i].x = (float)*(short*)((pVtxBase+nOff + 0) ^ 2);
         g_vtxNonTransformed[i].y = (float)*(short*)((pVtxBase+nOff + 2) ^ 2);
         g_vtxNonTransformed[i].z = (float)*(short*)((pVtxBase+nOff + 4) ^ 2);
 
-        Vec3Transform(&g_vtxTransformed[i], (XVECTOR3*)&g_vtxNonTransformed[i], &matWorldProject);  // Convert to w=1
-
-        if( gRSP.DKRVtxCount == 0 && dwNum==1 )
-        {
-            gRSP.DKRBaseVec.x = g_vtxTransformed[i].x;
-            gRSP.DKRBaseVec.y = g_vtxTransformed[i].y;
-            gRSP.DKRBaseVec.z = g_vtxTransformed[i].z;
-            gRSP.DKRBaseVec.w = g_vtxTransformed[i].w;
-        }
-        else if( addbase )
+        if (gRSP.bLightingEnable)
         {
-            g_vtxTransformed[i].x += gRSP.DKRBaseVec.x;
-            g_vtxTransformed[i].y += gRSP.DKRBaseVec.y;
-            g_vtxTransformed[i].z += gRSP.DKRBaseVec.z;
-            g_vtxTransformed[i].w  = gRSP.DKRBaseVec.w;
+            short wA = *(short*)((pVtxBase+nOff + 6) ^ 2);
+            short wB = *(short*)((pVtxBase+nOff + 8) ^ 2);
+
+            g_vtxNormal[i].x = (char)(int8_t)(wA >> 8); //norma.nx;
+            g_vtxNormal[i].y = (char)(int8_t)(wA);      //norma.ny;
+            g_vtxNormal[i].z = (char)(int8_t)(wB >> 8); //norma.nz;
         }
 
-        g_vecProjected[i].w = 1.0f / g_vtxTransformed[i].w;
-        g_vecProjected[i].x = g_vtxTransformed[i].x * g_vecProjected[i].w;
-        g_vecProjected[i].y = g_vtxTransformed[i].y * g_vecProjected[i].w;
-        g_vecProjected[i].z = g_vtxTransformed[i].z * g_vecProjected[i].w;
+        nOff += 10;
+    }
 
-        gRSP.DKRVtxCount++;
+    ProjectVertices(dwV0, dwNum, matWorldProject, (addbase && !setbase) ? &gRSP.DKRBaseVec : NULL, false, gRSP.bFogEnabled);
 
-        if( gRSP.bFogEnabled )
-        {
-            g_fFogCoord[i] = g_vecProjected[i].z;
-            if( g_vecProjected[i].w < 0 || g_vecProjected[i].z < 0 || g_fFogCoord[i] < gRSPfFogMin )
-                g_fFogCoord[i] = gRSPfFogMin;
-        }
+    if( setbase )
+    {
+        gRSP.DKRBaseVec.x = g_vtxTransformed[dwV0].x;
+        gRSP.DKRBaseVec.y = g_vtxTransformed[dwV0].y;
+        gRSP.DKRBaseVec.z = g_vtxTransformed[dwV0].z;
+        gRSP.DKRBaseVec.w = g_vtxTransformed[dwV0].w;
+    }
+
+    gRSP.DKRVtxCount += dwNum;
 
-        RSP_Vtx_Clipping(i);
+    if (gRSP.bLightingEnable)
+        LightVertices(dwV0, dwNum, matWorldProject);
 
+    nOff = 0;
+    for (uint32_t i = dwV0; i < end; i++)
+    {
         short wA = *(short*)((pVtxBase+nOff + 6) ^ 2);
         short wB = *(short*)((pVtxBase+nOff + 8) ^ 2);
 
@@ -962,12 +1180,9 @@ void ProcessVertexDataDKR(uint32_t dwAddr, uint32_t dwV0, uint32_t dwNum)
 
         if (gRSP.bLightingEnable)
         {
-            g_normal.x = (char)r; //norma.nx;
-            g_normal.y = (char)g; //norma.ny;
-            g_normal.z = (char)b; //norma.nz;
-
-            Vec3TransformNormal(g_normal, matWorldProject)
-                g_dwVtxDifColor[i] = LightVert(g_normal, i);
+            g_normal.x = g_vtxNormal[i].x;
+            g_normal.y = g_vtxNormal[i].y;
+            g_normal.z = g_vtxNormal[i].z;
         }
         else   // Assign true vert colour after lighting/fogging
             g_dwVtxDifColor[i] = COLOR_RGBA(r, g, b, a);
@@ -993,27 +1208,20 @@ void ProcessVertexDataConker(uint32_t dwAddr, uint32_t dwV0, uint32_t dwNum)
 
     for (uint32_t i = dwV0; i < dwV0 + dwNum; i++)
     {
-        SP_Timing(RSP_GBI0_Vtx);
-
         FiddledVtx & vert = pVtxBase[i - dwV0];
 
         g_vtxNonTransformed[i].x = (float)vert.x;
         g_vtxNonTransformed[i].y = (float)vert.y;
         g_vtxNonTransformed[i].z = (float)vert.z;
+    }
 
-        {
-            Vec3Transform(&g_vtxTransformed[i], (XVECTOR3*)&g_vtxNonTransformed[i], &gRSPworldProject); // Convert to w=1
-            g_vecProjected[i].w = 1.0f / g_vtxTransformed[i].w;
-            g_vecProjected[i].x = g_vtxTransformed[i].x * g_vecProjected[i].w;
-            g_vecProjected[i].y = g_vtxTransformed[i].y * g_vecProjected[i].w;
-            g_vecProjected[i].z = g_vtxTransformed[i].z * g_vecProjected[i].w;
-        }
+    ProjectVertices(dwV0, dwNum, gRSPworldProject, NULL, false, true);
 
-        g_fFogCoord[i] = g_vecProjected[i].z;
-        if( g_vecProjected[i].w < 0 || g_vecProjected[i].z < 0 || g_fFogCoord[i] < gRSPfFogMin )
-            g_fFogCoord[i] = gRSPfFogMin;
+    for (uint32_t i = dwV0; i < dwV0 + dwNum; i++)
+    {
+        SP_Timing(RSP_GBI0_Vtx);
 
-        RSP_Vtx_Clipping(i);
+        FiddledVtx & vert = pVtxBase[i - dwV0];
 
         if( gRSP.bLightingEnable )
         {
@@ -1130,30 +1338,28 @@ void ProcessVertexData_Rogue_Squadron(uint32_t dwXYZAddr, uint32_t dwColorAddr,
         g_vtxNonTransformed[i].y = (float)vertxyz.y;
         g_vtxNonTransformed[i].z = (float)vertxyz.z;
 
+        if( gRSP.bLightingEnable )
         {
-            Vec3Transform(&g_vtxTransformed[i], (XVECTOR3*)&g_vtxNonTransformed[i], &gRSPworldProject); // Convert to w=1
-            g_vecProjected[i].w = 1.0f / g_vtxTransformed[i].w;
-            g_vecProjected[i].x = g_vtxTransformed[i].x * g_vecProjected[i].w;
-            g_vecProjected[i].y = g_vtxTransformed[i].y * g_vecProjected[i].w;
-            g_vecProjected[i].z = g_vtxTransformed[i].z * g_vecProjected[i].w;
+            g_vtxNormal[i].x = (float)vertcolors.nx;
+            g_vtxNormal[i].y = (float)vertcolors.ny;
+            g_vtxNormal[i].z = (float)vertcolors.nz;
         }
+    }
 
-        g_fFogCoord[i] = g_vecProjected[i].z;
-        if( g_vecProjected[i].w < 0 || g_vecProjected[i].z < 0 || g_fFogCoord[i] < gRSPfFogMin )
-            g_fFogCoord[i] = gRSPfFogMin;
+    ProjectVertices(dwV0, dwNum, gRSPworldProject, NULL, false, true);
+
+    if( gRSP.bLightingEnable )
+        LightVertices(dwV0, dwNum, gRSPmodelViewTop);
 
-        RSP_Vtx_Clipping(i);
+    for (uint32_t i = dwV0; i < dwV0 + dwNum; i++)
+    {
+        RS_Vtx_Color & vertcolors = pVtxColorBase[i - dwV0];
 
         if( gRSP.bLightingEnable )
         {
-            g_normal.x = (float)vertcolors.nx;
-            g_normal.y = (float)vertcolors.ny;
-            g_normal.z = (float)vertcolors.nz;
-
-            {
-                Vec3TransformNormal(g_normal, gRSPmodelViewTop);
-                g_dwVtxDifColor[i] = LightVert(g_normal, i);
-            }
+            g_normal.x = g_vtxNormal[i].x;
+            g_normal.y = g_vtxNormal[i].y;
+            g_normal.z = g_vtxNormal[i].z;
             *(((uint8_t*)&(g_dwVtxDifColor[i]))+3) = vertcolors.a;    // still use alpha from the vertex
         }
         else
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <stdlib.h>
 #include "../../libretro/libretro_private.h"
+#include "../../Graphics/vec4f.h"
 
 #define M64P_PLUGIN_PROTOTYPES 1
 #include "osal_preproc.h"
@@ -383,6 +384,24 @@ bool isMMXSupported()
    return false; 
 }
 
+bool isSIMDSupported()
+{
+#if defined(VEC4F_SSE) || defined(VEC4F_NEON)
+   unsigned cpu = RETRO_SIMD_SSE2 | RETRO_SIMD_NEON;
+
+   if (perf_get_cpu_features_cb)
+      cpu = perf_get_cpu_features_cb();
+
+#if defined(VEC4F_SSE)
+   return (cpu & RETRO_SIMD_SSE2) != 0;
+#else
+   return (cpu & RETRO_SIMD_NEON) != 0;
+#endif
+#else
+   return false;
+#endif
+}
+
 static void ReadConfiguration(void)
 {
    struct retro_variable var = { "mupen64-screensize", 0 };
@@ -445,6 +464,7 @@ static void ReadConfiguration(void)
    CDeviceBuilder::SelectDeviceType((SupportedDeviceType)options.OpenglRenderSetting);
 
    status.isMMXSupported = isMMXSupported();
+   status.isSIMDEnabled = isSIMDSupported();
    ProcessVertexData = ProcessVertexDataNoSSE;
 }
     
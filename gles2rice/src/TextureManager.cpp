@@ -27,42 +27,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 CTextureManager gTextureManager;
 
-unsigned int g_maxTextureMemUsage = (5*1024*1024);
-unsigned int g_amountToFree = (512*1024);
+unsigned int g_maxTextureMemUsage = (64*1024*1024);
 bool g_bUseSetTextureMem = false;
 
-// Returns the first prime greater than or equal to nFirst
-inline int GetNextPrime(int nFirst)
-{
-   int nCurrent = nFirst;
-
-   // Just make sure it's odd
-   if ((nCurrent % 2) == 0)
-      nCurrent++;
-
-   for (;;)
-   {
-      // nSqrtCurrent = nCurrent^0.5 + 1 (round up)
-      int nSqrtCurrent  = (int)sqrt((double)nCurrent) + 1;
-      bool bIsComposite = false;
-
-      // Test all odd numbers from 3..nSqrtCurrent
-      for (int i = 3; i <= nSqrtCurrent; i+=2)
-      {
-         if ((nCurrent % i) == 0)
-         {
-            bIsComposite = true;
-            break;
-         }
-      }
-
-      if (!bIsComposite)
-         return nCurrent;
-
-      // Select next odd candidate...
-      nCurrent += 2;
-   }
-}
+#define TXTR_CACHE_INITIAL_SLOTS    1024
 
 ///////////////////////////////////////////////////////////////////////
 //
@@ -70,19 +38,19 @@ inline int GetNextPrime(int nFirst)
 CTextureManager::CTextureManager() :
     m_pHead(NULL),
     m_pCacheTxtrList(NULL),
-    m_numOfCachedTxtrList(809)
+    m_numOfCachedTxtrList(TXTR_CACHE_INITIAL_SLOTS),
+    m_numOfCachedTxtr(0)
 {
-    m_numOfCachedTxtrList = GetNextPrime(800);
-
     m_currentTextureMemUsage    = 0;
     m_pYoungestTexture          = NULL;
     m_pOldestTexture            = NULL;
 
-    m_pCacheTxtrList = new TxtrCacheEntry *[m_numOfCachedTxtrList];
+    m_pCacheTxtrList = new TxtrCacheSlot[m_numOfCachedTxtrList];
 
     for (uint32_t i = 0; i < m_numOfCachedTxtrList; i++)
-        m_pCacheTxtrList[i] = NULL;
+        m_pCacheTxtrList[i].pEntry = NULL;
 
+    memset(&m_stats, 0, sizeof(m_stats));
     memset(&m_blackTextureEntry, 0, sizeof(TxtrCacheEntry));
     memset(&m_PrimColorTextureEntry, 0, sizeof(TxtrCacheEntry));
     memset(&m_EnvColorTextureEntry, 0, sizeof(TxtrCacheEntry));
@@ -129,6 +97,15 @@ bool CTextureManager::CleanUp()
     return true;
 }
 
+void CTextureManager::PrintCacheStats()
+{
+    DebugMessage(M64MSG_INFO, "Texture cache: %u hits, %u misses, %u reloads, %u evictions, %u table growths",
+        m_stats.dwHits, m_stats.dwMisses, m_stats.dwReloads, m_stats.dwEvictions, m_stats.dwTableGrowths);
+    DebugMessage(M64MSG_INFO, "Texture cache: %u CRCs calculated, %u reused within a frame, %u entries in %u KB",
+        m_stats.dwCRCs, m_stats.dwCRCsSaved, m_numOfCachedTxtr, m_currentTextureMemUsage / 1024);
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
 bool CTextureManager::TCacheEntryIsLoaded(TxtrCacheEntry *pEntry)
 {
     for (int i = 0; i < MAX_TEXTURES; i++)
@@ -152,20 +129,17 @@ void CTextureManager::PurgeOldTextures()
     static const uint32_t dwFramesToKill = 5*30;          // 5 secs at 30 fps
     static const uint32_t dwFramesToDelete = 30*30;       // 30 secs at 30 fps
     
-    for ( uint32_t i = 0; i < m_numOfCachedTxtrList; i++ )
+    // Removing an entry can move a later one into its slot, so the slot
+    // is looked at again before moving on.
+    uint32_t i = 0;
+    while (i < m_numOfCachedTxtrList)
     {
-        TxtrCacheEntry * pEntry;
-        TxtrCacheEntry * pNext;
-        
-        pEntry = m_pCacheTxtrList[i];
-        while (pEntry)
-        {
-            pNext = pEntry->pNext;
-            
-            if ( status.gDlistCount - pEntry->FrameLastUsed > dwFramesToKill && !TCacheEntryIsLoaded(pEntry))
-                RemoveTexture(pEntry);
-            pEntry = pNext;
-        }
+        TxtrCacheEntry * pEntry = m_pCacheTxtrList[i].pEntry;
+
+        if (pEntry && status.gDlistCount - pEntry->FrameLastUsed > dwFramesToKill && !TCacheEntryIsLoaded(pEntry))
+            RemoveTexture(pEntry);
+        else
+            i++;
     }
     
     
@@ -202,27 +176,23 @@ void CTextureManager::RecycleAllTextures()
     if (m_pCacheTxtrList == NULL)
         return;
     
-    uint32_t dwCount = 0;
-    uint32_t dwTotalUses = 0;
-    
     m_pYoungestTexture          = NULL;
     m_pOldestTexture            = NULL;
+    m_currentTextureMemUsage    = 0;
 
     for (uint32_t i = 0; i < m_numOfCachedTxtrList; i++)
     {
-        while (m_pCacheTxtrList[i])
-        {
-            TxtrCacheEntry *pTVictim = m_pCacheTxtrList[i];
-            m_pCacheTxtrList[i] = pTVictim->pNext;
-            
-            dwTotalUses += pTVictim->dwUses;
-            dwCount++;
-            if (g_bUseSetTextureMem)
-                delete pTVictim;
-            else
-               RecycleTexture(pTVictim);
-        }
+        TxtrCacheEntry *pTVictim = m_pCacheTxtrList[i].pEntry;
+        if (pTVictim == NULL)
+            continue;
+
+        m_pCacheTxtrList[i].pEntry = NULL;
+        if (g_bUseSetTextureMem)
+            delete pTVictim;
+        else
+            RecycleTexture(pTVictim);
     }
+    m_numOfCachedTxtr = 0;
 }
 
 void CTextureManager::RecheckHiresForAllTextures()
@@ -232,13 +202,8 @@ void CTextureManager::RecheckHiresForAllTextures()
 
     for (uint32_t i = 0; i < m_numOfCachedTxtrList; i++)
     {
-        while (m_pCacheTxtrList[i])
-        {
-            TxtrCacheEntry *pTVictim = m_pCacheTxtrList[i];
-            m_pCacheTxtrList[i] = pTVictim->pNext;
-            pTVictim->bExternalTxtrChecked = false;
-
-        }
+        if (m_pCacheTxtrList[i].pEntry)
+            m_pCacheTxtrList[i].pEntry->bExternalTxtrChecked = false;
     }
 }
 
@@ -283,18 +248,77 @@ TxtrCacheEntry * CTextureManager::ReviveTexture( uint32_t width, uint32_t height
 }
 
 
-uint32_t CTextureManager::Hash(uint32_t dwValue)
+uint32_t CTextureManager::Hash(const TxtrInfo &ti)
 {
     // Divide by four, because most textures will be on a 4 byte boundry, so bottom four
     // bits are null
-    return (dwValue>>2) % m_numOfCachedTxtrList;
+    uint32_t dwKey = (ti.Address >> 2) ^ (ti.Format << 27) ^ (ti.Size << 30);
+    dwKey *= 0x9E3779B1;
+    return dwKey ^ (dwKey >> 16);
 }
 
-void CTextureManager::MakeTextureYoungest(TxtrCacheEntry *pEntry)
+void CTextureManager::InsertSlot(uint32_t dwKey, TxtrCacheEntry *pEntry)
 {
-    if (!g_bUseSetTextureMem)
-        return;
+    const uint32_t dwMask = m_numOfCachedTxtrList - 1;
+    uint32_t i = dwKey & dwMask;
+
+    while (m_pCacheTxtrList[i].pEntry != NULL)
+        i = (i + 1) & dwMask;
+
+    m_pCacheTxtrList[i].dwKey = dwKey;
+    m_pCacheTxtrList[i].pEntry = pEntry;
+}
+
+// Empties a slot, then moves back the entries after it that would no
+// longer be reached from their home slot.
+void CTextureManager::RemoveSlot(uint32_t dwSlot)
+{
+    const uint32_t dwMask = m_numOfCachedTxtrList - 1;
+    uint32_t i = dwSlot;
+    uint32_t j = dwSlot;
+
+    for (;;)
+    {
+        m_pCacheTxtrList[i].pEntry = NULL;
+
+        for (;;)
+        {
+            j = (j + 1) & dwMask;
+            if (m_pCacheTxtrList[j].pEntry == NULL)
+                return;
+
+            uint32_t dwHome = m_pCacheTxtrList[j].dwKey & dwMask;
+            if (((j - dwHome) & dwMask) >= ((j - i) & dwMask))
+                break;
+        }
 
+        m_pCacheTxtrList[i] = m_pCacheTxtrList[j];
+        i = j;
+    }
+}
+
+void CTextureManager::GrowTable()
+{
+    TxtrCacheSlot *pOldList = m_pCacheTxtrList;
+    uint32_t dwOldSize = m_numOfCachedTxtrList;
+
+    m_numOfCachedTxtrList *= 2;
+    m_pCacheTxtrList = new TxtrCacheSlot[m_numOfCachedTxtrList];
+    for (uint32_t i = 0; i < m_numOfCachedTxtrList; i++)
+        m_pCacheTxtrList[i].pEntry = NULL;
+
+    for (uint32_t i = 0; i < dwOldSize; i++)
+    {
+        if (pOldList[i].pEntry)
+            InsertSlot(pOldList[i].dwKey, pOldList[i].pEntry);
+    }
+
+    delete []pOldList;
+    m_stats.dwTableGrowths++;
+}
+
+void CTextureManager::MakeTextureYoungest(TxtrCacheEntry *pEntry)
+{
     if (pEntry == m_pYoungestTexture)
         return;
 
@@ -331,38 +355,66 @@ void CTextureManager::MakeTextureYoungest(TxtrCacheEntry *pEntry)
     }
 }
 
+// pEntry->ti and pEntry->dwPalCRC must be set
 void CTextureManager::AddTexture(TxtrCacheEntry *pEntry)
 {   
-    uint32_t dwKey = Hash(pEntry->ti.Address);
-    
     if (m_pCacheTxtrList == NULL)
         return;
     
-    //TxtrCacheEntry **p = &m_pCacheTxtrList[dwKey];
-    
-    // Add to head (not tail, for speed - new textures are more likely to be accessed next)
-    pEntry->pNext = m_pCacheTxtrList[dwKey];
-    m_pCacheTxtrList[dwKey] = pEntry;
+    // Keep the table at most half full
+    if ((m_numOfCachedTxtr + 1) * 2 > m_numOfCachedTxtrList)
+        GrowTable();
+
+    InsertSlot(Hash(pEntry->ti), pEntry);
+    m_numOfCachedTxtr++;
 
     // Move the texture to the top of the age list
     MakeTextureYoungest(pEntry);
 }
 
 
-
+// Returns an entry for the texture with any palette, preferring one whose
+// CRC was already checked in this frame.
 TxtrCacheEntry * CTextureManager::GetTxtrCacheEntry(TxtrInfo * pti)
 {
-    TxtrCacheEntry *pEntry;
+    TxtrCacheEntry *pFound = NULL;
+    
+    if (m_pCacheTxtrList == NULL)
+        return NULL;
     
+    const uint32_t dwKey = Hash(*pti);
+    const uint32_t dwMask = m_numOfCachedTxtrList - 1;
+
+    for (uint32_t i = dwKey & dwMask; m_pCacheTxtrList[i].pEntry; i = (i + 1) & dwMask)
+    {
+        TxtrCacheEntry *pEntry = m_pCacheTxtrList[i].pEntry;
+
+        if (m_pCacheTxtrList[i].dwKey == dwKey && pEntry->ti == *pti)
+        {
+            if (pEntry->FrameLastCRCed == status.gDlistCount)
+                return pEntry;
+            if (pFound == NULL)
+                pFound = pEntry;
+        }
+    }
+
+    return pFound;
+}
+
+// Returns the entry for the texture with the given palette
+TxtrCacheEntry * CTextureManager::GetTxtrCacheEntry(TxtrInfo * pti, uint32_t dwPalCRC)
+{
     if (m_pCacheTxtrList == NULL)
         return NULL;
     
-    // See if it is already in the hash table
-    uint32_t dwKey = Hash(pti->Address);
+    const uint32_t dwKey = Hash(*pti);
+    const uint32_t dwMask = m_numOfCachedTxtrList - 1;
 
-    for (pEntry = m_pCacheTxtrList[dwKey]; pEntry; pEntry = pEntry->pNext)
+    for (uint32_t i = dwKey & dwMask; m_pCacheTxtrList[i].pEntry; i = (i + 1) & dwMask)
     {
-        if ( pEntry->ti == *pti )
+        TxtrCacheEntry *pEntry = m_pCacheTxtrList[i].pEntry;
+
+        if (m_pCacheTxtrList[i].dwKey == dwKey && pEntry->dwPalCRC == dwPalCRC && pEntry->ti == *pti)
         {
             MakeTextureYoungest(pEntry);
             return pEntry;
@@ -379,71 +431,66 @@ void CTextureManager::RemoveTexture(TxtrCacheEntry * pEntry)
     if (m_pCacheTxtrList == NULL)
         return;
 
-    // See if it is already in the hash table
-    uint32_t dwKey = Hash(pEntry->ti.Address);
-
-    TxtrCacheEntry* pPrev = NULL;
-    TxtrCacheEntry* pCurr = m_pCacheTxtrList[dwKey];
+    const uint32_t dwKey = Hash(pEntry->ti);
+    const uint32_t dwMask = m_numOfCachedTxtrList - 1;
 
-    while (pCurr)
+    for (uint32_t i = dwKey & dwMask; m_pCacheTxtrList[i].pEntry; i = (i + 1) & dwMask)
     {
-        // Check that the attributes match
-        if ( pCurr->ti == pEntry->ti )
-        {
-            if (pPrev != NULL) 
-                pPrev->pNext = pCurr->pNext;
-            else
-               m_pCacheTxtrList[dwKey] = pCurr->pNext;
+        if (m_pCacheTxtrList[i].pEntry != pEntry)
+            continue;
 
-            if (g_bUseSetTextureMem)
-            {
-                // remove the texture from the age list
-                if (pEntry->pNextYoungest != NULL)
-                    pEntry->pNextYoungest->pLastYoungest = pEntry->pLastYoungest;
-                if (pEntry->pLastYoungest != NULL)
-                    pEntry->pLastYoungest->pNextYoungest = pEntry->pNextYoungest;
-
-                // decrease the mem usage counter
-                m_currentTextureMemUsage -= (pEntry->pTexture->m_dwWidth * pEntry->pTexture->m_dwHeight * 4);
-            
-                delete pEntry;
-            }
-            else
-                RecycleTexture(pEntry);
+        RemoveSlot(i);
+        m_numOfCachedTxtr--;
 
-            break;
-        }
+        // remove the texture from the age list
+        if (pEntry == m_pOldestTexture)
+            m_pOldestTexture = pEntry->pNextYoungest;
+        if (pEntry == m_pYoungestTexture)
+            m_pYoungestTexture = pEntry->pLastYoungest;
+        if (pEntry->pNextYoungest != NULL)
+            pEntry->pNextYoungest->pLastYoungest = pEntry->pLastYoungest;
+        if (pEntry->pLastYoungest != NULL)
+            pEntry->pLastYoungest->pNextYoungest = pEntry->pNextYoungest;
+        pEntry->pNextYoungest = NULL;
+        pEntry->pLastYoungest = NULL;
 
-        pPrev = pCurr;
-        pCurr = pCurr->pNext;
+        // decrease the mem usage counter
+        m_currentTextureMemUsage -= pEntry->dwMemSize;
+
+        if (g_bUseSetTextureMem)
+            delete pEntry;
+        else
+            RecycleTexture(pEntry);
+        break;
     }
 }
     
+// The new entry is not in the table yet, AddTexture() it once its
+// TxtrInfo and palette CRC are set.
 TxtrCacheEntry * CTextureManager::CreateNewCacheEntry(uint32_t dwAddr, uint32_t dwWidth, uint32_t dwHeight)
 {
    TxtrCacheEntry * pEntry = NULL;
+   uint32_t dwMemSize = dwWidth * dwHeight * 4;
 
-   if (g_bUseSetTextureMem)
+   // make sure there is enough room for the new texture by deleting the
+   // least recently used textures that are not bound
+   TxtrCacheEntry *pVictim = m_pOldestTexture;
+   while ((m_currentTextureMemUsage + dwMemSize) > g_maxTextureMemUsage && pVictim != NULL)
    {
-      uint32_t widthToCreate = dwWidth;
-      uint32_t heightToCreate = dwHeight;
-      unsigned int freeUpSize = (widthToCreate * heightToCreate * 4) + g_amountToFree;
+      TxtrCacheEntry *nextYoungest = pVictim->pNextYoungest;
 
-      // make sure there is enough room for the new texture by deleting old textures
-      while ((m_currentTextureMemUsage + freeUpSize) > g_maxTextureMemUsage && m_pOldestTexture != NULL)
+      if (!TCacheEntryIsLoaded(pVictim))
       {
-         TxtrCacheEntry *nextYoungest = m_pOldestTexture->pNextYoungest;
-
-         RemoveTexture(m_pOldestTexture);
-
-         m_pOldestTexture = nextYoungest;
-
-         //printf("Freeing Texture\n");
+         RemoveTexture(pVictim);
+         m_stats.dwEvictions++;
       }
 
-      m_currentTextureMemUsage += widthToCreate * heightToCreate * 4;
+      pVictim = nextYoungest;
    }
-   else
+
+   m_currentTextureMemUsage += dwMemSize;
+
+   if (!g_bUseSetTextureMem)
    {
       // Find a used texture
       pEntry = ReviveTexture(dwWidth, dwHeight);
@@ -456,6 +503,7 @@ TxtrCacheEntry * CTextureManager::CreateNewCacheEntry(uint32_t dwAddr, uint32_t
       if (pEntry == NULL)
       {
          _VIDEO_DisplayTemporaryMessage("Error to create an texture entry");
+         m_currentTextureMemUsage -= dwMemSize;
          return NULL;
       }
 
@@ -480,14 +528,15 @@ TxtrCacheEntry * CTextureManager::CreateNewCacheEntry(uint32_t dwAddr, uint32_t
    pEntry->dwUses = 0;
    pEntry->dwTimeLastUsed = status.gRDPTime;
    pEntry->dwCRC = 0;
+   pEntry->dwPalCRC = 0;
    pEntry->FrameLastUsed = status.gDlistCount;
    pEntry->FrameLastUpdated = 0;
+   pEntry->FrameLastCRCed = 0;
+   pEntry->dwMemSize = dwMemSize;
    pEntry->lastEntry = NULL;
    pEntry->bExternalTxtrChecked = false;
    pEntry->maxCI = -1;
 
-   // Add to the hash table
-   AddTexture(pEntry);
    return pEntry;  
 }
 
@@ -558,10 +607,11 @@ TxtrCacheEntry * CTextureManager::GetTexture(TxtrInfo * pgti, bool fromTMEM, boo
         }
     }
 
-    if (pEntry && pEntry->dwTimeLastUsed == status.gRDPTime && status.gDlistCount != 0 && !status.bN64FrameBufferIsUsed )       // This is not good, Palatte may changes
+    if (pEntry && pEntry->FrameLastCRCed == status.gDlistCount && status.gDlistCount != 0 && !status.bN64FrameBufferIsUsed )
     {
         // We've already calculated a CRC this frame!
         dwAsmCRC = pEntry->dwCRC;
+        m_stats.dwCRCsSaved++;
     }
     else
     {
@@ -570,7 +620,10 @@ TxtrCacheEntry * CTextureManager::GetTexture(TxtrInfo * pgti, bool fromTMEM, boo
             if( loadFromTextureBuffer )
                 dwAsmCRC = gRenderTextureInfos[txtBufIdxToLoadFrom].crcInRDRAM;
             else
+            {
                 CalculateRDRAMCRC(pgti->pPhysicalAddress, pgti->LeftToLoad, pgti->TopToLoad, pgti->WidthToLoad, pgti->HeightToLoad, pgti->Size, pgti->Pitch);
+                m_stats.dwCRCs++;
+            }
         }
     }
 
@@ -613,12 +666,20 @@ TxtrCacheEntry * CTextureManager::GetTexture(TxtrInfo * pgti, bool fromTMEM, boo
         dwAsmCRC = dwAsmCRCSave;
     }
 
+    // A palette texture has an entry for each palette it is drawn with
+    if (pEntry && doCRCCheck && pEntry->dwPalCRC != dwPalCRC)
+        pEntry = GetTxtrCacheEntry(pgti, dwPalCRC);
+    else if (pEntry)
+        MakeTextureYoungest(pEntry);
+
     if (pEntry && doCRCCheck )
     {
         if(pEntry->dwCRC == dwAsmCRC && pEntry->dwPalCRC == dwPalCRC &&
             (!loadFromTextureBuffer || gRenderTextureInfos[txtBufIdxToLoadFrom].updateAtFrame < pEntry->FrameLastUsed ) )
         {
             // Tile is ok, return
+            m_stats.dwHits++;
+            pEntry->FrameLastCRCed = status.gDlistCount;
             pEntry->dwUses++;
             pEntry->dwTimeLastUsed = status.gRDPTime;
             pEntry->FrameLastUsed = status.gDlistCount;
@@ -634,7 +695,8 @@ TxtrCacheEntry * CTextureManager::GetTexture(TxtrInfo * pgti, bool fromTMEM, boo
         }
     }
 
-    if (pEntry == NULL)
+    bool bNewEntry = (pEntry == NULL);
+    if (bNewEntry)
     {
         // We need to create a new entry, and add it
         //  to the hash table.
@@ -646,13 +708,20 @@ TxtrCacheEntry * CTextureManager::GetTexture(TxtrInfo * pgti, bool fromTMEM, boo
             _VIDEO_DisplayTemporaryMessage("Fail to create new texture entry");
             return NULL;
         }
+        m_stats.dwMisses++;
     }
+    else
+        m_stats.dwReloads++;
 
     pEntry->ti = *pgti;
     pEntry->dwCRC = dwAsmCRC;
     pEntry->dwPalCRC = dwPalCRC;
     pEntry->bExternalTxtrChecked = false;
     pEntry->maxCI = maxCI;
+    if (doCRCCheck)
+        pEntry->FrameLastCRCed = status.gDlistCount;
+    if (bNewEntry)
+        AddTexture(pEntry);
 
     if (pEntry->pTexture != NULL)
     {
@@ -1171,43 +1240,19 @@ TxtrCacheEntry * CTextureManager::GetCachedTexture(uint32_t tex)
    uint32_t size = 0;
    for( uint32_t i=0; i<m_numOfCachedTxtrList; i++ )
    {
-      if( m_pCacheTxtrList[i] == NULL )
+      if( m_pCacheTxtrList[i].pEntry == NULL )
          continue;
-      else
-      {
-         TxtrCacheEntry *pEntry;
-
-         for (pEntry = m_pCacheTxtrList[i]; pEntry; pEntry = pEntry->pNext)
-         {
-            if( size == tex )
-               return pEntry;
-            else
-               size++;
-         }
-      }
+      if( size == tex )
+         return m_pCacheTxtrList[i].pEntry;
+      size++;
    }
    return NULL;
 }
 
 uint32_t CTextureManager::GetNumOfCachedTexture()
 {
-   uint32_t size = 0;
-   for( uint32_t i=0; i<m_numOfCachedTxtrList; i++ )
-   {
-      if( m_pCacheTxtrList[i] == NULL )
-         continue;
-      else
-      {
-         TxtrCacheEntry *pEntry;
-
-         for (pEntry = m_pCacheTxtrList[i]; pEntry; pEntry = pEntry->pNext)
-         {
-            size++;
-         }
-      }
-   }
-   TRACE1("Totally %d texture cached", size);
-   return size;
+   TRACE1("Totally %d texture cached", m_numOfCachedTxtr);
+   return m_numOfCachedTxtr;
 }
 #endif
 
@@ -154,6 +154,8 @@ typedef struct TxtrCacheEntry
     uint32_t  dwTimeLastUsed; // timeGetTime of time of last usage
     uint32_t  FrameLastUsed;  // Frame # that this was last used
     uint32_t  FrameLastUpdated;
+    uint32_t  FrameLastCRCed; // Frame # in which dwCRC was last checked against RDRAM
+    uint32_t  dwMemSize;      // Bytes counted against g_maxTextureMemUsage
 
     CTexture    *pTexture;
     CTexture    *pEnhancedTexture;
@@ -166,8 +168,33 @@ typedef struct TxtrCacheEntry
 } TxtrCacheEntry;
 
 
+// Slot of the texture cache table. Empty slots have pEntry == NULL.
+typedef struct TxtrCacheSlot
+{
+    uint32_t        dwKey;      // CTextureManager::Hash() of the entry
+    TxtrCacheEntry *pEntry;
+} TxtrCacheSlot;
+
+typedef struct TxtrCacheStats
+{
+    uint32_t  dwHits;           // Found, RDRAM unchanged
+    uint32_t  dwMisses;         // Not found, a new entry was made
+    uint32_t  dwReloads;        // Found, but RDRAM or the palette had changed
+    uint32_t  dwCRCs;           // CRCs calculated over a texture
+    uint32_t  dwCRCsSaved;      // CRCs reused from earlier in the frame
+    uint32_t  dwEvictions;      // Entries dropped to stay within g_maxTextureMemUsage
+    uint32_t  dwTableGrowths;   // Times the table was rehashed into a larger one
+} TxtrCacheStats;
+
 //*****************************************************************************
 // Texture cache implementation
+//
+// Entries are kept in an open addressing table (linear probing, no
+// tombstones) hashed on address, format and size. An entry matches when its
+// TxtrInfo is the same and, for palette textures, the CRC of the palette is
+// the same, so a texture drawn with several palettes keeps an entry for each
+// of them. Entries are also kept on an age list, and the least recently used
+// ones are dropped when a new texture would exceed g_maxTextureMemUsage.
 //*****************************************************************************
 class CTextureManager
 {
@@ -178,6 +205,10 @@ protected:
     void RecycleTexture(TxtrCacheEntry *pEntry);
     TxtrCacheEntry * ReviveTexture( uint32_t width, uint32_t height );
     TxtrCacheEntry * GetTxtrCacheEntry(TxtrInfo * pti);
+    TxtrCacheEntry * GetTxtrCacheEntry(TxtrInfo * pti, uint32_t dwPalCRC);
+    void InsertSlot(uint32_t dwKey, TxtrCacheEntry *pEntry);
+    void RemoveSlot(uint32_t dwSlot);
+    void GrowTable();
     
     void ConvertTexture(TxtrCacheEntry * pEntry, bool fromTMEM);
     void ConvertTexture_16(TxtrCacheEntry * pEntry, bool fromTMEM);
@@ -202,7 +233,7 @@ protected:
     void ExpandTexture(TxtrCacheEntry * pEntry, uint32_t sizeOfLoad, uint32_t sizeToCreate, uint32_t sizeCreated,
         int arrayWidth, int flag, int mask, int mirror, int clamp, uint32_t otherSize);
 
-    uint32_t Hash(uint32_t dwValue);
+    uint32_t Hash(const TxtrInfo &ti);
     bool TCacheEntryIsLoaded(TxtrCacheEntry *pEntry);
 
     void updateColorTexture(CTexture *ptexture, uint32_t color);
@@ -214,8 +245,10 @@ public:
     
 protected:
     TxtrCacheEntry * m_pHead;
-    TxtrCacheEntry ** m_pCacheTxtrList;
-    uint32_t m_numOfCachedTxtrList;
+    TxtrCacheSlot * m_pCacheTxtrList;
+    uint32_t m_numOfCachedTxtrList;     // Slots, a power of two
+    uint32_t m_numOfCachedTxtr;         // Entries in the slots
+    TxtrCacheStats m_stats;
 
     TxtrCacheEntry m_blackTextureEntry;
     TxtrCacheEntry m_PrimColorTextureEntry;
@@ -244,6 +277,7 @@ public:
     void RecycleAllTextures();
     void RecheckHiresForAllTextures();
     bool CleanUp();
+    void PrintCacheStats();
     
 #ifdef DEBUGGER
     TxtrCacheEntry * GetCachedTexture(uint32_t tex);
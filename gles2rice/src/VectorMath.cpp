@@ -23,6 +23,8 @@
 
 #include "VectorMath.h"
 
+#include "../../Graphics/3dmath.h"
+
 //---------- XMATRIX
 
 XMATRIX::XMATRIX()
@@ -144,16 +146,7 @@ XMATRIX XMATRIX::operator * ( const XMATRIX &pIn ) const
 {
     XMATRIX mTemp;
     
-    for (int i=0; i<4; i++)
-    {
-        for (int j=0; j<4; j++)
-        {
-            mTemp.m[i][j] = m[i][0]*pIn.m[0][j] +
-                            m[i][1]*pIn.m[1][j] +
-                            m[i][2]*pIn.m[2][j] +
-                            m[i][3]*pIn.m[3][j];
-        }
-    }
+    MultMatrix(const_cast<float(*)[4]>(pIn.m), const_cast<float(*)[4]>(m), mTemp.m);
     
     return mTemp;
 }
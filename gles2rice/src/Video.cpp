@@ -378,6 +378,8 @@ void riceRomClosed(void)
 
     status.bGameIsRunning = false;
 
+    gTextureManager.PrintCacheStats();
+
     // Kill all textures?
     gTextureManager.RecycleAllTextures();
     gTextureManager.CleanUp();
@@ -121,6 +121,8 @@ typedef struct {
 
     bool    isMMXEnabled;
 
+    bool    isSIMDEnabled;          // ProcessVertexData works on four vertices at a time
+
     bool    toShowCFB;
 
     bool    bAllowLoadFromTMEM;
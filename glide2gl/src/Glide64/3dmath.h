@@ -54,6 +54,9 @@ void math_init(void);
 
 void MulMatrices(float m1[4][4], float m2[4][4], float r[4][4]);
 
+/* v->x, y, z and w from (x, y, z, 1) * rdp.combined */
+void transform_vertex(VERTEX *v, float x, float y, float z);
+
 void InverseTransformVector(float *src, float *dst, float mat[4][4]);
 void  NormalizeVector(float *v);
 
@@ -5,6 +5,7 @@
 #include "../../../Graphics/RSP/gSP_state.h"
 
 #include "glide64_gSP.h"
+#include "3dmath.h"
 
 int vtx_last = 0;
 
@@ -144,13 +145,13 @@ void glide64gSPClipRatio(uint32_t r)
 void glide64gSPClipVertex(uint32_t v)
 {
    VERTEX *vtx = (VERTEX*)&rdp.vtx[v];
+   float pos[4];
 
-   vtx->scr_off = 0;
-   if (vtx->x > +vtx->w)   vtx->scr_off |= 2;
-   if (vtx->x < -vtx->w)   vtx->scr_off |= 1;
-   if (vtx->y > +vtx->w)   vtx->scr_off |= 8;
-   if (vtx->y < -vtx->w)   vtx->scr_off |= 4;
-   if (vtx->w < 0.1f)      vtx->scr_off |= 16;
+   pos[0] = vtx->x;
+   pos[1] = vtx->y;
+   pos[2] = vtx->z;
+   pos[3] = vtx->w;
+   vtx->scr_off = ClipVertexFlags(pos, 0.1f);
 }
 
 void glide64gSPLookAt(uint32_t l, uint32_t n)
@@ -481,10 +482,7 @@ void glide64gSPVertex(uint32_t v, uint32_t n, uint32_t v0)
       vtx->uv_scaled    = 0;
       vtx->a            = color[0];
 
-      vtx->x = x*rdp.combined[0][0] + y*rdp.combined[1][0] + z*rdp.combined[2][0] + rdp.combined[3][0];
-      vtx->y = x*rdp.combined[0][1] + y*rdp.combined[1][1] + z*rdp.combined[2][1] + rdp.combined[3][1];
-      vtx->z = x*rdp.combined[0][2] + y*rdp.combined[1][2] + z*rdp.combined[2][2] + rdp.combined[3][2];
-      vtx->w = x*rdp.combined[0][3] + y*rdp.combined[1][3] + z*rdp.combined[2][3] + rdp.combined[3][3];
+      transform_vertex(vtx, x, y, z);
 
       vtx->uv_calculated = 0xFFFFFFFF;
       vtx->screen_translated = 0;
@@ -746,10 +744,7 @@ void glide64gSPCIVertex(uint32_t v, uint32_t n, uint32_t v0)
       vert->uv_scaled = 0;
       vert->a         = color[0];
 
-      vert->x         = x*rdp.combined[0][0] + y*rdp.combined[1][0] + z*rdp.combined[2][0] + rdp.combined[3][0];
-      vert->y         = x*rdp.combined[0][1] + y*rdp.combined[1][1] + z*rdp.combined[2][1] + rdp.combined[3][1];
-      vert->z         = x*rdp.combined[0][2] + y*rdp.combined[1][2] + z*rdp.combined[2][2] + rdp.combined[3][2];
-      vert->w         = x*rdp.combined[0][3] + y*rdp.combined[1][3] + z*rdp.combined[2][3] + rdp.combined[3][3];
+      transform_vertex(vert, x, y, z);
 
       vert->uv_calculated     = 0xFFFFFFFF;
       vert->screen_translated = 0;
@@ -837,10 +832,7 @@ void glide64gSPCBFDVertex(uint32_t a, uint32_t n, uint32_t v0)
       vert->uv_scaled   = 0;
       vert->a           = color[0];
 
-      vert->x = x*rdp.combined[0][0] + y*rdp.combined[1][0] + z*rdp.combined[2][0] + rdp.combined[3][0];
-      vert->y = x*rdp.combined[0][1] + y*rdp.combined[1][1] + z*rdp.combined[2][1] + rdp.combined[3][1];
-      vert->z = x*rdp.combined[0][2] + y*rdp.combined[1][2] + z*rdp.combined[2][2] + rdp.combined[3][2];
-      vert->w = x*rdp.combined[0][3] + y*rdp.combined[1][3] + z*rdp.combined[2][3] + rdp.combined[3][3];
+      transform_vertex(vert, x, y, z);
 
       vert->uv_calculated     = 0xFFFFFFFF;
       vert->screen_translated = 0;
@@ -109,10 +109,7 @@ static void t3d_vertex(uint32_t addr, uint32_t v0, uint32_t n)
       v->b         = ((uint8_t*)gfx_info.RDRAM)[(addr+i + 14)^3];
       v->a         = ((uint8_t*)gfx_info.RDRAM)[(addr+i + 15)^3];
 
-      v->x         = x*rdp.combined[0][0] + y*rdp.combined[1][0] + z*rdp.combined[2][0] + rdp.combined[3][0];
-      v->y         = x*rdp.combined[0][1] + y*rdp.combined[1][1] + z*rdp.combined[2][1] + rdp.combined[3][1];
-      v->z         = x*rdp.combined[0][2] + y*rdp.combined[1][2] + z*rdp.combined[2][2] + rdp.combined[3][2];
-      v->w         = x*rdp.combined[0][3] + y*rdp.combined[1][3] + z*rdp.combined[2][3] + rdp.combined[3][3];
+      transform_vertex(v, x, y, z);
 
       if (fabs(v->w) < 0.001)
          v->w              = 0.001f;
@@ -29,16 +29,32 @@
 
 #include "glide.h"
 #include "glitchmain.h"
+#include "glitch64_program_cache.h"
+#include "uthash.h"
 #include "../../libretro/libretro_private.h"
 
 #include "../../Graphics/RDP/RDP_state.h"
 
 float glide64_pow(float a, float b);
+extern const char* retro_get_system_directory(void);
 
-typedef struct _shader_program_key
-{
-   int index;
+/* Program binaries are core in GL 4.1 and GLES 3.1 */
+#if !defined(HAVE_OPENGLES) || defined(HAVE_OPENGLES_3_1)
+#define HAVE_PROGRAM_BINARY
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+/* Bump whenever the shaders generated for a key change, so that programs
+ * cached on disk by older builds are dropped. */
+#define PROGRAM_CACHE_VERSION 1
 
+typedef struct
+{
    int color_combiner;
    int alpha_combiner;
    int texture0_combiner;
@@ -50,6 +66,12 @@ typedef struct _shader_program_key
    int dither_enabled;
    int three_point_filter0;
    int three_point_filter1;
+} shader_key;
+
+typedef struct _shader_program_key
+{
+   shader_key key;
+
    GLuint program_object;
    int texture0_location;
    int texture1_location;
@@ -65,6 +87,8 @@ typedef struct _shader_program_key
    int constant_color_location;
    int ccolor0_location;
    int ccolor1_location;
+
+   UT_hash_handle hh;
 } shader_program_key;
 
 static int fct[4], source0[4], operand0[4], source1[4], operand1[4], source2[4], operand2[4];
@@ -72,10 +96,15 @@ static int fcta[4],sourcea0[4],operanda0[4],sourcea1[4],operanda1[4],sourcea2[4]
 static int alpha_ref, alpha_func;
 bool alpha_test = 0;
 
+/* hashed by key */
 static shader_program_key *shader_programs = NULL;
 static shader_program_key *current_shader  = NULL;
 
-static int number_of_programs = 0;
+static program_cache_t *program_cache = NULL;
+#ifdef HAVE_PROGRAM_BINARY
+static GLint program_binary_formats = 0;
+#endif
+
 static int color_combiner_key;
 static int alpha_combiner_key;
 static int texture0_combiner_key;
@@ -259,6 +288,16 @@ static char fragment_shader_texture0[1024*2];
 static char fragment_shader_chroma[1024*2];
 static char shader_log[2048];
 
+/* copies src to dst and returns the end of the copy, so that a shader is
+ * assembled without scanning it again for every part */
+static char *shader_append(char *dst, const char *src)
+{
+   size_t len = strlen(src);
+
+   memcpy(dst, src, len + 1);
+   return dst + len;
+}
+
 void check_compile(GLuint shader)
 {
    GLint success;
@@ -287,40 +326,8 @@ void check_link(GLuint program)
    }
 }
 
-static void append_shader_program(shader_program_key *shader)
-{
-   int curr_index;
-   int                   index = number_of_programs;
-
-   if (current_shader)
-      curr_index = current_shader->index;
-
-   shader->index = index;
-
-   if (!shader_programs)
-      shader_programs = (shader_program_key*)malloc(sizeof(shader_program_key));
-   else
-   {
-      shader_program_key *new_ptr = (shader_program_key*)
-         realloc(shader_programs, (index + 1) * sizeof(shader_program_key));
-      if (!new_ptr)
-         return;
-
-      shader_programs = new_ptr;
-   }
-
-   if (current_shader)
-      current_shader = &shader_programs[curr_index];
-
-   shader_programs[index] = *shader;
-
-   ++number_of_programs;
-}
-
-static void shader_bind_attributes(shader_program_key *shader)
+static void shader_bind_attributes(GLuint prog)
 {
-   GLuint prog = shader->program_object;
-
    glBindAttribLocation(prog, POSITION_ATTR,   "aPosition");
    glBindAttribLocation(prog, COLOUR_ATTR,     "aColor");
    glBindAttribLocation(prog, TEXCOORD_0_ATTR, "aMultiTexCoord0");
@@ -330,7 +337,7 @@ static void shader_bind_attributes(shader_program_key *shader)
 
 static void use_shader_program(shader_program_key *shader)
 {
-   current_shader = &shader_programs[shader->index];
+   current_shader = shader;
    glUseProgram(shader->program_object);
 }
 
@@ -356,60 +363,204 @@ static void shader_find_uniforms(shader_program_key *shader)
    shader->alphaRef_location       = glGetUniformLocation(prog, "alphaRef");
 }
 
-static void finish_shader_program_setup(shader_program_key *shader)
+static GLuint link_shader_program(const char *source)
 {
    GLuint fragshader = glCreateShader(GL_FRAGMENT_SHADER);
+   GLuint program;
 
-   glShaderSource(fragshader, 1, (const GLchar**)&fragment_shader, NULL);
+   glShaderSource(fragshader, 1, (const GLchar**)&source, NULL);
    glCompileShader(fragshader);
    check_compile(fragshader);
 
-   shader->program_object = glCreateProgram();
-   glAttachShader(shader->program_object, vertex_shader_object);
-   glAttachShader(shader->program_object, fragshader);
+   program = glCreateProgram();
+   glAttachShader(program, vertex_shader_object);
+   glAttachShader(program, fragshader);
 
-   shader_bind_attributes(shader);
+   shader_bind_attributes(program);
 
-   glLinkProgram(shader->program_object);
-   check_link(shader->program_object);
-   glUseProgram(shader->program_object);
+   glLinkProgram(program);
+   check_link(program);
+
+   /* freed along with the program */
+   glDeleteShader(fragshader);
+   return program;
+}
+
+static shader_program_key *add_shader_program(const shader_key *key, GLuint program)
+{
+   shader_program_key *shader = (shader_program_key*)calloc(1, sizeof(*shader));
 
+   if (!shader)
+   {
+      glDeleteProgram(program);
+      return NULL;
+   }
+
+   shader->key            = *key;
+   shader->program_object = program;
    shader_find_uniforms(shader);
-   append_shader_program(shader);
+
+   HASH_ADD(hh, shader_programs, key, sizeof(shader_key), shader);
+   return shader;
 }
 
-void init_combiner(void)
+static void free_shader_programs(void)
 {
-   shader_program_key shader;
+   shader_program_key *shader, *tmp;
+
+   HASH_ITER(hh, shader_programs, shader, tmp)
+   {
+      HASH_DEL(shader_programs, shader);
+      if (glIsProgram(shader->program_object))
+         glDeleteProgram(shader->program_object);
+      free(shader);
+   }
 
-   if (shader_programs)
-      free(shader_programs);
+   shader_programs = NULL;
+   current_shader  = NULL;
+}
 
-   number_of_programs = 0;
-   shader_programs    = NULL;
-   current_shader     = NULL;
+/* Saves the program, as a binary when the driver can give one back. */
+static void cache_shader_program(const shader_key *key, GLuint program, const char *source)
+{
+   void   *binary = NULL;
+   GLint   size   = 0;
+   GLenum  format = 0;
+
+   if (!program_cache)
+      return;
+
+#ifdef HAVE_PROGRAM_BINARY
+   if (program_binary_formats > 0)
+   {
+      glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+      if (size > 0)
+         binary = malloc(size);
+      if (binary)
+         glGetProgramBinary(program, size, &size, &format, binary);
+   }
+#endif
+
+   program_cache_add(program_cache, key, source, format, binary, binary ? size : 0);
+   free(binary);
+}
+
+static uint32_t hash_shader_text(uint32_t hash, const char *text)
+{
+   while (*text)
+      hash = (hash ^ (unsigned char)*text++) * 16777619u;
+   return hash;
+}
+
+/* Creates the programs of every key cached on disk, from the binaries when
+ * the driver takes them back and from the sources otherwise, so combiners
+ * seen in earlier runs do not have to be compiled during play. */
+static void load_program_cache(void)
+{
+   const char *vendor   = (const char*)glGetString(GL_VENDOR);
+   const char *renderer = (const char*)glGetString(GL_RENDERER);
+   const char *version  = (const char*)glGetString(GL_VERSION);
+   unsigned   loaded = 0, compiled = 0;
+   char       driver[512];
+   char       path[1024];
+   uint32_t   hash;
+   size_t     i, count;
+
+   snprintf(path, sizeof(path), "%s/glide64_programs.cache", retro_get_system_directory());
+   snprintf(driver, sizeof(driver), "%s / %s / %s",
+         vendor ? vendor : "", renderer ? renderer : "", version ? version : "");
+
+   hash = hash_shader_text(2166136261u ^ PROGRAM_CACHE_VERSION, vertex_shader);
+   hash = hash_shader_text(hash, fragment_shader_header);
+
+#ifdef HAVE_PROGRAM_BINARY
+   program_binary_formats = 0;
+   glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &program_binary_formats);
+#endif
+
+   program_cache = program_cache_open(path, hash, sizeof(shader_key), driver);
+   count         = program_cache_count(program_cache);
+
+   for (i = 0; i < count; i++)
+   {
+      const struct program_cache_entry *entry = program_cache_get(program_cache, i);
+      shader_program_key *shader;
+      GLuint program = 0;
+      shader_key key;
+
+      /* the file gives no alignment */
+      memcpy(&key, entry->key, sizeof(key));
+      HASH_FIND(hh, shader_programs, &key, sizeof(key), shader);
+      if (shader)
+         continue;
+
+#ifdef HAVE_PROGRAM_BINARY
+      if (entry->binary && program_binary_formats > 0)
+      {
+         GLint linked = GL_FALSE;
+
+         program = glCreateProgram();
+         glProgramBinary(program, entry->binary_format, entry->binary, (GLsizei)entry->binary_size);
+         glGetProgramiv(program, GL_LINK_STATUS, &linked);
+         if (linked)
+            loaded++;
+         else
+         {
+            glDeleteProgram(program);
+            program = 0;
+         }
+      }
+#endif
+
+      if (!program)
+      {
+         program = link_shader_program(entry->source);
+         cache_shader_program(&key, program, entry->source);
+         compiled++;
+      }
+
+      add_shader_program(&key, program);
+   }
+
+   if (count && log_cb)
+      log_cb(RETRO_LOG_INFO, "Glitch64: %u cached programs loaded, %u compiled from cached sources\n",
+            loaded, compiled);
+}
+
+void init_combiner(void)
+{
+   shader_key key;
+   shader_program_key *shader;
+   char *end;
+
+   free_shader_programs();
    fragment_shader    = (char*)malloc(4096*2);
    need_to_compile    = true;
 
    /* default shader */
-   memset(&shader, 0, sizeof(shader));
+   memset(&key, 0, sizeof(key));
 
-   strcpy(fragment_shader, fragment_shader_header);
-   strcat(fragment_shader, fragment_shader_default);
-   strcat(fragment_shader, fragment_shader_end);
+   end = shader_append(fragment_shader, fragment_shader_header);
+   end = shader_append(end, fragment_shader_default);
+   shader_append(end, fragment_shader_end);
 
    vertex_shader_object = glCreateShader(GL_VERTEX_SHADER);
    glShaderSource(vertex_shader_object, 1, (const GLchar**)&vertex_shader, NULL);
    glCompileShader(vertex_shader_object);
    check_compile(vertex_shader_object);
 
-   finish_shader_program_setup(&shader);
-   program_object_default = shader.program_object;
+   program_object_default = link_shader_program(fragment_shader);
+   shader = add_shader_program(&key, program_object_default);
 
-   use_shader_program(&shader);
+   if (shader)
+   {
+      use_shader_program(shader);
+
+      glUniform1i(shader->texture0_location, 0);
+      glUniform1i(shader->texture1_location, 1);
+   }
 
-   glUniform1i(shader.texture0_location, 0);
-   glUniform1i(shader.texture1_location, 1);
+   load_program_cache();
 
    strcpy(fragment_shader_color_combiner, "");
    strcpy(fragment_shader_alpha_combiner, "");
@@ -513,98 +664,81 @@ static void update_uniforms(const shader_program_key *prog)
 
 void compile_shader(void)
 {
-   shader_program_key shader;
-   int i;
+   shader_program_key *shader;
+   shader_key key;
+   GLuint program;
+   char *end;
 
    need_to_compile = 0;
 
-   for( i = 0; i < number_of_programs; i++)
+   memset(&key, 0, sizeof(key));
+
+   key.color_combiner      = color_combiner_key;
+   key.alpha_combiner      = alpha_combiner_key;
+   key.texture0_combiner   = texture0_combiner_key;
+   key.texture1_combiner   = texture1_combiner_key;
+   key.texture0_combinera  = texture0_combinera_key;
+   key.texture1_combinera  = texture1_combinera_key;
+   key.fog_enabled         = fog_enabled;
+   key.chroma_enabled      = chroma_enabled;
+   key.dither_enabled      = dither_enabled;
+   key.three_point_filter0 = three_point_filter[0];
+   key.three_point_filter1 = three_point_filter[1];
+
+   HASH_FIND(hh, shader_programs, &key, sizeof(key), shader);
+   if (shader)
    {
-      shader_program_key *program = &shader_programs[i];
-      if(program->color_combiner == color_combiner_key &&
-            program->alpha_combiner == alpha_combiner_key &&
-            program->texture0_combiner == texture0_combiner_key &&
-            program->texture1_combiner == texture1_combiner_key &&
-            program->texture0_combinera == texture0_combinera_key &&
-            program->texture1_combinera == texture1_combinera_key &&
-            program->fog_enabled == fog_enabled &&
-            program->chroma_enabled == chroma_enabled &&
-            program->dither_enabled == dither_enabled &&
-            program->three_point_filter0 == three_point_filter[0] &&
-            program->three_point_filter1 == three_point_filter[1])
-      {
-         use_shader_program(program);
-         update_uniforms(program);
-         return;
-      }
+      use_shader_program(shader);
+      update_uniforms(shader);
+      return;
    }
 
-   memset(&shader, 0, sizeof(shader));
-
-   shader.color_combiner = color_combiner_key;
-   shader.alpha_combiner = alpha_combiner_key;
-   shader.texture0_combiner = texture0_combiner_key;
-   shader.texture1_combiner = texture1_combiner_key;
-   shader.texture0_combinera = texture0_combinera_key;
-   shader.texture1_combinera = texture1_combinera_key;
-   shader.fog_enabled    = fog_enabled;
-   shader.chroma_enabled = chroma_enabled;
-   shader.dither_enabled = dither_enabled;
-   shader.three_point_filter0 = three_point_filter[0];
-   shader.three_point_filter1 = three_point_filter[1];
-
-   strcpy(fragment_shader, fragment_shader_header);
+   end = shader_append(fragment_shader, fragment_shader_header);
 
    if (dither_enabled)
-      strcat(fragment_shader, fragment_shader_dither);
+      end = shader_append(end, fragment_shader_dither);
 
-   strcat(fragment_shader, three_point_filter[0] ? fragment_shader_readtex0color_3point : fragment_shader_readtex0color);
-   strcat(fragment_shader, three_point_filter[1] ? fragment_shader_readtex1color_3point : fragment_shader_readtex1color);
-   strcat(fragment_shader, fragment_shader_texture0);
-   strcat(fragment_shader, fragment_shader_texture1);
-   strcat(fragment_shader, fragment_shader_color_combiner);
-   strcat(fragment_shader, fragment_shader_alpha_combiner);
+   end = shader_append(end, three_point_filter[0] ? fragment_shader_readtex0color_3point : fragment_shader_readtex0color);
+   end = shader_append(end, three_point_filter[1] ? fragment_shader_readtex1color_3point : fragment_shader_readtex1color);
+   end = shader_append(end, fragment_shader_texture0);
+   end = shader_append(end, fragment_shader_texture1);
+   end = shader_append(end, fragment_shader_color_combiner);
+   end = shader_append(end, fragment_shader_alpha_combiner);
 
    if (fog_enabled)
-      strcat(fragment_shader, fragment_shader_fog);
+      end = shader_append(end, fragment_shader_fog);
 
    if (chroma_enabled)
    {
-      strcat(fragment_shader, fragment_shader_chroma);
+      end = shader_append(end, fragment_shader_chroma);
       strcat(fragment_shader_texture1, "test_chroma(ctexture1); \n");
       compile_chroma_shader();
    }
 
-   strcat(fragment_shader, fragment_shader_end);
+   shader_append(end, fragment_shader_end);
+
+   program = link_shader_program(fragment_shader);
+   cache_shader_program(&key, program, fragment_shader);
 
-   finish_shader_program_setup(&shader);
+   shader = add_shader_program(&key, program);
+   if (!shader)
+      return;
 
-   update_uniforms(&shader);
+   use_shader_program(shader);
+   update_uniforms(shader);
 }
 
 void free_combiners(void)
 {
-   if (shader_programs)
-   {
-      shader_program_key *s = shader_programs;
-
-      while (number_of_programs--)
-      {
-         if (glIsProgram(s->program_object))
-            glDeleteProgram(s->program_object);
-      }
+   free_shader_programs();
 
-      free(shader_programs);
-   }
+   program_cache_close(program_cache);
+   program_cache = NULL;
 
    if (fragment_shader)
       free(fragment_shader);
 
-   shader_programs = NULL;
-   current_shader  = NULL;
    fragment_shader = NULL;
-
-   number_of_programs = 0;
 }
 
 void set_copy_shader(void)
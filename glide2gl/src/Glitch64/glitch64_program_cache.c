@@ -0,0 +1,247 @@
+/*
+* Glide64 - Glide video plugin for Nintendo 64 emulators.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glitch64_program_cache.h"
+
+/* Layout, in host byte order:
+ *   header: magic, version, key size, driver string length, driver string
+ *   entry:  source size (with the NUL), binary size, binary format,
+ *           key, source, binary */
+#define PROGRAM_CACHE_MAGIC 0x50343647 /* "G64P" */
+
+struct program_cache
+{
+   FILE *file;
+   size_t key_size;
+   unsigned char *data;   /* file contents the entries point into */
+   struct program_cache_entry *entries;
+   size_t count;
+};
+
+static bool read_u32(const unsigned char **p, const unsigned char *end, uint32_t *v)
+{
+   if ((size_t)(end - *p) < sizeof(*v))
+      return false;
+   memcpy(v, *p, sizeof(*v));
+   *p += sizeof(*v);
+   return true;
+}
+
+static bool write_u32(FILE *f, uint32_t v)
+{
+   return fwrite(&v, sizeof(v), 1, f) == 1;
+}
+
+static bool write_header(FILE *f, uint32_t version, size_t key_size, const char *driver)
+{
+   const uint32_t len = (uint32_t)strlen(driver);
+
+   return write_u32(f, PROGRAM_CACHE_MAGIC) && write_u32(f, version)
+      && write_u32(f, (uint32_t)key_size) && write_u32(f, len)
+      && fwrite(driver, 1, len, f) == len;
+}
+
+static bool write_entry(FILE *f, size_t key_size, const struct program_cache_entry *e)
+{
+   const size_t source_size = strlen(e->source) + 1;
+   const size_t binary_size = e->binary ? e->binary_size : 0;
+
+   return write_u32(f, (uint32_t)source_size) && write_u32(f, (uint32_t)binary_size)
+      && write_u32(f, e->binary_format)
+      && fwrite(e->key, 1, key_size, f) == key_size
+      && fwrite(e->source, 1, source_size, f) == source_size
+      && (binary_size == 0 || fwrite(e->binary, 1, binary_size, f) == binary_size);
+}
+
+static unsigned char *read_file(const char *path, size_t *size)
+{
+   FILE *f = fopen(path, "rb");
+   unsigned char *data = NULL;
+   long len;
+
+   if (!f)
+      return NULL;
+   if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0)
+   {
+      data = (unsigned char*)malloc((size_t)len);
+      if (data && fread(data, 1, (size_t)len, f) != (size_t)len)
+      {
+         free(data);
+         data = NULL;
+      }
+      *size = (size_t)len;
+   }
+   fclose(f);
+   return data;
+}
+
+/* Reads the entries of a file written with the same version and key size;
+ * returns false if the file needs to be written again. */
+static bool parse(program_cache_t *cache, size_t size, uint32_t version, const char *driver)
+{
+   const unsigned char *p = cache->data, *end = cache->data + size;
+   uint32_t magic, file_version, key_size, driver_len;
+   bool same_driver, clean = true;
+
+   if (!read_u32(&p, end, &magic) || magic != PROGRAM_CACHE_MAGIC
+         || !read_u32(&p, end, &file_version) || file_version != version
+         || !read_u32(&p, end, &key_size) || key_size != cache->key_size
+         || !read_u32(&p, end, &driver_len) || (size_t)(end - p) < driver_len)
+      return false;
+
+   same_driver = driver_len == strlen(driver) && memcmp(p, driver, driver_len) == 0;
+   p += driver_len;
+
+   while (p < end)
+   {
+      struct program_cache_entry e;
+      uint32_t source_size, binary_size;
+      size_t i, left;
+
+      /* sizes are checked one at a time against what is left, so a corrupt
+       * file cannot wrap their sum past the end of the data */
+      if (!read_u32(&p, end, &source_size) || !read_u32(&p, end, &binary_size)
+            || !read_u32(&p, end, &e.binary_format)
+            || source_size == 0)
+         return false;
+      left = end - p;
+      if (left < cache->key_size)
+         return false;
+      left -= cache->key_size;
+      if (left < source_size)
+         return false;
+      left -= source_size;
+      if (left < binary_size
+            || p[cache->key_size + source_size - 1] != '\0')
+         return false; /* cut short while it was written */
+
+      e.key = p;
+      e.source = (const char*)p + cache->key_size;
+      e.binary = (same_driver && binary_size) ? p + cache->key_size + source_size : NULL;
+      e.binary_size = e.binary ? binary_size : 0;
+      p += cache->key_size + source_size + binary_size;
+
+      if (binary_size && !same_driver)
+         clean = false;
+
+      for (i = 0; i < cache->count; i++)
+         if (memcmp(cache->entries[i].key, e.key, cache->key_size) == 0)
+            break;
+      if (i < cache->count)
+         clean = false;
+      else
+         cache->count++;
+      cache->entries[i] = e;
+   }
+
+   return clean && same_driver;
+}
+
+program_cache_t *program_cache_open(const char *path, uint32_t version,
+      size_t key_size, const char *driver)
+{
+   program_cache_t *cache = (program_cache_t*)calloc(1, sizeof(*cache));
+   size_t size = 0, max_entries;
+   bool clean = false;
+
+   if (!cache)
+      return NULL;
+   cache->key_size = key_size;
+
+   cache->data = read_file(path, &size);
+   if (cache->data)
+   {
+      /* every entry takes at least its key and a NUL */
+      max_entries = size / (3 * sizeof(uint32_t) + key_size + 1) + 1;
+      cache->entries = (struct program_cache_entry*)malloc(max_entries * sizeof(*cache->entries));
+      if (cache->entries)
+         clean = parse(cache, size, version, driver);
+      if (!clean && cache->count == 0)
+      {
+         /* nothing worth keeping */
+         free(cache->entries);
+         free(cache->data);
+         cache->entries = NULL;
+         cache->data = NULL;
+      }
+   }
+
+   if (clean)
+      cache->file = fopen(path, "ab");
+   else
+   {
+      size_t i;
+
+      cache->file = fopen(path, "wb");
+      if (cache->file && !write_header(cache->file, version, key_size, driver))
+      {
+         fclose(cache->file);
+         cache->file = NULL;
+      }
+      for (i = 0; cache->file && i < cache->count; i++)
+         write_entry(cache->file, key_size, &cache->entries[i]);
+      if (cache->file)
+         fflush(cache->file);
+   }
+
+   return cache;
+}
+
+void program_cache_close(program_cache_t *cache)
+{
+   if (!cache)
+      return;
+   if (cache->file)
+      fclose(cache->file);
+   free(cache->entries);
+   free(cache->data);
+   free(cache);
+}
+
+size_t program_cache_count(const program_cache_t *cache)
+{
+   return cache ? cache->count : 0;
+}
+
+const struct program_cache_entry *program_cache_get(const program_cache_t *cache, size_t i)
+{
+   return &cache->entries[i];
+}
+
+bool program_cache_add(program_cache_t *cache, const void *key, const char *source,
+      uint32_t binary_format, const void *binary, size_t binary_size)
+{
+   struct program_cache_entry e;
+
+   if (!cache || !cache->file)
+      return false;
+
+   e.key = key;
+   e.source = source;
+   e.binary = binary;
+   e.binary_size = binary_size;
+   e.binary_format = binary_format;
+
+   if (!write_entry(cache->file, cache->key_size, &e))
+      return false;
+   return fflush(cache->file) == 0;
+}
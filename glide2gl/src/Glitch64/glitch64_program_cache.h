@@ -0,0 +1,60 @@
+/*
+* Glide64 - Glide video plugin for Nintendo 64 emulators.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef GLITCH64_PROGRAM_CACHE_H
+#define GLITCH64_PROGRAM_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boolean.h>
+
+/* On-disk cache of combiner programs.
+ *
+ * Each entry holds a combiner key, the fragment shader source built for it
+ * and, if the driver can export them, the linked program binary. The file
+ * is dropped when the generator version or the key size changes. Binaries
+ * saved under another driver string are dropped but their sources are
+ * kept, so the programs can still be compiled ahead of use.
+ *
+ * New entries are appended as they are compiled; an entry added again for
+ * the same key replaces the older one when the file is next opened. */
+
+struct program_cache_entry
+{
+   const void *key;
+   const char *source;
+   const void *binary;   /* NULL when there is none */
+   size_t binary_size;
+   uint32_t binary_format;
+};
+
+typedef struct program_cache program_cache_t;
+
+program_cache_t *program_cache_open(const char *path, uint32_t version,
+      size_t key_size, const char *driver);
+void program_cache_close(program_cache_t *cache);
+
+/* entries read when the cache was opened */
+size_t program_cache_count(const program_cache_t *cache);
+const struct program_cache_entry *program_cache_get(const program_cache_t *cache, size_t i);
+
+bool program_cache_add(program_cache_t *cache, const void *key, const char *source,
+      uint32_t binary_format, const void *binary, size_t binary_size);
+
+#endif
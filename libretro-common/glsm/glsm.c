@@ -1842,6 +1842,46 @@ void rglWaitSync(void *sync, GLbitfield flags, uint64_t timeout)
 #endif
 }
 
+/*
+ *
+ * Core in:
+ * OpenGL    : 3.2
+ * OpenGLES  : 3.0
+ */
+GLenum rglClientWaitSync(void *sync, GLbitfield flags, uint64_t timeout)
+{
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES) && defined(HAVE_OPENGLES3)
+   return glClientWaitSync((GLsync)sync, flags, (GLuint64)timeout);
+#else
+   return 0;
+#endif
+}
+
+/*
+ *
+ * Core in:
+ * OpenGL    : 3.2
+ * OpenGLES  : 3.0
+ */
+void rglDeleteSync(void *sync)
+{
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES) && defined(HAVE_OPENGLES3)
+   glDeleteSync((GLsync)sync);
+#endif
+}
+
+/*
+ *
+ * Core in:
+ * OpenGL    : 4.4
+ */
+void rglBufferStorage(GLenum target, GLsizeiptr size, const GLvoid *data, GLbitfield flags)
+{
+#if defined(HAVE_OPENGL)
+   glBufferStorage(target, size, data, flags);
+#endif
+}
+
 /* GLSM-side */
 
 static void glsm_state_setup(void)
@@ -161,6 +161,9 @@ RETRO_BEGIN_DECLS
 #define glClearBufferfi             rglClearBufferfi
 #define glWaitSync                  rglWaitSync
 #define glFenceSync                 rglFenceSync
+#define glClientWaitSync            rglClientWaitSync
+#define glDeleteSync                rglDeleteSync
+#define glBufferStorage             rglBufferStorage
 
 const GLubyte* rglGetStringi(GLenum name, GLuint index);
 void rglTexBuffer(GLenum target, GLenum internalFormat, GLuint buffer);
@@ -397,6 +400,9 @@ void rglTexSubImage2D( 	GLenum target,
 void rglDeleteVertexArrays(GLsizei n, const GLuint *arrays);
 void *rglFenceSync(GLenum condition, GLbitfield flags);
 void rglWaitSync(void *sync, GLbitfield flags, uint64_t timeout);
+GLenum rglClientWaitSync(void *sync, GLbitfield flags, uint64_t timeout);
+void rglDeleteSync(void *sync);
+void rglBufferStorage(GLenum target, GLsizeiptr size, const GLvoid *data, GLbitfield flags);
 
 RETRO_END_DECLS
 
@@ -53,6 +53,8 @@
 #include <retro_inline.h>
 #include <boolean.h>
 
+#include "crc32_accel.h"
+
 #ifdef _MSC_VER
 typedef unsigned __int8  uint8_t;
 typedef unsigned __int32 uint32_t;
@@ -99,6 +101,8 @@ void CRC_BuildTable(void)
 
    table_initialized = true;
 
+   crc32_accel_features();
+
    for (i = 0; i <= 0xFF; i++)
    {
      uint32_t crc = i;
@@ -114,7 +118,12 @@ void CRC_BuildTable(void)
 
 unsigned int CRC32(unsigned int crc, void *buffer, unsigned int count)
 {
-   return crc32_8bytes(buffer, count, crc);
+   /* Hardware folding takes the bulk, the slices finish the tail. */
+   uint32_t raw = ~crc;
+   size_t done  = crc32_accel_update(CRC32_ACCEL_BRUMME, &raw, buffer, count);
+   if (done == count)
+      return ~raw;
+   return crc32_8bytes((const uint8_t*)buffer + done, count - done, ~raw);
 }
 
 uint32_t CRC_Calculate(void *buffer, uint32_t count)
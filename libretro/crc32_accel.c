@@ -0,0 +1,397 @@
+/* Hardware accelerated CRC-32 paths shared by the video plugins.
+ *
+ * x86:   PCLMULQDQ folding (any reflected polynomial, constants below) and
+ *        the SSE4.2 crc32 instruction (CRC-32C only).
+ * ARMv8: the crc32/crc32c instructions when the compiler targets them.
+ *
+ * Every path is selected at runtime from crc32_accel_features() and falls
+ * back to slicing-by-8 tables, so the results never depend on the CPU. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "crc32_accel.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#if defined(_MSC_VER) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) || defined(__clang__)
+#define CRC32_ACCEL_X86 1
+#endif
+#endif
+
+#if defined(CRC32_ACCEL_X86)
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CRC32_TARGET(x)
+#else
+#include <cpuid.h>
+#define CRC32_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32_ACCEL_ARMV8 1
+#endif
+
+#define CRC32_IEEE_REFLECTED       0xEDB88320
+#define CRC32_BRUMME_REFLECTED     0x04C11DB7
+#define CRC32_CASTAGNOLI_REFLECTED 0x82F63B78
+
+static uint32_t crc_table_ieee[8][256];
+static uint32_t crc_table_c[8][256];
+static int      crc_features = -1;
+
+static void crc32_accel_build_table(uint32_t table[8][256], uint32_t poly)
+{
+   int i, j, slice;
+
+   for (i = 0; i < 256; i++)
+   {
+      uint32_t crc = i;
+      for (j = 0; j < 8; j++)
+         crc = (crc >> 1) ^ ((crc & 1) * poly);
+      table[0][i] = crc;
+   }
+
+   for (slice = 1; slice < 8; slice++)
+      for (i = 0; i < 256; i++)
+         table[slice][i] = (table[slice - 1][i] >> 8) ^ table[0][table[slice - 1][i] & 0xFF];
+}
+
+static uint32_t crc32_accel_table(uint32_t table[8][256], uint32_t crc,
+      const uint8_t *p, size_t len)
+{
+   while (len && ((uintptr_t)p & 3))
+   {
+      crc = (crc >> 8) ^ table[0][(crc ^ *p++) & 0xFF];
+      len--;
+   }
+
+   while (len >= 8)
+   {
+      uint32_t one, two;
+      memcpy(&one, p, 4);
+      memcpy(&two, p + 4, 4);
+#ifdef MSB_FIRST
+      one = ((one >> 24) | ((one >> 8) & 0xFF00) | ((one << 8) & 0xFF0000) | (one << 24));
+      two = ((two >> 24) | ((two >> 8) & 0xFF00) | ((two << 8) & 0xFF0000) | (two << 24));
+#endif
+      one ^= crc;
+      crc = table[7][ one        & 0xFF] ^
+            table[6][(one >>  8) & 0xFF] ^
+            table[5][(one >> 16) & 0xFF] ^
+            table[4][ one >> 24        ] ^
+            table[3][ two        & 0xFF] ^
+            table[2][(two >>  8) & 0xFF] ^
+            table[1][(two >> 16) & 0xFF] ^
+            table[0][ two >> 24        ];
+      p   += 8;
+      len -= 8;
+   }
+
+   while (len--)
+      crc = (crc >> 8) ^ table[0][(crc ^ *p++) & 0xFF];
+
+   return crc;
+}
+
+unsigned crc32_accel_features(void)
+{
+   unsigned features = 0;
+
+   if (crc_features >= 0)
+      return crc_features;
+
+   crc32_accel_build_table(crc_table_ieee, CRC32_IEEE_REFLECTED);
+   crc32_accel_build_table(crc_table_c, CRC32_CASTAGNOLI_REFLECTED);
+
+#if defined(CRC32_ACCEL_X86)
+   {
+      int regs[4] = {0};
+#ifdef _MSC_VER
+      __cpuid(regs, 1);
+#else
+      unsigned a, b, c, d;
+      if (__get_cpuid(1, &a, &b, &c, &d))
+         regs[2] = c;
+#endif
+      /* PCLMULQDQ (bit 1) plus SSE4.1 (bit 19) for pextrd */
+      if ((regs[2] & (1 << 1)) && (regs[2] & (1 << 19)))
+         features |= CRC32_ACCEL_HAS_PCLMUL;
+      if (regs[2] & (1 << 20))
+         features |= CRC32_ACCEL_HAS_SSE42;
+   }
+#endif
+#if defined(CRC32_ACCEL_ARMV8)
+   features |= CRC32_ACCEL_HAS_ARMV8;
+#endif
+
+   if (getenv("CRC32_ACCEL_DISABLE"))
+      features = 0;
+
+   crc_features = features;
+   return features;
+}
+
+#if defined(CRC32_ACCEL_X86)
+
+/* Folding constants for a reflected polynomial P (see Intel's
+ * "Fast CRC Computation Using PCLMULQDQ"): k1/k2 fold 512 bits,
+ * k3/k4 fold 128 bits, k5 folds 64 -> 32, then a Barrett reduction
+ * with P' and mu = x^64 / P. */
+struct crc32_fold_consts
+{
+   uint64_t k1k2[2];
+   uint64_t k3k4[2];
+   uint64_t k5k0[2];
+   uint64_t poly[2];
+};
+
+static const struct crc32_fold_consts crc32_fold_ieee = {
+   { 0x0154442bd4ULL, 0x01c6e41596ULL },
+   { 0x01751997d0ULL, 0x00ccaa009eULL },
+   { 0x0163cd6124ULL, 0x0000000000ULL },
+   { 0x01db710641ULL, 0x01f7011641ULL }
+};
+
+/* Same derivation for brumme_crc.c's polynomial, whose x^0 term is
+ * clear; the folding and Barrett steps do not depend on it. */
+static const struct crc32_fold_consts crc32_fold_brumme = {
+   { 0x0007dbe810ULL, 0x00094e01e6ULL },
+   { 0x000e22d4dcULL, 0x000862c3fcULL },
+   { 0x0008b1aaecULL, 0x0000000000ULL },
+   { 0x0009823b6fULL, 0x01207389d3ULL }
+};
+
+/* len must be at least 64 and a multiple of 16. */
+CRC32_TARGET("pclmul,sse4.1")
+static uint32_t crc32_fold_pclmul(const struct crc32_fold_consts *k,
+      uint32_t crc, const uint8_t *buf, size_t len)
+{
+   __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+   x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+   x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+   x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+   x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+   x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+
+   x0 = _mm_loadu_si128((const __m128i*)k->k1k2);
+
+   buf += 64;
+   len -= 64;
+
+   /* four independent 128-bit accumulators */
+   while (len >= 64)
+   {
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+      x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+      x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+      x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+      x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+      x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+      x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(buf + 0x00)));
+      x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(buf + 0x10)));
+      x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(buf + 0x20)));
+      x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(buf + 0x30)));
+
+      buf += 64;
+      len -= 64;
+   }
+
+   /* fold the accumulators into one */
+   x0 = _mm_loadu_si128((const __m128i*)k->k3k4);
+
+   x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+   x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+   x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+   x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+   x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+   x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+   while (len >= 16)
+   {
+      x2 = _mm_loadu_si128((const __m128i*)buf);
+
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+      buf += 16;
+      len -= 16;
+   }
+
+   /* 128 -> 64 bits */
+   x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+   x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+   x1 = _mm_srli_si128(x1, 8);
+   x1 = _mm_xor_si128(x1, x2);
+
+   x0 = _mm_loadl_epi64((const __m128i*)k->k5k0);
+
+   x2 = _mm_srli_si128(x1, 4);
+   x1 = _mm_and_si128(x1, x3);
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+   x1 = _mm_xor_si128(x1, x2);
+
+   /* Barrett reduction to 32 bits */
+   x0 = _mm_loadu_si128((const __m128i*)k->poly);
+
+   x2 = _mm_and_si128(x1, x3);
+   x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+   x2 = _mm_and_si128(x2, x3);
+   x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+   x1 = _mm_xor_si128(x1, x2);
+
+   return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+CRC32_TARGET("sse4.2")
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *p, size_t len)
+{
+   while (len && ((uintptr_t)p & 7))
+   {
+      crc = _mm_crc32_u8(crc, *p++);
+      len--;
+   }
+#if defined(__x86_64__) || defined(_M_X64)
+   {
+      uint64_t crc64 = crc;
+      while (len >= 8)
+      {
+         uint64_t v;
+         memcpy(&v, p, 8);
+         crc64 = _mm_crc32_u64(crc64, v);
+         p   += 8;
+         len -= 8;
+      }
+      crc = (uint32_t)crc64;
+   }
+#endif
+   while (len >= 4)
+   {
+      uint32_t v;
+      memcpy(&v, p, 4);
+      crc  = _mm_crc32_u32(crc, v);
+      p   += 4;
+      len -= 4;
+   }
+   while (len--)
+      crc = _mm_crc32_u8(crc, *p++);
+   return crc;
+}
+
+#endif
+
+#if defined(CRC32_ACCEL_ARMV8)
+
+static uint32_t crc32_armv8(uint32_t crc, const uint8_t *p, size_t len)
+{
+   while (len && ((uintptr_t)p & 7))
+   {
+      crc = __crc32b(crc, *p++);
+      len--;
+   }
+   while (len >= 8)
+   {
+      uint64_t v;
+      memcpy(&v, p, 8);
+      crc  = __crc32d(crc, v);
+      p   += 8;
+      len -= 8;
+   }
+   while (len--)
+      crc = __crc32b(crc, *p++);
+   return crc;
+}
+
+static uint32_t crc32c_armv8(uint32_t crc, const uint8_t *p, size_t len)
+{
+   while (len && ((uintptr_t)p & 7))
+   {
+      crc = __crc32cb(crc, *p++);
+      len--;
+   }
+   while (len >= 8)
+   {
+      uint64_t v;
+      memcpy(&v, p, 8);
+      crc  = __crc32cd(crc, v);
+      p   += 8;
+      len -= 8;
+   }
+   while (len--)
+      crc = __crc32cb(crc, *p++);
+   return crc;
+}
+
+#endif
+
+size_t crc32_accel_update(enum crc32_accel_poly poly, uint32_t *crc,
+      const void *buf, size_t len)
+{
+   unsigned features = crc32_accel_features();
+
+   (void)features;
+   (void)poly;
+   (void)crc;
+   (void)buf;
+
+#if defined(CRC32_ACCEL_ARMV8)
+   if (poly == CRC32_ACCEL_IEEE && (features & CRC32_ACCEL_HAS_ARMV8))
+   {
+      *crc = crc32_armv8(*crc, (const uint8_t*)buf, len);
+      return len;
+   }
+#endif
+#if defined(CRC32_ACCEL_X86)
+   /* Below 64 bytes the setup costs more than the table loop. */
+   if (len >= 64 && (features & CRC32_ACCEL_HAS_PCLMUL))
+   {
+      size_t bulk = len & ~(size_t)15;
+      *crc = crc32_fold_pclmul(poly == CRC32_ACCEL_IEEE
+            ? &crc32_fold_ieee : &crc32_fold_brumme,
+            *crc, (const uint8_t*)buf, bulk);
+      return bulk;
+   }
+#endif
+   return 0;
+}
+
+uint32_t crc32_accel_ieee(uint32_t crc, const void *buf, size_t len)
+{
+   size_t done = crc32_accel_update(CRC32_ACCEL_IEEE, &crc, buf, len);
+   if (done == len)
+      return crc;
+   return crc32_accel_table(crc_table_ieee, crc, (const uint8_t*)buf + done, len - done);
+}
+
+uint32_t crc32_accel_c(uint32_t crc, const void *buf, size_t len)
+{
+   unsigned features = crc32_accel_features();
+
+   (void)features;
+
+#if defined(CRC32_ACCEL_X86)
+   if (features & CRC32_ACCEL_HAS_SSE42)
+      return crc32c_sse42(crc, (const uint8_t*)buf, len);
+#endif
+#if defined(CRC32_ACCEL_ARMV8)
+   if (features & CRC32_ACCEL_HAS_ARMV8)
+      return crc32c_armv8(crc, (const uint8_t*)buf, len);
+#endif
+   return crc32_accel_table(crc_table_c, crc, (const uint8_t*)buf, len);
+}
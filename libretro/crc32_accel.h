@@ -0,0 +1,54 @@
+#ifndef _LIBRETRO_CRC32_ACCEL_H
+#define _LIBRETRO_CRC32_ACCEL_H
+
+/* Hardware CRC paths shared by the video plugins.
+ *
+ * All functions work on the raw reflected CRC register (no pre- or
+ * post-inversion), so callers keep whatever conditioning their existing
+ * CRC routines apply and the resulting values stay bit-identical to the
+ * table based code they replace. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum crc32_accel_poly
+{
+   /* 0xEDB88320 reflected: zlib / IEEE 802.3 (libretro_crc.c, GLideN64, Rice) */
+   CRC32_ACCEL_IEEE = 0,
+   /* 0x04C11DB7 used directly as the reflected constant (brumme_crc.c).
+    * Not a standard CRC, but ucode detection tables depend on it. */
+   CRC32_ACCEL_BRUMME
+};
+
+#define CRC32_ACCEL_HAS_PCLMUL   (1 << 0)
+#define CRC32_ACCEL_HAS_SSE42    (1 << 1)
+#define CRC32_ACCEL_HAS_ARMV8    (1 << 2)
+
+/* Probes the CPU once; later calls return the cached mask.
+ * Setting CRC32_ACCEL_DISABLE in the environment forces the table paths. */
+unsigned crc32_accel_features(void);
+
+/* Advances *crc over a prefix of buf using the fastest available path and
+ * returns how many bytes were consumed. The caller finishes the remaining
+ * (len - return value) bytes with its own table code. Returns 0 when no
+ * hardware path applies to this polynomial or length. */
+size_t crc32_accel_update(enum crc32_accel_poly poly, uint32_t *crc,
+      const void *buf, size_t len);
+
+/* Raw IEEE CRC-32 register update over the whole buffer. */
+uint32_t crc32_accel_ieee(uint32_t crc, const void *buf, size_t len);
+
+/* Raw CRC-32C (Castagnoli) register update over the whole buffer.
+ * Used for cache keys that are never persisted, where the polynomial is
+ * free to follow the fastest instruction (SSE4.2 crc32 / ARMv8 crc32c). */
+uint32_t crc32_accel_c(uint32_t crc, const void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
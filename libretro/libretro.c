@@ -27,6 +27,7 @@
 #include "../mupen64plus-rsp-cxd4/config.h"
 #include "plugin/audio_libretro/audio_plugin.h"
 #include "../Graphics/plugin.h"
+#include "../Graphics/3dmath.h"
 
 #ifndef PRESCALE_WIDTH
 #define PRESCALE_WIDTH  640
@@ -81,6 +82,8 @@ static uint32_t game_size = 0;
 static bool     emu_initialized     = false;
 static unsigned initial_boot        = true;
 static unsigned audio_buffer_size   = 2048;
+static unsigned audio_output_rate   = 44100;
+static bool     audio_polyphase     = true;
 
 static unsigned retro_filtering     = 0;
 static bool     reinit_screen       = false;
@@ -257,6 +260,10 @@ static void setup_variables(void)
 #endif
       {"mupen64-audio-buffer-size",
          "Audio Buffer Size (restart); 2048|1024"},
+      {"mupen64-audio-rate",
+         "Audio Output Rate (restart); 44100|48000"},
+      {"mupen64-audio-resampler",
+         "Audio Resampler (restart); polyphase|sinc"},
       {"mupen64-astick-deadzone",
         "Analog Deadzone (percent); 15|20|25|30|0|5|10"},
       {"mupen64-pak1",
@@ -570,7 +577,7 @@ void retro_get_system_av_info(struct retro_system_av_info *info)
    info->geometry.max_height   = screen_height;
    info->geometry.aspect_ratio = 4.0 / 3.0;
    info->timing.fps = (region == SYSTEM_PAL) ? 50.0 : (60/1.001);                // TODO: Actual timing 
-   info->timing.sample_rate = 44100.0;
+   info->timing.sample_rate = audio_output_rate;
 }
 
 unsigned retro_get_region (void)
@@ -595,6 +602,10 @@ void retro_init(void)
    else
       perf_get_cpu_features_cb = NULL;
 
+   /* SSE2 or NEON vertex math for the HLE plugins, if the CPU has it */
+   if (perf_get_cpu_features_cb)
+      MathInit((perf_get_cpu_features_cb() & (RETRO_SIMD_SSE2 | RETRO_SIMD_NEON)) != 0);
+
    environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &colorMode);
    environ_cb(RETRO_ENVIRONMENT_GET_RUMBLE_INTERFACE, &rumble);
 
@@ -690,6 +701,18 @@ void update_variables(bool startup)
       if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
          audio_buffer_size = atoi(var.value);
 
+      var.key = "mupen64-audio-rate";
+      var.value = NULL;
+
+      if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+         audio_output_rate = atoi(var.value);
+
+      var.key = "mupen64-audio-resampler";
+      var.value = NULL;
+
+      if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+         audio_polyphase = !strcmp(var.value, "polyphase");
+
       var.key = "mupen64-gfxplugin";
       var.value = NULL;
 
@@ -968,7 +991,8 @@ bool retro_load_game(const struct retro_game_info *game)
    update_variables(true);
    initial_boot = false;
 
-   init_audio_libretro(audio_buffer_size);
+   init_audio_libretro(audio_buffer_size, audio_output_rate,
+         audio_polyphase ? "polyphase" : "sinc");
 
 #if defined(HAVE_VULKAN)
    if (gfx_plugin == GFX_PARALLEL)
@@ -1179,6 +1203,8 @@ void retro_run (void)
          glsm_exit();
 #endif
    } while (emu_step_render());
+
+   drain_audio_libretro();
 }
 
 void retro_reset (void)
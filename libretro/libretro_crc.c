@@ -1,6 +1,8 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include "crc32_accel.h"
+
 #define CRC32_POLYNOMIAL     0x04C11DB7
 
 unsigned int CRCTable[ 256 ];
@@ -33,23 +35,18 @@ void CRC_BuildTable(void)
          crc = (crc << 1) ^ (crc & (1 << 31) ? CRC32_POLYNOMIAL : 0);
       CRCTable[i] = Reflect( crc, 32 );
    }
+
+   crc32_accel_features();
 }
 
 unsigned int CRC32( unsigned int crc, void *buffer, unsigned int count )
 {
-   uint8_t *p = (uint8_t*) buffer;
-   while (count--)
-      crc = (crc >> 8) ^ CRCTable[(crc & 0xFF) ^ *p++];
-   return ~crc;
+   return ~crc32_accel_ieee(crc, buffer, count);
 }
 
 uint32_t CRC_Calculate(void *buffer, uint32_t count)
 {
-   uint32_t crc = 0xffffffff;
-   uint8_t *p = (uint8_t*) buffer;
-   while (count--)
-      crc = (crc >> 8) ^ CRCTable[(crc & 0xFF) ^ *p++];
-   return ~crc;
+   return ~crc32_accel_ieee(0xffffffff, buffer, count);
 }
 
 uint32_t adler32(uint32_t adler, void *buf, int len)
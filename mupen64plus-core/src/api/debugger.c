@@ -40,6 +40,8 @@
 #include "main/main.h"
 #include "memory/memory.h"
 #include "../pi/pi_controller.h"
+#include "../si/si_controller.h"
+#include "r4300/lockstep.h"
 #include "r4300/r4300_core.h"
 #include "../ri/ri_controller.h"
 #include "../vi/vi_controller.h"
@@ -79,6 +81,10 @@ void CoreCompareCallback(void)
 {
     if (callback_core_compare != NULL)
         (*callback_core_compare)(op_R4300);
+#ifdef COMPARE_CORE
+    else
+        lockstep_check();
+#endif
 }
 
 void CoreCompareDataSync(int length, void *ptr)
@@ -365,9 +371,9 @@ EXPORT int CALL DebugBreakpointCommand(m64p_dbg_bkp_command command, unsigned in
         case M64P_BKP_CMD_ADD_ADDR:
             return add_breakpoint(index);
         case M64P_BKP_CMD_ADD_STRUCT:
-            return add_breakpoint_struct((breakpoint *) ptr);
+            return add_breakpoint_struct((m64p_breakpoint *) ptr);
         case M64P_BKP_CMD_REPLACE:
-            replace_breakpoint_num(index, (breakpoint *) ptr);
+            replace_breakpoint_num(index, (m64p_breakpoint *) ptr);
             return 0;
         case M64P_BKP_CMD_REMOVE_ADDR:
             remove_breakpoint_by_address(index);
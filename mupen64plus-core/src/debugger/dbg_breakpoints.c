@@ -19,6 +19,10 @@
  *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <SDL.h>
 #include <SDL_thread.h>
 
@@ -32,95 +36,277 @@
 #include "memory/memory.h"
 
 int g_NumBreakpoints=0;
-breakpoint g_Breakpoints[BREAKPOINTS_MAX_NUMBER];
+m64p_breakpoint g_Breakpoints[BREAKPOINTS_MAX_NUMBER];
+
+/* Lookup index over the enabled breakpoints, rebuilt whenever the list
+ * changes. For each access kind it holds a bitmap of the 4 KB pages that
+ * some breakpoint touches, so that the common "nothing here" answer is a
+ * single bit test, and the intervals sorted by start address as an
+ * implicit balanced tree with the largest end address of every subtree,
+ * so a hit test is O(log n). Ranges that wrap past 0xFFFFFFFF are split
+ * in two. */
+#define BPT_PAGE_SHIFT  12
+#define BPT_PAGE_WORDS  (1 << (32 - BPT_PAGE_SHIFT - 5))
+
+enum { BPT_KIND_EXEC, BPT_KIND_READ, BPT_KIND_WRITE, BPT_KINDS };
+
+static const uint32 bpt_kind_flag[BPT_KINDS] = {
+    M64P_BKP_FLAG_EXEC, M64P_BKP_FLAG_READ, M64P_BKP_FLAG_WRITE
+};
+
+struct bpt_interval {
+    uint32 start;
+    uint32 end;
+    int num;
+};
+
+struct bpt_index {
+    int count;
+    struct bpt_interval iv[2 * BREAKPOINTS_MAX_NUMBER];
+    uint32 maxend[2 * BREAKPOINTS_MAX_NUMBER];
+    uint32 pages[BPT_PAGE_WORDS];
+};
+
+static struct bpt_index g_BptIndex[BPT_KINDS];
+
+static void mark_pages(struct bpt_index *idx, uint32 start, uint32 end)
+{
+    uint32 page = start >> BPT_PAGE_SHIFT, last = end >> BPT_PAGE_SHIFT;
+
+    /* whole words first, for breakpoints over large ranges */
+    while (page <= last) {
+        if ((page & 31) == 0 && last - page >= 31) {
+            idx->pages[page >> 5] = 0xFFFFFFFF;
+            if (last - page == 31)
+                break;
+            page += 32;
+        }
+        else {
+            idx->pages[page >> 5] |= 1u << (page & 31);
+            if (page == last)
+                break;
+            page++;
+        }
+    }
+}
+
+static int compare_intervals(const void *a, const void *b)
+{
+    const struct bpt_interval *x = (const struct bpt_interval *) a;
+    const struct bpt_interval *y = (const struct bpt_interval *) b;
+
+    if (x->start != y->start)
+        return (x->start < y->start) ? -1 : 1;
+    return x->num - y->num;
+}
+
+static uint32 build_maxend(struct bpt_index *idx, int lo, int hi)
+{
+    int mid = (lo + hi) / 2;
+    uint32 m, sub;
+
+    if (lo >= hi)
+        return 0;
+
+    m = idx->iv[mid].end;
+    sub = build_maxend(idx, lo, mid);
+    if (sub > m)
+        m = sub;
+    sub = build_maxend(idx, mid + 1, hi);
+    if (sub > m)
+        m = sub;
+
+    idx->maxend[mid] = m;
+    return m;
+}
+
+static void add_interval(struct bpt_index *idx, uint32 start, uint32 end, int num)
+{
+    idx->iv[idx->count].start = start;
+    idx->iv[idx->count].end = end;
+    idx->iv[idx->count].num = num;
+    idx->count++;
+    mark_pages(idx, start, end);
+}
+
+static void rebuild_breakpoint_index(void)
+{
+    int kind, i;
+
+    for (kind = 0; kind < BPT_KINDS; kind++) {
+        struct bpt_index *idx = &g_BptIndex[kind];
+        uint32 flags = M64P_BKP_FLAG_ENABLED | bpt_kind_flag[kind];
+
+        idx->count = 0;
+        memset(idx->pages, 0, sizeof(idx->pages));
+
+        for (i = 0; i < g_NumBreakpoints; i++) {
+            const m64p_breakpoint *bpt = &g_Breakpoints[i];
+
+            if ((bpt->flags & flags) != flags)
+                continue;
+
+            if (bpt->endaddr < bpt->address) {
+                add_interval(idx, bpt->address, 0xFFFFFFFF, i);
+                add_interval(idx, 0, bpt->endaddr, i);
+            }
+            else
+                add_interval(idx, bpt->address, bpt->endaddr, i);
+        }
+
+        qsort(idx->iv, idx->count, sizeof(idx->iv[0]), compare_intervals);
+        build_maxend(idx, 0, idx->count);
+    }
+}
+
+static int page_has_breakpoint(const struct bpt_index *idx, uint32 address, uint32 endaddr)
+{
+    uint32 page = address >> BPT_PAGE_SHIFT, last = endaddr >> BPT_PAGE_SHIFT;
+
+    for (;;) {
+        if (idx->pages[page >> 5] & (1u << (page & 31)))
+            return 1;
+        if (page == last)
+            return 0;
+        page++;
+    }
+}
+
+/* lowest breakpoint number in [lo, hi) overlapping [address, endaddr] */
+static void query_intervals(const struct bpt_index *idx, int lo, int hi,
+                            uint32 address, uint32 endaddr, int *best)
+{
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+
+        if (idx->maxend[mid] < address)
+            return;
+
+        query_intervals(idx, lo, mid, address, endaddr, best);
 
+        /* everything from here on starts past the range */
+        if (idx->iv[mid].start > endaddr)
+            return;
+
+        if (idx->iv[mid].end >= address && (*best == -1 || idx->iv[mid].num < *best))
+            *best = idx->iv[mid].num;
+
+        lo = mid + 1;
+    }
+}
+
+static int lookup_kind(int kind, uint32 address, uint32 endaddr)
+{
+    const struct bpt_index *idx = &g_BptIndex[kind];
+    int best = -1;
+
+    if (idx->count == 0 || !page_has_breakpoint(idx, address, endaddr))
+        return -1;
+
+    query_intervals(idx, 0, idx->count, address, endaddr, &best);
+    return best;
+}
+
+static int region_has_breakpoint(int kind, uint32 region)
+{
+    return (g_BptIndex[kind].pages[region >> 1] >> ((region & 1) * 16)) & 0xFFFF;
+}
+
+/* Puts the checking memory handlers on exactly the 64 KB regions of bpt
+ * that still hold an enabled read or write breakpoint. */
+static void sync_memory_breaks(const m64p_breakpoint *bpt)
+{
+    uint32 region = bpt->address >> 16;
+    uint32 count = (((bpt->endaddr >> 16) - region) & 0xFFFF) + 1;
+
+    if (bpt->endaddr < bpt->address && count == 1)
+        count = 0x10000;
+
+    for (; count; count--, region = (region + 1) & 0xFFFF) {
+        if (bpt->flags & M64P_BKP_FLAG_READ) {
+            if (region_has_breakpoint(BPT_KIND_READ, region))
+                activate_memory_break_read(region << 16);
+            else
+                deactivate_memory_break_read(region << 16);
+        }
+        if (bpt->flags & M64P_BKP_FLAG_WRITE) {
+            if (region_has_breakpoint(BPT_KIND_WRITE, region))
+                activate_memory_break_write(region << 16);
+            else
+                deactivate_memory_break_write(region << 16);
+        }
+    }
+}
 
 int add_breakpoint( uint32 address )
 {
+    int bpt;
+
     if( g_NumBreakpoints == BREAKPOINTS_MAX_NUMBER ) {
         DebugMessage(M64MSG_ERROR, "BREAKPOINTS_MAX_NUMBER have been reached.");
         return -1;
     }
-    g_Breakpoints[g_NumBreakpoints].address=address;
-    g_Breakpoints[g_NumBreakpoints].endaddr=address;
-    BPT_SET_FLAG(g_Breakpoints[g_NumBreakpoints], BPT_FLAG_EXEC);
+    bpt = g_NumBreakpoints++;
+    g_Breakpoints[bpt].address=address;
+    g_Breakpoints[bpt].endaddr=address;
+    g_Breakpoints[bpt].flags=M64P_BKP_FLAG_EXEC;
 
-    enable_breakpoint(g_NumBreakpoints);
+    enable_breakpoint(bpt);
 
-    return g_NumBreakpoints++;
+    return bpt;
 }
 
-int add_breakpoint_struct(breakpoint* newbp)
+int add_breakpoint_struct(m64p_breakpoint* newbp)
 {
-     if( g_NumBreakpoints == BREAKPOINTS_MAX_NUMBER ) {
+    int bpt;
+
+    if( g_NumBreakpoints == BREAKPOINTS_MAX_NUMBER ) {
         DebugMessage(M64MSG_ERROR, "BREAKPOINTS_MAX_NUMBER have been reached.");
         return -1;
     }
+    bpt = g_NumBreakpoints++;
 
-    memcpy(&g_Breakpoints[g_NumBreakpoints], newbp, sizeof(breakpoint));
+    memcpy(&g_Breakpoints[bpt], newbp, sizeof(m64p_breakpoint));
 
-    if(BPT_CHECK_FLAG(g_Breakpoints[g_NumBreakpoints], BPT_FLAG_ENABLED))
+    if(BPT_CHECK_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_ENABLED))
     {
-        BPT_CLEAR_FLAG(g_Breakpoints[g_NumBreakpoints], BPT_FLAG_ENABLED);
-        enable_breakpoint( g_NumBreakpoints );
+        BPT_CLEAR_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_ENABLED);
+        enable_breakpoint( bpt );
     }
     
-    return g_NumBreakpoints++;
+    return bpt;
 }
 
 void enable_breakpoint( int bpt)
 {
-    breakpoint *curBpt = g_Breakpoints + bpt;
-    uint64 bptAddr;
-    
-    if(BPT_CHECK_FLAG((*curBpt), BPT_FLAG_READ)) {
-        for(bptAddr = curBpt->address; bptAddr <= (curBpt->endaddr | 0xFFFF); bptAddr+=0x10000)
-            if(lookup_breakpoint((uint32) bptAddr & 0xFFFF0000, 0x10000, BPT_FLAG_ENABLED | BPT_FLAG_READ) == -1)
-                activate_memory_break_read((uint32) bptAddr);
-    }
+    BPT_SET_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_ENABLED);
 
-    if(BPT_CHECK_FLAG((*curBpt), BPT_FLAG_WRITE)) {
-        for(bptAddr = curBpt->address; bptAddr <= (curBpt->endaddr | 0xFFFF); bptAddr+=0x10000)
-            if(lookup_breakpoint((uint32) bptAddr & 0xFFFF0000, 0x10000, BPT_FLAG_ENABLED | BPT_FLAG_WRITE) == -1)
-                activate_memory_break_write((uint32) bptAddr);
-    }
-    
-    BPT_SET_FLAG(g_Breakpoints[bpt], BPT_FLAG_ENABLED);
+    rebuild_breakpoint_index();
+    sync_memory_breaks(&g_Breakpoints[bpt]);
 }
 
 void disable_breakpoint( int bpt )
 {
-    breakpoint *curBpt = g_Breakpoints + bpt;
-    uint64 bptAddr;
-
-    BPT_CLEAR_FLAG(g_Breakpoints[bpt], BPT_FLAG_ENABLED);
-
-    if(BPT_CHECK_FLAG((*curBpt), BPT_FLAG_READ)) {
-        for(bptAddr = curBpt->address; bptAddr <= ((unsigned long)(curBpt->endaddr | 0xFFFF)); bptAddr+=0x10000)
-            if(lookup_breakpoint((uint32) bptAddr & 0xFFFF0000, 0x10000, BPT_FLAG_ENABLED | BPT_FLAG_READ) == -1)
-                deactivate_memory_break_read((uint32) bptAddr);
-    }
-
-    if(BPT_CHECK_FLAG((*curBpt), BPT_FLAG_WRITE)) {
-        for(bptAddr = curBpt->address; bptAddr <= ((unsigned long)(curBpt->endaddr | 0xFFFF)); bptAddr+=0x10000)
-            if(lookup_breakpoint((uint32) bptAddr & 0xFFFF0000, 0x10000, BPT_FLAG_ENABLED | BPT_FLAG_WRITE) == -1)
-                deactivate_memory_break_write((uint32) bptAddr);
-    }
+    BPT_CLEAR_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_ENABLED);
 
-    BPT_CLEAR_FLAG(g_Breakpoints[bpt], BPT_FLAG_ENABLED);
+    rebuild_breakpoint_index();
+    sync_memory_breaks(&g_Breakpoints[bpt]);
 }
 
 void remove_breakpoint_by_num( int bpt )
 {
     int curBpt;
     
-    if(BPT_CHECK_FLAG(g_Breakpoints[bpt], BPT_FLAG_ENABLED))
+    if(BPT_CHECK_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_ENABLED))
         disable_breakpoint( bpt );
 
     for(curBpt=bpt+1; curBpt<g_NumBreakpoints; curBpt++)
         g_Breakpoints[curBpt-1]=g_Breakpoints[curBpt];
     
     g_NumBreakpoints--;
+
+    /* numbers above bpt moved down */
+    rebuild_breakpoint_index();
 }
 
 void remove_breakpoint_by_address( uint32 address )
@@ -134,22 +320,22 @@ void remove_breakpoint_by_address( uint32 address )
         remove_breakpoint_by_num( bpt );
 }
 
-void replace_breakpoint_num( int bpt, breakpoint* copyofnew )
+void replace_breakpoint_num( int bpt, m64p_breakpoint* copyofnew )
 {
     
-    if(BPT_CHECK_FLAG(g_Breakpoints[bpt], BPT_FLAG_ENABLED))
+    if(BPT_CHECK_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_ENABLED))
         disable_breakpoint( bpt );
 
-    memcpy(&(g_Breakpoints[bpt]), copyofnew, sizeof(breakpoint));
+    memcpy(&(g_Breakpoints[bpt]), copyofnew, sizeof(m64p_breakpoint));
 
-    if(BPT_CHECK_FLAG(g_Breakpoints[bpt], BPT_FLAG_ENABLED))
+    if(BPT_CHECK_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_ENABLED))
     {
-        BPT_CLEAR_FLAG(g_Breakpoints[bpt], BPT_FLAG_ENABLED);
+        BPT_CLEAR_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_ENABLED);
         enable_breakpoint( bpt );
     }
 }
 
-int lookup_breakpoint( uint32 address, uint32 size, uint32 flags)
+static int lookup_breakpoint_linear( uint32 address, uint32 size, uint32 flags)
 {
     int i;
     uint64 endaddr = ((uint64)address) + ((uint64)size) - 1;
@@ -175,9 +361,25 @@ int lookup_breakpoint( uint32 address, uint32 size, uint32 flags)
     return -1;
 }
 
+int lookup_breakpoint( uint32 address, uint32 size, uint32 flags)
+{
+    uint64 endaddr = ((uint64)address) + ((uint64)size) - 1;
+    int kind;
+
+    /* the index only covers enabled breakpoints of a single kind */
+    for (kind = 0; kind < BPT_KINDS; kind++)
+        if (flags == (M64P_BKP_FLAG_ENABLED | bpt_kind_flag[kind]))
+            break;
+
+    if (kind == BPT_KINDS || size == 0)
+        return lookup_breakpoint_linear(address, size, flags);
+
+    return lookup_kind(kind, address, (endaddr > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32) endaddr);
+}
+
 int check_breakpoints( uint32 address )
 {
-    return lookup_breakpoint( address, 1, BPT_FLAG_ENABLED | BPT_FLAG_EXEC );
+    return lookup_kind(BPT_KIND_EXEC, address, address);
 }
 
 
@@ -193,7 +395,7 @@ int check_breakpoints_on_mem_access( uint32 pc, uint32 address, uint32 size, uin
         bpt=lookup_breakpoint( address, size, flags );
         if(bpt != -1)
         {
-            if(BPT_CHECK_FLAG(g_Breakpoints[bpt], BPT_FLAG_LOG))
+            if(BPT_CHECK_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_LOG))
                 log_breakpoint(pc, flags, address);
             
             run = 0;
@@ -209,10 +411,9 @@ int log_breakpoint(uint32 PC, uint32 Flag, uint32 Access)
 {
     char msg[32];
     
-    if(Flag & BPT_FLAG_READ) sprintf(msg, "0x%08X read 0x%08X", PC, Access);
-    else if(Flag & BPT_FLAG_WRITE) sprintf(msg, "0x%08X wrote 0x%08X", PC, Access);
+    if(Flag & M64P_BKP_FLAG_READ) sprintf(msg, "0x%08X read 0x%08X", PC, Access);
+    else if(Flag & M64P_BKP_FLAG_WRITE) sprintf(msg, "0x%08X wrote 0x%08X", PC, Access);
     else sprintf(msg, "0x%08X executed", PC);
     DebugMessage(M64MSG_INFO, "BPT: %s", msg);
     return 0;
 }
-
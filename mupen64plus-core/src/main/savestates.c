@@ -75,6 +75,7 @@ int savestates_load_m64p(const unsigned char *data, size_t size)
    int i;
    uint32_t FCR31;
    uint32_t* cp0_regs = r4300_cp0_regs();
+   const unsigned char *lut_r, *lut_w;
    unsigned char *curr = (unsigned char*)data; // < HACK
 
    /* Read and check Mupen64Plus magic number. */
@@ -223,8 +224,9 @@ int savestates_load_m64p(const unsigned char *data, size_t size)
    g_pi.flashram.erase_offset = GETDATA(curr, unsigned int);
    g_pi.flashram.write_pointer = GETDATA(curr, unsigned int);
 
-   COPYARRAY(tlb_LUT_r, curr, unsigned int, 0x100000);
-   COPYARRAY(tlb_LUT_w, curr, unsigned int, 0x100000);
+   lut_r = (const unsigned char *) GETARRAY(curr, unsigned int, 0x100000);
+   lut_w = (const unsigned char *) GETARRAY(curr, unsigned int, 0x100000);
+   tlb_lut_load(lut_r, lut_w);
 
    *r4300_llbit() = GETDATA(curr, unsigned int);
    COPYARRAY(r4300_regs(), curr, int64_t, 32);
@@ -466,8 +468,9 @@ int savestates_save_m64p(unsigned char *data, size_t size)
    PUTDATA(curr, unsigned int, g_pi.flashram.erase_offset);
    PUTDATA(curr, unsigned int, g_pi.flashram.write_pointer);
 
-   PUTARRAY(tlb_LUT_r, curr, unsigned int, 0x100000);
-   PUTARRAY(tlb_LUT_w, curr, unsigned int, 0x100000);
+   tlb_lut_save(curr, curr + 0x100000*sizeof(unsigned int));
+   to_little_endian_buffer(curr, sizeof(unsigned int), 0x200000);
+   curr += 0x200000*sizeof(unsigned int);
 
    PUTDATA(curr, unsigned int, *r4300_llbit());
    PUTARRAY(r4300_regs(), curr, int64_t, 32);
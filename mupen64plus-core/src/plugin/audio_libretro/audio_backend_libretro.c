@@ -37,11 +37,23 @@
 #include <conversion/float_to_s16.h>
 #include <conversion/s16_to_float.h>
 
+#if !defined(MSB_FIRST)
+#if defined(__SSE2__) || defined(ARCH_MIN_SSE2) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#endif
+
 extern retro_audio_sample_batch_t audio_batch_cb;
+extern retro_log_printf_t log_cb;
 
 #include "audio_resampler_driver.h"
+#include "polyphase_resampler.h"
+#include "audio_ring.h"
 
 static unsigned MAX_AUDIO_FRAMES = 2048;
+static unsigned OutputFreq = 44100;
 
 #define VI_INTR_TIME 500000
 
@@ -53,12 +65,17 @@ static unsigned CountsPerByte;
 
 bool no_audio;
 
+static polyphase_resampler_t *polyphase;
 static const rarch_resampler_t *resampler;
 static void *resampler_audio_data;
+static int16_t *audio_in_buffer_s16;
 static float *audio_in_buffer_float;
 static float *audio_out_buffer_float;
 static int16_t *audio_out_buffer_s16;
 
+/* resampled frames waiting for drain_audio_libretro() */
+static struct audio_ring audio_ring;
+
 void (*audio_convert_s16_to_float_arm)(float *out,
       const int16_t *in, size_t samples, float gain);
 void (*audio_convert_float_to_s16_arm)(int16_t *out,
@@ -66,26 +83,57 @@ void (*audio_convert_float_to_s16_arm)(int16_t *out,
 
 void deinit_audio_libretro(void)
 {
+   if (polyphase)
+   {
+      polyphase_resampler_free(polyphase);
+      polyphase = NULL;
+   }
+
    if (resampler && resampler_audio_data)
    {
       resampler->free(resampler_audio_data);
       resampler = NULL;
       resampler_audio_data = NULL;
-      free(audio_in_buffer_float);
-      free(audio_out_buffer_float);
-      free(audio_out_buffer_s16);
    }
+
+   free(audio_in_buffer_s16);
+   free(audio_in_buffer_float);
+   free(audio_out_buffer_float);
+   free(audio_out_buffer_s16);
+   audio_in_buffer_s16    = NULL;
+   audio_in_buffer_float  = NULL;
+   audio_out_buffer_float = NULL;
+   audio_out_buffer_s16   = NULL;
+
+   if (audio_ring.dropped && log_cb)
+      log_cb(RETRO_LOG_WARN, "Audio: %lu frames dropped, the frontend did not take them in time.\n",
+            (unsigned long)audio_ring.dropped);
+   audio_ring_deinit(&audio_ring);
 }
 
-void init_audio_libretro(unsigned max_audio_frames)
+void init_audio_libretro(unsigned max_audio_frames, unsigned output_rate,
+      const char *resampler_ident)
 {
-   rarch_resampler_realloc(&resampler_audio_data, &resampler, "sinc", 1.0);
-
    MAX_AUDIO_FRAMES = max_audio_frames;
+   OutputFreq       = output_rate;
+
+   /* A few frames of headroom; without the ring, frames go straight out. */
+   audio_ring_init(&audio_ring, 8 * MAX_AUDIO_FRAMES);
 
+   audio_out_buffer_s16 = malloc(2 * MAX_AUDIO_FRAMES * sizeof(int16_t));
+
+   if (!strcmp(resampler_ident, "polyphase"))
+   {
+      polyphase = polyphase_resampler_new(GameFreq, OutputFreq);
+      if (polyphase)
+         return;
+   }
+
+   rarch_resampler_realloc(&resampler_audio_data, &resampler, "sinc", 1.0);
+
+   audio_in_buffer_s16    = malloc(2 * MAX_AUDIO_FRAMES * sizeof(int16_t));
    audio_in_buffer_float  = malloc(2 * MAX_AUDIO_FRAMES * sizeof(float));
    audio_out_buffer_float = malloc(2 * MAX_AUDIO_FRAMES * sizeof(float));
-   audio_out_buffer_s16   = malloc(2 * MAX_AUDIO_FRAMES * sizeof(int16_t));
 
    convert_s16_to_float_init_simd();
    convert_float_to_s16_init_simd();
@@ -103,6 +151,8 @@ void set_audio_format_via_libretro(void* user_data,
    g_ai.regs[AI_DACRATE_REG] = (ROM_PARAMS.aidacrate / frequency) - 1;
 
    GameFreq        = frequency;
+   if (polyphase)
+      polyphase_resampler_set_rates(polyphase, GameFreq, OutputFreq);
    BytesPerSecond  = frequency * 4;
    CountsPerSecond = VI_INTR_TIME * 60 /* TODO/FIXME - dehardcode */;
    CountsPerByte   = CountsPerSecond / BytesPerSecond;
@@ -115,17 +165,76 @@ void set_audio_format_via_libretro(void* user_data,
    g_ai.regs[AI_DACRATE_REG] = saved_ai_dacrate;
 }
 
+/* AI DMA words hold the left sample in the upper halfword. Reading them
+ * as words gives the right order on either host endianness and leaves
+ * RDRAM untouched. */
+static void ai_words_to_s16(int16_t *out, const uint32_t *in, size_t frames)
+{
+   size_t i = 0;
+
+#if !defined(MSB_FIRST)
+#if defined(__SSE2__) || defined(ARCH_MIN_SSE2) || defined(_M_X64)
+   for (; i + 4 <= frames; i += 4)
+   {
+      __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+      v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+      _mm_storeu_si128((__m128i*)(out + i * 2), v);
+   }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+   for (; i + 4 <= frames; i += 4)
+      vst1q_s16(out + i * 2, vrev32q_s16(vld1q_s16((const int16_t*)(in + i))));
+#endif
+#endif
+   for (; i < frames; i++)
+   {
+      out[i * 2]     = (int16_t)(in[i] >> 16);
+      out[i * 2 + 1] = (int16_t)in[i];
+   }
+}
+
+static void send_audio_frames(const int16_t *out, size_t frames)
+{
+   if (audio_ring.frames)
+   {
+      audio_ring_write(&audio_ring, out, frames);
+      return;
+   }
+
+   while (frames)
+   {
+      size_t ret = audio_batch_cb(out, frames);
+      frames    -= ret;
+      out       += ret * 2;
+   }
+}
+
+/* Hands the queued frames to the frontend; called once per retro_run, or
+ * from any single thread that owns the consumer side of the ring. */
+void drain_audio_libretro(void)
+{
+   const int16_t *out;
+   size_t frames;
+
+   if (!audio_ring.frames)
+      return;
+
+   while ((frames = audio_ring_peek(&audio_ring, &out)))
+   {
+      size_t ret = audio_batch_cb(out, frames);
+      audio_ring_consume(&audio_ring, ret);
+      if (ret == 0)
+         break;
+   }
+}
+
 /* Abuse core & audio plugin implementation details to obtain the desired effect. */
 void push_audio_samples_via_libretro(void* user_data, const void* buffer, size_t size)
 {
-   int16_t *out;
-   size_t max_frames, remain_frames;
-   uint32_t i;
+   size_t max_frames;
    double ratio;
    struct resampler_data data = {0};
-   int16_t *raw_data = (int16_t*)buffer;
-   size_t frames     = size / 4;
-   uint8_t *p        = (uint8_t*)buffer;
+   const uint32_t *words = (const uint32_t*)buffer;
+   size_t frames         = size / 4;
 
    /* save registers values */
    uint32_t saved_ai_length = g_ai.regs[AI_LEN_REG];
@@ -136,54 +245,48 @@ void push_audio_samples_via_libretro(void* user_data, const void* buffer, size_t
    g_ai.regs[AI_DRAM_ADDR_REG] = (uint8_t*)buffer - (uint8_t*)g_rdram;
    g_ai.regs[AI_LEN_REG] = size;
 
-   for (i = 0; i < size; i += 4)
-   {
-      p[i ] ^= p[i + 2];
-      p[i + 2] ^= p[i ];
-      p[i ] ^= p[i + 2];
-      p[i + 1] ^= p[i + 3];
-      p[i + 3] ^= p[i + 1];
-      p[i + 1] ^= p[i + 3];
-   }
-
-audio_batch:
-   out               = NULL;
-   ratio             = 44100.0 / GameFreq;
-   max_frames        = (GameFreq > 44100) ? MAX_AUDIO_FRAMES : (size_t)(MAX_AUDIO_FRAMES / ratio - 1);
-   remain_frames     = 0;
    if (no_audio)
-      return;
+      goto restore;
 
-   if (frames > max_frames)
+   if (polyphase)
    {
-      remain_frames = frames - max_frames;
-      frames = max_frames;
+      max_frames = polyphase_resampler_max_input(polyphase, MAX_AUDIO_FRAMES);
+
+      while (frames)
+      {
+         size_t n = (frames > max_frames) ? max_frames : frames;
+         size_t out_frames = polyphase_resampler_process_words(polyphase, words, n, audio_out_buffer_s16);
+
+         send_audio_frames(audio_out_buffer_s16, out_frames);
+         words  += n;
+         frames -= n;
+      }
+      goto restore;
    }
 
-   data.data_in      = audio_in_buffer_float;
-   data.data_out     = audio_out_buffer_float;
-   data.input_frames = frames;
-   data.ratio        = ratio;
+   ratio      = (double)OutputFreq / GameFreq;
+   max_frames = (ratio < 1.0) ? MAX_AUDIO_FRAMES : (size_t)(MAX_AUDIO_FRAMES / ratio - 1);
 
-   convert_s16_to_float(audio_in_buffer_float, raw_data, frames * 2, 1.0f);
-   resampler->process(resampler_audio_data, &data);
-   convert_float_to_s16(audio_out_buffer_s16, audio_out_buffer_float, data.output_frames * 2);
+   while (frames)
+   {
+      size_t n = (frames > max_frames) ? max_frames : frames;
 
-   out                    = audio_out_buffer_s16;
+      data.data_in      = audio_in_buffer_float;
+      data.data_out     = audio_out_buffer_float;
+      data.input_frames = n;
+      data.ratio        = ratio;
 
-   while (data.output_frames)
-   {
-      size_t ret          = audio_batch_cb(out, data.output_frames);
-      data.output_frames -= ret;
-      out                += ret * 2;
-   }
-   if (remain_frames)
-   {
-      raw_data = raw_data + frames * 2;
-      frames   = remain_frames;
-      goto audio_batch;
+      ai_words_to_s16(audio_in_buffer_s16, words, n);
+      convert_s16_to_float(audio_in_buffer_float, audio_in_buffer_s16, n * 2, 1.0f);
+      resampler->process(resampler_audio_data, &data);
+      convert_float_to_s16(audio_out_buffer_s16, audio_out_buffer_float, data.output_frames * 2);
+
+      send_audio_frames(audio_out_buffer_s16, data.output_frames);
+      words  += n;
+      frames -= n;
    }
 
+restore:
    /* restore original registers vlaues */
    g_ai.regs[AI_LEN_REG]       = saved_ai_length;
    g_ai.regs[AI_DRAM_ADDR_REG] = saved_ai_dram;
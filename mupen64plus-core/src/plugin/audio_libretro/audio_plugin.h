@@ -24,7 +24,9 @@
 
 #include <stddef.h>
 
-void init_audio_libretro(unsigned max_frames);
+void init_audio_libretro(unsigned max_frames, unsigned output_rate,
+      const char *resampler_ident);
 void deinit_audio_libretro(void);
+void drain_audio_libretro(void);
 
 #endif
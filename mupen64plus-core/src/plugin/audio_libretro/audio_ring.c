@@ -0,0 +1,107 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - audio_ring.c                                            *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_ring.h"
+
+/* The index written by the other side is read with acquire semantics and
+ * our own index is published with release semantics, so the frames are
+ * visible before the index that covers them. MSVC gives volatile accesses
+ * these semantics on x86 (/volatile:ms). */
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+#define LOAD_ACQUIRE(p)     __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#elif defined(__GNUC__)
+#define LOAD_ACQUIRE(p)     load_acquire(p)
+#define STORE_RELEASE(p, v) do { __sync_synchronize(); *(p) = (v); } while (0)
+static size_t load_acquire(volatile size_t *p)
+{
+   size_t v = *p;
+   __sync_synchronize();
+   return v;
+}
+#else
+#define LOAD_ACQUIRE(p)     (*(p))
+#define STORE_RELEASE(p, v) (*(p) = (v))
+#endif
+
+bool audio_ring_init(struct audio_ring *ring, size_t min_frames)
+{
+   size_t size = 1;
+
+   while (size < min_frames)
+      size <<= 1;
+
+   memset(ring, 0, sizeof(*ring));
+   ring->frames = (int16_t*)malloc(size * 2 * sizeof(int16_t));
+   if (ring->frames == NULL)
+      return false;
+   ring->size = size;
+   return true;
+}
+
+void audio_ring_deinit(struct audio_ring *ring)
+{
+   free(ring->frames);
+   memset(ring, 0, sizeof(*ring));
+}
+
+size_t audio_ring_write(struct audio_ring *ring, const int16_t *frames, size_t count)
+{
+   size_t head = ring->head;
+   size_t space = ring->size - (head - LOAD_ACQUIRE(&ring->tail));
+   size_t start = head & (ring->size - 1);
+   size_t first;
+
+   if (count > space)
+   {
+      ring->dropped += count - space;
+      count = space;
+   }
+
+   first = ring->size - start;
+   if (first > count)
+      first = count;
+   memcpy(ring->frames + start * 2, frames, first * 2 * sizeof(int16_t));
+   memcpy(ring->frames, frames + first * 2, (count - first) * 2 * sizeof(int16_t));
+
+   STORE_RELEASE(&ring->head, head + count);
+   return count;
+}
+
+size_t audio_ring_peek(struct audio_ring *ring, const int16_t **frames)
+{
+   size_t tail = ring->tail;
+   size_t count = LOAD_ACQUIRE(&ring->head) - tail;
+   size_t start = tail & (ring->size - 1);
+
+   if (count > ring->size - start)
+      count = ring->size - start;
+
+   *frames = ring->frames + start * 2;
+   return count;
+}
+
+void audio_ring_consume(struct audio_ring *ring, size_t count)
+{
+   STORE_RELEASE(&ring->tail, ring->tail + count);
+}
@@ -0,0 +1,55 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - audio_ring.h                                            *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_PLUGIN_AUDIO_RING_H
+#define M64P_PLUGIN_AUDIO_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boolean.h>
+
+/* Lock-free single producer / single consumer ring of stereo s16 frames.
+ *
+ * Only the producer moves head and only the consumer moves tail, so the
+ * two sides may run on different threads without a lock. When the ring
+ * is full the producer drops the new frames rather than waiting. */
+
+struct audio_ring
+{
+   int16_t *frames;
+   size_t size;            /* in frames, a power of two */
+   volatile size_t head;   /* frames written, wraps */
+   volatile size_t tail;   /* frames read, wraps */
+   size_t dropped;         /* producer side, frames that did not fit */
+};
+
+bool audio_ring_init(struct audio_ring *ring, size_t min_frames);
+void audio_ring_deinit(struct audio_ring *ring);
+
+/* Producer: returns the number of frames queued. */
+size_t audio_ring_write(struct audio_ring *ring, const int16_t *frames, size_t count);
+
+/* Consumer: points *frames at the oldest queued frames and returns how
+ * many are contiguous; audio_ring_consume releases them. */
+size_t audio_ring_peek(struct audio_ring *ring, const int16_t **frames);
+void audio_ring_consume(struct audio_ring *ring, size_t count);
+
+#endif
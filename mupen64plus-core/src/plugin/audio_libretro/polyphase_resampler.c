@@ -0,0 +1,401 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - polyphase_resampler.c                                   *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_inline.h>
+
+#include "polyphase_resampler.h"
+
+#if !defined(MSB_FIRST)
+#if defined(__SSE2__) || defined(ARCH_MIN_SSE2) || defined(_M_X64)
+#include <emmintrin.h>
+#define PR_SSE2 1
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PR_NEON 1
+#endif
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846264338327
+#endif
+
+#define TAPS        16
+#define MAX_PHASES  1024
+#define COEFF_BITS  14
+#define BLOCK       512   /* input frames deinterleaved per pass */
+
+/* passband edge relative to the lower Nyquist frequency, and window shape */
+#define CUTOFF      0.90
+#define KAISER_BETA 6.0
+
+struct bank
+{
+   unsigned in_rate;
+   unsigned out_rate;
+   unsigned den;       /* output step is step_int + step_frac / den input frames */
+   unsigned step_int;
+   unsigned step_frac;
+   unsigned phases;
+   uint64_t phase_mul; /* phase = frac * phase_mul >> 32 */
+   int16_t *coeffs;    /* phases * TAPS, 16-byte aligned */
+   void *alloc;
+   struct bank *next;
+};
+
+struct polyphase_resampler
+{
+   struct bank *banks;
+   const struct bank *bank;
+   unsigned frac;      /* position past buf[pos], in 1/den frames */
+   size_t pos;         /* first tap of the next output frame */
+   size_t fill;
+   int16_t buf[2][TAPS + BLOCK];
+};
+
+static unsigned gcd(unsigned a, unsigned b)
+{
+   while (b)
+   {
+      unsigned t = a % b;
+      a = b;
+      b = t;
+   }
+   return a;
+}
+
+static double bessel_i0(double x)
+{
+   double sum = 1.0, term = 1.0;
+   unsigned k;
+
+   for (k = 1; k < 32; k++)
+   {
+      term *= (x / (2.0 * k)) * (x / (2.0 * k));
+      sum += term;
+   }
+   return sum;
+}
+
+static void build_phase(int16_t *out, double delay, double fc)
+{
+   double h[TAPS], sum = 0.0;
+   int q[TAPS], total = 0, peak = 0;
+   unsigned k;
+
+   for (k = 0; k < TAPS; k++)
+   {
+      /* distance from the output instant, which lies delay frames after tap TAPS/2 - 1 */
+      double x = (double)k - (TAPS / 2 - 1) - delay;
+      double t = x / (TAPS / 2);
+      double w = (t * t < 1.0) ? bessel_i0(KAISER_BETA * sqrt(1.0 - t * t)) / bessel_i0(KAISER_BETA) : 0.0;
+      double s = (x == 0.0) ? 1.0 : sin(M_PI * fc * x) / (M_PI * fc * x);
+      h[k] = fc * s * w;
+      sum += h[k];
+   }
+
+   /* unity gain at DC, with the rounding error put on the largest tap */
+   for (k = 0; k < TAPS; k++)
+   {
+      q[k] = (int)floor(h[k] / sum * (1 << COEFF_BITS) + 0.5);
+      total += q[k];
+      if (q[k] > q[peak])
+         peak = k;
+   }
+   q[peak] += (1 << COEFF_BITS) - total;
+
+   for (k = 0; k < TAPS; k++)
+      out[k] = (int16_t)q[k];
+}
+
+static struct bank *build_bank(unsigned in_rate, unsigned out_rate)
+{
+   struct bank *b = (struct bank*)calloc(1, sizeof(*b));
+   unsigned g = gcd(in_rate, out_rate);
+   double fc = CUTOFF * ((out_rate < in_rate) ? (double)out_rate / in_rate : 1.0);
+   unsigned p;
+
+   if (b == NULL)
+      return NULL;
+
+   b->in_rate   = in_rate;
+   b->out_rate  = out_rate;
+   b->den       = out_rate / g;
+   b->step_int  = (in_rate / g) / b->den;
+   b->step_frac = (in_rate / g) % b->den;
+   b->phases    = (b->den < MAX_PHASES) ? b->den : MAX_PHASES;
+   /* rounded up so that frac maps to itself when there is a phase per step */
+   b->phase_mul = (((uint64_t)b->phases << 32) + b->den - 1) / b->den;
+
+   b->alloc = malloc(b->phases * TAPS * sizeof(int16_t) + 15);
+   if (b->alloc == NULL)
+   {
+      free(b);
+      return NULL;
+   }
+   b->coeffs = (int16_t*)(((uintptr_t)b->alloc + 15) & ~(uintptr_t)15);
+
+   for (p = 0; p < b->phases; p++)
+      build_phase(b->coeffs + p * TAPS, (double)p / b->phases, fc);
+
+   return b;
+}
+
+bool polyphase_resampler_set_rates(polyphase_resampler_t *re,
+      unsigned in_rate, unsigned out_rate)
+{
+   struct bank *b;
+
+   if (in_rate == 0 || out_rate == 0)
+      return false;
+   if (re->bank && re->bank->in_rate == in_rate && re->bank->out_rate == out_rate)
+      return true;
+
+   for (b = re->banks; b != NULL; b = b->next)
+      if (b->in_rate == in_rate && b->out_rate == out_rate)
+         break;
+
+   if (b == NULL)
+   {
+      b = build_bank(in_rate, out_rate);
+      if (b == NULL)
+         return false;
+      b->next = re->banks;
+      re->banks = b;
+   }
+
+   re->bank = b;
+   re->frac = 0;
+   return true;
+}
+
+polyphase_resampler_t *polyphase_resampler_new(unsigned in_rate, unsigned out_rate)
+{
+   polyphase_resampler_t *re = (polyphase_resampler_t*)calloc(1, sizeof(*re));
+
+   if (re == NULL)
+      return NULL;
+
+   /* silence before the first frame, so that it lands on the center tap */
+   re->fill = TAPS / 2 - 1;
+
+   if (!polyphase_resampler_set_rates(re, in_rate, out_rate))
+   {
+      free(re);
+      return NULL;
+   }
+   return re;
+}
+
+void polyphase_resampler_free(polyphase_resampler_t *re)
+{
+   struct bank *b, *next;
+
+   if (re == NULL)
+      return;
+
+   for (b = re->banks; b != NULL; b = next)
+   {
+      next = b->next;
+      free(b->alloc);
+      free(b);
+   }
+   free(re);
+}
+
+size_t polyphase_resampler_max_input(const polyphase_resampler_t *re, size_t out_frames)
+{
+   const struct bank *b = re->bank;
+   uint64_t step = (uint64_t)b->step_int * b->den + b->step_frac;
+
+   if (out_frames < 2)
+      return 0;
+   return (size_t)((uint64_t)(out_frames - 1) * step / b->den);
+}
+
+static INLINE void filter_frame(const int16_t *l, const int16_t *r,
+      const int16_t *c, int16_t *out)
+{
+#if defined(PR_SSE2)
+   const __m128i c0 = _mm_load_si128((const __m128i*)c);
+   const __m128i c1 = _mm_load_si128((const __m128i*)(c + 8));
+   __m128i sl = _mm_add_epi32(
+         _mm_madd_epi16(_mm_loadu_si128((const __m128i*)l), c0),
+         _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(l + 8)), c1));
+   __m128i sr = _mm_add_epi32(
+         _mm_madd_epi16(_mm_loadu_si128((const __m128i*)r), c0),
+         _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(r + 8)), c1));
+   __m128i s = _mm_add_epi32(_mm_unpacklo_epi32(sl, sr), _mm_unpackhi_epi32(sl, sr));
+
+   s = _mm_add_epi32(s, _mm_srli_si128(s, 8));
+   s = _mm_srai_epi32(_mm_add_epi32(s, _mm_set1_epi32(1 << (COEFF_BITS - 1))), COEFF_BITS);
+   s = _mm_packs_epi32(s, s);
+   *(int32_t*)out = _mm_cvtsi128_si32(s);
+#elif defined(PR_NEON)
+   const int16x8_t c0 = vld1q_s16(c);
+   const int16x8_t c1 = vld1q_s16(c + 8);
+   const int16x8_t l0 = vld1q_s16(l), l1 = vld1q_s16(l + 8);
+   const int16x8_t r0 = vld1q_s16(r), r1 = vld1q_s16(r + 8);
+   int32x4_t sl = vmull_s16(vget_low_s16(l0), vget_low_s16(c0));
+   int32x4_t sr = vmull_s16(vget_low_s16(r0), vget_low_s16(c0));
+   int32x2_t s;
+
+   sl = vmlal_s16(sl, vget_high_s16(l0), vget_high_s16(c0));
+   sl = vmlal_s16(sl, vget_low_s16(l1), vget_low_s16(c1));
+   sl = vmlal_s16(sl, vget_high_s16(l1), vget_high_s16(c1));
+   sr = vmlal_s16(sr, vget_high_s16(r0), vget_high_s16(c0));
+   sr = vmlal_s16(sr, vget_low_s16(r1), vget_low_s16(c1));
+   sr = vmlal_s16(sr, vget_high_s16(r1), vget_high_s16(c1));
+   s = vpadd_s32(vpadd_s32(vget_low_s32(sl), vget_high_s32(sl)),
+                 vpadd_s32(vget_low_s32(sr), vget_high_s32(sr)));
+   vst1_lane_s32((int32_t*)out,
+         vreinterpret_s32_s16(vqrshrn_n_s32(vcombine_s32(s, s), COEFF_BITS)), 0);
+#else
+   int32_t sl = 0, sr = 0;
+   unsigned k;
+
+   for (k = 0; k < TAPS; k++)
+   {
+      sl += l[k] * c[k];
+      sr += r[k] * c[k];
+   }
+   sl = (sl + (1 << (COEFF_BITS - 1))) >> COEFF_BITS;
+   sr = (sr + (1 << (COEFF_BITS - 1))) >> COEFF_BITS;
+   out[0] = (int16_t)(sl > 32767 ? 32767 : sl < -32768 ? -32768 : sl);
+   out[1] = (int16_t)(sr > 32767 ? 32767 : sr < -32768 ? -32768 : sr);
+#endif
+}
+
+/* Filters every output frame whose taps are all buffered, then moves the
+ * taps still needed to the front. */
+static size_t run(polyphase_resampler_t *re, int16_t *out)
+{
+   const struct bank *b = re->bank;
+   size_t pos = re->pos, n = 0;
+   unsigned frac = re->frac;
+
+   while (pos + TAPS <= re->fill)
+   {
+      unsigned phase = (unsigned)((frac * b->phase_mul) >> 32);
+
+      filter_frame(&re->buf[0][pos], &re->buf[1][pos], b->coeffs + phase * TAPS, out + n * 2);
+      n++;
+
+      pos += b->step_int;
+      frac += b->step_frac;
+      if (frac >= b->den)
+      {
+         frac -= b->den;
+         pos++;
+      }
+   }
+
+   if (pos >= re->fill)
+   {
+      /* downsampling can step past the buffered frames */
+      re->pos = pos - re->fill;
+      re->fill = 0;
+   }
+   else
+   {
+      re->fill -= pos;
+      memmove(re->buf[0], re->buf[0] + pos, re->fill * sizeof(int16_t));
+      memmove(re->buf[1], re->buf[1] + pos, re->fill * sizeof(int16_t));
+      re->pos = 0;
+   }
+   re->frac = frac;
+   return n;
+}
+
+static void fill_s16(int16_t *l, int16_t *r, const void *data, size_t offset, size_t n)
+{
+   const int16_t *in = (const int16_t*)data + offset * 2;
+   size_t i;
+
+   for (i = 0; i < n; i++)
+   {
+      l[i] = in[i * 2];
+      r[i] = in[i * 2 + 1];
+   }
+}
+
+static void fill_words(int16_t *l, int16_t *r, const void *data, size_t offset, size_t n)
+{
+   const uint32_t *in = (const uint32_t*)data + offset;
+   size_t i = 0;
+
+#if defined(PR_SSE2)
+   for (; i + 8 <= n; i += 8)
+   {
+      __m128i a = _mm_loadu_si128((const __m128i*)(in + i));
+      __m128i b = _mm_loadu_si128((const __m128i*)(in + i + 4));
+      _mm_storeu_si128((__m128i*)(l + i),
+            _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16)));
+      _mm_storeu_si128((__m128i*)(r + i),
+            _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                            _mm_srai_epi32(_mm_slli_epi32(b, 16), 16)));
+   }
+#elif defined(PR_NEON)
+   for (; i + 8 <= n; i += 8)
+   {
+      int16x8x2_t v = vld2q_s16((const int16_t*)(in + i));
+      vst1q_s16(l + i, v.val[1]);
+      vst1q_s16(r + i, v.val[0]);
+   }
+#endif
+   for (; i < n; i++)
+   {
+      l[i] = (int16_t)(in[i] >> 16);
+      r[i] = (int16_t)in[i];
+   }
+}
+
+static size_t process(polyphase_resampler_t *re, const void *in, size_t frames, int16_t *out,
+      void (*fill)(int16_t *l, int16_t *r, const void *data, size_t offset, size_t n))
+{
+   size_t produced = 0, done = 0;
+
+   while (done < frames)
+   {
+      size_t n = (frames - done < BLOCK) ? frames - done : BLOCK;
+
+      fill(re->buf[0] + re->fill, re->buf[1] + re->fill, in, done, n);
+      re->fill += n;
+      done += n;
+
+      produced += run(re, out + produced * 2);
+   }
+   return produced;
+}
+
+size_t polyphase_resampler_process(polyphase_resampler_t *re,
+      const int16_t *in, size_t frames, int16_t *out)
+{
+   return process(re, in, frames, out, fill_s16);
+}
+
+size_t polyphase_resampler_process_words(polyphase_resampler_t *re,
+      const uint32_t *in, size_t frames, int16_t *out)
+{
+   return process(re, in, frames, out, fill_words);
+}
@@ -0,0 +1,59 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - polyphase_resampler.h                                   *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_PLUGIN_POLYPHASE_RESAMPLER_H
+#define M64P_PLUGIN_POLYPHASE_RESAMPLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boolean.h>
+
+/* Fixed-point polyphase resampler for interleaved stereo s16.
+ *
+ * The output position advances by exactly in_rate/out_rate input frames,
+ * kept as a reduced fraction, so there is no drift. Each output frame is a
+ * 16-tap windowed sinc with Q14 coefficients taken from a bank of one
+ * filter per output phase (up to 1024, the nearest one is used beyond
+ * that). Banks are built once per rate pair and kept until the resampler
+ * is freed. The SSE2 and NEON paths give the same results as the C one. */
+
+typedef struct polyphase_resampler polyphase_resampler_t;
+
+polyphase_resampler_t *polyphase_resampler_new(unsigned in_rate, unsigned out_rate);
+void polyphase_resampler_free(polyphase_resampler_t *re);
+
+/* Changes the rates; buffered input is kept so the stream stays continuous. */
+bool polyphase_resampler_set_rates(polyphase_resampler_t *re,
+      unsigned in_rate, unsigned out_rate);
+
+/* Most input frames whose output fits in out_frames */
+size_t polyphase_resampler_max_input(const polyphase_resampler_t *re, size_t out_frames);
+
+/* Consumes all frames of in and returns the number of frames written to out. */
+size_t polyphase_resampler_process(polyphase_resampler_t *re,
+      const int16_t *in, size_t frames, int16_t *out);
+
+/* Same, reading AI DMA words (left sample in the upper halfword) in place,
+ * so the buffer can be taken straight from RDRAM. */
+size_t polyphase_resampler_process_words(polyphase_resampler_t *re,
+      const uint32_t *in, size_t frames, int16_t *out);
+
+#endif
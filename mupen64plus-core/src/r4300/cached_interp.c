@@ -132,13 +132,18 @@ unsigned int jump_to_address;
    static void name##_IDLE(void) \
    { \
       const int take_jump = (condition); \
+      const uint32_t jump_target = (destination); \
       int skip; \
       if (cop1 && check_cop1_unusable()) return; \
       if (take_jump) \
       { \
          cp0_update_count(); \
          skip = next_interupt - g_cp0_regs[CP0_COUNT_REG]; \
-         if (skip > 3) g_cp0_regs[CP0_COUNT_REG] += (skip & UINT32_C(0xFFFFFFFC)); \
+         if (skip > 3 && (jump_target == PC->addr || poll_loop_is_idle(PC->addr, jump_target))) \
+         { \
+            g_cp0_regs[CP0_COUNT_REG] += (skip & UINT32_C(0xFFFFFFFC)); \
+            idle_skipped += (skip & UINT32_C(0xFFFFFFFC)); \
+         } \
          else name(); \
       } \
       else name(); \
@@ -537,6 +542,9 @@ static unsigned int update_invalid_addr(unsigned int addr)
 void jump_to_func(void)
 {
    unsigned int paddr;
+   unsigned int site = link_site;
+
+   link_site = 0;
    if (skip_jump) return;
    paddr = update_invalid_addr(addr);
    if (!paddr) return;
@@ -551,14 +559,21 @@ void jump_to_func(void)
          blocks[addr>>12]->block = NULL;
          blocks[addr>>12]->jumps_table = NULL;
          blocks[addr>>12]->riprel_table = NULL;
+         blocks[addr>>12]->source = NULL;
+         blocks[addr>>12]->runs = NULL;
       }
     blocks[addr>>12]->start = addr & ~0xFFF;
     blocks[addr>>12]->end = (addr & ~0xFFF) + 0x1000;
-    init_block(blocks[addr>>12]);
+    if (!revalidate_block(blocks[addr>>12]))
+       init_block(blocks[addr>>12]);
      }
    PC=actual->block+((addr-actual->start)>>2);
    
-   if (r4300emu == CORE_DYNAREC) dyna_jump();
+   if (r4300emu == CORE_DYNAREC)
+   {
+      link_exit(site);
+      dyna_jump();
+   }
 }
 #undef addr
 
@@ -602,28 +617,38 @@ void invalidate_cached_code_hacktarux(uint32_t address, size_t size)
         /* invalidate blocks (if necessary) */
         addr_max = address+size;
 
-        for(addr = address; addr < addr_max; addr += 4)
+        for(addr = address; addr < addr_max; addr = (addr | 0xfff) + 1)
         {
+            uint32_t last = addr_max - 1;
+            uint64_t chunks;
+
             i = (addr >> 12);
+            if ((last ^ addr) & ~0xfff)
+                last = addr | 0xfff;
 
-            if (invalid_code[i] == 0)
+            if (invalid_code[i] != 0)
+                continue;
+
+            if (blocks[i] == NULL)
+            {
+                invalid_code[i] = 1;
+                continue;
+            }
+
+            /* only look at the words of 64-byte chunks holding compiled code */
+            chunks = (~UINT64_C(0) << ((addr & 0xfff) >> 6)) & (~UINT64_C(0) >> (63 - ((last & 0xfff) >> 6)));
+            if (!(blocks[i]->code_mask & chunks))
+                continue;
+
+            for (addr &= ~3; addr <= last; addr += 4)
             {
-                if (blocks[i] == NULL
-                || blocks[i]->block[(addr & 0xfff) / 4].ops != current_instruction_table.NOTCOMPILED)
+                if (blocks[i]->block[(addr & 0xfff) / 4].ops != current_instruction_table.NOTCOMPILED)
                 {
                     invalid_code[i] = 1;
-                    /* go directly to next i */
-                    addr &= ~0xfff;
-                    addr |= 0xffc;
+                    break;
                 }
             }
-            else
-            {
-                /* go directly to next i */
-                addr &= ~0xfff;
-                addr |= 0xffc;
-            }
+            addr = last;
         }
     }
 }
-
@@ -32,6 +32,10 @@ void free_assembler(void **block_jumps_table, int *block_jumps_number, void **bl
 {
 }
 
+void remove_jumps(unsigned int start, unsigned int end)
+{
+}
+
 void passe2(precomp_instr *dest, int start, int end, precomp_block *block)
 {
 }
@@ -570,6 +574,10 @@ void genbeq_idle()
 {
 }
 
+void genpoll_loop()
+{
+}
+
 void genbnel()
 {
 }
@@ -140,6 +140,18 @@ void add_jump(unsigned int pc_addr, unsigned int mi_addr, unsigned int absolute6
    jumps_number++;
 }
 
+/* drops the jumps emitted in [start, end) of the code, once it is no
+ * longer reached */
+void remove_jumps(unsigned int start, unsigned int end)
+{
+   int i, n;
+
+   for (i = 0, n = 0; i < jumps_number; i++)
+      if (jumps_table[i].pc_addr < start || jumps_table[i].pc_addr >= end)
+         jumps_table[n++] = jumps_table[i];
+   jumps_number = n;
+}
+
 void passe2(precomp_instr *dest, int start, int end, precomp_block *block)
 {
    unsigned int real_code_length;
@@ -235,19 +247,26 @@ void jump_start_rel32(void)
 }
 
 void jump_end_rel8(void)
+{
+   jump_end_rel8_at(g_jump_start8);
+}
+
+/* for several short jumps to the same place: jump_start is the
+ * code_length right after the jump */
+void jump_end_rel8_at(unsigned int jump_start)
 {
    unsigned int jump_end = code_length;
-   int jump_vec = jump_end - g_jump_start8;
+   int jump_vec = jump_end - jump_start;
 
    if (jump_vec > 127 || jump_vec < -128)
    {
-      DebugMessage(M64MSG_ERROR, "8-bit relative jump too long! From %x to %x", g_jump_start8, jump_end);
+      DebugMessage(M64MSG_ERROR, "8-bit relative jump too long! From %x to %x", jump_start, jump_end);
 #if !defined(_MSC_VER)
       asm(" int $3; ");
 #endif
    }
 
-   code_length = g_jump_start8 - 1;
+   code_length = jump_start - 1;
    put8(jump_vec);
    code_length = jump_end;
 }
@@ -82,6 +82,7 @@ extern const uint16_t trunc_mode, round_mode, ceil_mode, floor_mode;
 
 void jump_start_rel8(void);
 void jump_end_rel8(void);
+void jump_end_rel8_at(unsigned int jump_start);
 void jump_start_rel32(void);
 void jump_end_rel32(void);
 void add_jump(unsigned int pc_addr, unsigned int mi_addr, unsigned int absolute64);
@@ -76,11 +76,11 @@ static void genupdate_count(unsigned int addr)
 #ifdef __x86_64__
    mov_reg64_imm64(RAX, (uint64_t) (dst+1));
    mov_m64rel_xreg64((uint64_t *)(&PC), RAX);
-   mov_reg64_imm64(RAX, (uint64_t)update_count);
+   mov_reg64_imm64(RAX, (uint64_t)cp0_update_count);
    call_reg64(RAX);
 #else
    mov_m32_imm32((unsigned int*)(&PC), (unsigned int)(dst+1));
-   mov_reg32_imm32(EAX, (unsigned int)update_count);
+   mov_reg32_imm32(EAX, (unsigned int)cp0_update_count);
    call_reg32(EAX);
 #endif
 #endif
@@ -136,6 +136,107 @@ static void gencheck_interupt_out(unsigned int addr)
 #endif
 }
 
+#ifdef __x86_64__
+/* Out-of-page J and JAL end in a jmp rel32 that jump_to_func() links to
+ * the target's code. Stores only flag invalid_code when they hit compiled
+ * code, so the linked path checks the target page and its kseg alias on
+ * every pass; an exception taken by the interrupt check sets skip_jump. */
+void genlink_out(unsigned int naddr)
+{
+   unsigned int site;
+
+   if (naddr < 0x80000000 || naddr >= 0xC0000000 || (naddr & 0x1FFFFFFF) >= 0x00800000)
+      return;
+
+   mov_xreg32_m32rel(EAX, (unsigned int *)(&skip_jump));
+   movsx_xreg32_m8rel(ECX, (unsigned char *)(&invalid_code[naddr>>12]));
+   or_reg64_reg64(RAX, RCX);
+   movsx_xreg32_m8rel(ECX, (unsigned char *)(&invalid_code[(naddr^0x20000000)>>12]));
+   or_reg64_reg64(RAX, RCX);
+   jne_rj(0);
+   jump_start_rel8();
+
+   mov_xreg64_m64rel(RAX, (uint64_t *)(&blocks[naddr>>12]));
+   mov_m64rel_xreg64((uint64_t *)(&actual), RAX);
+   put8(0xE9);
+   site = code_length;
+   put32(0);
+
+   jump_end_rel8();
+
+   mov_m32rel_imm32(&link_from, dst_block->start >> 12);
+   mov_m32rel_imm32(&link_site, site);
+}
+
+/* dst is the delay slot of a JAL or JALR $ra */
+void genpush_return(void)
+{
+   if (dst_block->start < 0x80000000 || dst_block->start >= 0xC0000000 ||
+       ((dst->addr + 4) & 0xFFF) == 0)
+      return;
+
+   mov_xreg32_m32rel(EAX, &return_stack_top);
+   add_reg32_imm32(EAX, 1);
+   and_eax_imm32(RETURN_STACK_SIZE - 1);
+   mov_m32rel_xreg32(&return_stack_top, EAX);
+   shl_reg32_imm8(EAX, 3);
+   mov_reg64_imm64(RCX, (uint64_t) return_stack);
+   add_reg64_reg64(RCX, RAX);
+   mov_reg64_imm64(RDX, (uint64_t) (dst+1));
+   mov_preg64pimm8_reg64(RCX, 0, RDX);
+}
+
+/* JR $ra leaving the page: the target is in EBX and the popped return
+ * stack slot in ECX. Falls through to the slow path when the prediction
+ * does not hold. */
+void genpredict_return(void)
+{
+   unsigned int fail[4];
+   int i, n = 0;
+
+   mov_reg64_imm64(RSI, (uint64_t) return_stack);
+   mov_reg64_preg64x8preg64(RSI, RCX, RSI);
+   mov_reg32_preg64pimm32(EAX, RSI, (unsigned int) offsetof(precomp_instr, addr));
+   cmp_reg32_reg32(EAX, EBX);
+   jne_rj(0);
+   fail[n++] = code_length;
+
+   mov_reg32_preg64pimm32(EAX, RSI, (unsigned int) offsetof(precomp_instr, reg_cache_infos.need_map));
+   cmp_reg32_imm8(EAX, 0);
+   jne_rj(0);
+   fail[n++] = code_length;
+
+   /* pushed return points are in kseg0 or kseg1 */
+   mov_reg32_reg32(EAX, EBX);
+   shr_reg32_imm8(EAX, 12);
+   and_eax_imm32(~0x20000 & 0xFFFFF);
+   mov_reg64_imm64(RDX, (uint64_t) invalid_code);
+   movsx_reg32_8preg64preg64(ECX, RAX, RDX);
+   add_reg64_imm32(RDX, 0x20000);
+   movsx_reg32_8preg64preg64(EDX, RAX, RDX);
+   or_reg64_reg64(RCX, RDX);
+   jne_rj(0);
+   fail[n++] = code_length;
+
+   cmp_m32rel_imm32((unsigned int *)(&skip_jump), 0);
+   jne_rj(0);
+   fail[n++] = code_length;
+
+   mov_reg32_reg32(EAX, EBX);
+   shr_reg32_imm8(EAX, 12);
+   mov_reg64_imm64(RDX, (uint64_t) blocks);
+   mov_reg64_preg64x8preg64(RDX, RAX, RDX);
+   mov_m64rel_xreg64((uint64_t *)(&actual), RDX);
+   mov_reg32_preg64pimm32(EAX, RSI, (unsigned int) offsetof(precomp_instr, local_addr));
+   mov_reg64_preg64pimm32(RDX, RDX, (unsigned int) offsetof(precomp_block, code));
+   add_reg64_reg64(RAX, RDX);
+   jmp_reg64(RAX);
+
+   for (i = 0; i < n; i++)
+      jump_end_rel8_at(fail[i]);
+}
+#endif
+
 static void genbeq_test(void)
 {
    int rs_64bit = is64((unsigned int *)dst->f.i.rs);
@@ -523,7 +624,7 @@ void genlink_subblock(void)
 }
 
 #ifdef COMPARE_CORE
-extern unsigned int op_R4300; /* api/debugger.c */
+extern unsigned int op_R4300; /* r4300/pure_interp.c */
 
 void gendebug(void)
 {
@@ -543,7 +644,7 @@ void gendebug(void)
    mov_reg64_imm64(RAX, (uint64_t) dst);
    mov_memoffs64_rax((uint64_t *) &PC);
    mov_reg32_imm32(EAX, (unsigned int) src);
-   mov_memoffs32_eax((unsigned int *) &op);
+   mov_memoffs32_eax((unsigned int *) &op_R4300);
    mov_reg64_imm64(RAX, (uint64_t) CoreCompareCallback);
    call_reg64(RAX);
 
@@ -567,7 +668,7 @@ void gendebug(void)
    mov_m32_reg32((unsigned int*)&edi, EDI);
 
    mov_m32_imm32((unsigned int*)(&PC), (unsigned int)(dst));
-   mov_m32_imm32((unsigned int*)(&op), (unsigned int)(src));
+   mov_m32_imm32((unsigned int*)(&op_R4300), (unsigned int)(src));
    mov_reg32_imm32(EAX, (unsigned int) CoreCompareCallback);
    call_reg32(EAX);
 
@@ -732,6 +833,7 @@ void genj_out(void)
 #ifdef __x86_64__
    mov_m32rel_imm32((void*)(&last_addr), naddr);
    gencheck_interupt_out(naddr);
+   genlink_out(naddr);
    mov_m32rel_imm32(&jump_to_address, naddr);
    mov_reg64_imm64(RAX, (uint64_t) (dst+1));
    mov_m64rel_xreg64((uint64_t *)(&PC), RAX);
@@ -764,24 +866,33 @@ void genj_idle(void)
    mov_xreg32_m32rel(EAX, (unsigned int *)(&next_interupt));
    sub_xreg32_m32rel(EAX, (unsigned int *)(&g_cp0_regs[CP0_COUNT_REG]));
    cmp_reg32_imm8(EAX, 3);
-   jbe_rj(12);
+   jbe_rj(19);
 
    and_eax_imm32(0xFFFFFFFC);  // 5
    add_m32rel_xreg32((unsigned int *)(&g_cp0_regs[CP0_COUNT_REG]), EAX); // 7
+   add_m32rel_xreg32((unsigned int *)(&idle_skipped), EAX); // 7
 #else
    mov_eax_memoffs32((unsigned int *)(&next_interupt));
    sub_reg32_m32(EAX, (unsigned int *)(&g_cp0_regs[CP0_COUNT_REG]));
    cmp_reg32_imm8(EAX, 3);
-   jbe_rj(11);
+   jbe_rj(17);
 
    and_eax_imm32(0xFFFFFFFC);  // 5
    add_m32_reg32((unsigned int *)(&g_cp0_regs[CP0_COUNT_REG]), EAX); // 6
+   add_m32_reg32((unsigned int *)(&idle_skipped), EAX); // 6
 #endif
 
    genj();
 #endif
 }
 
+/* A loop waiting on memory: the interpreter's _IDLE form checks what the
+ * loop reads before skipping ahead (see poll_loop_is_idle()). */
+void genpoll_loop(void)
+{
+   gencallinterp((native_type)dst->ops, 1);
+}
+
 void genjal(void)
 {
 #ifdef INTERPRET_JAL
@@ -807,6 +918,7 @@ void genjal(void)
 
    naddr = ((dst-1)->f.j.inst_index<<2) | (dst->addr & 0xF0000000);
 
+   genpush_return();
    mov_m32rel_imm32((void*)(&last_addr), naddr);
 #else
    mov_m32_imm32((unsigned int *)(reg + 31), dst->addr + 4);
@@ -849,8 +961,10 @@ void genjal_out(void)
 
    naddr = ((dst-1)->f.j.inst_index<<2) | (dst->addr & 0xF0000000);
 
+   genpush_return();
    mov_m32rel_imm32((void*)(&last_addr), naddr);
    gencheck_interupt_out(naddr);
+   genlink_out(naddr);
    mov_m32rel_imm32(&jump_to_address, naddr);
    mov_reg64_imm64(RAX, (uint64_t) (dst+1));
    mov_m64rel_xreg64((uint64_t *)(&PC), RAX);
@@ -891,18 +1005,20 @@ void genjal_idle(void)
    mov_xreg32_m32rel(EAX, (unsigned int *)(&next_interupt));
    sub_xreg32_m32rel(EAX, (unsigned int *)(&g_cp0_regs[CP0_COUNT_REG]));
    cmp_reg32_imm8(EAX, 3);
-   jbe_rj(12);
+   jbe_rj(19);
 
    and_eax_imm32(0xFFFFFFFC);  // 5
    add_m32rel_xreg32((unsigned int *)(&g_cp0_regs[CP0_COUNT_REG]), EAX); // 7
+   add_m32rel_xreg32((unsigned int *)(&idle_skipped), EAX); // 7
 #else
    mov_eax_memoffs32((unsigned int *)(&next_interupt));
    sub_reg32_m32(EAX, (unsigned int *)(&g_cp0_regs[CP0_COUNT_REG]));
    cmp_reg32_imm8(EAX, 3);
-   jbe_rj(11);
+   jbe_rj(17);
 
    and_eax_imm32(0xFFFFFFFC);
    add_m32_reg32((unsigned int *)(&g_cp0_regs[CP0_COUNT_REG]), EAX);
+   add_m32_reg32((unsigned int *)(&idle_skipped), EAX);
 #endif
 
    genjal();
@@ -1035,6 +1151,7 @@ void gentest_idle(void)
 
    and_reg32_imm32(reg, 0xFFFFFFFC);
    add_m32rel_xreg32((unsigned int *)(&g_cp0_regs[CP0_COUNT_REG]), reg);
+   add_m32rel_xreg32((unsigned int *)(&idle_skipped), reg);
 
    jump_end_rel8();
 #else
@@ -1046,11 +1163,12 @@ void gentest_idle(void)
    mov_reg32_m32(reg, (unsigned int *)(&next_interupt));
    sub_reg32_m32(reg, (unsigned int *)(&g_cp0_regs[CP0_COUNT_REG]));
    cmp_reg32_imm8(reg, 5);
-   jbe_rj(18);
+   jbe_rj(24);
 
    sub_reg32_imm32(reg, 2); // 6
    and_reg32_imm32(reg, 0xFFFFFFFC); // 6
    add_m32_reg32((unsigned int *)(&g_cp0_regs[CP0_COUNT_REG]), reg); // 6
+   add_m32_reg32((unsigned int *)(&idle_skipped), reg); // 6
 #endif
    jump_end_rel32();
 }
@@ -204,6 +204,7 @@ void genjr(void)
    unsigned int diff = (unsigned int) offsetof(precomp_instr, local_addr);
    unsigned int diff_need = (unsigned int) offsetof(precomp_instr, reg_cache_infos.need_map);
    unsigned int diff_wrap = (unsigned int) offsetof(precomp_instr, reg_cache_infos.jump_wrapper);
+   int ret = dst->f.i.rs == reg + 31;
 
    if (((dst->addr & 0xFFF) == 0xFFC && 
             (dst->addr < 0x80000000 || dst->addr >= 0xC0000000))||no_compiled_jump)
@@ -224,6 +225,17 @@ void genjr(void)
 
    gencheck_interupt_reg();
 
+   /* pop the return stack even for returns within the page, so it stays
+    * balanced with the calls */
+   if (ret)
+   {
+      mov_xreg32_m32rel(ECX, &return_stack_top);
+      mov_reg32_reg32(EDX, ECX);
+      add_reg32_imm32(EDX, RETURN_STACK_SIZE - 1);
+      and_reg32_imm32(EDX, RETURN_STACK_SIZE - 1);
+      mov_m32rel_xreg32(&return_stack_top, EDX);
+   }
+
    mov_xreg32_m32rel(EAX, (unsigned int *)&local_rs);
    mov_reg32_reg32(EBX, EAX);
    and_eax_imm32(0xFFFFF000);
@@ -232,6 +244,8 @@ void genjr(void)
 
    jump_start_rel32();
 
+   if (ret)
+      genpredict_return();
    mov_m32rel_xreg32(&jump_to_address, EBX);
    mov_reg64_imm64(RAX, (uint64_t) (dst+1));
    mov_m64rel_xreg64((uint64_t *)(&PC), RAX);
@@ -351,6 +365,8 @@ void genjalr(void)
       mov_m32rel_imm32(((unsigned int *)(dst-1)->f.r.rd)+1, 0xFFFFFFFF);
    else
       mov_m32rel_imm32(((unsigned int *)(dst-1)->f.r.rd)+1, 0);
+   if ((dst-1)->f.r.rd == reg + 31)
+      genpush_return();
 
    mov_xreg32_m32rel(EAX, (unsigned int *)&local_rs);
    mov_m32rel_xreg32((unsigned int *)&last_addr, EAX);
@@ -78,11 +78,16 @@ void free_all_registers(void)
 
 void simplify_access(void)
 {
+#ifndef COMPARE_CORE
    int i;
 
    dst->local_addr = code_length;
    for(i=0; i<8; i++)
       dst->reg_cache_infos.needed_registers[i] = NULL;
+#endif
+   /* with COMPARE_CORE the instruction starts with gendebug(), which
+    * flushes the registers the jumps into it load, so they must still
+    * land on its call */
 }
 
 #if defined(__x86_64__)
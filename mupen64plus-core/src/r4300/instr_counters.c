@@ -102,3 +102,424 @@ void instr_counters_print(void)
 }
 
 #endif /* COUNT_INSTR */
+
+#if defined(PROFILE_GUEST)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "api/callbacks.h"
+#include "api/m64p_types.h"
+#include "instr_counters.h"
+#include "main/main.h"
+#include "r4300.h"
+#include "rsp/rsp_core.h"
+#include "tlb.h"
+
+/* how far back to look for the branch ending the previous block and for
+ * the "jr $ra" ending the previous function, in instructions */
+#define BLOCK_SCAN 256
+#define FUNC_SCAN  0x4000
+
+#define SITE_CACHE_SIZE 4096
+#define STACK_TABLE_SIZE 16384
+#define TOP_FUNCTIONS 16
+
+/* resolved function/block of a sampled address, revalidated against the
+ * instruction word so overlays loaded over it are resolved again */
+struct profile_site
+{
+    uint32_t addr;
+    uint32_t word;
+    uint32_t func;
+    uint32_t block;
+};
+
+struct profile_stack
+{
+    uint32_t caller;
+    uint32_t func;
+    uint32_t block;
+    unsigned int hits;
+};
+
+struct profile_symbol
+{
+    uint32_t addr;
+    char *name;
+};
+
+static struct profile_site sites[SITE_CACHE_SIZE];
+static struct profile_stack stacks[STACK_TABLE_SIZE];
+static unsigned int stack_count;
+static unsigned int samples, dropped, unresolved;
+
+static struct profile_symbol *symbols;
+static size_t symbol_count;
+static guest_symbolizer symbolizer;
+
+/* Reads guest code without the side effects of the memory handlers: TLB
+ * misses and addresses outside RDRAM/SP memory are reported as unreadable
+ * instead of raising an exception. */
+static int read_guest_word(uint32_t addr, uint32_t *word)
+{
+    uint32_t phys;
+
+    if ((addr & UINT32_C(0xc0000000)) == UINT32_C(0x80000000))
+        phys = addr;
+    else
+    {
+        uint32_t entry = tlb_lut_r(addr >> 12);
+        if (entry == 0)
+            return 0;
+        phys = (entry & UINT32_C(0xFFFFF000)) | (addr & 0xFFF);
+    }
+    phys &= UINT32_C(0x1ffffffc);
+
+    if (phys < RDRAM_MAX_SIZE)
+        *word = g_rdram[phys / 4];
+    else if ((phys & UINT32_C(0xffffe000)) == UINT32_C(0x04000000))
+        *word = g_sp.mem[(phys & 0x1ffc) / 4];
+    else
+        return 0;
+    return 1;
+}
+
+static int is_block_end(uint32_t w)
+{
+    switch (w >> 26)
+    {
+        case 0: /* SPECIAL: JR, JALR */
+            return (w & 0x3e) == 0x08;
+        case 1: /* REGIMM: BLTZ..BGEZL, BLTZAL..BGEZALL */
+            return (w & UINT32_C(0x000c0000)) == 0;
+        case 2: case 3: case 4: case 5: case 6: case 7:
+        case 20: case 21: case 22: case 23:
+            return 1;
+        case 16: /* ERET */
+            return w == UINT32_C(0x42000018);
+        case 17: /* BC1 */
+            return ((w >> 21) & 0x1f) == 8;
+    }
+    return 0;
+}
+
+static int is_func_end(uint32_t w)
+{
+    return w == UINT32_C(0x03e00008) || w == UINT32_C(0x42000018);
+}
+
+/* The block starts after the delay slot of the previous branch. A branch
+ * right before addr means addr is a delay slot; it belongs to the block
+ * ending with that branch, so the scan carries on past it. */
+static uint32_t find_block_start(uint32_t addr, uint32_t func)
+{
+    uint32_t a, w;
+    int i;
+
+    for (i = 1, a = addr - 4; i <= BLOCK_SCAN && a >= func; i++, a -= 4)
+    {
+        if (!read_guest_word(a, &w))
+            break;
+        if (is_block_end(w) && a + 8 <= addr)
+            return a + 8;
+    }
+    return (a + 4 > func) ? a + 4 : func;
+}
+
+/* Without symbols a function starts after the "jr $ra" and delay slot of
+ * the previous one, skipping nop padding. */
+static uint32_t find_func_start(uint32_t addr)
+{
+    uint32_t a, w, start;
+    int i;
+
+    for (i = 1, a = addr - 4; i <= FUNC_SCAN; i++, a -= 4)
+    {
+        if (!read_guest_word(a, &w))
+            break;
+        if (is_func_end(w) && a + 8 <= addr)
+            break;
+    }
+    start = a + 8;
+    if (start > addr)
+        return addr;
+
+    while (start < addr && read_guest_word(start, &w) && w == 0)
+        start += 4;
+    return start;
+}
+
+static const char *lookup_symbol(uint32_t addr, uint32_t *start)
+{
+    size_t lo = 0, hi = symbol_count;
+
+    if (symbolizer != NULL)
+        return symbolizer(addr, start);
+
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (symbols[mid].addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return NULL;
+    *start = symbols[lo - 1].addr;
+    return symbols[lo - 1].name;
+}
+
+static const struct profile_site *resolve(uint32_t addr)
+{
+    struct profile_site *site = &sites[(addr >> 2) & (SITE_CACHE_SIZE - 1)];
+    uint32_t word, func;
+
+    if (!read_guest_word(addr, &word))
+        return NULL;
+    if (site->addr == addr && site->word == word && site->func != 0)
+        return site;
+
+    if (lookup_symbol(addr, &func) == NULL)
+        func = find_func_start(addr);
+
+    site->addr = addr;
+    site->word = word;
+    site->func = func;
+    site->block = find_block_start(addr, func);
+    return site;
+}
+
+static void record(uint32_t caller, uint32_t func, uint32_t block)
+{
+    unsigned int h = ((caller * 0x9E3779B1u) ^ (func * 0x85EBCA6Bu) ^ block) >> 2;
+    unsigned int i;
+
+    for (i = 0; i < STACK_TABLE_SIZE; i++, h++)
+    {
+        struct profile_stack *s = &stacks[h & (STACK_TABLE_SIZE - 1)];
+        if (s->hits == 0)
+        {
+            if (stack_count >= STACK_TABLE_SIZE * 3 / 4)
+                break;
+            s->caller = caller;
+            s->func = func;
+            s->block = block;
+            stack_count++;
+        }
+        else if (s->caller != caller || s->func != func || s->block != block)
+            continue;
+        s->hits++;
+        return;
+    }
+    dropped++;
+}
+
+void guest_profile_sample(void)
+{
+    const struct profile_site *site;
+    uint32_t caller = 0;
+    uint32_t ra = (uint32_t) reg[31];
+
+    samples++;
+
+#ifdef NEW_DYNAREC
+    /* new_dynarec only tracks the guest PC on exceptions */
+    if (r4300emu == CORE_DYNAREC)
+    {
+        unresolved++;
+        return;
+    }
+#endif
+
+    site = resolve(PC->addr);
+    if (site == NULL)
+    {
+        unresolved++;
+        return;
+    }
+
+    /* In a non-leaf function $ra is only the caller's return address until
+     * the first call; after that it points back into the function itself
+     * and the caller is unknown. */
+    if (ra >= 8)
+    {
+        const struct profile_site *call = resolve(ra - 8);
+        if (call != NULL && call->func != site->func)
+            caller = call->func;
+    }
+
+    record(caller, site->func, site->block);
+}
+
+void guest_profile_set_symbolizer(guest_symbolizer fn)
+{
+    symbolizer = fn;
+    memset(sites, 0, sizeof(sites));
+}
+
+static int compare_symbols(const void *a, const void *b)
+{
+    uint32_t x = ((const struct profile_symbol *) a)->addr;
+    uint32_t y = ((const struct profile_symbol *) b)->addr;
+    return (x > y) - (x < y);
+}
+
+static void free_symbols(void)
+{
+    size_t i;
+
+    for (i = 0; i < symbol_count; i++)
+        free(symbols[i].name);
+    free(symbols);
+    symbols = NULL;
+    symbol_count = 0;
+}
+
+int guest_profile_load_symbols(const char *filename)
+{
+    FILE *f = fopen(filename, "r");
+    char line[256], name[200], type[8];
+    unsigned int addr;
+    size_t capacity = 0;
+
+    if (f == NULL)
+        return 0;
+
+    free_symbols();
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        if (sscanf(line, "%x %7s %199s", &addr, type, name) != 3 &&
+            sscanf(line, "%x %199s", &addr, name) != 2)
+            continue;
+        if (symbol_count == capacity)
+        {
+            struct profile_symbol *grown;
+            capacity = capacity ? capacity * 2 : 256;
+            grown = (struct profile_symbol *) realloc(symbols, capacity * sizeof(*symbols));
+            if (grown == NULL)
+                break;
+            symbols = grown;
+        }
+        symbols[symbol_count].addr = addr;
+        symbols[symbol_count].name = strdup(name);
+        symbol_count++;
+    }
+    fclose(f);
+
+    qsort(symbols, symbol_count, sizeof(*symbols), compare_symbols);
+    memset(sites, 0, sizeof(sites));
+    DebugMessage(M64MSG_INFO, "Guest profiler: %u symbols loaded from %s", (unsigned int) symbol_count, filename);
+    return (int) symbol_count;
+}
+
+void guest_profile_reset(void)
+{
+    memset(sites, 0, sizeof(sites));
+    memset(stacks, 0, sizeof(stacks));
+    stack_count = 0;
+    samples = dropped = unresolved = 0;
+}
+
+static void format_frame(char *out, size_t size, uint32_t addr, int is_func)
+{
+    uint32_t start;
+    const char *name = lookup_symbol(addr, &start);
+
+    if (name == NULL)
+        snprintf(out, size, is_func ? "func_%08X" : "%08X", addr);
+    else if (start == addr)
+        snprintf(out, size, "%s", name);
+    else
+        snprintf(out, size, "%s+0x%X", name, addr - start);
+}
+
+static int compare_by_func(const void *a, const void *b)
+{
+    const struct profile_stack *x = (const struct profile_stack *) a;
+    const struct profile_stack *y = (const struct profile_stack *) b;
+    if (x->hits == 0 || y->hits == 0)
+        return (x->hits == 0) - (y->hits == 0);
+    return (x->func > y->func) - (x->func < y->func);
+}
+
+static void print_top_functions(void)
+{
+    struct profile_stack top[TOP_FUNCTIONS];
+    struct profile_stack *sorted;
+    char name[256];
+    unsigned int i, j, k, n = 0;
+
+    sorted = (struct profile_stack *) malloc(sizeof(stacks));
+    if (sorted == NULL)
+        return;
+    memcpy(sorted, stacks, sizeof(stacks));
+    qsort(sorted, STACK_TABLE_SIZE, sizeof(sorted[0]), compare_by_func);
+
+    /* sum per function, keeping the TOP_FUNCTIONS largest sorted */
+    for (i = 0; i < stack_count; i = j)
+    {
+        struct profile_stack f = sorted[i];
+        for (f.hits = 0, j = i; j < stack_count && sorted[j].func == f.func; j++)
+            f.hits += sorted[j].hits;
+
+        if (n < TOP_FUNCTIONS)
+            n++;
+        else if (top[n - 1].hits >= f.hits)
+            continue;
+        for (k = n - 1; k > 0 && top[k - 1].hits < f.hits; k--)
+            top[k] = top[k - 1];
+        top[k] = f;
+    }
+    free(sorted);
+
+    for (i = 0; i < n; i++)
+    {
+        format_frame(name, sizeof(name), top[i].func, 1);
+        DebugMessage(M64MSG_INFO, "%5.1f%% %8u  %s", top[i].hits * 100.0 / samples, top[i].hits, name);
+    }
+}
+
+void guest_profile_write(const char *filename)
+{
+    FILE *f;
+    char caller[256], func[256], block[256];
+    unsigned int i;
+
+    if (samples == 0)
+        return;
+
+    f = fopen(filename, "w");
+    if (f == NULL)
+    {
+        DebugMessage(M64MSG_ERROR, "Couldn't open %s for writing the guest profile", filename);
+        return;
+    }
+
+    for (i = 0; i < STACK_TABLE_SIZE; i++)
+    {
+        const struct profile_stack *s = &stacks[i];
+        if (s->hits == 0)
+            continue;
+        format_frame(func, sizeof(func), s->func, 1);
+        format_frame(block, sizeof(block), s->block, 0);
+        if (s->caller != 0)
+        {
+            format_frame(caller, sizeof(caller), s->caller, 1);
+            fprintf(f, "%s;%s;%s %u\n", caller, func, block, s->hits);
+        }
+        else
+            fprintf(f, "%s;%s %u\n", func, block, s->hits);
+    }
+    if (unresolved != 0)
+        fprintf(f, "[unresolved] %u\n", unresolved);
+    fclose(f);
+
+    DebugMessage(M64MSG_INFO, "Guest profile: %u samples, %u stacks, %u dropped, %u unresolved, written to %s",
+                 samples, stack_count, dropped, unresolved, filename);
+    print_top_functions();
+}
+
+#endif /* PROFILE_GUEST */
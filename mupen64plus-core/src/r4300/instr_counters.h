@@ -28,4 +28,30 @@ extern unsigned int instr_count[132];
 void instr_counters_print(void);
 #endif /* COUNT_INSTR */
 
+#if defined(PROFILE_GUEST)
+#include <stdint.h>
+
+/* Guest profiler: PROFILE_INT fires every GUEST_PROFILE_PERIOD count
+ * cycles and records the block about to run (interrupts are only checked
+ * at jumps), the function containing it and, when $ra still points out of
+ * that function, its caller. guest_profile_write() emits one
+ * "caller;function;block count" line per stack, which flamegraph.pl and
+ * speedscope read directly. */
+#ifndef GUEST_PROFILE_PERIOD
+#define GUEST_PROFILE_PERIOD 10000
+#endif
+
+/* Returns the name of the function containing addr and stores its entry
+ * point in *start, or returns NULL to fall back to scanning back for the
+ * previous "jr $ra". */
+typedef const char *(*guest_symbolizer)(uint32_t addr, uint32_t *start);
+
+void guest_profile_reset(void);
+void guest_profile_set_symbolizer(guest_symbolizer symbolizer);
+/* "address name" or nm style "address type name" lines, in any order */
+int guest_profile_load_symbols(const char *filename);
+void guest_profile_sample(void);
+void guest_profile_write(const char *filename);
+#endif /* PROFILE_GUEST */
+
 #endif /* M64P_R4300_INSTR_COUNTERS_H */
@@ -33,6 +33,7 @@
 #include "cached_interp.h"
 #include "cp0_private.h"
 #include "exception.h"
+#include "instr_counters.h"
 #include "main/main.h"
 #include "main/savestates.h"
 #include "mi_controller.h"
@@ -321,6 +322,8 @@ int save_eventqueue_infos(char *buf)
 
     for(e = q.first; e != NULL; e = e->next)
     {
+        if (e->data.type == PROFILE_INT)
+            continue;
         memcpy(buf + len    , &e->data.type , 4);
         memcpy(buf + len + 4, &e->data.count, 4);
         len += 8;
@@ -341,6 +344,9 @@ void load_eventqueue_infos(char *buf)
         add_interupt_event_count(type, count);
         len += 8;
     }
+#if defined(PROFILE_GUEST)
+    add_interupt_event(PROFILE_INT, GUEST_PROFILE_PERIOD);
+#endif
 }
 
 void init_interupt(void)
@@ -352,6 +358,9 @@ void init_interupt(void)
     clear_queue();
     add_interupt_event_count(VI_INT, g_vi.next_vi);
     add_interupt_event_count(SPECIAL_INT, 0);
+#if defined(PROFILE_GUEST)
+    add_interupt_event(PROFILE_INT, GUEST_PROFILE_PERIOD);
+#endif
 }
 
 void check_interupt(void)
@@ -531,6 +540,8 @@ void gen_interupt(void)
         case VI_INT:
             remove_interupt_event();
             vi_vertical_interrupt_event(&g_vi);
+            if (r4300emu != CORE_PURE_INTERPRETER)
+                dynarec_stats_vi();
             retro_return(false);
             break;
     
@@ -587,6 +598,14 @@ void gen_interupt(void)
             }
             break;
 
+#if defined(PROFILE_GUEST)
+        case PROFILE_INT:
+            remove_interupt_event();
+            add_interupt_event(PROFILE_INT, GUEST_PROFILE_PERIOD);
+            guest_profile_sample();
+            break;
+#endif
+
         default:
             DebugMessage(M64MSG_ERROR, "Unknown interrupt queue event type %.8X.", q.first->data.type);
             remove_interupt_event();
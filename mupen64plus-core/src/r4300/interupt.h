@@ -57,5 +57,6 @@ void load_eventqueue_infos(char *buf);
 #define HW2_INT     0x200
 #define NMI_INT     0x400
 #define CART_INT    0x800
+#define PROFILE_INT 0x1000 /* PROFILE_GUEST sampling, never saved */
 
 #endif /* M64P_R4300_INTERUPT_H */
@@ -0,0 +1,483 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - lockstep.c                                              *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#if defined(COMPARE_CORE)
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+#include "api/callbacks.h"
+#include "api/m64p_types.h"
+#include "cp0_private.h"
+#include "cp1_private.h"
+#include "lockstep.h"
+#include "main/main.h"
+#include "memory/memory.h"
+#include "pure_interp.h"
+#include "r4300.h"
+#include "tlb.h"
+
+/* instructions the reference runs ahead; a jump and its delay slot count
+ * as one, as they do for the callbacks of every core */
+#define LOCKSTEP_MAX_STEPS 64
+/* every step may store, the jump steps twice */
+#define LOCKSTEP_MAX_WRITES (LOCKSTEP_MAX_STEPS * 2)
+
+/* an RDRAM doubleword the reference stored to */
+struct lockstep_write
+{
+   uint32_t offset;
+   uint32_t before[2];
+   uint32_t after[2];
+};
+
+static struct
+{
+   int running;      /* the reference is executing */
+   int pending;      /* a reference result waits for the active core */
+   int diverged;
+   int announced;
+   uint32_t last_pc; /* of the previous callback */
+
+   uint32_t start, end;
+   unsigned int steps, left, length;
+   uint32_t next_interupt;
+
+   int64_t reg[32], hi, lo;
+   int64_t fgr[32];
+   uint32_t fcr31;
+   unsigned int llbit;
+
+   struct lockstep_write writes[LOCKSTEP_MAX_WRITES];
+   unsigned int nwrites;
+
+   unsigned int compared, skipped;
+} ls;
+
+/* Translates without raising TLB exceptions; 0 if the access does not
+ * hit RDRAM. */
+static int rdram_offset(uint32_t vaddr, int w, uint32_t *offset)
+{
+   uint32_t phys;
+
+   if ((vaddr & UINT32_C(0xC0000000)) == UINT32_C(0x80000000))
+      phys = vaddr & UINT32_C(0x1FFFFFFF);
+   else
+   {
+      uint32_t entry;
+
+      /* GoldenEye maps the cartridge there without the TLB */
+      if (vaddr >= UINT32_C(0x7F000000) && vaddr < UINT32_C(0x80000000))
+         return 0;
+      entry = w ? tlb_lut_w(vaddr >> 12) : tlb_lut_r(vaddr >> 12);
+      if (entry == 0)
+         return 0;
+      phys = (entry & UINT32_C(0x1FFFF000)) | (vaddr & UINT32_C(0xFFF));
+   }
+
+   if (phys >= RDRAM_MAX_SIZE)
+      return 0;
+   *offset = phys;
+   return 1;
+}
+
+static const uint32_t *fetch(uint32_t vaddr)
+{
+   uint32_t phys;
+
+   if ((vaddr & UINT32_C(0xC0000000)) == UINT32_C(0x80000000))
+      phys = vaddr & UINT32_C(0x1FFFFFFF);
+   else
+   {
+      uint32_t entry;
+
+      if (vaddr >= UINT32_C(0x7F000000) && vaddr < UINT32_C(0x80000000))
+         return NULL;
+      entry = tlb_lut_r(vaddr >> 12);
+      if (entry == 0)
+         return NULL;
+      phys = (entry & UINT32_C(0x1FFFF000)) | (vaddr & UINT32_C(0xFFF));
+   }
+
+   if (phys >= RDRAM_MAX_SIZE && (phys & UINT32_C(0xFFFFE000)) != UINT32_C(0x04000000))
+      return NULL;
+   return fast_mem_access(vaddr);
+}
+
+/* Returns whether op is a jump and the register it links, 0 if none. */
+static int is_jump(uint32_t op, unsigned int *link)
+{
+   const unsigned int rt = (op >> 16) & 0x1F;
+
+   *link = 0;
+   switch (op >> 26)
+   {
+   case 0:
+      if ((op & 0x3F) == 9)
+         *link = (op >> 11) & 0x1F;
+      return (op & 0x3E) == 8;
+   case 1:
+      if (rt & 0x10)
+         *link = 31;
+      return (rt & 0x0C) == 0;
+   case 3:
+      *link = 31;
+      return 1;
+   case 2: case 4: case 5: case 6: case 7:
+   case 20: case 21: case 22: case 23:
+      return 1;
+   case 17:
+      return ((op >> 21) & 0x1F) == 8;
+   }
+   return 0;
+}
+
+/* Checks that the reference can run op without side effects outside of
+ * the CPU state and RDRAM and logs the RDRAM it is about to store to.
+ * link is a register the preceding jump writes before op runs. */
+static int screen(uint32_t pc, unsigned int link, int *jump, unsigned int *jump_link)
+{
+   const uint32_t *p = fetch(pc);
+   uint32_t op, vaddr, offset;
+   unsigned int base;
+   int store = 0;
+
+   if (p == NULL)
+      return 0;
+   op = *p;
+
+   switch (op >> 26)
+   {
+   case 0:
+      switch (op & 0x3F)
+      {
+      case 1: case 5: case 10: case 11: case 12: case 13: case 14:
+      case 40: case 41: case 57: case 61:
+      case 48: case 49: case 50: case 51: case 52: case 53: case 54: case 55:
+         return 0; /* SYSCALL, BREAK, traps and reserved */
+      }
+      break;
+   case 1:
+      if (((op >> 16) & 0x1F) & 0x0C)
+         return 0; /* traps and reserved */
+      break;
+   case 17:
+      if (!(g_cp0_regs[CP0_STATUS_REG] & UINT32_C(0x20000000)))
+         return 0;
+      break;
+   case 49: case 53:
+      if (!(g_cp0_regs[CP0_STATUS_REG] & UINT32_C(0x20000000)))
+         return 0;
+      /* fall through */
+   case 26: case 27: case 32: case 33: case 34: case 35:
+   case 36: case 37: case 38: case 39: case 48: case 55:
+      break;
+   case 57: case 61:
+      if (!(g_cp0_regs[CP0_STATUS_REG] & UINT32_C(0x20000000)))
+         return 0;
+      /* fall through */
+   case 40: case 41: case 42: case 43: case 44: case 45:
+   case 46: case 56: case 63:
+      store = 1;
+      break;
+   case 2: case 3: case 4: case 5: case 6: case 7:
+   case 8: case 9: case 10: case 11: case 12: case 13: case 14: case 15:
+   case 20: case 21: case 22: case 23: case 24: case 25:
+      break;
+   default:
+      return 0; /* COP0, CACHE, LLD, SCD and reserved */
+   }
+
+   switch (op >> 26)
+   {
+   case 26: case 27: case 32: case 33: case 34: case 35: case 36: case 37:
+   case 38: case 39: case 48: case 49: case 53: case 55:
+   case 40: case 41: case 42: case 43: case 44: case 45: case 46:
+   case 56: case 57: case 61: case 63:
+      base = (op >> 21) & 0x1F;
+      if (base != 0 && base == link)
+         return 0;
+      vaddr = (uint32_t)(reg[base] + (int16_t)op);
+      if (!rdram_offset(vaddr, store, &offset))
+         return 0;
+      if (store)
+      {
+         struct lockstep_write *w = &ls.writes[ls.nwrites++];
+         w->offset = offset & ~UINT32_C(7);
+         w->before[0] = g_rdram[w->offset / 4];
+         w->before[1] = g_rdram[w->offset / 4 + 1];
+      }
+      break;
+   }
+
+   *jump = is_jump(op, jump_link);
+   return 1;
+}
+
+static void run_reference(uint32_t start)
+{
+   precomp_instr *saved_pc = PC;
+   const unsigned int saved_emu = r4300emu;
+   const unsigned int saved_delay_slot = delay_slot;
+   const unsigned int saved_dyna_interp = dyna_interp;
+   const uint32_t saved_skip_jump = skip_jump;
+   const uint32_t saved_last_addr = last_addr;
+   const unsigned int saved_llbit = llbit;
+   const uint32_t saved_fcr31 = FCR31;
+   const int64_t saved_hi = hi, saved_lo = lo;
+   int64_t saved_reg[32], saved_fgr[32];
+   unsigned int saved_cp0[CP0_REGS_COUNT];
+   uint32_t pc = start;
+   int interrupted = 0;
+   unsigned int i;
+
+   memcpy(saved_reg, reg, sizeof(saved_reg));
+   memcpy(saved_fgr, reg_cop1_fgr_64, sizeof(saved_fgr));
+   memcpy(saved_cp0, g_cp0_regs, sizeof(saved_cp0));
+
+   ls.start = start;
+   ls.steps = ls.length = ls.nwrites = 0;
+   ls.next_interupt = next_interupt;
+
+   /* the pure interpreter neither invalidates the active core's code nor
+    * services interrupts this way; crossing next_interupt is checked below */
+   ls.running = 1;
+   r4300emu = CORE_PURE_INTERPRETER;
+   next_interupt = UINT32_C(0xFFFFFFFF);
+
+   while (ls.steps < LOCKSTEP_MAX_STEPS)
+   {
+      unsigned int link, slot_link;
+      int jump = 0, slot_jump = 0;
+      const unsigned int nwrites = ls.nwrites;
+
+      if (!screen(pc, 0, &jump, &link))
+         break;
+      if (jump && (!screen(pc + 4, link, &slot_jump, &slot_link) || slot_jump))
+      {
+         ls.nwrites = nwrites;
+         break;
+      }
+
+      pc = pure_interpreter_step(pc);
+      ls.steps++;
+      ls.length += jump ? 2 : 1;
+
+      if (skip_jump || ls.next_interupt <= g_cp0_regs[CP0_COUNT_REG]
+          || ((g_cp0_regs[CP0_STATUS_REG] & 2) && !(saved_cp0[CP0_STATUS_REG] & 2)))
+      {
+         interrupted = 1;
+         break;
+      }
+      if (jump)
+         break;
+   }
+
+   ls.end = pc;
+   memcpy(ls.reg, reg, sizeof(ls.reg));
+   memcpy(ls.fgr, reg_cop1_fgr_64, sizeof(ls.fgr));
+   ls.hi = hi;
+   ls.lo = lo;
+   ls.fcr31 = FCR31;
+   ls.llbit = llbit;
+
+   for (i = ls.nwrites; i-- > 0; )
+   {
+      struct lockstep_write *w = &ls.writes[i];
+      w->after[0] = g_rdram[w->offset / 4];
+      w->after[1] = g_rdram[w->offset / 4 + 1];
+   }
+   for (i = ls.nwrites; i-- > 0; )
+   {
+      const struct lockstep_write *w = &ls.writes[i];
+      g_rdram[w->offset / 4] = w->before[0];
+      g_rdram[w->offset / 4 + 1] = w->before[1];
+   }
+
+   memcpy(reg, saved_reg, sizeof(saved_reg));
+   memcpy(reg_cop1_fgr_64, saved_fgr, sizeof(saved_fgr));
+   memcpy(g_cp0_regs, saved_cp0, sizeof(saved_cp0));
+   hi = saved_hi;
+   lo = saved_lo;
+   llbit = saved_llbit;
+   if (FCR31 != saved_fcr31)
+   {
+      FCR31 = saved_fcr31;
+      update_x86_rounding_mode(FCR31);
+   }
+   next_interupt = ls.next_interupt;
+   last_addr = saved_last_addr;
+   skip_jump = saved_skip_jump;
+   dyna_interp = saved_dyna_interp;
+   delay_slot = saved_delay_slot;
+   r4300emu = saved_emu;
+   PC = saved_pc;
+   ls.running = 0;
+
+   /* an idle loop would end where it started */
+   if (interrupted || ls.steps == 0 || (ls.steps == 1 && ls.end == start))
+   {
+      if (interrupted)
+         ls.skipped++;
+      return;
+   }
+
+   ls.left = ls.steps;
+   ls.pending = 1;
+}
+
+static void report(uint32_t pc, const char *what)
+{
+   char line[8 * 9 + 1];
+   unsigned int i;
+
+   DebugMessage(M64MSG_ERROR, "Lockstep: divergence at %08" PRIx32 " after block %08" PRIx32
+                " (%u instructions, %u blocks matched before): %s",
+                pc, ls.start, ls.length, ls.compared, what);
+
+   line[0] = '\0';
+   for (i = 0; i < ls.length; i++)
+   {
+      const uint32_t *p = fetch(ls.start + i * 4);
+
+      sprintf(line + (i % 8) * 9, " %08" PRIx32, p ? *p : 0);
+      if (i % 8 == 7 || i == ls.length - 1)
+         DebugMessage(M64MSG_ERROR, "Lockstep:   %08" PRIx32 ":%s",
+                      ls.start + (i & ~7u) * 4, line);
+   }
+   ls.diverged = 1;
+}
+
+static void compare(uint32_t pc)
+{
+   char what[128];
+   unsigned int i;
+
+   /* the active core serviced an interrupt in the middle */
+   if (next_interupt != ls.next_interupt)
+   {
+      ls.skipped++;
+      return;
+   }
+
+   if (pc != ls.end)
+   {
+      sprintf(what, "PC, reference %08" PRIx32, ls.end);
+      report(pc, what);
+      return;
+   }
+
+   for (i = 1; i < 32; i++)
+   {
+      if (reg[i] != ls.reg[i])
+      {
+         sprintf(what, "r%u = %016" PRIx64 ", reference %016" PRIx64, i, reg[i], ls.reg[i]);
+         report(pc, what);
+         return;
+      }
+   }
+   if (hi != ls.hi || lo != ls.lo)
+   {
+      sprintf(what, "hi:lo = %016" PRIx64 ":%016" PRIx64 ", reference %016" PRIx64 ":%016" PRIx64,
+              hi, lo, ls.hi, ls.lo);
+      report(pc, what);
+      return;
+   }
+   for (i = 0; i < 32; i++)
+   {
+      if (reg_cop1_fgr_64[i] != ls.fgr[i])
+      {
+         sprintf(what, "f%u = %016" PRIx64 ", reference %016" PRIx64, i, reg_cop1_fgr_64[i], ls.fgr[i]);
+         report(pc, what);
+         return;
+      }
+   }
+   if (FCR31 != ls.fcr31 || llbit != ls.llbit)
+   {
+      sprintf(what, "FCR31 %08" PRIx32 " llbit %u, reference FCR31 %08" PRIx32 " llbit %u",
+              FCR31, llbit, ls.fcr31, ls.llbit);
+      report(pc, what);
+      return;
+   }
+   for (i = 0; i < ls.nwrites; i++)
+   {
+      const struct lockstep_write *w = &ls.writes[i];
+
+      if (g_rdram[w->offset / 4] != w->after[0] || g_rdram[w->offset / 4 + 1] != w->after[1])
+      {
+         sprintf(what, "RDRAM %08" PRIx32 " = %08" PRIx32 "%08" PRIx32 ", reference %08" PRIx32 "%08" PRIx32,
+                 w->offset, g_rdram[w->offset / 4], g_rdram[w->offset / 4 + 1],
+                 w->after[0], w->after[1]);
+         report(pc, what);
+         return;
+      }
+   }
+
+   ls.compared++;
+}
+
+void lockstep_check(void)
+{
+   uint32_t pc;
+
+   /* the checks run at instruction boundaries only */
+   if (ls.running || ls.diverged || delay_slot || r4300emu == CORE_PURE_INTERPRETER)
+      return;
+
+   pc = PC->addr;
+   /* a block entered for the first time reports its first instruction
+    * again once it is compiled */
+   if (pc == ls.last_pc)
+      return;
+   ls.last_pc = pc;
+
+   if (!ls.announced)
+   {
+      DebugMessage(M64MSG_INFO, "Lockstep: comparing the %s against the pure interpreter",
+                   r4300emu == CORE_DYNAREC ? "dynarec" : "cached interpreter");
+      ls.announced = 1;
+   }
+
+   if (ls.pending)
+   {
+      if (--ls.left > 0)
+         return;
+      ls.pending = 0;
+      compare(pc);
+      if (ls.diverged)
+         return;
+   }
+
+   run_reference(pc);
+}
+
+void lockstep_print_stats(void)
+{
+   if (ls.announced)
+      DebugMessage(M64MSG_INFO, "Lockstep: %u blocks matched, %u skipped for interrupts%s",
+                   ls.compared, ls.skipped, ls.diverged ? ", stopped at the first divergence" : "");
+   memset(&ls, 0, sizeof(ls));
+}
+
+#endif /* COMPARE_CORE */
@@ -0,0 +1,43 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - lockstep.h                                              *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_R4300_LOCKSTEP_H
+#define M64P_R4300_LOCKSTEP_H
+
+#if defined(COMPARE_CORE)
+/* Built-in core comparison, used by CoreCompareCallback() when no
+ * external compare callback is registered.
+ *
+ * At the start of a block the pure interpreter runs ahead on the current
+ * state, up to and including the next jump and its delay slot. Its
+ * registers and the RDRAM words it stored to are kept, then the state and
+ * memory are put back and the active core runs the same block. When the
+ * active core reaches the end of the block both results are compared and
+ * the first divergence is reported together with the opcodes of the block.
+ *
+ * Blocks only cover code the reference can run without side effects:
+ * loads and stores must hit RDRAM, and COP0, CACHE, SYSCALL, BREAK and
+ * trap instructions end the block before them. Blocks during which an
+ * interrupt is serviced are not compared. */
+void lockstep_check(void);
+void lockstep_print_stats(void);
+#endif
+
+#endif /* M64P_R4300_LOCKSTEP_H */
@@ -37,6 +37,7 @@
 #include "main/main.h"
 #include "memory/memory.h"
 #include "osal/preproc.h"
+#include "pure_interp.h"
 #include "r4300.h"
 #include "tlb.h"
 
@@ -722,6 +723,21 @@ void InterpretOpcode()
 	} /* switch ((op >> 26) & 0x3F) */
 }
 
+/* opcode at PC, handed to the external core compare callback */
+unsigned int op_R4300;
+
+#ifdef COMPARE_CORE
+/* Runs the instruction at addr, a jump together with its delay slot, for
+ * the lockstep checker and returns the address of the next one. */
+uint32_t pure_interpreter_step(uint32_t addr)
+{
+   PC = &interp_PC;
+   PC->addr = addr;
+   InterpretOpcode();
+   return PC->addr;
+}
+#endif
+
 void pure_interpreter(void)
 {
    stop = 0;
@@ -731,6 +747,7 @@ void pure_interpreter(void)
    while (!stop)
    {
 #ifdef COMPARE_CORE
+     op_R4300 = *fast_mem_access(PC->addr);
      CoreCompareCallback();
 #endif
 #ifdef DBG
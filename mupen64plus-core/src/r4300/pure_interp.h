@@ -22,6 +22,12 @@
 #ifndef M64P_R4300_PURE_INTERP_H
 #define M64P_R4300_PURE_INTERP_H
 
+#include <stdint.h>
+
 void pure_interpreter(void);
 
+#ifdef COMPARE_CORE
+uint32_t pure_interpreter_step(uint32_t addr);
+#endif
+
 #endif /* M64P_R4300_PURE_INTERP_H */
@@ -53,10 +53,14 @@
 #include "debugger/dbg_types.h"
 #endif
 
-#if defined(COUNT_INSTR)
+#if defined(COUNT_INSTR) || defined(PROFILE_GUEST)
 #include "instr_counters.h"
 #endif
 
+#ifdef COMPARE_CORE
+#include "lockstep.h"
+#endif
+
 unsigned int r4300emu = 0;
 unsigned int count_per_op = COUNT_PER_OP_DEFAULT;
 int rompause;
@@ -126,11 +130,7 @@ void r4300_reset_hard(void)
         tlb_e[i].end_odd=0;
         tlb_e[i].phys_odd=0;
     }
-    for (i=0; i<0x100000; i++)
-    {
-        tlb_LUT_r[i] = 0;
-        tlb_LUT_w[i] = 0;
-    }
+    tlb_lut_clear();
     llbit=0;
     hi=0;
     lo=0;
@@ -250,6 +250,10 @@ void r4300_execute(void)
 #if defined(COUNT_INSTR)
     memset(instr_count, 0, 131*sizeof(instr_count[0]));
 #endif
+#if defined(PROFILE_GUEST)
+    guest_profile_reset();
+    guest_profile_load_symbols("guest_symbols.txt");
+#endif
 
     last_addr = 0xa4000040;
     next_interupt = 624999;
@@ -294,6 +298,9 @@ void r4300_execute(void)
         pfProfile = NULL;
 #endif
         free_blocks();
+#ifndef NEW_DYNAREC
+        free_code_arena();
+#endif
     }
 #endif
     else /* if (r4300emu == CORE_INTERPRETER) */
@@ -325,10 +332,18 @@ void r4300_execute(void)
     }
 
     DebugMessage(M64MSG_INFO, "R4300 emulator finished.");
+    if (r4300emu != CORE_PURE_INTERPRETER)
+        idle_stats_print();
+#ifdef COMPARE_CORE
+    lockstep_print_stats();
+#endif
 
     /* print instruction counts */
 #if defined(COUNT_INSTR)
     if (r4300emu == CORE_DYNAREC)
         instr_counters_print();
 #endif
+#if defined(PROFILE_GUEST)
+    guest_profile_write("guest_profile.folded");
+#endif
 }
@@ -37,16 +37,26 @@
 #include "api/m64p_types.h"
 #include "cached_interp.h"
 #include "cp0_private.h"
+#include "main/main.h"
 #include "main/profile.h"
+#include "main/rom.h"
 #include "memory/memory.h"
 #include "ops.h"
 #include "r4300.h"
 #include "recomp.h"
 #include "recomph.h" //include for function prototypes
 #include "tlb.h"
+#include "vi/vi_controller.h"
 
 static void *malloc_exec(size_t size);
 static void free_exec(void *ptr, size_t length);
+static unsigned char *alloc_code(size_t size);
+static void release_code(unsigned char *ptr, size_t size);
+static void trim_code(precomp_block *block);
+static void reserve_code_space(const precomp_block *block);
+static int in_code_arena(const void *ptr);
+static void unlink_code(const unsigned char *code, unsigned char *moved);
+static void clear_return_stack(void);
 
 // global variables :
 precomp_instr *dst; // destination structure for the recompiled instruction
@@ -57,6 +67,9 @@ precomp_block *dst_block; // the current block that we are recompiling
 uint32_t src; // the current recompiled instruction
 int fast_memory;
 int no_compiled_jump = 0; /* use cached interpreter instead of recompiler for jumps */
+unsigned int link_from;
+unsigned int link_site;
+unsigned int return_stack_top;
 
 static void (*recomp_func)(void); // pointer to the dynarec's generator
                                   // function for the latest decoded opcode
@@ -68,8 +81,321 @@ FILE *pfProfile;
 static const uint32_t *SRC; // currently recompiled instruction in the input stream
 static int check_nop; // next instruction is nop ?
 static int delay_slot_compiled = 0;
+static int init_length; // size of the NOTCOMPILED stubs at the start of a block's code
+
+/* a page is compiled again from scratch once the code of its reset
+ * sequences is over this many bytes and more than its live code */
+#define DEAD_CODE_LIMIT 8192
+
+/* self-modifying code counters, logged once per emulated second */
+static struct
+{
+   unsigned int recompiles; // sequences compiled
+   unsigned int reinits;    // compiled pages thrown away entirely
+   unsigned int partial;    // pages where only the changed sequences were reset
+   unsigned int unchanged;  // invalidated pages whose code turned out untouched
+   unsigned int vis;
+} smc_stats;
+
+/* Out-of-page exits linked straight to their target's code. An exit is a
+ * jmp rel32 that falls through to the jump_to_func() call while its
+ * displacement is 0. Every link is recorded so that it can be undone when
+ * the code at either end is reset, moved or freed. */
+typedef struct
+{
+   precomp_block *from;
+   precomp_block *to;
+   unsigned int site; // offset of the displacement in from->code
+} block_link;
+
+static block_link *block_links = NULL;
+static int block_links_number = 0;
+static int max_block_links_number = 0;
+
+static struct
+{
+   unsigned int dispatches; // jumps that went through jump_to_func()
+   unsigned int links;
+   unsigned int unlinks;
+} link_stats;
+
+/* never matches: need_map sends JR $ra to the slow path */
+static precomp_instr no_return = { NULL, { { NULL, NULL, 0 } }, 1, 0, { 1 } };
+precomp_instr *return_stack[RETURN_STACK_SIZE] =
+{
+   &no_return, &no_return, &no_return, &no_return,
+   &no_return, &no_return, &no_return, &no_return
+};
+
+/* Translated code of every page is bump allocated from one executable
+ * reservation. A page's buffer grows in place while it is the last one
+ * allocated and moves to the top otherwise; when less than the headroom is
+ * left, the whole cache is flushed before the next block is compiled. */
+#if defined(__x86_64__)
+#define CODE_ARENA_SIZE (128 * 1024 * 1024)
+#else
+#define CODE_ARENA_SIZE (64 * 1024 * 1024)
+#endif
+#define CODE_ARENA_HEADROOM (512 * 1024)
+#define CODE_ALIGN(size) (((size) + 15) & ~(size_t)15)
+
+static unsigned char *code_arena = NULL;
+static int code_arena_failed = 0;
+static size_t code_arena_top = 0;  // bump pointer
+static size_t code_arena_live = 0; // bytes owned by blocks, the rest below top is garbage
+
+static struct
+{
+   uint64_t emitted;      // bytes of code generated
+   size_t peak;           // highest bump pointer
+   size_t peak_garbage;   // most bytes left behind by moved or freed buffers
+   unsigned int moves;    // buffers copied to the top to grow
+   unsigned int flushes;  // whole cache flushes
+   unsigned int overflows; // buffers that did not fit and got their own mapping
+} code_arena_stats;
+
+/* Poll loops
+ *
+ * A branch to itself with a nop in its delay slot only burns cycles until
+ * the next event, so its _IDLE form moves the count straight to
+ * next_interupt. Short backward loops waiting on memory, like
+ *
+ *    loop: lw   t0, 0x0008(t1)      # MI_INTR, or a flag in RDRAM
+ *          andi t0, t0, 0x0008
+ *          beq  t0, zero, loop
+ *          nop
+ *
+ * are just as idle as long as every iteration computes the same values
+ * from the same memory: the body may only load, compute and branch out of
+ * the loop, and no register may carry a value from one iteration into the
+ * next. RDRAM and the MI/SP/PI/SI registers only change at events, while
+ * VI_CURRENT, AI_LEN and the DP counters follow the count and keep the
+ * loop running. The loaded addresses depend on the registers, so they are
+ * checked again by poll_loop_is_idle() each time the loop is skipped. */
+#define POLL_LOOP_MAX 8 // instructions, including the delay slot
+
+uint32_t idle_skipped;
+
+static struct
+{
+   uint64_t skipped;        // count cycles skipped by idle loops
+   uint64_t cycles;         // count cycles emulated
+   uint32_t window_skipped; // the same over the last second
+   uint32_t window_cycles;
+   unsigned int poll_loops; // loops compiled to their _IDLE form
+} idle_stats;
+
+static int poll_address_ok(uint32_t address)
+{
+   uint32_t phys;
+
+   if ((address & UINT32_C(0xc0000000)) == UINT32_C(0x80000000))
+      phys = address & UINT32_C(0x1fffffff);
+   else
+   {
+      uint32_t entry = tlb_lut_r(address >> 12);
+      if (entry == 0)
+         return 0;
+      phys = (entry & UINT32_C(0x1ffff000)) | (address & 0xfff);
+   }
+
+   if (phys < RDRAM_MAX_SIZE)
+      return 1;
+   switch (phys >> 16)
+   {
+      case 0x0404: return phys < UINT32_C(0x0404001c); // SP, but not the semaphore
+      case 0x0430: return 1;                            // MI
+      case 0x0460: return 1;                            // PI
+      case 0x0480: return phys == UINT32_C(0x04800018); // SI_STATUS
+   }
+   return 0;
+}
+
+/* Registers read and written by a poll loop instruction, 0 if it may not
+ * appear in one. *branch is set for conditional branches, *load for loads. */
+static int poll_decode(uint32_t w, uint32_t *reads, uint32_t *writes, int *branch, int *load)
+{
+   const uint32_t rs = UINT32_C(1) << ((w >> 21) & 0x1f);
+   const uint32_t rt = UINT32_C(1) << ((w >> 16) & 0x1f);
+   const uint32_t rd = UINT32_C(1) << ((w >> 11) & 0x1f);
 
+   *reads = *writes = 0;
+   *branch = *load = 0;
+   switch (w >> 26)
+   {
+      case 0x00:
+         switch (w & 0x3f)
+         {
+            case 0x00: case 0x02: case 0x03: // SLL, SRL, SRA
+            case 0x38: case 0x3a: case 0x3b: // DSLL, DSRL, DSRA
+            case 0x3c: case 0x3e: case 0x3f: // DSLL32, DSRL32, DSRA32
+               *reads = rt;
+               *writes = rd;
+               break;
+            case 0x04: case 0x06: case 0x07: // SLLV, SRLV, SRAV
+            case 0x14: case 0x16: case 0x17: // DSLLV, DSRLV, DSRAV
+            case 0x20: case 0x21: case 0x22: case 0x23: // ADD, ADDU, SUB, SUBU
+            case 0x24: case 0x25: case 0x26: case 0x27: // AND, OR, XOR, NOR
+            case 0x2a: case 0x2b:                       // SLT, SLTU
+            case 0x2c: case 0x2d: case 0x2e: case 0x2f: // DADD, DADDU, DSUB, DSUBU
+               *reads = rs | rt;
+               *writes = rd;
+               break;
+            case 0x10: case 0x12: // MFHI, MFLO
+               *writes = rd;
+               break;
+            default:
+               return 0;
+         }
+         break;
+      case 0x01: // BLTZ, BGEZ
+         if (((w >> 16) & 0x1f) > 1)
+            return 0;
+         *reads = rs;
+         *branch = 1;
+         break;
+      case 0x04: case 0x05: // BEQ, BNE
+         *reads = rs | rt;
+         *branch = 1;
+         break;
+      case 0x06: case 0x07: // BLEZ, BGTZ
+         *reads = rs;
+         *branch = 1;
+         break;
+      case 0x08: case 0x09: case 0x0a: case 0x0b: // ADDI, ADDIU, SLTI, SLTIU
+      case 0x0c: case 0x0d: case 0x0e:            // ANDI, ORI, XORI
+      case 0x18: case 0x19:                       // DADDI, DADDIU
+         *reads = rs;
+         *writes = rt;
+         break;
+      case 0x0f: // LUI
+         *writes = rt;
+         break;
+      case 0x20: case 0x21: case 0x23: // LB, LH, LW
+      case 0x24: case 0x25: case 0x27: // LBU, LHU, LWU
+      case 0x37:                       // LD
+         *reads = rs;
+         *writes = rt;
+         *load = 1;
+         break;
+      default:
+         return 0;
+   }
+   *writes &= ~UINT32_C(1);
+   return 1;
+}
 
+/* Checks the n words of a loop starting at start, whose closing branch or
+ * jump is words[n-2]. With regs, the loads must also read memory that only
+ * changes at events; without, the loop is only checked to be able to. */
+static int poll_loop_scan(const uint32_t *words, unsigned int n, uint32_t start, const int64_t *regs)
+{
+   const uint32_t end = start + (n - 2) * 4;
+   uint32_t reads[POLL_LOOP_MAX], writes[POLL_LOOP_MAX];
+   int load[POLL_LOOP_MAX];
+   uint32_t written = 0, loop_writes = 0, known;
+   int64_t value[32];
+   unsigned int i;
+
+   for (i = 0; i < n; i++)
+   {
+      int branch;
+
+      if (i == n - 2)
+      {
+         /* the closing branch, already known to jump back to start */
+         if ((words[i] >> 26) == 0x02)
+            reads[i] = writes[i] = 0, load[i] = 0;
+         else if (!poll_decode(words[i], &reads[i], &writes[i], &branch, &load[i]))
+            return 0;
+         continue;
+      }
+      if (!poll_decode(words[i], &reads[i], &writes[i], &branch, &load[i]))
+         return 0;
+      if (branch)
+      {
+         /* exits only, and not with the closing branch in their delay slot */
+         uint32_t target = start + i * 4 + 4 + (uint32_t)(int16_t) words[i] * 4;
+         if (i >= n - 3 || (target >= start && target <= end + 4))
+            return 0;
+      }
+      loop_writes |= writes[i];
+   }
+
+   /* nothing carried over from the previous iteration */
+   for (i = 0; i < n; i++)
+   {
+      if (reads[i] & loop_writes & ~written)
+         return 0;
+      written |= writes[i];
+   }
+
+   /* follow the constants building the load addresses */
+   known = ~loop_writes;
+   if (regs != NULL)
+      memcpy(value, regs, sizeof(value));
+   else
+      memset(value, 0, sizeof(value));
+   for (i = 0; i < n; i++)
+   {
+      const uint32_t w = words[i], op = w >> 26;
+      const unsigned int rs = (w >> 21) & 0x1f, rt = (w >> 16) & 0x1f;
+      const int rs_known = (known >> rs) & 1;
+
+      if (load[i])
+      {
+         if (!rs_known)
+            return 0;
+         if (regs != NULL && !poll_address_ok((uint32_t)(value[rs] + (int16_t) w)))
+            return 0;
+      }
+
+      known &= ~writes[i];
+      if (writes[i] == 0 || load[i])
+         continue;
+      if (op == 0x0f) // LUI
+         value[rt] = (int64_t)(int32_t)(w << 16);
+      else if (op == 0x09 && rs_known) // ADDIU
+         value[rt] = (int64_t)(int32_t)(value[rs] + (int16_t) w);
+      else if (op == 0x19 && rs_known) // DADDIU
+         value[rt] = value[rs] + (int16_t) w;
+      else if (op == 0x0d && rs_known) // ORI
+         value[rt] = value[rs] | (uint16_t) w;
+      else
+         continue;
+      known |= writes[i];
+   }
+   return 1;
+}
+
+/* Called from the _IDLE form of a loop's closing branch when it is taken. */
+int poll_loop_is_idle(uint32_t branch, uint32_t target)
+{
+   const uint32_t *words;
+   unsigned int n;
+
+   if (target >= branch || branch - target > (POLL_LOOP_MAX - 2) * 4 ||
+       (branch & ~UINT32_C(0xfff)) != (target & ~UINT32_C(0xfff)) || (branch & 0xfff) == 0xffc)
+      return 0;
+   n = (branch - target) / 4 + 2;
+   words = fast_mem_access(target);
+   return words != NULL && poll_loop_scan(words, n, target, reg);
+}
+
+/* Whether the branch being compiled closes a loop that poll_loop_is_idle()
+ * may skip. */
+static int is_poll_loop(uint32_t target)
+{
+   unsigned int n;
+
+   if (target >= dst->addr || target < dst_block->start || dst->addr == dst_block->end - 4)
+      return 0;
+   n = (dst->addr - target) / 4 + 2;
+   if (n > POLL_LOOP_MAX || !poll_loop_scan(SRC - (n - 2), n, target, NULL))
+      return 0;
+   idle_stats.poll_loops++;
+   return 1;
+}
 
 static void RSV(void)
 {
@@ -556,6 +882,11 @@ static void RBLTZ(void)
       dst->ops = current_instruction_table.BLTZ_OUT;
       recomp_func = genbltz_out;
    }
+   else if (is_poll_loop(target))
+   {
+      dst->ops = current_instruction_table.BLTZ_IDLE;
+      recomp_func = genpoll_loop;
+   }
 }
 
 static void RBGEZ(void)
@@ -578,6 +909,11 @@ static void RBGEZ(void)
       dst->ops = current_instruction_table.BGEZ_OUT;
       recomp_func = genbgez_out;
    }
+   else if (is_poll_loop(target))
+   {
+      dst->ops = current_instruction_table.BGEZ_IDLE;
+      recomp_func = genpoll_loop;
+   }
 }
 
 static void RBLTZL(void)
@@ -600,6 +936,11 @@ static void RBLTZL(void)
       dst->ops = current_instruction_table.BLTZL_OUT;
       recomp_func = genbltzl_out;
    }
+   else if (is_poll_loop(target))
+   {
+      dst->ops = current_instruction_table.BLTZL_IDLE;
+      recomp_func = genpoll_loop;
+   }
 }
 
 static void RBGEZL(void)
@@ -622,6 +963,11 @@ static void RBGEZL(void)
       dst->ops = current_instruction_table.BGEZL_OUT;
       recomp_func = genbgezl_out;
    }
+   else if (is_poll_loop(target))
+   {
+      dst->ops = current_instruction_table.BGEZL_IDLE;
+      recomp_func = genpoll_loop;
+   }
 }
 
 static void RTGEI(void)
@@ -1639,6 +1985,11 @@ static void RJ(void)
       dst->ops = current_instruction_table.J_OUT;
       recomp_func = genj_out;
    }
+   else if (is_poll_loop(target))
+   {
+      dst->ops = current_instruction_table.J_IDLE;
+      recomp_func = genpoll_loop;
+   }
 }
 
 static void RJAL(void)
@@ -1683,6 +2034,11 @@ static void RBEQ(void)
       dst->ops = current_instruction_table.BEQ_OUT;
       recomp_func = genbeq_out;
    }
+   else if (is_poll_loop(target))
+   {
+      dst->ops = current_instruction_table.BEQ_IDLE;
+      recomp_func = genpoll_loop;
+   }
 }
 
 static void RBNE(void)
@@ -1705,6 +2061,11 @@ static void RBNE(void)
       dst->ops = current_instruction_table.BNE_OUT;
       recomp_func = genbne_out;
    }
+   else if (is_poll_loop(target))
+   {
+      dst->ops = current_instruction_table.BNE_IDLE;
+      recomp_func = genpoll_loop;
+   }
 }
 
 static void RBLEZ(void)
@@ -1727,6 +2088,11 @@ static void RBLEZ(void)
       dst->ops = current_instruction_table.BLEZ_OUT;
       recomp_func = genblez_out;
    }
+   else if (is_poll_loop(target))
+   {
+      dst->ops = current_instruction_table.BLEZ_IDLE;
+      recomp_func = genpoll_loop;
+   }
 }
 
 static void RBGTZ(void)
@@ -1749,6 +2115,11 @@ static void RBGTZ(void)
       dst->ops = current_instruction_table.BGTZ_OUT;
       recomp_func = genbgtz_out;
    }
+   else if (is_poll_loop(target))
+   {
+      dst->ops = current_instruction_table.BGTZ_IDLE;
+      recomp_func = genpoll_loop;
+   }
 }
 
 static void RADDI(void)
@@ -1845,6 +2216,11 @@ static void RBEQL(void)
       dst->ops = current_instruction_table.BEQL_OUT;
       recomp_func = genbeql_out;
    }
+   else if (is_poll_loop(target))
+   {
+      dst->ops = current_instruction_table.BEQL_IDLE;
+      recomp_func = genpoll_loop;
+   }
 }
 
 static void RBNEL(void)
@@ -1867,6 +2243,11 @@ static void RBNEL(void)
       dst->ops = current_instruction_table.BNEL_OUT;
       recomp_func = genbnel_out;
    }
+   else if (is_poll_loop(target))
+   {
+      dst->ops = current_instruction_table.BNEL_IDLE;
+      recomp_func = genpoll_loop;
+   }
 }
 
 static void RBLEZL(void)
@@ -1889,6 +2270,11 @@ static void RBLEZL(void)
       dst->ops = current_instruction_table.BLEZL_OUT;
       recomp_func = genblezl_out;
    }
+   else if (is_poll_loop(target))
+   {
+      dst->ops = current_instruction_table.BLEZL_IDLE;
+      recomp_func = genpoll_loop;
+   }
 }
 
 static void RBGTZL(void)
@@ -1911,6 +2297,11 @@ static void RBGTZL(void)
       dst->ops = current_instruction_table.BGTZL_OUT;
       recomp_func = genbgtzl_out;
    }
+   else if (is_poll_loop(target))
+   {
+      dst->ops = current_instruction_table.BGTZL_IDLE;
+      recomp_func = genpoll_loop;
+   }
 }
 
 static void RDADDI(void)
@@ -2154,10 +2545,37 @@ static int get_block_length(const precomp_block *block)
   return (block->end-block->start)/4;
 }
 
-static size_t get_block_memsize(const precomp_block *block)
+/* compiled sequences run up to a quarter page past the end of the block */
+static int get_block_entries(const precomp_block *block)
 {
   int length = get_block_length(block);
-  return ((length+1)+(length>>2)) * sizeof(precomp_instr);
+  return (length+1)+(length>>2);
+}
+
+static size_t get_block_memsize(const precomp_block *block)
+{
+  return get_block_entries(block) * sizeof(precomp_instr);
+}
+
+static void add_run(precomp_block *block, int first, int last,
+                    unsigned int code_start, unsigned int code_end)
+{
+  precomp_run *run;
+
+  if (block->runs_number == block->max_runs_number)
+  {
+    int max_runs_number = block->max_runs_number ? block->max_runs_number * 2 : 16;
+    precomp_run *new_ptr = (precomp_run *) realloc(block->runs, max_runs_number * sizeof(precomp_run));
+    if (!new_ptr)
+      return;
+    block->runs = new_ptr;
+    block->max_runs_number = max_runs_number;
+  }
+  run = &block->runs[block->runs_number++];
+  run->first = (uint16_t) first;
+  run->last = (uint16_t) last;
+  run->code_start = code_start;
+  run->code_end = code_end;
 }
 
 /**********************************************************************
@@ -2166,17 +2584,22 @@ static size_t get_block_memsize(const precomp_block *block)
 void init_block(precomp_block *block)
 {
   int i, length, already_exist = 1;
-  static int init_length;
+  static int init_nesting = 0;
+  size_t memsize = get_block_memsize(block);
   timed_section_start(TIMED_SECTION_COMPILER);
 #ifdef CORE_DBG
   DebugMessage(M64MSG_INFO, "init block %" PRIX32 " - %" PRIX32, block->start, block->end);
 #endif
 
   length = get_block_length(block);
+
+  /* mirrors are initialized from inside this function, a flush there
+   * would throw away the code just emitted for the outer block */
+  if (r4300emu == CORE_DYNAREC && !init_nesting)
+    reserve_code_space(block);
    
   if (!block->block)
   {
-    size_t memsize = get_block_memsize(block);
     if (r4300emu == CORE_DYNAREC) {
         block->block = (precomp_instr *) malloc_exec(memsize);
         if (!block->block) {
@@ -2191,10 +2614,23 @@ void init_block(precomp_block *block)
             return;
         }
     }
+    block->source = (uint32_t *) malloc(get_block_entries(block) * sizeof(uint32_t));
+    block->max_runs_number = 0;
 
-    memset(block->block, 0, memsize);
     already_exist = 0;
   }
+  else if (block->runs_number)
+    smc_stats.reinits++;
+  block->runs_number = 0;
+  block->dead_code_length = 0;
+  block->code_mask = 0;
+
+  /* a flushed block gets its NOTCOMPILED stubs emitted again */
+  if (r4300emu == CORE_DYNAREC && !block->code)
+    already_exist = 0;
+
+  if (!already_exist)
+    memset(block->block, 0, memsize);
 
   if (r4300emu == CORE_DYNAREC)
   {
@@ -2206,7 +2642,7 @@ void init_block(precomp_block *block)
 #else
       max_code_length = 32768;
 #endif
-      block->code = (unsigned char *) malloc_exec(max_code_length);
+      block->code = alloc_code(max_code_length);
     }
     else
     {
@@ -2214,6 +2650,9 @@ void init_block(precomp_block *block)
     }
     code_length = 0;
     inst_pointer = &block->code;
+    unlink_code(block->code, NULL);
+    if (link_from < 0x100000 && blocks[link_from] == block)
+      link_from = ~0u;
     
     if (block->jumps_table)
     {
@@ -2257,6 +2696,7 @@ void init_block(precomp_block *block)
   pfProfile = NULL;
 #endif
   init_length = code_length;
+  code_arena_stats.emitted += code_length;
   }
   else
   {
@@ -2281,12 +2721,14 @@ void init_block(precomp_block *block)
        gennotcompiled() and gendebug() is position-independent and contains no jumps . */
     block->code_length = code_length;
     block->max_code_length = max_code_length;
+    trim_code(block);
     free_assembler(&block->jumps_table, &block->jumps_number, &block->riprel_table, &block->riprel_number);
   }
    
   /* here we're marking the block as a valid code even if it's not compiled
    * yet as the game should have already set up the code correctly.
    */
+  init_nesting++;
   invalid_code[block->start>>12] = 0;
   if (block->end < UINT32_C(0x80000000) || block->start >= UINT32_C(0xc0000000))
   { 
@@ -2299,6 +2741,8 @@ void init_block(precomp_block *block)
       blocks[paddr>>12]->block = NULL;
       blocks[paddr>>12]->jumps_table = NULL;
       blocks[paddr>>12]->riprel_table = NULL;
+      blocks[paddr>>12]->source = NULL;
+      blocks[paddr>>12]->runs = NULL;
       blocks[paddr>>12]->start = paddr & ~UINT32_C(0xFFF);
       blocks[paddr>>12]->end = (paddr & ~UINT32_C(0xFFF)) + UINT32_C(0x1000);
     }
@@ -2313,6 +2757,8 @@ void init_block(precomp_block *block)
       blocks[paddr>>12]->block = NULL;
       blocks[paddr>>12]->jumps_table = NULL;
       blocks[paddr>>12]->riprel_table = NULL;
+      blocks[paddr>>12]->source = NULL;
+      blocks[paddr>>12]->runs = NULL;
       blocks[paddr>>12]->start = paddr & ~UINT32_C(0xFFF);
       blocks[paddr>>12]->end = (paddr & ~UINT32_C(0xFFF)) + UINT32_C(0x1000);
     }
@@ -2331,12 +2777,15 @@ void init_block(precomp_block *block)
         blocks[alt_addr>>12]->block = NULL;
         blocks[alt_addr>>12]->jumps_table = NULL;
         blocks[alt_addr>>12]->riprel_table = NULL;
+        blocks[alt_addr>>12]->source = NULL;
+        blocks[alt_addr>>12]->runs = NULL;
         blocks[alt_addr>>12]->start = alt_addr & ~UINT32_C(0xFFF);
         blocks[alt_addr>>12]->end = (alt_addr & ~UINT32_C(0xFFF)) + UINT32_C(0x1000);
       }
       init_block(blocks[alt_addr>>12]);
     }
   }
+  init_nesting--;
   timed_section_end(TIMED_SECTION_COMPILER);
 }
 
@@ -2350,10 +2799,119 @@ void free_block(precomp_block *block)
         else
             free(block->block);
         block->block = NULL;
+        clear_return_stack();
+    }
+    if (block->code)
+    {
+        unlink_code(block->code, NULL);
+        release_code(block->code, block->max_code_length);
+        block->code = NULL;
     }
-    if (block->code) { free_exec(block->code, block->max_code_length); block->code = NULL; }
     if (block->jumps_table) { free(block->jumps_table); block->jumps_table = NULL; }
     if (block->riprel_table) { free(block->riprel_table); block->riprel_table = NULL; }
+    if (block->source) { free(block->source); block->source = NULL; }
+    if (block->runs) { free(block->runs); block->runs = NULL; }
+}
+
+/**********************************************************************
+ ********** bring an invalidated block up to date in place ************
+ **********************************************************************/
+/* Called instead of init_block() when a page was marked invalid. Every
+ * compiled sequence is checked against the words it was compiled from and
+ * only the ones that changed go back to NOTCOMPILED, together with all
+ * other sequences sharing their instructions, since a sequence falls
+ * through its own copy of them. Their code stays in the buffer, unreached,
+ * until DEAD_CODE_LIMIT. Returns 0 when the whole page has to be
+ * initialized again. */
+int revalidate_block(precomp_block *block)
+{
+  const uint32_t *mem;
+  int i, j, n, entries, length, changed = 0;
+
+  if (!block->block || !block->source || !block->runs_number)
+    return 0;
+  if (r4300emu == CORE_DYNAREC && !block->code)
+    return 0;
+  /* TLB mapped code goes through the physical page and its mirrors */
+  if (block->start < UINT32_C(0x80000000) || block->start >= UINT32_C(0xc0000000))
+    return 0;
+  mem = fast_mem_access(block->start);
+  if (mem == NULL)
+    return 0;
+
+  length = get_block_length(block);
+  entries = get_block_entries(block);
+  for (i = 0; i < length; i++)
+    if (block->block[i].ops == current_instruction_table.NOTCOMPILED2)
+      return 0;
+
+  if (r4300emu == CORE_DYNAREC)
+    init_assembler(block->jumps_table, block->jumps_number, block->riprel_table, block->riprel_number);
+
+  /* reset changed sequences, drop the jumps in their code and mark their
+   * record for removal */
+  for (i = 0; i < block->runs_number; i++)
+  {
+    precomp_run *run = &block->runs[i];
+    int first = run->first;
+    int last = run->last;
+    if (memcmp(mem + first, block->source + first, (last + 1 - first) * sizeof(uint32_t)) != 0)
+    {
+      for (j = first; j <= last + 1 && j < entries; j++)
+      {
+        precomp_instr *instr = block->block + j;
+        instr->ops = current_instruction_table.NOTCOMPILED;
+        instr->reg_cache_infos.need_map = 0;
+        if (j < length)
+          instr->local_addr = j * (init_length / length);
+      }
+      if (r4300emu == CORE_DYNAREC)
+      {
+        remove_jumps(run->code_start, run->code_end);
+        block->dead_code_length += run->code_end - run->code_start;
+      }
+      run->first = 0xFFFF;
+      changed++;
+    }
+  }
+
+  if (r4300emu == CORE_DYNAREC && block->dead_code_length > DEAD_CODE_LIMIT &&
+      block->dead_code_length * 2 > block->code_length - init_length)
+  {
+    free_assembler(&block->jumps_table, &block->jumps_number, &block->riprel_table, &block->riprel_number);
+    return 0;
+  }
+
+  if (changed)
+  {
+    /* other sequences over the reset instructions keep their record, their
+     * code is still reached through the instructions they own alone */
+    for (i = 0, n = 0; i < block->runs_number; i++)
+      if (block->runs[i].first != 0xFFFF)
+        block->runs[n++] = block->runs[i];
+    block->runs_number = n;
+
+    block->code_mask = 0;
+    for (i = 0; i < length; i++)
+      if (block->block[i].ops != current_instruction_table.NOTCOMPILED)
+        block->code_mask |= UINT64_C(1) << (i >> 4);
+
+    /* point the jumps into the reset instructions back at their stubs */
+    if (r4300emu == CORE_DYNAREC)
+    {
+      unlink_code(block->code, NULL);
+      passe2(block->block, 0, 0, block);
+    }
+    smc_stats.partial++;
+  }
+  else
+    smc_stats.unchanged++;
+
+  if (r4300emu == CORE_DYNAREC)
+    free_assembler(&block->jumps_table, &block->jumps_number, &block->riprel_table, &block->riprel_number);
+
+  invalid_code[block->start>>12] = 0;
+  return 1;
 }
 
 /**********************************************************************
@@ -2361,7 +2919,8 @@ void free_block(precomp_block *block)
  **********************************************************************/
 void recompile_block(const uint32_t *source, precomp_block *block, uint32_t func)
 {
-   uint32_t i;
+   uint32_t i, last;
+   unsigned int code_start = 0;
    int length, finished=0;
    timed_section_start(TIMED_SECTION_COMPILER);
    length = (block->end-block->start)/4;
@@ -2372,7 +2931,11 @@ void recompile_block(const uint32_t *source, precomp_block *block, uint32_t func
    
    if (r4300emu == CORE_DYNAREC)
      {
+    reserve_code_space(block);
+    if (!block->code)
+       init_block(block);
     code_length = block->code_length;
+    code_start = code_length;
     max_code_length = block->max_code_length;
     inst_pointer = &block->code;
     init_assembler(block->jumps_table, block->jumps_number, block->riprel_table, block->riprel_number);
@@ -2390,7 +2953,10 @@ void recompile_block(const uint32_t *source, precomp_block *block, uint32_t func
           uint32_t address2 =
            virtual_to_physical_address(block->start + i*4, 0);
          if(blocks[address2>>12]->block[(address2&UINT32_C(0xFFF))/4].ops == current_instruction_table.NOTCOMPILED)
+         {
            blocks[address2>>12]->block[(address2&UINT32_C(0xFFF))/4].ops = current_instruction_table.NOTCOMPILED2;
+           blocks[address2>>12]->code_mask |= UINT64_C(1) << ((address2&UINT32_C(0xFFF)) >> 6);
+         }
       }
     
     SRC = source + i;
@@ -2440,6 +3006,17 @@ void recompile_block(const uint32_t *source, precomp_block *block, uint32_t func
       finished = 1;
      }
 
+   /* the sequence depends on the words it read, including the one after
+    * the last instruction (check_nop) */
+   last = i;
+   if (block->source)
+      memcpy(block->source + (func & 0xFFF) / 4, source + (func & 0xFFF) / 4,
+             (last + 1 - (func & 0xFFF) / 4) * sizeof(uint32_t));
+   for (i = (func & 0xFFF) / 4; i < last && i < (uint32_t) length; i++)
+      block->code_mask |= UINT64_C(1) << (i >> 4);
+   i = last;
+   smc_stats.recompiles++;
+
 #if defined(PROFILE_R4300)
     long x86addr = (long) (block->code + code_length);
     int mipsop = -3; /* -3 == block-postfix */
@@ -2480,10 +3057,14 @@ void recompile_block(const uint32_t *source, precomp_block *block, uint32_t func
      {
     free_all_registers();
     passe2(block->block, (func&0xFFF)/4, i, block);
+    code_arena_stats.emitted += code_length - block->code_length;
     block->code_length = code_length;
     block->max_code_length = max_code_length;
+    trim_code(block);
     free_assembler(&block->jumps_table, &block->jumps_number, &block->riprel_table, &block->riprel_number);
      }
+   add_run(block, (func & 0xFFF) / 4, last, code_start,
+           r4300emu == CORE_DYNAREC ? block->code_length : 0);
 #ifdef CORE_DBG
    DebugMessage(M64MSG_INFO, "block recompiled (%" PRIX32 "-%" PRIX32 ")", func, block->start+i*4);
 #endif
@@ -2628,17 +3209,35 @@ static void *malloc_exec(size_t size)
  **********************************************************************/
 void *realloc_exec(void *ptr, size_t oldsize, size_t newsize)
 {
-   void* block = malloc_exec(newsize);
+   unsigned char *block;
+   size_t copysize;
+
+   if (in_code_arena(ptr))
+   {
+      size_t old_aligned = CODE_ALIGN(oldsize);
+      size_t new_aligned = CODE_ALIGN(newsize);
+
+      /* the last buffer handed out just grows */
+      if ((unsigned char *) ptr + old_aligned == code_arena + code_arena_top &&
+          CODE_ARENA_SIZE - code_arena_top >= new_aligned - old_aligned)
+      {
+         code_arena_top += new_aligned - old_aligned;
+         code_arena_live += new_aligned - old_aligned;
+         if (code_arena_top > code_arena_stats.peak)
+            code_arena_stats.peak = code_arena_top;
+         return ptr;
+      }
+      code_arena_stats.moves++;
+   }
+
+   block = alloc_code(newsize);
    if (block != NULL)
    {
-      size_t copysize;
-      if (oldsize < newsize)
-         copysize = oldsize;
-      else
-         copysize = newsize;
+      copysize = (oldsize < newsize) ? oldsize : newsize;
       memcpy(block, ptr, copysize);
+      unlink_code((unsigned char *) ptr, block);
    }
-   free_exec(ptr, oldsize);
+   release_code((unsigned char *) ptr, oldsize);
    return block;
 }
 
@@ -2655,3 +3254,256 @@ static void free_exec(void *ptr, size_t length)
    free(ptr);
 #endif
 }
+
+/**********************************************************************
+ ********************* code arena for the dynarec *********************
+ **********************************************************************/
+static int in_code_arena(const void *ptr)
+{
+   return code_arena != NULL &&
+          (const unsigned char *) ptr >= code_arena &&
+          (const unsigned char *) ptr < code_arena + CODE_ARENA_SIZE;
+}
+
+static unsigned char *alloc_code(size_t size)
+{
+   size = CODE_ALIGN(size);
+
+   if (code_arena == NULL && !code_arena_failed)
+   {
+      code_arena = (unsigned char *) malloc_exec(CODE_ARENA_SIZE);
+      code_arena_failed = (code_arena == NULL);
+      code_arena_top = 0;
+      code_arena_live = 0;
+   }
+
+   if (code_arena != NULL && CODE_ARENA_SIZE - code_arena_top >= size)
+   {
+      unsigned char *ptr = code_arena + code_arena_top;
+      code_arena_top += size;
+      code_arena_live += size;
+      if (code_arena_top > code_arena_stats.peak)
+         code_arena_stats.peak = code_arena_top;
+      return ptr;
+   }
+
+   /* only reached when the headroom was not enough for one block */
+   code_arena_stats.overflows++;
+   return (unsigned char *) malloc_exec(size);
+}
+
+static void release_code(unsigned char *ptr, size_t size)
+{
+   if (!in_code_arena(ptr))
+   {
+      free_exec(ptr, CODE_ALIGN(size));
+      return;
+   }
+
+   size = CODE_ALIGN(size);
+   code_arena_live -= size;
+   if (ptr + size == code_arena + code_arena_top)
+      code_arena_top -= size;
+   if (code_arena_live == 0)
+      code_arena_top = 0;
+   if (code_arena_top - code_arena_live > code_arena_stats.peak_garbage)
+      code_arena_stats.peak_garbage = code_arena_top - code_arena_live;
+}
+
+/* hand back the unused tail of a block that sits at the top */
+static void trim_code(precomp_block *block)
+{
+#if !defined(PROFILE_R4300) /* code must not move while profiling */
+   size_t used = CODE_ALIGN((size_t) block->code_length + 1);
+   size_t size = CODE_ALIGN((size_t) block->max_code_length);
+
+   if (in_code_arena(block->code) && used < size &&
+       block->code + size == code_arena + code_arena_top)
+   {
+      code_arena_top -= size - used;
+      code_arena_live -= size - used;
+      block->max_code_length = (unsigned int) used;
+   }
+#endif
+}
+
+static void flush_code_arena(void)
+{
+   int i;
+
+   for (i = 0; i < 0x100000; i++)
+   {
+      precomp_block *block = blocks[i];
+      if (block == NULL || block->code == NULL)
+         continue;
+      release_code(block->code, block->max_code_length);
+      block->code = NULL;
+      block->code_length = 0;
+      block->max_code_length = 0;
+      if (block->jumps_table) { free(block->jumps_table); block->jumps_table = NULL; }
+      if (block->riprel_table) { free(block->riprel_table); block->riprel_table = NULL; }
+   }
+   /* everything is recompiled through jump_to() from now on */
+   memset(invalid_code, 1, 0x100000);
+   block_links_number = 0;
+   link_from = ~0u;
+   code_arena_stats.flushes++;
+   DebugMessage(M64MSG_VERBOSE, "Dynarec code cache full, flushed (%u flushes)", code_arena_stats.flushes);
+}
+
+/* Only called where no translated code is still running after the C
+ * function returns: dyna_jump() replaces the return address. Moving the
+ * block to the top can take its whole current size. */
+static void reserve_code_space(const precomp_block *block)
+{
+   size_t needed = CODE_ARENA_HEADROOM;
+
+   if (code_arena == NULL)
+      return;
+   if (block->code != NULL)
+      needed += CODE_ALIGN((size_t) block->max_code_length);
+   if (CODE_ARENA_SIZE - code_arena_top < needed)
+      flush_code_arena();
+}
+
+void free_code_arena(void)
+{
+   if (code_arena != NULL)
+   {
+      DebugMessage(M64MSG_INFO, "Dynarec code cache: %" PRIu64 " KB emitted, %u KB peak, %u KB peak garbage, %u moves, %u flushes, %u overflows",
+                   code_arena_stats.emitted / 1024, (unsigned int) (code_arena_stats.peak / 1024),
+                   (unsigned int) (code_arena_stats.peak_garbage / 1024), code_arena_stats.moves,
+                   code_arena_stats.flushes, code_arena_stats.overflows);
+      free_exec(code_arena, CODE_ARENA_SIZE);
+   }
+   free(block_links);
+   block_links = NULL;
+   block_links_number = 0;
+   max_block_links_number = 0;
+   code_arena = NULL;
+   code_arena_failed = 0;
+   code_arena_top = 0;
+   code_arena_live = 0;
+   memset(&code_arena_stats, 0, sizeof(code_arena_stats));
+}
+
+/**********************************************************************
+ ********************** links between blocks **************************
+ **********************************************************************/
+/* Called by jump_to_func() once the target is compiled, with PC and
+ * actual pointing at it. Links the exit that got there, if any, when the
+ * target instruction can be entered without mapped registers. */
+void link_exit(unsigned int site)
+{
+   precomp_block *from;
+   unsigned char *target;
+   int64_t disp;
+
+   link_stats.dispatches++;
+   if (!site || link_from >= 0x100000 || stop)
+      return;
+   from = blocks[link_from];
+   if (from == NULL || from == actual || from->code == NULL || actual->code == NULL)
+      return;
+   if (site + 4 > from->code_length || from->code[site - 1] != 0xE9)
+      return;
+   /* still linked, the jump came through a failed check */
+   if (*((int32_t *) (from->code + site)) != 0)
+      return;
+   if (PC->ops == current_instruction_table.NOTCOMPILED ||
+       PC->ops == current_instruction_table.NOTCOMPILED2 ||
+       PC->reg_cache_infos.need_map)
+      return;
+
+   target = actual->code + PC->local_addr;
+   disp = target - (from->code + site + 4);
+   if (disp != (int32_t) disp)
+      return;
+
+   if (block_links_number == max_block_links_number)
+   {
+      int max = max_block_links_number ? max_block_links_number * 2 : 1024;
+      block_link *links = (block_link *) realloc(block_links, max * sizeof(block_link));
+      if (links == NULL)
+         return;
+      block_links = links;
+      max_block_links_number = max;
+   }
+   block_links[block_links_number].from = from;
+   block_links[block_links_number].to = actual;
+   block_links[block_links_number].site = site;
+   block_links_number++;
+   *((int32_t *) (from->code + site)) = (int32_t) disp;
+   link_stats.links++;
+}
+
+/* Points every exit linked from or into code back at its jump_to_func()
+ * call. When code moved, its own exits are found at the new address. */
+static void unlink_code(const unsigned char *code, unsigned char *moved)
+{
+   int i = 0;
+
+   if (code == NULL)
+      return;
+   while (i < block_links_number)
+   {
+      block_link *link = block_links + i;
+      unsigned char *base = link->from->code;
+
+      if (link->from->code != code && link->to->code != code)
+      {
+         i++;
+         continue;
+      }
+      if (link->from->code == code && moved != NULL)
+         base = moved;
+      *((int32_t *) (base + link->site)) = 0;
+      *link = block_links[--block_links_number];
+      link_stats.unlinks++;
+   }
+}
+
+static void clear_return_stack(void)
+{
+   int i;
+   for (i = 0; i < RETURN_STACK_SIZE; i++)
+      return_stack[i] = &no_return;
+}
+
+void dynarec_stats_vi(void)
+{
+   unsigned int vis = ++smc_stats.vis;
+
+   idle_stats.window_skipped += idle_skipped;
+   idle_stats.window_cycles += g_vi.delay;
+   idle_skipped = 0;
+
+   if (vis < (unsigned int) ROM_PARAMS.vilimit)
+      return;
+   if (idle_stats.window_skipped)
+      DebugMessage(M64MSG_VERBOSE, "Idle loops: %.1f%% of cycles skipped",
+                   idle_stats.window_skipped * 100.0 / idle_stats.window_cycles);
+   idle_stats.skipped += idle_stats.window_skipped;
+   idle_stats.cycles += idle_stats.window_cycles;
+   idle_stats.window_skipped = idle_stats.window_cycles = 0;
+   if (smc_stats.reinits || smc_stats.partial || smc_stats.unchanged)
+      DebugMessage(M64MSG_VERBOSE, "Code invalidations/s: %u pages reset, %u partially reset, %u unchanged; %u sequences compiled",
+                   smc_stats.reinits, smc_stats.partial, smc_stats.unchanged, smc_stats.recompiles);
+   if (r4300emu == CORE_DYNAREC)
+      DebugMessage(M64MSG_VERBOSE, "Dynarec dispatch: %u slow-path jumps/frame, %u exits linked, %u unlinked, %d live links",
+                   link_stats.dispatches / vis, link_stats.links, link_stats.unlinks, block_links_number);
+   memset(&smc_stats, 0, sizeof(smc_stats));
+   memset(&link_stats, 0, sizeof(link_stats));
+}
+
+void idle_stats_print(void)
+{
+   idle_stats.skipped += idle_stats.window_skipped + idle_skipped;
+   idle_stats.cycles += idle_stats.window_cycles;
+   if (idle_stats.cycles)
+      DebugMessage(M64MSG_INFO, "Idle loops in %s: %" PRIu64 " of %" PRIu64 " cycles skipped (%.1f%%), %u poll loops compiled",
+                   ROM_PARAMS.headername, idle_stats.skipped, idle_stats.cycles,
+                   idle_stats.skipped * 100.0 / idle_stats.cycles, idle_stats.poll_loops);
+   memset(&idle_stats, 0, sizeof(idle_stats));
+   idle_skipped = 0;
+}
@@ -72,6 +72,16 @@ typedef struct _precomp_instr
    reg_cache_struct reg_cache_infos;
 } precomp_instr;
 
+/* one compiled sequence: the instructions it read and, with the dynarec,
+ * the code it emitted */
+typedef struct _precomp_run
+{
+   uint16_t first;
+   uint16_t last;
+   unsigned int code_start;
+   unsigned int code_end;
+} precomp_run;
+
 typedef struct _precomp_block
 {
    precomp_instr *block;
@@ -84,23 +94,48 @@ typedef struct _precomp_block
    int jumps_number;
    void *riprel_table;
    int riprel_number;
+   uint32_t *source;       /* instruction words as they were compiled */
+   precomp_run *runs;
+   int runs_number;
+   int max_runs_number;
+   unsigned int dead_code_length; /* code of reset sequences, not reached */
+   uint64_t code_mask;     /* 64-byte chunks that hold compiled instructions */
    //unsigned char md5[16];
    unsigned int adler32;
 } precomp_block;
 
 void recompile_block(const uint32_t *source, precomp_block *block, uint32_t func);
 void init_block(precomp_block *block);
+int revalidate_block(precomp_block *block);
 void free_block(precomp_block *block);
 void recompile_opcode(void);
 void dyna_jump(void);
 void dyna_start(void *code);
 void dyna_stop(void);
 void *realloc_exec(void *ptr, size_t oldsize, size_t newsize);
+void free_code_arena(void);
+void link_exit(unsigned int site);
+int poll_loop_is_idle(uint32_t branch, uint32_t target);
+void dynarec_stats_vi(void);
+void idle_stats_print(void);
 
 extern precomp_instr *dst; /* precomp_instr structure for instruction being recompiled */
 
+/* out-of-page exit that called jump_to_func(): page of its block and
+ * offset of its jmp displacement in the block's code, 0 for none */
+extern unsigned int link_from;
+extern unsigned int link_site;
+
+/* return points of the last JAL/JALR instructions, popped by JR $ra */
+#define RETURN_STACK_SIZE 8
+extern precomp_instr *return_stack[RETURN_STACK_SIZE];
+extern unsigned int return_stack_top;
+
 extern int no_compiled_jump;
 
+/* count cycles skipped by idle loops since the last VI */
+extern uint32_t idle_skipped;
+
 #ifdef DYNAREC
 #include "hacktarux_dynarec/assemble.h"
 #endif
@@ -40,8 +40,12 @@ extern uint32_t src;   /* opcode of r4300 instruction being recompiled */
 void passe2(precomp_instr *dest, int start, int end, precomp_block* block);
 void init_assembler(void *block_jumps_table, int block_jumps_number, void *block_riprel_table, int block_riprel_number);
 void free_assembler(void **block_jumps_table, int *block_jumps_number, void **block_riprel_table, int *block_riprel_number);
+void remove_jumps(unsigned int start, unsigned int end);
 
 void gencallinterp(uintptr_t addr, int jump);
+void genlink_out(unsigned int naddr);
+void genpush_return(void);
+void genpredict_return(void);
 
 void genupdate_system(int type);
 void genbnel(void);
@@ -145,6 +149,7 @@ void genc_le_d(void);
 void genbgezal_idle(void);
 void genj_idle(void);
 void genbeq_idle(void);
+void genpoll_loop(void);
 void genlh(void);
 void genmov_d(void);
 void genc_lt_d(void);
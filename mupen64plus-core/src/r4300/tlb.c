@@ -21,53 +21,190 @@
 
 #include "tlb.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "api/m64p_types.h"
 #include "exception.h"
 #include "main/rom.h"
 
 tlb tlb_e[32];
 
-unsigned int tlb_LUT_r[0x100000];
-unsigned int tlb_LUT_w[0x100000];
+#ifdef NEW_DYNAREC
+uint32_t tlb_LUT_r[0x100000];
+uint32_t tlb_LUT_w[0x100000];
 
-void tlb_unmap(tlb *entry)
+/* sets the pages in [start, end) to value, value + 0x1000, ...; 0 unmaps */
+static void lut_fill(uint32_t *lut, uint32_t start, uint32_t end, uint32_t value)
+{
+    uint32_t i;
+
+    for (i = start; i < end; i += 0x1000)
+    {
+        lut[i>>12] = value;
+        if (value)
+            value += 0x1000;
+    }
+}
+
+void tlb_lut_clear(void)
+{
+    memset(tlb_LUT_r, 0, sizeof(tlb_LUT_r));
+    memset(tlb_LUT_w, 0, sizeof(tlb_LUT_w));
+}
+
+void tlb_lut_save(unsigned char *lut_r, unsigned char *lut_w)
+{
+    memcpy(lut_r, tlb_LUT_r, sizeof(tlb_LUT_r));
+    memcpy(lut_w, tlb_LUT_w, sizeof(tlb_LUT_w));
+}
+
+void tlb_lut_load(const unsigned char *lut_r, const unsigned char *lut_w)
+{
+    memcpy(tlb_LUT_r, lut_r, sizeof(tlb_LUT_r));
+    memcpy(tlb_LUT_w, lut_w, sizeof(tlb_LUT_w));
+}
+
+#define LUT_R tlb_LUT_r
+#define LUT_W tlb_LUT_w
+#else
+uint32_t *tlb_dir_r[TLB_LUT_DIR_SIZE];
+uint32_t *tlb_dir_w[TLB_LUT_DIR_SIZE];
+
+#define LEAF_BYTES (TLB_LUT_LEAF_SIZE * sizeof(uint32_t))
+
+/* sets the pages in [start, end) to value, value + 0x1000, ...; 0 unmaps.
+ * Works a leaf at a time, so unmapping skips absent leaves whole. */
+static void lut_fill(uint32_t **dir, uint32_t start, uint32_t end, uint32_t value)
+{
+    uint32_t page = start >> 12;
+    uint32_t pages = (start < end) ? ((end - start + 0xFFF) >> 12) : 0;
+
+    while (pages)
+    {
+        uint32_t first = page & (TLB_LUT_LEAF_SIZE - 1);
+        uint32_t count = TLB_LUT_LEAF_SIZE - first;
+        uint32_t *leaf = dir[page >> TLB_LUT_LEAF_BITS];
+        uint32_t i;
+
+        if (count > pages)
+            count = pages;
+
+        if (leaf == NULL && value != 0)
+        {
+            leaf = (uint32_t *) calloc(TLB_LUT_LEAF_SIZE, sizeof(uint32_t));
+            if (leaf == NULL)
+                return;
+            dir[page >> TLB_LUT_LEAF_BITS] = leaf;
+        }
+
+        if (leaf)
+        {
+            if (value == 0)
+                memset(&leaf[first], 0, count * sizeof(uint32_t));
+            else
+                for (i = 0; i < count; i++)
+                    leaf[first + i] = value + (i << 12);
+        }
+
+        if (value)
+            value += count << 12;
+        page  += count;
+        pages -= count;
+    }
+}
+
+static void dir_free(uint32_t **dir)
 {
     unsigned int i;
 
+    for (i = 0; i < TLB_LUT_DIR_SIZE; i++)
+    {
+        free(dir[i]);
+        dir[i] = NULL;
+    }
+}
+
+static void dir_save(uint32_t **dir, unsigned char *lut)
+{
+    unsigned int i;
+
+    for (i = 0; i < TLB_LUT_DIR_SIZE; i++, lut += LEAF_BYTES)
+    {
+        if (dir[i])
+            memcpy(lut, dir[i], LEAF_BYTES);
+        else
+            memset(lut, 0, LEAF_BYTES);
+    }
+}
+
+static void dir_load(uint32_t **dir, const unsigned char *lut)
+{
+    static const unsigned char zero[LEAF_BYTES];
+    unsigned int i;
+
+    for (i = 0; i < TLB_LUT_DIR_SIZE; i++, lut += LEAF_BYTES)
+    {
+        if (memcmp(lut, zero, LEAF_BYTES) == 0)
+            continue;
+        dir[i] = (uint32_t *) malloc(LEAF_BYTES);
+        if (dir[i])
+            memcpy(dir[i], lut, LEAF_BYTES);
+    }
+}
+
+void tlb_lut_clear(void)
+{
+    dir_free(tlb_dir_r);
+    dir_free(tlb_dir_w);
+}
+
+void tlb_lut_save(unsigned char *lut_r, unsigned char *lut_w)
+{
+    dir_save(tlb_dir_r, lut_r);
+    dir_save(tlb_dir_w, lut_w);
+}
+
+void tlb_lut_load(const unsigned char *lut_r, const unsigned char *lut_w)
+{
+    tlb_lut_clear();
+    dir_load(tlb_dir_r, lut_r);
+    dir_load(tlb_dir_w, lut_w);
+}
+
+#define LUT_R tlb_dir_r
+#define LUT_W tlb_dir_w
+#endif
+
+void tlb_unmap(tlb *entry)
+{
     if (entry->v_even)
     {
-        for (i=entry->start_even; i<entry->end_even; i += 0x1000)
-            tlb_LUT_r[i>>12] = 0;
+        lut_fill(LUT_R, entry->start_even, entry->end_even, 0);
         if (entry->d_even)
-            for (i=entry->start_even; i<entry->end_even; i += 0x1000)
-                tlb_LUT_w[i>>12] = 0;
+            lut_fill(LUT_W, entry->start_even, entry->end_even, 0);
     }
 
     if (entry->v_odd)
     {
-        for (i=entry->start_odd; i<entry->end_odd; i += 0x1000)
-            tlb_LUT_r[i>>12] = 0;
+        lut_fill(LUT_R, entry->start_odd, entry->end_odd, 0);
         if (entry->d_odd)
-            for (i=entry->start_odd; i<entry->end_odd; i += 0x1000)
-                tlb_LUT_w[i>>12] = 0;
+            lut_fill(LUT_W, entry->start_odd, entry->end_odd, 0);
     }
 }
 
 void tlb_map(tlb *entry)
 {
-    unsigned int i;
-
     if (entry->v_even)
     {
         if (entry->start_even < entry->end_even &&
             !(entry->start_even >= 0x80000000 && entry->end_even < 0xC0000000) &&
             entry->phys_even < 0x20000000)
         {
-            for (i=entry->start_even;i<entry->end_even;i+=0x1000)
-                tlb_LUT_r[i>>12] = UINT32_C(0x80000000) | (entry->phys_even + (i - entry->start_even) + 0xFFF);
+            uint32_t value = UINT32_C(0x80000000) | (entry->phys_even + 0xFFF);
+            lut_fill(LUT_R, entry->start_even, entry->end_even, value);
             if (entry->d_even)
-                for (i=entry->start_even;i<entry->end_even;i+=0x1000)
-                    tlb_LUT_w[i>>12] = UINT32_C(0x80000000) | (entry->phys_even + (i - entry->start_even) + 0xFFF);
+                lut_fill(LUT_W, entry->start_even, entry->end_even, value);
         }
     }
 
@@ -77,11 +214,10 @@ void tlb_map(tlb *entry)
             !(entry->start_odd >= 0x80000000 && entry->end_odd < 0xC0000000) &&
             entry->phys_odd < 0x20000000)
         {
-            for (i=entry->start_odd;i<entry->end_odd;i+=0x1000)
-                tlb_LUT_r[i>>12] = UINT32_C(0x80000000) | (entry->phys_odd + (i - entry->start_odd) + 0xFFF);
+            uint32_t value = UINT32_C(0x80000000) | (entry->phys_odd + 0xFFF);
+            lut_fill(LUT_R, entry->start_odd, entry->end_odd, value);
             if (entry->d_odd)
-                for (i=entry->start_odd;i<entry->end_odd;i+=0x1000)
-                    tlb_LUT_w[i>>12] = UINT32_C(0x80000000) | (entry->phys_odd + (i - entry->start_odd) + 0xFFF);
+                lut_fill(LUT_W, entry->start_odd, entry->end_odd, value);
         }
     }
 }
@@ -116,13 +252,15 @@ uint32_t virtual_to_physical_address(uint32_t addresse, int w)
     }
     if (w == 1)
     {
-        if (tlb_LUT_w[addresse>>12])
-            return (tlb_LUT_w[addresse>>12] & UINT32_C(0xFFFFF000)) | (addresse & UINT32_C(0xFFF));
+        uint32_t entry = tlb_lut_w(addresse>>12);
+        if (entry)
+            return (entry & UINT32_C(0xFFFFF000)) | (addresse & UINT32_C(0xFFF));
     }
     else
     {
-        if (tlb_LUT_r[addresse>>12])
-            return (tlb_LUT_r[addresse>>12] & UINT32_C(0xFFFFF000)) | (addresse & UINT32_C(0xFFF));
+        uint32_t entry = tlb_lut_r(addresse>>12);
+        if (entry)
+            return (entry & UINT32_C(0xFFFFF000)) | (addresse & UINT32_C(0xFFF));
     }
     //printf("tlb exception !!! @ %x, %x, add:%x\n", addresse, w, PC->addr);
     //getchar();
@@ -24,6 +24,8 @@
 
 #include <stdint.h>
 
+#include <retro_inline.h>
+
 typedef struct _tlb
 {
    short mask;
@@ -50,9 +52,45 @@ typedef struct _tlb
 } tlb;
 
 extern tlb tlb_e[32];
+
+/* Translation of each 4 KB virtual page: 0 when unmapped, otherwise
+ * 0x80000000 | (physical address of the page + 0xFFF). */
+#ifdef NEW_DYNAREC
+/* the new_dynarec linkage code indexes the flat tables */
 extern uint32_t tlb_LUT_r[0x100000];
 extern uint32_t tlb_LUT_w[0x100000];
 
+static INLINE uint32_t tlb_lut_r(uint32_t page) { return tlb_LUT_r[page]; }
+static INLINE uint32_t tlb_lut_w(uint32_t page) { return tlb_LUT_w[page]; }
+#else
+/* Two levels of 1024 entries. A leaf covers 4 MB of the address space
+ * and is only allocated once a page in it gets mapped, so the tables stay
+ * at a few KB instead of 8 MB. */
+#define TLB_LUT_LEAF_BITS 10
+#define TLB_LUT_LEAF_SIZE (1 << TLB_LUT_LEAF_BITS)
+#define TLB_LUT_DIR_SIZE (0x100000 >> TLB_LUT_LEAF_BITS)
+
+extern uint32_t *tlb_dir_r[TLB_LUT_DIR_SIZE];
+extern uint32_t *tlb_dir_w[TLB_LUT_DIR_SIZE];
+
+static INLINE uint32_t tlb_lut_r(uint32_t page)
+{
+   const uint32_t *leaf = tlb_dir_r[page >> TLB_LUT_LEAF_BITS];
+   return leaf ? leaf[page & (TLB_LUT_LEAF_SIZE - 1)] : 0;
+}
+
+static INLINE uint32_t tlb_lut_w(uint32_t page)
+{
+   const uint32_t *leaf = tlb_dir_w[page >> TLB_LUT_LEAF_BITS];
+   return leaf ? leaf[page & (TLB_LUT_LEAF_SIZE - 1)] : 0;
+}
+#endif
+
+void tlb_lut_clear(void);
+/* flat 0x100000 entry copies in host byte order, as kept in savestates */
+void tlb_lut_save(unsigned char *lut_r, unsigned char *lut_w);
+void tlb_lut_load(const unsigned char *lut_r, const unsigned char *lut_w);
+
 void tlb_unmap(tlb *entry);
 void tlb_map(tlb *entry);
 uint32_t virtual_to_physical_address(uint32_t addresse, int w);
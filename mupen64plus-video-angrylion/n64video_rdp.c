@@ -42,6 +42,10 @@ struct stepwalker_info
 static int cmd_cur;
 static int cmd_ptr; /* for 64-bit elements, always <= +0x7FFF */
 
+#ifdef TRACE_DP_PIXELS
+UINT64 rdp_pixel_count;
+#endif
+
 /* static DP_FIFO cmd_fifo; */
 static DP_FIFO cmd_data[0x0003FFFF/sizeof(i64) + 1];
 
@@ -1884,6 +1888,20 @@ NOINLINE static void render_spans(
 #ifdef _DEBUG
     ++render_cycle_mode_counts[cycle_type];
 #endif
+#ifdef TRACE_DP_PIXELS
+    {
+        register int i;
+
+        for (i = yhlimit; i <= yllimit; i++)
+        {
+            const int length = flip
+              ? span[i].lx - span[i].rx : span[i].rx - span[i].lx;
+
+            if (span[i].validline && length >= 0)
+                rdp_pixel_count += length + 1;
+        }
+    }
+#endif
 
     if (cycle_type & 02)
         if (cycle_type & 01)
@@ -321,6 +321,9 @@ enum {
 };
 
 extern void process_RDP_list(void);
+#ifdef TRACE_DP_PIXELS
+extern UINT64 rdp_pixel_count; /* pixels covered by the spans handed to render_spans */
+#endif
 
 extern void (*fbread1_ptr)(UINT32, UINT32*);
 extern void (*fbread2_ptr)(UINT32, UINT32*);
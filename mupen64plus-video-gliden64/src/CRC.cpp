@@ -1,4 +1,7 @@
 #include <stdint.h>
+#include <string.h>
+
+#include "../../libretro/crc32_accel.h"
 
 #define CRC32_POLYNOMIAL     0x04C11DB7
 
@@ -29,18 +32,14 @@ void CRC_BuildTable()
 
 		CRCTable[i] = Reflect( crc, 32 );
 	}
+
+	crc32_accel_features();
 }
 
 uint32_t CRC_Calculate( uint32_t crc, const void * buffer, uint32_t count )
 {
-	uint8_t *p;
-	uint32_t orig = crc;
-
-	p = (uint8_t*) buffer;
-	while (count--)
-		crc = (crc >> 8) ^ CRCTable[(crc & 0xFF) ^ *p++];
-
-	return crc ^ orig;
+	// Same register update as the CRCTable loop; the ucode tables depend on it.
+	return crc32_accel_ieee(crc, buffer, count) ^ crc;
 }
 
 uint32_t CRC_CalculatePalette(uint32_t crc, const void * buffer, uint32_t count )
@@ -80,3 +79,89 @@ uint32_t textureCRC(uint8_t * addr, uint32_t height, uint32_t stride)
 
 	return crc&0xFFFFFFFF;
 }
+
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const uint8_t * p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t hashRound(uint64_t acc, uint64_t input)
+{
+	acc += input * PRIME64_2;
+	acc = rotl64(acc, 31);
+	return acc * PRIME64_1;
+}
+
+static inline uint64_t hashMerge(uint64_t acc, uint64_t val)
+{
+	acc ^= hashRound(0, val);
+	return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t TextureHash64(uint64_t seed, const void * buffer, uint32_t count)
+{
+	const uint8_t * p = (const uint8_t*)buffer;
+	const uint8_t * const end = p + count;
+	uint64_t h;
+
+	if (count >= 32) {
+		// Four independent lanes keep the multipliers busy.
+		uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+		uint64_t v2 = seed + PRIME64_2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - PRIME64_1;
+		const uint8_t * const limit = end - 32;
+		do {
+			v1 = hashRound(v1, read64(p));
+			v2 = hashRound(v2, read64(p + 8));
+			v3 = hashRound(v3, read64(p + 16));
+			v4 = hashRound(v4, read64(p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+		h = hashMerge(h, v1);
+		h = hashMerge(h, v2);
+		h = hashMerge(h, v3);
+		h = hashMerge(h, v4);
+	} else
+		h = seed + PRIME64_5;
+
+	h += count;
+
+	for (; p + 8 <= end; p += 8) {
+		h ^= hashRound(0, read64(p));
+		h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+	}
+	if (p + 4 <= end) {
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		h ^= (uint64_t)v * PRIME64_1;
+		h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+	for (; p < end; ++p) {
+		h ^= (*p) * PRIME64_5;
+		h = rotl64(h, 11) * PRIME64_1;
+	}
+
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
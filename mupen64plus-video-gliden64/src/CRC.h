@@ -7,3 +7,5 @@ uint32_t CRC_Calculate( uint32_t crc, const void *buffer, uint32_t count );
 uint32_t CRC_CalculatePalette( uint32_t crc, const void *buffer, uint32_t count );
 // Fast checksum calculation from Glide64
 uint32_t textureCRC(uint8_t * addr, uint32_t height, uint32_t stride);
+// 64-bit hash (XXH64 structure), for cache keys that are never persisted
+uint64_t TextureHash64( uint64_t seed, const void *buffer, uint32_t count );
@@ -4,6 +4,8 @@
 #include <stdint.h>
 
 #include <map>
+#include <set>
+#include <string>
 
 #include "OpenGL.h"
 #include "gDP.h"
@@ -142,6 +144,9 @@ public:
 	// Update uniforms for GL without UniformBlock support
 	void updateParameters(OGLRender::RENDER_STATE _renderState);
 
+	// Compiles the combiners this ROM used in earlier sessions.
+	void prewarmCombiners();
+
 private:
 	CombinerInfo() : m_bChanged(false), m_bShaderCacheSupported(false), m_shadersLoaded(0), m_pCurrent(NULL) {}
 	CombinerInfo(const CombinerInfo &);
@@ -151,6 +156,13 @@ private:
 	uint32_t _getConfigOptionsBitSet() const;
 	ShaderCombiner * _compile(uint64_t mux) const;
 
+	// Per-ROM list of the combiners used in earlier sessions. The combiners
+	// in it are compiled before the first frame; every combiner compiled
+	// while running is appended to it.
+	void _recordCombinerKey(uint64_t _mux);
+	void _countCombinerUse(uint64_t _mux);
+	void _printPrewarmStats() const;
+
 	bool m_bChanged;
 	bool m_bShaderCacheSupported;
 	uint32_t m_shadersLoaded;
@@ -158,6 +170,23 @@ private:
 	ShaderCombiner * m_pCurrent;
 	typedef std::map<uint64_t, ShaderCombiner *> Combiners;
 	Combiners m_combiners;
+
+	struct PrewarmStats {
+		uint32_t compiled;         // combiners compiled before the first frame
+		uint32_t used;             // of those, combiners used since
+		uint32_t usedFrames;       // frames that would have compiled one of them
+		uint32_t lateCompiled;     // combiners still compiled while running
+		uint32_t lateFrames;       // frames that compiled one
+		double prewarmTime;        // ms spent compiling before the first frame
+		double avoidedTime;        // ms of that spent on combiners used since
+		double lateTime;           // ms spent compiling while running
+		uint32_t lastUsedFrame;
+		uint32_t lastLateFrame;
+	};
+	std::string m_keysPath;
+	std::set<uint64_t> m_recordedKeys;
+	std::map<uint64_t, double> m_prewarmed; // not used yet, with their compile time in ms
+	PrewarmStats m_prewarmStats;
 	UniformCollection * m_pUniformCollection;
 };
 
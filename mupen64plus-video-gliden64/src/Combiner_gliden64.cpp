@@ -1,6 +1,10 @@
+#include <chrono>
 #include <fstream>
 #include <functional>
+#include <vector>
+#include <ctype.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "OpenGL.h"
 #include "Combiner.h"
@@ -11,6 +15,11 @@
 #include "Config.h"
 #include "PluginAPI.h"
 #include "RSP.h"
+#include "GBI.h"
+#include "api/libretro.h"
+
+extern retro_log_printf_t log_cb;
+extern "C" const char* retro_get_system_directory(void);
 
 static int saRGBExpanded[] =
 {
@@ -75,6 +84,7 @@ void Combiner_Init(void)
    CombinerInfo & cmbInfo = CombinerInfo::get();
    cmbInfo.init();
    InitShaderCombiner();
+   cmbInfo.prewarmCombiners();
    gDP.otherMode.cycleType = G_CYC_1CYCLE;
 
    if (cmbInfo.getCombinersNumber() == 0)
@@ -124,6 +134,7 @@ void CombinerInfo::destroy()
 	m_pCurrent = NULL;
 	if (m_bShaderCacheSupported)
 		_saveShadersStorage();
+	_printPrewarmStats();
 	m_shadersLoaded = 0;
 	for (Combiners::iterator cur = m_combiners.begin(); cur != m_combiners.end(); ++cur)
 		delete cur->second;
@@ -271,11 +282,23 @@ void CombinerInfo::setCombine(uint64_t _mux )
 	if (iter != m_combiners.end()) {
 		m_pCurrent = iter->second;
 		m_pCurrent->update(false);
+		if (!m_prewarmed.empty())
+			_countCombinerUse(_mux);
 	} else {
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 		m_pCurrent = _compile(_mux);
 		m_pCurrent->update(true);
 		m_pUniformCollection->bindWithShaderCombiner(m_pCurrent);
 		m_combiners[_mux] = m_pCurrent;
+
+		const uint32_t frame = video().getBuffersSwapCount();
+		m_prewarmStats.lateTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		++m_prewarmStats.lateCompiled;
+		if (m_prewarmStats.lateFrames == 0 || m_prewarmStats.lastLateFrame != frame) {
+			++m_prewarmStats.lateFrames;
+			m_prewarmStats.lastLateFrame = frame;
+		}
+		_recordCombinerKey(_mux);
 	}
 	m_bChanged = true;
 }
@@ -354,3 +377,125 @@ bool CombinerInfo::_loadShadersStorage()
 {
 	return true;
 }
+
+/* The key list is a text file with one combiner per line: the mux and the
+ * cycle type it was compiled for, with KEY_HWLIGHT set when the shader
+ * included hardware lighting. Lines are appended as combiners are first
+ * compiled, so a line cut short by a crash is dropped when the list is
+ * read back and the file is written again. */
+#define KEYS_HEADER		"GLideN64 combiner keys 1"
+#define KEY_CYCLE_MASK	0x3
+#define KEY_HWLIGHT		0x4
+
+void CombinerInfo::prewarmCombiners()
+{
+	m_prewarmed.clear();
+	m_recordedKeys.clear();
+	memset(&m_prewarmStats, 0, sizeof(m_prewarmStats));
+	m_keysPath.clear();
+	if (config.generalEmulation.enableShadersStorage == 0)
+		return;
+
+	// ROM names may hold characters file systems do not accept
+	std::string romName(__RSP.romname);
+	for (size_t i = 0; i < romName.size(); ++i) {
+		if (!isalnum((unsigned char)romName[i]))
+			romName[i] = '_';
+	}
+	m_keysPath = std::string(retro_get_system_directory()) + "/GLideN64." + romName + ".keys";
+
+	std::vector<std::pair<uint64_t, uint32_t> > keys;
+	bool bClean = false;
+	std::ifstream keysFile(m_keysPath.c_str());
+	std::string line;
+	if (std::getline(keysFile, line) && line == KEYS_HEADER) {
+		bClean = true;
+		while (std::getline(keysFile, line)) {
+			unsigned long long mux;
+			unsigned int flags;
+			if (keysFile.eof() || sscanf(line.c_str(), "%llx %x", &mux, &flags) != 2 ||
+				!m_recordedKeys.insert(mux).second) {
+				bClean = false;
+				continue;
+			}
+			keys.push_back(std::make_pair((uint64_t)mux, (uint32_t)flags));
+		}
+	}
+	keysFile.close();
+
+	if (!bClean) {
+		std::ofstream out(m_keysPath.c_str(), std::ios::trunc);
+		out << KEYS_HEADER << '\n';
+		for (size_t i = 0; i < keys.size(); ++i) {
+			char buf[32];
+			snprintf(buf, sizeof(buf), "%016llx %x\n", (unsigned long long)keys[i].first, keys[i].second);
+			out << buf;
+		}
+	}
+
+	const uint32_t cycleType = gDP.otherMode.cycleType;
+	for (size_t i = 0; i < keys.size(); ++i) {
+		const uint64_t mux = keys[i].first;
+		// Lighting depends on the microcode, which is not loaded yet.
+		if ((keys[i].second & KEY_HWLIGHT) != 0 || m_combiners.find(mux) != m_combiners.end())
+			continue;
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		gDP.otherMode.cycleType = keys[i].second & KEY_CYCLE_MASK;
+		ShaderCombiner * pCombiner = _compile(mux);
+		m_pUniformCollection->bindWithShaderCombiner(pCombiner);
+		m_combiners[mux] = pCombiner;
+		const double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		m_prewarmed[mux] = time;
+		m_prewarmStats.prewarmTime += time;
+		++m_prewarmStats.compiled;
+	}
+	gDP.otherMode.cycleType = cycleType;
+	gDP.changed |= CHANGED_COMBINE;
+
+	if (log_cb && m_prewarmStats.compiled > 0)
+		log_cb(RETRO_LOG_INFO, "GLideN64: compiled %u combiners for %s in %.1f ms\n",
+			m_prewarmStats.compiled, __RSP.romname, m_prewarmStats.prewarmTime);
+}
+
+void CombinerInfo::_recordCombinerKey(uint64_t _mux)
+{
+	if (m_keysPath.empty() || !m_recordedKeys.insert(_mux).second)
+		return;
+
+	uint32_t flags = gDP.otherMode.cycleType & KEY_CYCLE_MASK;
+	if (config.generalEmulation.enableHWLighting != 0 && GBI.isHWLSupported() && m_pCurrent->usesShadeColor())
+		flags |= KEY_HWLIGHT;
+
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%016llx %x\n", (unsigned long long)_mux, flags);
+	std::ofstream out(m_keysPath.c_str(), std::ios::app);
+	out << buf;
+}
+
+void CombinerInfo::_countCombinerUse(uint64_t _mux)
+{
+	std::map<uint64_t, double>::iterator iter = m_prewarmed.find(_mux);
+	if (iter == m_prewarmed.end())
+		return;
+
+	// Without the key list this would have been compiled here.
+	const uint32_t frame = video().getBuffersSwapCount();
+	++m_prewarmStats.used;
+	m_prewarmStats.avoidedTime += iter->second;
+	if (m_prewarmStats.usedFrames == 0 || m_prewarmStats.lastUsedFrame != frame) {
+		++m_prewarmStats.usedFrames;
+		m_prewarmStats.lastUsedFrame = frame;
+	}
+	m_prewarmed.erase(iter);
+}
+
+void CombinerInfo::_printPrewarmStats() const
+{
+	if (log_cb == NULL || m_keysPath.empty())
+		return;
+	log_cb(RETRO_LOG_INFO, "GLideN64: %u of %u combiners compiled before the first frame were used, "
+		"saving %.1f ms of compiling in %u frames\n",
+		m_prewarmStats.used, m_prewarmStats.compiled, m_prewarmStats.avoidedTime, m_prewarmStats.usedFrames);
+	log_cb(RETRO_LOG_INFO, "GLideN64: %u combiners compiled while running, %.1f ms in %u frames\n",
+		m_prewarmStats.lateCompiled, m_prewarmStats.lateTime, m_prewarmStats.lateFrames);
+}
@@ -100,6 +100,7 @@ struct gliden64_config
 		uint32_t txForce16bpp;				// Force use 16bit color textures
 		uint32_t txCacheCompression;			// Zip textures cache
 		uint32_t txSaveCache;				// Save texture cache to hard disk
+		uint32_t txAsyncFilter;				// Filter textures on a worker thread
 
 		wchar_t txPath[256];
 	} textureFilter;
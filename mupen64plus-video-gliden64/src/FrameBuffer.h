@@ -122,6 +122,11 @@ void FrameBuffer_Init();
 void FrameBuffer_Destroy();
 void FrameBuffer_CopyToRDRAM( uint32_t _address , bool _sync );
 void FrameBuffer_CopyChunkToRDRAM(uint32_t _address);
+// Asynchronous copies to RDRAM are read back into PBOs. StartCopies writes
+// the ones the GPU has finished to RDRAM, WaitForCopies completes every copy
+// touching a range the guest accesses.
+void FrameBuffer_StartCopies();
+void FrameBuffer_WaitForCopies(uint32_t _address, uint32_t _size);
 void FrameBuffer_CopyFromRDRAM( uint32_t address, bool bUseAlpha );
 bool FrameBuffer_CopyDepthBuffer( uint32_t address );
 bool FrameBuffer_CopyDepthBufferChunk(uint32_t address);
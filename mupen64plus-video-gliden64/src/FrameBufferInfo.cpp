@@ -9,6 +9,7 @@
 void FrameBufferWrite(uint32_t addr, uint32_t size)
 {
 	//LOG("FBWrite addr=%08lx size=%u\n", addr, size);
+	FrameBuffer_WaitForCopies(RSP_SegmentToPhysical(addr), size);
 }
 
 void FrameBufferWriteList(FrameBufferModifyEntry *plist, uint32_t size)
@@ -23,6 +24,7 @@ void FrameBufferWriteList(FrameBufferModifyEntry *plist, uint32_t size)
 void FrameBufferRead(uint32_t addr)
 {
    const uint32_t address = RSP_SegmentToPhysical(addr);
+	FrameBuffer_WaitForCopies(address & ~0xFFF, 0x1000);
 	FrameBuffer * pBuffer  = frameBufferList().findBuffer(address);
 
 	if (!pBuffer)
@@ -34,9 +34,11 @@ public:
       m_pTexture(NULL),
       m_pCurFrameBuffer(NULL),
       m_curIndex(-1),
-      m_frameCount(-1)
+      m_frameCount(-1),
+      m_numCopies(0)
 	{
 		m_PBO[0] = m_PBO[1] = m_PBO[2] = 0;
+		m_pMapped[0] = m_pMapped[1] = NULL;
 	}
 
 	void Init();
@@ -47,6 +49,9 @@ public:
 
 	void CopyToRDRAM(uint32_t _address, bool _sync);
 
+	void startCopies();
+	void waitForCopies(uint32_t _address, uint32_t _size);
+
 private:
 	union RGBA {
 		struct {
@@ -55,15 +60,30 @@ private:
 		uint32_t raw;
 	};
 
+	// A frame buffer read back into m_PBO[index] and the RDRAM range it goes to.
+	struct Copy {
+		GLsync fence; // NULL once the copy is in RDRAM
+		const GLubyte * pixels;
+		uint32_t startAddress, endAddress;
+		uint32_t bufferAddress, bufferSize;
+		uint32_t width, height, numPixels;
+	};
+
    bool _prepareCopy(uint32_t _address);
 	void _copy(uint32_t _startAddress, uint32_t _endAddress, bool _sync);
+	static void _writeCopy(const Copy & _copy);
+	void _finishCopy(uint32_t _index, bool _wait);
 
 	GLuint m_FBO;
 	CachedTexture * m_pTexture;
    FrameBuffer * m_pCurFrameBuffer;
 	uint32_t m_curIndex;
    uint32_t m_frameCount;
+	// m_PBO[0] and m_PBO[1] take asynchronous copies, m_PBO[2] synchronous ones
 	GLuint m_PBO[3];
+	GLubyte * m_pMapped[2]; // persistent mappings of m_PBO[0] and m_PBO[1], if supported
+	Copy m_copies[2];
+	uint32_t m_numCopies;   // copies still on the GPU
 };
 
 class DepthBufferToRDRAM
@@ -1022,16 +1042,45 @@ void FrameBufferToRDRAM::Init()
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 
 	// Generate and initialize Pixel Buffer Objects
+	bool persistent = false;
+#if defined(HAVE_OPENGL) && defined(GL_MAP_PERSISTENT_BIT)
+	GLint majorVersion = 0, minorVersion = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+	glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+	persistent = majorVersion > 4 || (majorVersion == 4 && minorVersion >= 4) ||
+		OGLVideo::isExtensionSupported("GL_ARB_buffer_storage");
+#endif
 	glGenBuffers(3, m_PBO);
 	for (uint32_t i = 0; i < 3; ++i) {
 		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_PBO[i]);
+#if defined(HAVE_OPENGL) && defined(GL_MAP_PERSISTENT_BIT)
+		if (persistent && i < 2) {
+			const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_PIXEL_PACK_BUFFER, m_pTexture->textureBytes, NULL, flags);
+			m_pMapped[i] = (GLubyte*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_pTexture->textureBytes, flags);
+			continue;
+		}
+#endif
 		glBufferData(GL_PIXEL_PACK_BUFFER, m_pTexture->textureBytes, NULL, GL_DYNAMIC_READ);
 	}
 	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 	m_curIndex = 0;
+
+	for (uint32_t i = 0; i < 2; ++i)
+		m_copies[i].fence = NULL;
+	m_numCopies = 0;
 }
 
 void FrameBufferToRDRAM::Destroy() {
+	waitForCopies(0, RDRAMSize);
+	for (uint32_t i = 0; i < 2; ++i) {
+		if (m_pMapped[i] != NULL) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, m_PBO[i]);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			m_pMapped[i] = NULL;
+		}
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 	if (m_FBO != 0) {
 		glDeleteFramebuffers(1, &m_FBO);
@@ -1171,20 +1220,40 @@ void FrameBufferToRDRAM::_copy(uint32_t _startAddress, uint32_t _endAddress, boo
 		colorFormatBytes = fboFormats.monochromeFormatBytes;
 	}
 
+	Copy copy;
+	copy.startAddress = _startAddress;
+	copy.endAddress = _endAddress;
+	copy.bufferAddress = m_pCurFrameBuffer->m_startAddress;
+	copy.bufferSize = m_pCurFrameBuffer->m_size;
+	copy.width = width;
+	copy.height = height;
+	copy.numPixels = numPixels;
+
 #ifndef HAVE_OPENGLES2
 	// If Sync, read pixels from the buffer, copy them to RDRAM.
-	// If not Sync, read pixels from the buffer, copy pixels from the previous buffer to RDRAM.
+	// If not Sync, read pixels into the next PBO and copy them to RDRAM once
+	// the GPU is done with them, see startCopies().
 	if (!_sync) {
 		m_curIndex ^= 1;
-		const uint32_t nextIndex = m_curIndex^1;
+		_finishCopy(m_curIndex, true);
 		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_PBO[m_curIndex]);
 		glReadPixels(x0, y0, width, height, colorFormat, colorType, 0);
-		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_PBO[nextIndex]);
-	} else {
-		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_PBO[2]);
-		glReadPixels(x0, y0, width, height, colorFormat, colorType, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		copy.fence = (GLsync)glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		copy.pixels = NULL;
+		m_copies[m_curIndex] = copy;
+		++m_numCopies;
+
+		m_pCurFrameBuffer->m_copiedToRdram = true;
+		m_pCurFrameBuffer->m_cleared = false;
+		gDP.changed |= CHANGED_SCISSOR;
+		return;
 	}
 
+	waitForCopies(_startAddress, _endAddress - _startAddress);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_PBO[2]);
+	glReadPixels(x0, y0, width, height, colorFormat, colorType, 0);
+
 	GLubyte* pixelData = (GLubyte*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, width * height * colorFormatBytes, GL_MAP_READ_BIT);
 	if (pixelData == NULL)
 		return;
@@ -1195,25 +1264,8 @@ void FrameBufferToRDRAM::_copy(uint32_t _startAddress, uint32_t _endAddress, boo
 	glReadPixels(x0, y0, width, height, colorFormat, colorType, pixelData);
 #endif // HAVE_OPENGLES2
 
-	if (m_pCurFrameBuffer->m_size == G_IM_SIZ_32b)
-   {
-		uint32_t *ptr_src = (uint32_t*)pixelData;
-		uint32_t *ptr_dst = (uint32_t*)(RDRAM + _startAddress);
-		RGBA c;
-      _writeToRdram<uint32_t, uint32_t>(ptr_src, ptr_dst, &RGBA16toRGBA32, 0, 0, width, height, numPixels, _startAddress, m_pCurFrameBuffer->m_startAddress, m_pCurFrameBuffer->m_size);
-	}
-   else if (m_pCurFrameBuffer->m_size == G_IM_SIZ_16b)
-   {
-		uint32_t * ptr_src = (uint32_t*)pixelData;
-		uint16_t * ptr_dst = (uint16_t*)(RDRAM + _startAddress);
-      _writeToRdram<uint32_t, uint16_t>(ptr_src, ptr_dst, &RGBA32toRGBA16, 0, 1, width, height, numPixels, _startAddress, m_pCurFrameBuffer->m_startAddress, m_pCurFrameBuffer->m_size);
-	}
-   else if (m_pCurFrameBuffer->m_size == G_IM_SIZ_8b)
-   {
-      uint8_t *ptr_src = (uint8_t*)pixelData;
-      uint8_t *ptr_dst = RDRAM + _startAddress;
-      _writeToRdram<uint8_t, uint8_t>(ptr_src, ptr_dst, &RGBA8toR8, 0, 3, width, height, numPixels, _startAddress, m_pCurFrameBuffer->m_startAddress, m_pCurFrameBuffer->m_size);
-   }
+	copy.pixels = pixelData;
+	_writeCopy(copy);
 
 	m_pCurFrameBuffer->m_copiedToRdram = true;
 	m_pCurFrameBuffer->copyRdram();
@@ -1227,6 +1279,89 @@ void FrameBufferToRDRAM::_copy(uint32_t _startAddress, uint32_t _endAddress, boo
 	gDP.changed |= CHANGED_SCISSOR;
 }
 
+void FrameBufferToRDRAM::_writeCopy(const Copy & _copy)
+{
+	if (_copy.bufferSize == G_IM_SIZ_32b)
+   {
+		uint32_t *ptr_src = (uint32_t*)_copy.pixels;
+		uint32_t *ptr_dst = (uint32_t*)(RDRAM + _copy.startAddress);
+      _writeToRdram<uint32_t, uint32_t>(ptr_src, ptr_dst, &RGBA16toRGBA32, 0, 0, _copy.width, _copy.height, _copy.numPixels, _copy.startAddress, _copy.bufferAddress, _copy.bufferSize);
+	}
+   else if (_copy.bufferSize == G_IM_SIZ_16b)
+   {
+		uint32_t * ptr_src = (uint32_t*)_copy.pixels;
+		uint16_t * ptr_dst = (uint16_t*)(RDRAM + _copy.startAddress);
+      _writeToRdram<uint32_t, uint16_t>(ptr_src, ptr_dst, &RGBA32toRGBA16, 0, 1, _copy.width, _copy.height, _copy.numPixels, _copy.startAddress, _copy.bufferAddress, _copy.bufferSize);
+	}
+   else if (_copy.bufferSize == G_IM_SIZ_8b)
+   {
+      uint8_t *ptr_src = (uint8_t*)_copy.pixels;
+      uint8_t *ptr_dst = RDRAM + _copy.startAddress;
+      _writeToRdram<uint8_t, uint8_t>(ptr_src, ptr_dst, &RGBA8toR8, 0, 3, _copy.width, _copy.height, _copy.numPixels, _copy.startAddress, _copy.bufferAddress, _copy.bufferSize);
+   }
+}
+
+// Copies the read back pixels to RDRAM, waiting for the GPU if _wait is set.
+void FrameBufferToRDRAM::_finishCopy(uint32_t _index, bool _wait)
+{
+	Copy & copy = m_copies[_index];
+	if (copy.fence == NULL)
+		return;
+	if (_wait) {
+		while (glClientWaitSync(copy.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+			;
+	} else {
+		const GLenum status = glClientWaitSync(copy.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			return;
+	}
+	glDeleteSync(copy.fence);
+	copy.fence = NULL;
+	--m_numCopies;
+
+	if (m_pMapped[_index] != NULL)
+		copy.pixels = m_pMapped[_index];
+	else {
+		const GLenum colorFormatBytes = copy.bufferSize > G_IM_SIZ_8b ? fboFormats.colorFormatBytes : fboFormats.monochromeFormatBytes;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_PBO[_index]);
+		copy.pixels = (const GLubyte*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, copy.width * copy.height * colorFormatBytes, GL_MAP_READ_BIT);
+	}
+	if (copy.pixels != NULL)
+		_writeCopy(copy);
+	if (m_pMapped[_index] == NULL) {
+		if (copy.pixels != NULL)
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	// Snapshot what was written for the validity check, as a synchronous copy does.
+	FrameBuffer * pBuffer = frameBufferList().findBuffer(copy.bufferAddress);
+	if (pBuffer != NULL && pBuffer->m_startAddress == copy.bufferAddress)
+		pBuffer->copyRdram();
+}
+
+// Called once a frame: copies the GPU has finished reading back go to RDRAM
+// now, the rest wait for the next frame or for an access to their range.
+void FrameBufferToRDRAM::startCopies()
+{
+	if (m_numCopies == 0)
+		return;
+	for (uint32_t i = 0; i < 2; ++i)
+		_finishCopy(i, false);
+}
+
+void FrameBufferToRDRAM::waitForCopies(uint32_t _address, uint32_t _size)
+{
+	if (m_numCopies == 0)
+		return;
+	for (uint32_t i = 0; i < 2; ++i) {
+		const Copy & copy = m_copies[i];
+		if (copy.fence != NULL && _address < copy.endAddress &&
+			uint64_t(_address) + _size > copy.startAddress)
+			_finishCopy(i, true);
+	}
+}
+
 void FrameBufferToRDRAM::copyToRDRAM(uint32_t _address, bool _sync)
 {
 	if (!_prepareCopy(_address))
@@ -1265,6 +1400,20 @@ void FrameBuffer_CopyChunkToRDRAM(uint32_t _address)
 #endif
 }
 
+void FrameBuffer_StartCopies()
+{
+#ifndef HAVE_OPENGLES2
+	g_fbToRDRAM.startCopies();
+#endif
+}
+
+void FrameBuffer_WaitForCopies(uint32_t _address, uint32_t _size)
+{
+#ifndef HAVE_OPENGLES2
+	g_fbToRDRAM.waitForCopies(_address, _size);
+#endif
+}
+
 #ifndef HAVE_OPENGLES2
 void DepthBufferToRDRAM::Init()
 {
@@ -97,7 +97,7 @@ typedef unsigned char boolean;
 #define DUMP_TEXCACHE       0x01000000
 #define DUMP_HIRESTEXCACHE  0x02000000
 #define TILE_HIRESTEX       0x04000000
-#define UNDEFINED_0         0x08000000
+#define ASYNC_FILTER        0x08000000 /* filter cache misses on a worker thread */
 #define FORCE16BPP_HIRESTEX 0x10000000
 #define FORCE16BPP_TEX      0x20000000
 #define LET_TEXARTISTS_FLY  0x40000000 /* a little freedom for texture artists */
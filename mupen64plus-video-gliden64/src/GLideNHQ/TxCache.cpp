@@ -27,10 +27,49 @@
 
 #include "TxCache.h"
 #include "TxDbg.h"
+#include "TxLz4.h"
 #include <osal_files.h>
 #include <zlib.h>
 #include <memory.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* Cache file layout: header, texture data, then the index. Entries are
+ * stored LZ4 compressed (GL_TEXFMT_LZ4) unless that does not shrink them.
+ * The file is mapped read-only and textures are only read on get(), so
+ * opening a large cache costs one pass over the index.
+ */
+#define TXCACHE_FILE_MAGIC   0x43514847 /* "GHQC" */
+#define TXCACHE_FILE_VERSION 1
+
+struct TXCACHEFILEHEADER {
+	uint32_t magic;
+	uint32_t version;
+	int32_t config;
+	uint32_t count;
+	uint64 indexOffset;
+};
+
+struct TXCACHEFILEENTRY {
+	uint64 checksum;
+	uint64 offset;
+	uint32_t size;
+	int32_t width;
+	int32_t height;
+	uint32_t format;
+	uint16_t texture_format;
+	uint16_t pixel_type;
+	uint8_t is_hires_tex;
+	uint8_t pad[3];
+};
 
 TxCache::~TxCache()
 {
@@ -49,6 +88,9 @@ TxCache::TxCache(int options, int cachesize, const wchar_t *path, const wchar_t
 	_cacheSize = cachesize;
 	_callback = callback;
 	_totalSize = 0;
+	_mapData = NULL;
+	_mapSize = 0;
+	_mapHandle = NULL;
 
 	/* save path name */
 	if (path)
@@ -58,29 +100,31 @@ TxCache::TxCache(int options, int cachesize, const wchar_t *path, const wchar_t
 	if (ident)
 		_ident.assign(ident);
 
-	/* zlib memory buffers to (de)compress hires textures */
-	if (_options & (GZ_TEXCACHE|GZ_HIRESTEXCACHE)) {
-		_gzdest0   = TxMemBuf::getInstance()->get(0);
-		_gzdest1   = TxMemBuf::getInstance()->get(1);
-		_gzdestLen = (TxMemBuf::getInstance()->size_of(0) < TxMemBuf::getInstance()->size_of(1)) ?
-					TxMemBuf::getInstance()->size_of(0) : TxMemBuf::getInstance()->size_of(1);
-
-		if (!_gzdest0 || !_gzdest1 || !_gzdestLen) {
-			_options &= ~(GZ_TEXCACHE|GZ_HIRESTEXCACHE);
-			_gzdest0 = NULL;
-			_gzdest1 = NULL;
-			_gzdestLen = 0;
-		}
+	/* memory buffers to (de)compress textures. entries read from the
+	 * cache file are compressed regardless of the options. */
+	_gzdest0   = TxMemBuf::getInstance()->get(0);
+	_gzdest1   = TxMemBuf::getInstance()->get(1);
+	_gzdestLen = (TxMemBuf::getInstance()->size_of(0) < TxMemBuf::getInstance()->size_of(1)) ?
+				TxMemBuf::getInstance()->size_of(0) : TxMemBuf::getInstance()->size_of(1);
+
+	if (!_gzdest0 || !_gzdest1 || !_gzdestLen) {
+		_options &= ~(GZ_TEXCACHE|GZ_HIRESTEXCACHE);
+		_gzdest0 = NULL;
+		_gzdest1 = NULL;
+		_gzdestLen = 0;
 	}
 }
 
 boolean
 TxCache::add(uint64 checksum, GHQTexInfo *info, int dataSize)
 {
-	/* NOTE: dataSize must be provided if info->data is zlib compressed. */
+	/* NOTE: dataSize must be provided if info->data is compressed. */
 
 	if (!checksum || !info->data) return 0;
 
+	/* already cached, e.g. mapped from the cache file */
+	if (is_cached(checksum)) return 0;
+
 	uint8 *dest = info->data;
 	uint32 format = info->format;
 
@@ -90,16 +134,17 @@ TxCache::add(uint64 checksum, GHQTexInfo *info, int dataSize)
 		if (!dataSize) return 0;
 
 		if (_options & (GZ_TEXCACHE|GZ_HIRESTEXCACHE)) {
-			/* zlib compress it. compression level:1 (best speed) */
-			uint32 destLen = _gzdestLen;
+			/* LZ4 compress it. decompression runs on every hit, so it
+			 * has to be much cheaper than zlib. */
 			dest = (dest == _gzdest0) ? _gzdest1 : _gzdest0;
-			if (compress2(dest, &destLen, info->data, dataSize, 1) != Z_OK) {
+			int destLen = txLz4Compress(info->data, dataSize, dest, _gzdestLen);
+			if (destLen <= 0 || destLen >= dataSize) {
 				dest = info->data;
-				DBG_INFO(80, wst("Error: zlib compression failed!\n"));
+				DBG_INFO(80, wst("lz4 compression skipped\n"));
 			} else {
-				DBG_INFO(80, wst("zlib compressed: %.02fkb->%.02fkb\n"), (float)dataSize/1000, (float)destLen/1000);
+				DBG_INFO(80, wst("lz4 compressed: %.02fkb->%.02fkb\n"), (float)dataSize/1000, (float)destLen/1000);
 				dataSize = destLen;
-				format |= GL_TEXFMT_GZ;
+				format |= GL_TEXFMT_LZ4;
 			}
 		}
 	}
@@ -149,6 +194,7 @@ TxCache::add(uint64 checksum, GHQTexInfo *info, int dataSize)
 			txCache->info.data = tmpdata;
 			txCache->info.format = format;
 			txCache->size = dataSize;
+			txCache->mapped = 0;
 
 			/* add to cache */
 			if (_cacheSize > 0) {
@@ -195,13 +241,25 @@ TxCache::get(uint64 checksum, GHQTexInfo *info)
 		memcpy(info, &(((*itMap).second)->info), sizeof(GHQTexInfo));
 
 		/* push it to the back of the list */
-		if (_cacheSize > 0) {
+		if (_cacheSize > 0 && !((*itMap).second)->mapped) {
 			_cachelist.erase(((*itMap).second)->it);
 			_cachelist.push_back(checksum);
 			((*itMap).second)->it = --(_cachelist.end());
 		}
 
-		/* zlib decompress it */
+		/* LZ4 decompress it */
+		if (info->format & GL_TEXFMT_LZ4) {
+			uint8 *dest = (_gzdest0 == info->data) ? _gzdest1 : _gzdest0;
+			const int destLen = txLz4Decompress(info->data, ((*itMap).second)->size, dest, _gzdestLen);
+			if (destLen < 0) {
+				DBG_INFO(80, wst("Error: lz4 decompression failed!\n"));
+				return 0;
+			}
+			info->data = dest;
+			info->format &= ~GL_TEXFMT_LZ4;
+		}
+
+		/* zlib decompress it (entries from old cache files) */
 		if (info->format & GL_TEXFMT_GZ) {
 			uint32 destLen = _gzdestLen;
 			uint8 *dest = (_gzdest0 == info->data) ? _gzdest1 : _gzdest0;
@@ -223,11 +281,23 @@ TxCache::get(uint64 checksum, GHQTexInfo *info)
 boolean
 TxCache::save(const wchar_t *path, const wchar_t *filename, int config)
 {
+	/* NOTE: this is the last thing done with the cache. the contents are
+	 * released so that the mapping of the old file can be replaced. */
 	if (_cache.empty())
 		return true;
 
+	/* nothing new since the cache file was opened */
+	if (_mapData) {
+		std::map<uint64, TXCACHE*>::iterator itMap = _cache.begin();
+		while (itMap != _cache.end() && (*itMap).second->mapped)
+			itMap++;
+		if (itMap == _cache.end())
+			return true;
+	}
+
 	/* dump cache to disk */
 	char cbuf[MAX_PATH];
+	char tmpbuf[MAX_PATH + 4];
 
 	osal_mkdirp(path);
 
@@ -244,51 +314,63 @@ TxCache::save(const wchar_t *path, const wchar_t *filename, int config)
 #endif
 
 	wcstombs(cbuf, filename, MAX_PATH);
+	snprintf(tmpbuf, sizeof(tmpbuf), "%s.tmp", cbuf);
 
-	gzFile gzfp = gzopen(cbuf, "wb1");
-	DBG_INFO(80, wst("gzfp:%x file:%ls\n"), gzfp, filename);
-	if (gzfp) {
-		/* write header to determine config match */
-		gzwrite(gzfp, &config, 4);
+	/* write to a temporary file; the old one may still be mapped */
+	FILE *fp = fopen(tmpbuf, "wb");
+	DBG_INFO(80, wst("fp:%x file:%ls\n"), fp, filename);
+	boolean written = 0;
+	if (fp) {
+		TXCACHEFILEHEADER header;
+		std::vector<TXCACHEFILEENTRY> index;
+		index.reserve(_cache.size());
+
+		memset(&header, 0, sizeof(header));
+		fwrite(&header, sizeof(header), 1, fp);
+		uint64 offset = sizeof(header);
 
 		std::map<uint64, TXCACHE*>::iterator itMap = _cache.begin();
 		int total = 0;
 		while (itMap != _cache.end()) {
-			uint8 *dest = (*itMap).second->info.data;
-			uint32 destLen = (*itMap).second->size;
+			const uint8 *dest = (*itMap).second->info.data;
+			int destLen = (*itMap).second->size;
 			uint32 format = (*itMap).second->info.format;
 
-			/* to keep things simple, we save the texture data in a zlib uncompressed state. */
-			/* sigh... for those who cannot wait the extra few seconds. changed to keep
-	 * texture data in a zlib compressed state. if the GZ_TEXCACHE or GZ_HIRESTEXCACHE
-	 * option is toggled, the cache will need to be rebuilt.
-	 */
-			/*if (format & GL_TEXFMT_GZ) {
-	  dest = _gzdest0;
-	  destLen = _gzdestLen;
-	  if (dest && destLen) {
-	  if (uncompress(dest, &destLen, (*itMap).second->info.data, (*itMap).second->size) != Z_OK) {
-	  dest = NULL;
-	  destLen = 0;
-	  }
-	  format &= ~GL_TEXFMT_GZ;
-	  }
-	  }*/
-
-			if (dest && destLen) {
-				/* texture checksum */
-				gzwrite(gzfp, &((*itMap).first), 8);
-
-				/* other texture info */
-				gzwrite(gzfp, &((*itMap).second->info.width), 4);
-				gzwrite(gzfp, &((*itMap).second->info.height), 4);
-				gzwrite(gzfp, &format, 4);
-				gzwrite(gzfp, &((*itMap).second->info.texture_format), 2);
-				gzwrite(gzfp, &((*itMap).second->info.pixel_type), 2);
-				gzwrite(gzfp, &((*itMap).second->info.is_hires_tex), 1);
-
-				gzwrite(gzfp, &destLen, 4);
-				gzwrite(gzfp, dest, destLen);
+			/* entries loaded from an old gzip cache file */
+			if ((format & GL_TEXFMT_GZ) && _gzdest0) {
+				uLongf gzLen = _gzdestLen;
+				if (uncompress(_gzdest0, &gzLen, dest, destLen) == Z_OK) {
+					dest = _gzdest0;
+					destLen = gzLen;
+					format &= ~GL_TEXFMT_GZ;
+				} else
+					destLen = 0;
+			}
+
+			/* the file is always compressed */
+			if (!(format & (GL_TEXFMT_GZ|GL_TEXFMT_LZ4)) && _gzdest1) {
+				const int lzLen = txLz4Compress(dest, destLen, _gzdest1, _gzdestLen);
+				if (lzLen > 0 && lzLen < destLen) {
+					dest = _gzdest1;
+					destLen = lzLen;
+					format |= GL_TEXFMT_LZ4;
+				}
+			}
+
+			if (dest && destLen > 0 && fwrite(dest, 1, destLen, fp) == (size_t)destLen) {
+				TXCACHEFILEENTRY entry;
+				memset(&entry, 0, sizeof(entry));
+				entry.checksum = (*itMap).first;
+				entry.offset = offset;
+				entry.size = destLen;
+				entry.width = (*itMap).second->info.width;
+				entry.height = (*itMap).second->info.height;
+				entry.format = format;
+				entry.texture_format = (*itMap).second->info.texture_format;
+				entry.pixel_type = (*itMap).second->info.pixel_type;
+				entry.is_hires_tex = (*itMap).second->info.is_hires_tex;
+				index.push_back(entry);
+				offset += destLen;
 			}
 
 			itMap++;
@@ -296,12 +378,156 @@ TxCache::save(const wchar_t *path, const wchar_t *filename, int config)
 			if (_callback)
 				(*_callback)(wst("Total textures saved to HDD: %d\n"), ++total);
 		}
-		gzclose(gzfp);
+
+		header.magic = TXCACHE_FILE_MAGIC;
+		header.version = TXCACHE_FILE_VERSION;
+		header.config = config;
+		header.count = (uint32_t)index.size();
+		header.indexOffset = offset;
+		if (!index.empty())
+			fwrite(&index[0], sizeof(TXCACHEFILEENTRY), index.size(), fp);
+		fseek(fp, 0, SEEK_SET);
+		fwrite(&header, sizeof(header), 1, fp);
+
+		written = !ferror(fp);
+		if (fclose(fp) != 0)
+			written = 0;
+	}
+
+	/* drop the mapping before replacing the file */
+	clear();
+
+	if (written) {
+		remove(cbuf);
+		if (rename(tmpbuf, cbuf) != 0)
+			written = 0;
+	}
+	if (!written)
+		remove(tmpbuf);
+
+	CHDIR(curpath);
+
+	return written;
+}
+
+boolean
+TxCache::open(const wchar_t *path, const wchar_t *filename, int config)
+{
+	/* find it on disk */
+	char cbuf[MAX_PATH];
+
+#ifdef WIN32
+	wchar_t curpath[MAX_PATH];
+	GETCWD(MAX_PATH, curpath);
+	CHDIR(path);
+#else
+	char curpath[MAX_PATH];
+	GETCWD(MAX_PATH, curpath);
+	wcstombs(cbuf, path, MAX_PATH);
+	CHDIR(cbuf);
+#endif
+
+	wcstombs(cbuf, filename, MAX_PATH);
+
+	closeMap();
+
+#ifdef WIN32
+	HANDLE file = CreateFileA(cbuf, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+			_mapHandle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (_mapHandle) {
+				_mapData = (uint8*)MapViewOfFile(_mapHandle, FILE_MAP_READ, 0, 0, 0);
+				_mapSize = (size_t)size.QuadPart;
+			}
+		}
+		CloseHandle(file);
 	}
+#else
+	int fd = ::open(cbuf, O_RDONLY);
+	if (fd >= 0) {
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (data != MAP_FAILED) {
+				_mapData = (uint8*)data;
+				_mapSize = st.st_size;
+			}
+		}
+		::close(fd);
+	}
+#endif
+	DBG_INFO(80, wst("map:%x size:%d file:%ls\n"), _mapData, _mapSize, filename);
+
+	TXCACHEFILEHEADER header;
+	if (!_mapData || _mapSize < sizeof(header)) {
+		closeMap();
+		CHDIR(curpath);
+		return 0;
+	}
+
+	memcpy(&header, _mapData, sizeof(header));
+	if (header.magic != TXCACHE_FILE_MAGIC) {
+		/* cache file written by an older version */
+		closeMap();
+		CHDIR(curpath);
+		return load(path, filename, config);
+	}
+
+	if (header.version != TXCACHE_FILE_VERSION || header.config != config ||
+			header.indexOffset < sizeof(header) || header.indexOffset > _mapSize ||
+			(_mapSize - header.indexOffset) / sizeof(TXCACHEFILEENTRY) < header.count) {
+		closeMap();
+		CHDIR(curpath);
+		return 0;
+	}
+
+	const uint8 *entries = _mapData + header.indexOffset;
+	for (uint32_t i = 0; i < header.count; i++) {
+		TXCACHEFILEENTRY entry;
+		memcpy(&entry, entries + i * sizeof(TXCACHEFILEENTRY), sizeof(entry));
+		if (!entry.checksum || entry.offset < sizeof(header) || entry.offset > header.indexOffset ||
+				entry.size > header.indexOffset - entry.offset)
+			continue;
+
+		TXCACHE *txCache = new TXCACHE;
+		txCache->info.data = _mapData + entry.offset;
+		txCache->info.width = entry.width;
+		txCache->info.height = entry.height;
+		txCache->info.format = entry.format;
+		txCache->info.texture_format = entry.texture_format;
+		txCache->info.pixel_type = entry.pixel_type;
+		txCache->info.is_hires_tex = entry.is_hires_tex;
+		txCache->size = entry.size;
+		txCache->mapped = 1;
+		if (!_cache.insert(std::map<uint64, TXCACHE*>::value_type(entry.checksum, txCache)).second)
+			delete txCache;
+	}
+
+	if (_callback)
+		(*_callback)(wst("[%d] textures mapped - %ls\n"), _cache.size(), filename);
 
 	CHDIR(curpath);
 
-	return _cache.empty();
+	return !_cache.empty();
+}
+
+void
+TxCache::closeMap()
+{
+	if (!_mapData)
+		return;
+
+#ifdef WIN32
+	UnmapViewOfFile(_mapData);
+	CloseHandle((HANDLE)_mapHandle);
+#else
+	munmap(_mapData, _mapSize);
+#endif
+	_mapData = NULL;
+	_mapSize = 0;
+	_mapHandle = NULL;
 }
 
 boolean
@@ -382,12 +608,15 @@ TxCache::del(uint64 checksum)
 	std::map<uint64, TXCACHE*>::iterator itMap = _cache.find(checksum);
 	if (itMap != _cache.end()) {
 
-		/* for texture cache (not hi-res cache) */
-		if (!_cachelist.empty()) _cachelist.erase(((*itMap).second)->it);
+		/* mapped entries are not in the list and take no memory */
+		if (!(*itMap).second->mapped) {
+			/* for texture cache (not hi-res cache) */
+			if (!_cachelist.empty()) _cachelist.erase(((*itMap).second)->it);
 
-		/* remove from cache */
-		free((*itMap).second->info.data);
-		_totalSize -= (*itMap).second->size;
+			/* remove from cache */
+			free((*itMap).second->info.data);
+			_totalSize -= (*itMap).second->size;
+		}
 		delete (*itMap).second;
 		_cache.erase(itMap);
 
@@ -414,7 +643,8 @@ TxCache::clear()
 	if (!_cache.empty()) {
 		std::map<uint64, TXCACHE*>::iterator itMap = _cache.begin();
 		while (itMap != _cache.end()) {
-			free((*itMap).second->info.data);
+			if (!(*itMap).second->mapped)
+				free((*itMap).second->info.data);
 			delete (*itMap).second;
 			itMap++;
 		}
@@ -423,5 +653,7 @@ TxCache::clear()
 
 	if (!_cachelist.empty()) _cachelist.clear();
 
+	closeMap();
+
 	_totalSize = 0;
 }
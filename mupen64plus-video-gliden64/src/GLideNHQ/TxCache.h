@@ -36,6 +36,11 @@ private:
   uint8 *_gzdest0;
   uint8 *_gzdest1;
   uint32 _gzdestLen;
+  /* read-only mapping of the cache file opened by open() */
+  uint8 *_mapData;
+  size_t _mapSize;
+  void *_mapHandle;
+  void closeMap();
 protected:
   int _options;
   tx_wstring _ident;
@@ -46,12 +51,14 @@ protected:
     int size;
     GHQTexInfo info;
     std::list<uint64>::iterator it;
+    boolean mapped; /* info.data points into the cache file mapping */
   };
   int _totalSize;
   int _cacheSize;
   std::map<uint64, TXCACHE*> _cache;
   boolean save(const wchar_t *path, const wchar_t *filename, const int config);
   boolean load(const wchar_t *path, const wchar_t *filename, const int config);
+  boolean open(const wchar_t *path, const wchar_t *filename, const int config);
   boolean del(uint64 checksum); /* checksum hi:palette low:texture */
   boolean is_cached(uint64 checksum); /* checksum hi:palette low:texture */
   void clear();
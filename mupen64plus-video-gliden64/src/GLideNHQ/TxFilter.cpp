@@ -28,6 +28,7 @@
 #include <functional>
 #include <thread>
 #include <stdlib.h>
+#include <string.h>
 
 #include <osal_files.h>
 #include "TxFilter.h"
@@ -37,6 +38,12 @@
 
 void TxFilter::clear()
 {
+	/* finish with the filter thread; textures it already filtered
+	 * still go to the cache */
+	stopFilterThread();
+	if (_txTexCache)
+		collectFiltered();
+
 	/* clear hires texture cache */
 	delete _txHiResCache;
 
@@ -60,7 +67,8 @@ TxFilter::~TxFilter()
 TxFilter::TxFilter(int maxwidth, int maxheight, int maxbpp, int options,
 	int cachesize, const wchar_t * path, const wchar_t * texPackPath, const wchar_t * ident,
 				   dispInfoFuncExt callback) :
-	_tex1(NULL), _tex2(NULL), _txQuantize(NULL), _txTexCache(NULL), _txHiResCache(NULL), _txUtil(NULL), _txImage(NULL)
+	_tex1(NULL), _tex2(NULL), _txQuantize(NULL), _txTexCache(NULL), _txHiResCache(NULL), _txUtil(NULL), _txImage(NULL),
+	_filterThread(NULL), _quit(false), _jobTex1(NULL), _jobTex2(NULL)
 {
 	/* HACKALERT: the emulator misbehaves and sometimes forgets to shutdown */
 	if ((ident && wcscmp(ident, wst("DEFAULT")) != 0 && _ident.compare(ident) == 0) &&
@@ -143,16 +151,17 @@ TxFilter::TxFilter(int maxwidth, int maxheight, int maxbpp, int options,
 
 	if (_tex1 && _tex2)
 		_initialized = 1;
+
+	/* filtered textures reach the renderer through the texture cache */
+	if (_initialized && (_options & ASYNC_FILTER) && _cacheSize)
+		startFilterThread();
 }
 
 boolean
 TxFilter::filter(uint8 *src, int srcwidth, int srcheight, uint16 srcformat, uint64 g64crc, GHQTexInfo *info)
 {
-	uint8 *texture = src;
-	uint8 *tmptex = _tex1;
 	if (srcformat == GL_RGBA)
 		srcformat = GL_RGBA8;
-	uint16 destformat = srcformat;
 
 	/* We need to be initialized first! */
 	if (!_initialized) return 0;
@@ -162,21 +171,48 @@ TxFilter::filter(uint8 *src, int srcwidth, int srcheight, uint16 srcformat, uint
 
 		/* calculate checksum of source texture */
 		if (!g64crc)
-			g64crc = (uint64)(_txUtil->checksumTx(texture, srcwidth, srcheight, srcformat));
+			g64crc = (uint64)(_txUtil->checksumTx(src, srcwidth, srcheight, srcformat));
 
 		DBG_INFO(80, wst("filter: crc:%08X %08X %d x %d gfmt:%x\n"),
 				 (uint32)(g64crc >> 32), (uint32)(g64crc & 0xffffffff), srcwidth, srcheight, srcformat);
 
-#if 0 /* use hirestex to retrieve cached textures. */
-		/* check if we have it in cache */
+		collectFiltered();
+
+		/* check if we have it in cache. this is also where textures from
+		 * the cache file come from when hires textures are off. */
 		if (!(g64crc & 0xffffffff00000000) && /* we reach here only when there is no hires texture for this crc */
 				_txTexCache->get(g64crc, info)) {
 			DBG_INFO(80, wst("cache hit: %d x %d gfmt:%x\n"), info->width, info->height, info->format);
 			return 1; /* yep, we've got it */
 		}
-#endif
+
+		/* hand it to the filter thread. success without data tells the
+		 * caller to use the source for now and ask hirestex() later. */
+		if (_filterThread && queueFilter(src, srcwidth, srcheight, srcformat, g64crc)) {
+			info->data = NULL;
+			return 1;
+		}
 	}
 
+	if (!filterTexture(src, srcwidth, srcheight, srcformat, _tex1, _tex2, info))
+		return 0;
+
+	/* cache the texture. */
+	if (_cacheSize) _txTexCache->add(g64crc, info);
+
+	DBG_INFO(80, wst("filtered texture: %d x %d gfmt:%x\n"), info->width, info->height, info->format);
+
+	return 1;
+}
+
+boolean
+TxFilter::filterTexture(uint8 *src, int srcwidth, int srcheight, uint16 srcformat,
+						uint8 *tex1, uint8 *tex2, GHQTexInfo *info)
+{
+	uint8 *texture = src;
+	uint8 *tmptex = tex1;
+	uint16 destformat = srcformat;
+
 	/* Leave small textures alone because filtering makes little difference.
    * Moreover, some filters require at least 4 * 4 to work.
    * Bypass _options to do ARGB8888->16bpp if _maxbpp=16 or forced color reduction.
@@ -289,7 +325,7 @@ TxFilter::filter(uint8 *src, int srcwidth, int srcheight, uint16 srcformat, uint
 	   */
 			while (num_filters > 0) {
 
-				tmptex = (texture == _tex1) ? _tex2 : _tex1;
+				tmptex = (texture == tex1) ? tex2 : tex1;
 
 				uint8 *_texture = texture;
 				uint8 *_tmptex  = tmptex;
@@ -347,7 +383,7 @@ TxFilter::filter(uint8 *src, int srcwidth, int srcheight, uint16 srcformat, uint
 			if (destformat == GL_RGBA8) {
 				if (srcformat == GL_RGBA8 && (_maxbpp < 32 || _options & FORCE16BPP_TEX)) srcformat = GL_RGBA4;
 				if (srcformat != GL_RGBA8) {
-					tmptex = (texture == _tex1) ? _tex2 : _tex1;
+					tmptex = (texture == tex1) ? tex2 : tex1;
 					if (!_txQuantize->quantize(texture, tmptex, srcwidth, srcheight, GL_RGBA8, srcformat)) {
 						DBG_INFO(80, wst("Error: unsupported format! gfmt:%x\n"), srcformat);
 						return 0;
@@ -362,7 +398,7 @@ TxFilter::filter(uint8 *src, int srcwidth, int srcheight, uint16 srcformat, uint
 		case GL_RGBA4:
 
 			int scale = 1;
-			tmptex = (texture == _tex1) ? _tex2 : _tex1;
+			tmptex = (texture == tex1) ? tex2 : tex1;
 
 			switch (_options & ENHANCEMENT_MASK) {
 			case HQ4X_ENHANCEMENT:
@@ -417,11 +453,11 @@ TxFilter::filter(uint8 *src, int srcwidth, int srcheight, uint16 srcformat, uint
 			}
 
 			if (_options & SMOOTH_FILTER_MASK) {
-				tmptex = (texture == _tex1) ? _tex2 : _tex1;
+				tmptex = (texture == tex1) ? tex2 : tex1;
 				SmoothFilter_4444((uint16*)texture, srcwidth, srcheight, (uint16*)tmptex, (_options & SMOOTH_FILTER_MASK));
 				texture = tmptex;
 			} else if (_options & SHARP_FILTER_MASK) {
-				tmptex = (texture == _tex1) ? _tex2 : _tex1;
+				tmptex = (texture == tex1) ? tex2 : tex1;
 				SharpFilter_4444((uint16*)texture, srcwidth, srcheight, (uint16*)tmptex, (_options & SHARP_FILTER_MASK));
 				texture = tmptex;
 			}
@@ -442,14 +478,136 @@ TxFilter::filter(uint8 *src, int srcwidth, int srcheight, uint16 srcformat, uint
 	info->is_hires_tex = 0;
 	setTextureFormat(destformat, info);
 
-	/* cache the texture. */
-	if (_cacheSize) _txTexCache->add(g64crc, info);
+	return 1;
+}
 
-	DBG_INFO(80, wst("filtered texture: %d x %d gfmt:%x\n"), info->width, info->height, info->format);
+boolean
+TxFilter::queueFilter(uint8 *src, int srcwidth, int srcheight, uint16 srcformat, uint64 g64crc)
+{
+	std::lock_guard<std::mutex> lock(_jobMutex);
+
+	/* already on its way */
+	if (_pending.find(g64crc) != _pending.end())
+		return 1;
+
+	const int dataSize = _txUtil->sizeofTx(srcwidth, srcheight, srcformat);
+	if (!dataSize || _pending.size() >= MAX_FILTER_JOBS)
+		return 0;
+
+	FilterJob job;
+	job.data = (uint8*)malloc(dataSize);
+	if (!job.data)
+		return 0;
+	memcpy(job.data, src, dataSize);
+	job.crc = g64crc;
+	job.width = srcwidth;
+	job.height = srcheight;
+	job.format = srcformat;
+
+	_jobs.push_back(job);
+	_pending.insert(g64crc);
+	_jobCond.notify_one();
 
 	return 1;
 }
 
+void
+TxFilter::collectFiltered()
+{
+	std::list<FilterJob> done;
+	{
+		std::lock_guard<std::mutex> lock(_jobMutex);
+		if (_done.empty())
+			return;
+		done.swap(_done);
+		for (std::list<FilterJob>::iterator it = done.begin(); it != done.end(); ++it)
+			_pending.erase(it->crc);
+	}
+
+	for (std::list<FilterJob>::iterator it = done.begin(); it != done.end(); ++it) {
+		if (it->data) {
+			it->info.data = it->data;
+			_txTexCache->add(it->crc, &it->info);
+			free(it->data);
+		}
+	}
+}
+
+void
+TxFilter::filterThread()
+{
+	std::unique_lock<std::mutex> lock(_jobMutex);
+	while (true) {
+		while (!_quit && _jobs.empty())
+			_jobCond.wait(lock);
+		if (_quit)
+			break;
+
+		FilterJob job = _jobs.front();
+		_jobs.pop_front();
+		lock.unlock();
+
+		/* the result may be in the scratch buffers or the source itself */
+		uint8 *result = NULL;
+		if (filterTexture(job.data, job.width, job.height, job.format, _jobTex1, _jobTex2, &job.info)) {
+			const int dataSize = _txUtil->sizeofTx(job.info.width, job.info.height, job.info.format);
+			if (dataSize && (result = (uint8*)malloc(dataSize)) != NULL)
+				memcpy(result, job.info.data, dataSize);
+		}
+		free(job.data);
+		job.data = result;
+
+		lock.lock();
+		_done.push_back(job);
+	}
+}
+
+void
+TxFilter::startFilterThread()
+{
+	/* filters need their own scratch buffers, _tex1 and _tex2 are shared
+	 * with the texture caches */
+	const uint32 size = TxMemBuf::getInstance()->size_of(0);
+	_jobTex1 = (uint8*)malloc(size);
+	_jobTex2 = (uint8*)malloc(size);
+	if (!_jobTex1 || !_jobTex2) {
+		free(_jobTex1);
+		free(_jobTex2);
+		_jobTex1 = _jobTex2 = NULL;
+		return;
+	}
+
+	_quit = false;
+	_filterThread = new std::thread(&TxFilter::filterThread, this);
+}
+
+void
+TxFilter::stopFilterThread()
+{
+	if (!_filterThread)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_jobMutex);
+		_quit = true;
+	}
+	_jobCond.notify_all();
+	_filterThread->join();
+	delete _filterThread;
+	_filterThread = NULL;
+
+	for (std::list<FilterJob>::iterator it = _jobs.begin(); it != _jobs.end(); ++it) {
+		_pending.erase(it->crc);
+		free(it->data);
+	}
+	_jobs.clear();
+
+	free(_jobTex1);
+	free(_jobTex2);
+	_jobTex1 = _jobTex2 = NULL;
+}
+
+
 boolean
 TxFilter::hirestex(uint64 g64crc, uint64 r_crc64, uint16 *palette, GHQTexInfo *info)
 {
@@ -545,6 +703,7 @@ TxFilter::hirestex(uint64 g64crc, uint64 r_crc64, uint16 *palette, GHQTexInfo *i
 
 	/* check if we have it in memory cache */
 	if (_cacheSize && g64crc) {
+		collectFiltered();
 		if (_txTexCache->get(g64crc, info)) {
 			DBG_INFO(80, wst("cache hit: %d x %d gfmt:%x\n"), info->width, info->height, info->format);
 			return 1; /* yep, we've got it */
@@ -30,10 +30,27 @@
 #include "TxTexCache.h"
 #include "TxUtil.h"
 #include "TxImage.h"
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <set>
+#include <thread>
+
+/* maximum number of textures waiting for the filter thread */
+#define MAX_FILTER_JOBS 512
 
 class TxFilter
 {
 private:
+  struct FilterJob {
+    uint64 crc;
+    int width;
+    int height;
+    uint16 format;
+    uint8 *data; /* source texture, then the filtered result */
+    GHQTexInfo info;
+  };
+
   int _numcore;
 
   uint8 *_tex1;
@@ -51,7 +68,27 @@ private:
   TxUtil *_txUtil;
   TxImage *_txImage;
   boolean _initialized;
+
+  /* ASYNC_FILTER: cache misses are filtered on _filterThread and picked
+   * up from _done by the render thread, which owns the texture cache. */
+  std::thread *_filterThread;
+  std::mutex _jobMutex;
+  std::condition_variable _jobCond;
+  std::list<FilterJob> _jobs;
+  std::list<FilterJob> _done;
+  std::set<uint64> _pending;
+  bool _quit;
+  uint8 *_jobTex1;
+  uint8 *_jobTex2;
+
   void clear();
+  boolean filterTexture(uint8 *src, int srcwidth, int srcheight, uint16 srcformat,
+                        uint8 *tex1, uint8 *tex2, GHQTexInfo *info);
+  boolean queueFilter(uint8 *src, int srcwidth, int srcheight, uint16 srcformat, uint64 g64crc);
+  void collectFiltered();
+  void startFilterThread();
+  void stopFilterThread();
+  void filterThread();
 public:
   ~TxFilter();
   TxFilter(int maxwidth,
@@ -106,7 +106,7 @@ TxHiResCache::TxHiResCache(int maxwidth, int maxheight, int maxbpp, int options,
 	cachepath += wst("cache");
 	int config = _options & (HIRESTEXTURES_MASK|TILE_HIRESTEX|FORCE16BPP_HIRESTEX|GZ_HIRESTEXCACHE|LET_TEXARTISTS_FLY);
 
-	_haveCache = TxCache::load(cachepath.c_str(), filename.c_str(), config);
+	_haveCache = TxCache::open(cachepath.c_str(), filename.c_str(), config);
   }
 #endif
 
@@ -36,5 +36,7 @@
 
 /* in-memory zlib texture compression */
 #define GL_TEXFMT_GZ 0x80000000
+/* in-memory and cache file LZ4 texture compression */
+#define GL_TEXFMT_LZ4 0x40000000
 
 #endif /* __INTERNAL_H__ */
@@ -0,0 +1,206 @@
+/*
+ * Texture Filtering
+ * Version:  1.0
+ *
+ * this is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * this is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Make; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "TxLz4.h"
+#include <stdint.h>
+#include <string.h>
+
+/* format limits: minimum match, the last match has to start 12 bytes
+ * before the end and the last 5 bytes are always literals */
+#define MINMATCH   4
+#define MFLIMIT    12
+#define LASTLITERALS 5
+#define MAX_DISTANCE 65535
+#define HASH_BITS  12
+
+static inline uint32_t read32(const unsigned char *p)
+{
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static inline uint32_t hash32(uint32_t v)
+{
+	return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+static inline unsigned char * writeLength(unsigned char *op, int len)
+{
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = (unsigned char)len;
+	return op;
+}
+
+int
+txLz4Compress(const unsigned char *src, int srcLen, unsigned char *dst, int dstCap)
+{
+	int table[1 << HASH_BITS];
+	const unsigned char *ip = src;
+	const unsigned char *anchor = src;
+	const unsigned char * const iend = src + srcLen;
+	const unsigned char * const mflimit = iend - MFLIMIT;
+	const unsigned char * const matchlimit = iend - LASTLITERALS;
+	unsigned char *op = dst;
+	unsigned char * const oend = dst + dstCap;
+
+	if (srcLen < 0)
+		return 0;
+
+	if (srcLen > MFLIMIT) {
+		memset(table, 0, sizeof(table));
+		ip++;
+
+		while (ip <= mflimit) {
+			const uint32_t seq = read32(ip);
+			const uint32_t h = hash32(seq);
+			const unsigned char *ref = src + table[h];
+			table[h] = (int)(ip - src);
+
+			if (ref >= ip || ip - ref > MAX_DISTANCE || read32(ref) != seq) {
+				/* skip faster through data that does not compress */
+				ip += 1 + ((ip - anchor) >> 6);
+				continue;
+			}
+
+			const unsigned char *mp = ip + MINMATCH;
+			const unsigned char *rp = ref + MINMATCH;
+			while (mp < matchlimit && *mp == *rp) {
+				mp++;
+				rp++;
+			}
+			while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+				ip--;
+				ref--;
+			}
+
+			const int litLen = (int)(ip - anchor);
+			const int matchLen = (int)(mp - ip) - MINMATCH;
+			if (oend - op < 1 + litLen + litLen / 255 + 1 + 2 + matchLen / 255 + 1)
+				return 0;
+
+			unsigned char *token = op++;
+			if (litLen >= 15) {
+				*token = 15 << 4;
+				op = writeLength(op, litLen - 15);
+			} else
+				*token = (unsigned char)(litLen << 4);
+			memcpy(op, anchor, litLen);
+			op += litLen;
+
+			const int offset = (int)(ip - ref);
+			*op++ = (unsigned char)offset;
+			*op++ = (unsigned char)(offset >> 8);
+
+			if (matchLen >= 15) {
+				*token |= 15;
+				op = writeLength(op, matchLen - 15);
+			} else
+				*token |= (unsigned char)matchLen;
+
+			ip = anchor = mp;
+			if (ip <= mflimit)
+				table[hash32(read32(ip - 2))] = (int)(ip - 2 - src);
+		}
+	}
+
+	/* last literals */
+	const int litLen = (int)(iend - anchor);
+	if (oend - op < 1 + litLen + litLen / 255 + 1)
+		return 0;
+	if (litLen >= 15) {
+		*op++ = 15 << 4;
+		op = writeLength(op, litLen - 15);
+	} else
+		*op++ = (unsigned char)(litLen << 4);
+	memcpy(op, anchor, litLen);
+	op += litLen;
+
+	return (int)(op - dst);
+}
+
+int
+txLz4Decompress(const unsigned char *src, int srcLen, unsigned char *dst, int dstCap)
+{
+	const unsigned char *ip = src;
+	const unsigned char * const iend = src + srcLen;
+	unsigned char *op = dst;
+	unsigned char * const oend = dst + dstCap;
+
+	while (ip < iend) {
+		const unsigned int token = *ip++;
+		size_t len = token >> 4;
+		unsigned int b;
+
+		if (len == 15) {
+			do {
+				if (ip >= iend)
+					return -1;
+				b = *ip++;
+				len += b;
+			} while (b == 255);
+		}
+		if ((size_t)(iend - ip) < len || (size_t)(oend - op) < len)
+			return -1;
+		memcpy(op, ip, len);
+		op += len;
+		ip += len;
+
+		/* the last sequence has no match */
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return -1;
+		const size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - dst))
+			return -1;
+
+		len = token & 15;
+		if (len == 15) {
+			do {
+				if (ip >= iend)
+					return -1;
+				b = *ip++;
+				len += b;
+			} while (b == 255);
+		}
+		len += MINMATCH;
+		if ((size_t)(oend - op) < len)
+			return -1;
+
+		const unsigned char *match = op - offset;
+		if (offset >= len) {
+			memcpy(op, match, len);
+			op += len;
+		} else {
+			/* overlapping copy repeats the last offset bytes */
+			if (offset >= 8) {
+				for (; len >= 8; len -= 8, op += 8, match += 8)
+					memcpy(op, match, 8);
+			}
+			while (len--)
+				*op++ = *match++;
+		}
+	}
+
+	return (int)(op - dst);
+}
@@ -0,0 +1,39 @@
+/*
+ * Texture Filtering
+ * Version:  1.0
+ *
+ * this is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * this is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Make; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __TXLZ4_H__
+#define __TXLZ4_H__
+
+/* LZ4 block format codec for the texture caches. Decompression runs on
+ * every cache hit, so it is several times faster than zlib at a somewhat
+ * lower ratio. The blocks are plain LZ4 and can be checked with any LZ4
+ * implementation.
+ */
+
+/* worst case compressed size of len bytes */
+#define TXLZ4_BOUND(len) ((len) + (len) / 255 + 16)
+
+/* returns the compressed size, or 0 if it does not fit in dstCap */
+int txLz4Compress(const unsigned char *src, int srcLen, unsigned char *dst, int dstCap);
+
+/* returns the decompressed size, or -1 if src is malformed or does not
+ * fit in dstCap */
+int txLz4Decompress(const unsigned char *src, int srcLen, unsigned char *dst, int dstCap);
+
+#endif /* __TXLZ4_H__ */
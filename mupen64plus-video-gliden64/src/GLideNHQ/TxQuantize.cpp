@@ -31,6 +31,14 @@
 #include <thread>
 
 #include "TxQuantize.h"
+#include "../../../Graphics/texture_convert.h"
+
+/* Swizzle addressing an array of host 16-bit values in N64 byte order */
+#ifdef MSB_FIRST
+#define HOST_HALFWORD_SWIZZLE 0
+#else
+#define HOST_HALFWORD_SWIZZLE 1
+#endif
 
 TxQuantize::TxQuantize()
 {
@@ -91,26 +99,7 @@ const volatile unsigned char One2Eight[2] =
 void
 TxQuantize::ARGB1555_ARGB8888(uint32* src, uint32* dest, int width, int height)
 {
-	const int siz = (width * height) >> 1;
-	uint8 r, g, b, a;
-	uint32 color;
-	for (int i = 0; i < siz; ++i) {
-		color = (*src) & 0xffff;
-		r = Five2Eight[color >> 11];
-		g = Five2Eight[(color >> 6) & 0x001f];
-		b = Five2Eight[(color >> 1) & 0x001f];
-		a = One2Eight [(color     ) & 0x0001];
-		*dest = (a << 24) | (b << 16) | (g << 8) | r;
-		++dest;
-		color = (*src) >> 16;
-		r = Five2Eight[color >> 11];
-		g = Five2Eight[(color >> 6) & 0x001f];
-		b = Five2Eight[(color >> 1) & 0x001f];
-		a = One2Eight [(color     ) & 0x0001];
-		*dest = (a << 24) | (b << 16) | (g << 8) | r;
-		++dest;
-		++src;
-	}
+	tc_row_rgba5551((uint32_t*)dest, (const uint8*)src, 0, HOST_HALFWORD_SWIZZLE, width * height, 0);
 }
 
 void
@@ -214,19 +203,8 @@ TxQuantize::AI44_ARGB8888(uint32* src, uint32* dest, int width, int height)
 void
 TxQuantize::AI88_ARGB8888(uint32* src, uint32* dest, int width, int height)
 {
-	int siz = (width * height) >> 1;
-	int i;
-	for (i = 0; i < siz; i++) {
-		*dest = (*src & 0x000000ff);
-		*dest |= ((*dest << 8) | (*dest << 16));
-		*dest |= ((*src & 0x0000ff00) << 16);
-		dest++;
-		*dest = (*src & 0x00ff0000);
-		*dest |= ((*dest >> 8) | (*dest >> 16));
-		*dest |= (*src & 0xff000000);
-		dest++;
-		src++;
-	}
+	/* intensity is the low byte, so the swizzle is the opposite of 1555 */
+	tc_row_ia88((uint32_t*)dest, (const uint8*)src, 0, HOST_HALFWORD_SWIZZLE ^ 1, width * height);
 }
 
 void
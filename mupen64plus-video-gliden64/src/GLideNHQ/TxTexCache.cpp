@@ -33,6 +33,11 @@
 #include <osal_files.h>
 #include <zlib.h>
 
+/* Marks cache files whose keys are GLideN64's 64-bit texture hash. Files
+ * keyed by the CRC32 it used before have another config and are not
+ * loaded, since their keys would point at the wrong textures. */
+#define TEXCACHE_KEY_HASH64 0x00008000
+
 TxTexCache::~TxTexCache()
 {
 #if DUMP_CACHE
@@ -42,7 +47,7 @@ TxTexCache::~TxTexCache()
 		tx_wstring cachepath(_path);
 		cachepath += OSAL_DIR_SEPARATOR_STR;
 		cachepath += wst("cache");
-		int config = _options & (FILTER_MASK | ENHANCEMENT_MASK | FORCE16BPP_TEX | GZ_TEXCACHE);
+		int config = (_options & (FILTER_MASK | ENHANCEMENT_MASK | FORCE16BPP_TEX | GZ_TEXCACHE)) | TEXCACHE_KEY_HASH64;
 
 		TxCache::save(cachepath.c_str(), filename.c_str(), config);
 	}
@@ -64,9 +69,9 @@ TxTexCache::TxTexCache(int options, int cachesize, const wchar_t *path, const wc
 		tx_wstring cachepath(_path);
 		cachepath += OSAL_DIR_SEPARATOR_STR;
 		cachepath += wst("cache");
-		int config = _options & (FILTER_MASK | ENHANCEMENT_MASK | FORCE16BPP_TEX | GZ_TEXCACHE);
+		int config = (_options & (FILTER_MASK | ENHANCEMENT_MASK | FORCE16BPP_TEX | GZ_TEXCACHE)) | TEXCACHE_KEY_HASH64;
 
-		TxCache::load(cachepath.c_str(), filename.c_str(), config);
+		TxCache::open(cachepath.c_str(), filename.c_str(), config);
 	}
 #endif
 }
@@ -9,6 +9,43 @@ uint32_t RDRAMSize;
 
 bool ConfigOpen = false;
 
+#define TMEM_BLOCK_SHIFT 6
+#define TMEM_BLOCKS (sizeof(TMEM) >> TMEM_BLOCK_SHIFT)
+
+static uint64_t TMEMLoadCount = 0;
+static uint64_t TMEMLoadStamp[TMEM_BLOCKS];
+
+void TMEM_MarkLoaded(uint32_t _offset, uint32_t _bytes)
+{
+	if (_bytes == 0)
+		return;
+	++TMEMLoadCount;
+	if (_bytes >= sizeof(TMEM)) {
+		for (uint32_t i = 0; i < TMEM_BLOCKS; ++i)
+			TMEMLoadStamp[i] = TMEMLoadCount;
+		return;
+	}
+	// Loads wrap around the end of TMEM.
+	const uint32_t first = (_offset & (sizeof(TMEM) - 1)) >> TMEM_BLOCK_SHIFT;
+	const uint32_t last = ((_offset & (sizeof(TMEM) - 1)) + _bytes - 1) >> TMEM_BLOCK_SHIFT;
+	for (uint32_t i = first; i <= last; ++i)
+		TMEMLoadStamp[i & (TMEM_BLOCKS - 1)] = TMEMLoadCount;
+}
+
+uint64_t TMEM_GetLoadStamp(uint32_t _offset, uint32_t _bytes)
+{
+	uint64_t stamp = 0;
+	if (_bytes == 0)
+		return stamp;
+	const uint32_t first = _offset >> TMEM_BLOCK_SHIFT;
+	uint32_t last = (_offset + _bytes - 1) >> TMEM_BLOCK_SHIFT;
+	if (last >= TMEM_BLOCKS)
+		last = TMEM_BLOCKS - 1;
+	for (uint32_t i = first; i <= last; ++i)
+		stamp = stamp > TMEMLoadStamp[i] ? stamp : TMEMLoadStamp[i];
+	return stamp;
+}
+
 extern "C" void gles2n64_reset(void)
 {
 }
@@ -12,5 +12,11 @@ extern uint64_t TMEM[512];
 extern uint32_t RDRAMSize;
 extern bool ConfigOpen;
 
+// TMEM load tracking, in 64-byte blocks.
+// Every load into TMEM stamps the blocks it writes, so texture hashes
+// can be reused while their TMEM range has not been loaded again.
+void TMEM_MarkLoaded(uint32_t _offset, uint32_t _bytes);
+uint64_t TMEM_GetLoadStamp(uint32_t _offset, uint32_t _bytes);
+
 #endif
 
@@ -1511,6 +1511,8 @@ uint32_t TextureFilterHandler::_getConfigOptions() const
 		options |= GZ_TEXCACHE | GZ_HIRESTEXCACHE;
 	if (config.textureFilter.txSaveCache)
 		options |= (DUMP_TEXCACHE | DUMP_HIRESTEXCACHE);
+	if (config.textureFilter.txAsyncFilter)
+		options |= ASYNC_FILTER;
 	if (config.textureFilter.txHiresFullAlphaChannel)
 		options |= LET_TEXARTISTS_FLY;
 	if (config.textureFilter.txDump)
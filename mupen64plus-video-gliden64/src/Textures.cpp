@@ -13,6 +13,7 @@
 #include "gSP.h"
 #include "N64.h"
 #include "convert.h"
+#include "../../Graphics/texture_convert.h"
 #include "FrameBuffer.h"
 #include "Config.h"
 #include "GLideNHQ/Ext_TxFilter.h"
@@ -260,6 +261,88 @@ inline void GetYUV_RGBA4444(uint64_t * src, uint16_t * dst, uint16_t x)
 	*(dst++) = c;
 }
 
+// Whole-row decoders for the RGBA8888 paths, see Graphics/texture_convert.h.
+// swizzle is 4 on odd TMEM lines, matching the (i << 1) byte xor above.
+typedef void (*TexelRowFunc)(uint32_t * dst, const uint8_t * src, uint32_t swizzle, uint32_t count, const uint32_t * palette);
+
+static void RowI4(uint32_t * dst, const uint8_t * src, uint32_t swizzle, uint32_t count, const uint32_t *)
+{
+	tc_row_i4(dst, src, 0, swizzle, count);
+}
+
+static void RowI8(uint32_t * dst, const uint8_t * src, uint32_t swizzle, uint32_t count, const uint32_t *)
+{
+	tc_row_i8(dst, src, 0, swizzle, count);
+}
+
+static void RowIA44(uint32_t * dst, const uint8_t * src, uint32_t swizzle, uint32_t count, const uint32_t *)
+{
+	tc_row_ia44(dst, src, 0, swizzle, count);
+}
+
+static void RowIA88(uint32_t * dst, const uint8_t * src, uint32_t swizzle, uint32_t count, const uint32_t *)
+{
+	tc_row_ia88(dst, src, 0, swizzle, count);
+}
+
+static void RowRGBA5551(uint32_t * dst, const uint8_t * src, uint32_t swizzle, uint32_t count, const uint32_t *)
+{
+	tc_row_rgba5551(dst, src, 0, swizzle, count, 0);
+}
+
+static void RowRGBA8888(uint32_t * dst, const uint8_t * src, uint32_t swizzle, uint32_t count, const uint32_t *)
+{
+	tc_row_rgba8888(dst, src, 0, swizzle, count, 0);
+}
+
+static void RowCI4(uint32_t * dst, const uint8_t * src, uint32_t swizzle, uint32_t count, const uint32_t * palette)
+{
+	tc_row_ci4(dst, src, 0, swizzle, count, palette);
+}
+
+static void RowCI8(uint32_t * dst, const uint8_t * src, uint32_t swizzle, uint32_t count, const uint32_t * palette)
+{
+	tc_row_ci8(dst, src, 0, swizzle, count, palette);
+}
+
+// Returns the row decoder producing exactly what GetTexel would, converting
+// the TLUT into _palette for the CI formats. IA31 keeps its per-texel path:
+// it stores alpha in the red channel, which the shared decoder does not.
+static TexelRowFunc getTexelRowFunc(GetTexelFunc GetTexel, uint8_t _palNum, uint32_t * _palette)
+{
+	if (GetTexel == GetI4_RGBA8888)
+		return RowI4;
+	if (GetTexel == GetI8_RGBA8888)
+		return RowI8;
+	if (GetTexel == GetIA44_RGBA8888)
+		return RowIA44;
+	if (GetTexel == GetIA88_RGBA8888)
+		return RowIA88;
+	if (GetTexel == GetRGBA5551_RGBA8888)
+		return RowRGBA5551;
+	if (GetTexel == GetRGBA8888_RGBA8888)
+		return RowRGBA8888;
+	if (GetTexel == GetCI4RGBA_RGBA8888 || GetTexel == GetCI4IA_RGBA8888) {
+		const bool ia = GetTexel == GetCI4IA_RGBA8888;
+		for (uint32_t k = 0; k < 16; ++k) {
+			uint16_t color;
+			memcpy(&color, &TMEM[256 + (_palNum << 4) + k], sizeof(color));
+			_palette[k] = ia ? IA88_RGBA8888(color) : RGBA5551_RGBA8888(color);
+		}
+		return RowCI4;
+	}
+	if (GetTexel == GetCI8RGBA_RGBA8888 || GetTexel == GetCI8IA_RGBA8888) {
+		const bool ia = GetTexel == GetCI8IA_RGBA8888;
+		for (uint32_t k = 0; k < 256; ++k) {
+			uint16_t color;
+			memcpy(&color, &TMEM[256 + k], sizeof(color));
+			_palette[k] = ia ? IA88_RGBA8888(color) : RGBA5551_RGBA8888(color);
+		}
+		return RowCI8;
+	}
+	return NULL;
+}
+
 const struct TextureLoadParameters
 {
 	GetTexelFunc	Get16;
@@ -545,7 +628,7 @@ CachedTexture * TextureCache::_addTexture(uint32_t _crc32)
 	m_textures.emplace_front(glName);
 	Textures::iterator new_iter = m_textures.begin();
 	new_iter->crc = _crc32;
-	m_lruTextureLocations.insert(std::pair<uint32_t, Textures::iterator>(_crc32, new_iter));
+	m_lruTextureLocations.insert(_crc32, new_iter);
 	return &(*new_iter);
 }
 
@@ -771,12 +854,25 @@ void TextureCache::_loadBackground(CachedTexture *pTexture)
 	clampSClamp = pTexture->width - 1;
 	clampTClamp = pTexture->height - 1;
 
+	uint32_t palette[256];
+	TexelRowFunc decodeRow = glInternalFormat == GL_RGBA ? getTexelRowFunc(GetTexel, pTexture->palette, palette) : NULL;
+
 	j = 0;
 	for (y = 0; y < pTexture->realHeight; y++) {
 		ty = min(y, (uint32_t)clampTClamp);
 
 		pSrc = &pSwapped[bpl * ty];
 
+		if (decodeRow != NULL) {
+			// Decode up to the clamp edge, then repeat the edge texel.
+			const uint32_t rowTexels = min((uint32_t)pTexture->realWidth, (uint32_t)clampSClamp + 1);
+			decodeRow(pDest + j, pSrc, 0, rowTexels, palette);
+			for (x = rowTexels; x < pTexture->realWidth; x++)
+				pDest[j + x] = pDest[j + rowTexels - 1];
+			j += pTexture->realWidth;
+			continue;
+		}
+
 		for (x = 0; x < pTexture->realWidth; x++) {
 			tx = min(x, (uint32_t)clampSClamp);
 
@@ -792,9 +888,10 @@ void TextureCache::_loadBackground(CachedTexture *pTexture)
 			config.textureFilter.txFilterIgnoreBG == 0 &&
 			TFH.isInited()) {
 		GHQTexInfo ghqTexInfo;
-		if (txfilter_filter((uint8_t*)pDest, pTexture->realWidth, pTexture->realHeight,
-				glInternalFormat, (uint64)pTexture->crc, &ghqTexInfo) != 0 &&
-				ghqTexInfo.data != NULL) {
+		const bool bFiltered = txfilter_filter((uint8_t*)pDest, pTexture->realWidth, pTexture->realHeight,
+				glInternalFormat, (uint64)pTexture->crc, &ghqTexInfo) != 0;
+		pTexture->filterPending = bFiltered && ghqTexInfo.data == NULL;
+		if (bFiltered && ghqTexInfo.data != NULL) {
 			if (ghqTexInfo.width % 2 != 0 &&
 					ghqTexInfo.format != GL_RGBA &&
 					m_curUnpackAlignment > 1)
@@ -960,6 +1057,12 @@ void TextureCache::_getTextureDestData(CachedTexture& tmptex,
 		*pLine <<= 1;
 		for (y = 0; y < tmptex.realHeight; ++y) {
 			pSrc = &TMEM[tmptex.tMem] + *pLine * y;
+			if (glInternalFormat == GL_RGBA) {
+				// Texel pairs are stored as the bytes Y1 V Y0 U.
+				tc_row_yuv(pDest + j, (const uint8_t*)pSrc, 0, 3, tmptex.realWidth & ~1);
+				j += tmptex.realWidth & ~1;
+				continue;
+			}
 			for (x = 0; x < tmptex.realWidth / 2; x++) {
 				if (glInternalFormat == GL_RGBA) {
 					GetYUV_RGBA8888(pSrc, pDest + j, x);
@@ -972,6 +1075,40 @@ void TextureCache::_getTextureDestData(CachedTexture& tmptex,
 	} else {
 		j = 0;
       const uint32_t tMemMask = gDP.otherMode.textureLUT == G_TT_NONE ? 0x1FF : 0xFF;
+		uint32_t palette[256];
+		TexelRowFunc decodeRow = glInternalFormat == GL_RGBA ? getTexelRowFunc(GetTexel, tmptex.palette, palette) : NULL;
+		if (decodeRow != NULL) {
+			// The S wrap depends only on x: map it once, then decode each line
+			// in one call and gather through the map unless it is the identity.
+			std::vector<uint16_t> xmap(tmptex.realWidth);
+			uint32_t rowTexels = 0;
+			bool identity = true;
+			for (x = 0; x < tmptex.realWidth; ++x) {
+				tx = min(x, clampSClamp) & maskSMask;
+				if (x & mirrorSBit)
+					tx ^= maskSMask;
+				xmap[x] = tx;
+				rowTexels = max(rowTexels, (uint32_t)tx + 1);
+				identity = identity && tx == x;
+			}
+			std::vector<uint32_t> row(identity ? 0 : rowTexels);
+			for (y = 0; y < tmptex.realHeight; ++y) {
+				ty = min(y, clampTClamp) & maskTMask;
+				if (y & mirrorTBit)
+					ty ^= maskTMask;
+				const uint8_t * pRow = (const uint8_t*)&TMEM[(tmptex.tMem + *pLine * ty) & tMemMask];
+				const uint32_t swizzle = (ty & 1) << 2;
+				if (identity) {
+					decodeRow(pDest + j, pRow, swizzle, tmptex.realWidth, palette);
+					j += tmptex.realWidth;
+				} else {
+					decodeRow(row.data(), pRow, swizzle, rowTexels, palette);
+					for (x = 0; x < tmptex.realWidth; ++x)
+						pDest[j++] = row[xmap[x]];
+				}
+			}
+			return;
+		}
 		for (y = 0; y < tmptex.realHeight; ++y) {
 			ty = min(y, clampTClamp) & maskTMask;
 
@@ -1061,9 +1198,11 @@ void TextureCache::_load(uint32_t _tile, CachedTexture *_pTexture)
 				TFH.isInited())
 		{
 			GHQTexInfo ghqTexInfo;
-			if (txfilter_filter((uint8_t*)pDest, tmptex.realWidth, tmptex.realHeight,
+			const bool bFiltered = txfilter_filter((uint8_t*)pDest, tmptex.realWidth, tmptex.realHeight,
 							glInternalFormat, (uint64)_pTexture->crc,
-							&ghqTexInfo) != 0 && ghqTexInfo.data != NULL) {
+							&ghqTexInfo) != 0;
+			_pTexture->filterPending = bFiltered && ghqTexInfo.data == NULL;
+			if (bFiltered && ghqTexInfo.data != NULL) {
 #ifdef HAVE_OPENGLES2
 				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
 						ghqTexInfo.width, ghqTexInfo.height,
@@ -1136,31 +1275,90 @@ struct TextureParams
 	uint8_t size;
 };
 
+static
+uint32_t _finishHash(uint64_t _hash)
+{
+	return (uint32_t)(_hash ^ (_hash >> 32));
+}
+
+// Last hash computed for each texture unit, with everything it was
+// computed from. Reused as long as no load touched its TMEM range.
+struct TileHash
+{
+	TextureParams params;
+	uint32_t tmem;
+	uint32_t line;
+	uint32_t palette;
+	uint64_t loadStamp;
+	uint32_t crc;
+	bool valid;
+};
+
+static TileHash tileHashes[2];
+
 static
 uint32_t _calculateCRC(uint32_t t, const TextureParams & _params)
 {
-	const uint32_t line = gSP.textureTile[t]->line;
+	const gDPTile * pTile = gSP.textureTile[t];
+	const uint32_t line = pTile->line;
 	const uint32_t lineBytes = line << 3;
+	const uint32_t bytes = _params.height*lineBytes;
+	const uint32_t tmemOffset = pTile->tmem << 3;
+	const bool is32b = pTile->size == G_IM_SIZ_32b;
+
+	bool usePalette = false;
+	uint32_t palette = 0;
+	if (gDP.otherMode.textureLUT != G_TT_NONE || pTile->format == G_IM_FMT_CI) {
+		if (pTile->size == G_IM_SIZ_4b) {
+			palette = gDP.paletteCRC16[pTile->palette];
+			usePalette = true;
+		} else if (pTile->size == G_IM_SIZ_8b) {
+			palette = gDP.paletteCRC256;
+			usePalette = true;
+		}
+	}
 
-	const uint64_t *src = (uint64_t*)&TMEM[gSP.textureTile[t]->tmem];
-	uint32_t crc = 0xFFFFFFFF;
-	crc = CRC_Calculate(crc, src, _params.height*lineBytes);
-
-	if (gSP.textureTile[t]->size == G_IM_SIZ_32b) {
-		src = (uint64_t*)&TMEM[gSP.textureTile[t]->tmem + 256];
-		crc = CRC_Calculate(crc, src, _params.height*lineBytes);
+	// Ranges running past the end of TMEM hash memory outside of it,
+	// which load tracking cannot cover.
+	const uint32_t hashEnd = (is32b ? tmemOffset + 2048 : tmemOffset) + bytes;
+	const bool trackable = hashEnd <= sizeof(TMEM);
+	uint64_t loadStamp = 0;
+	if (trackable) {
+		loadStamp = TMEM_GetLoadStamp(tmemOffset, bytes);
+		if (is32b)
+			loadStamp = std::max(loadStamp, TMEM_GetLoadStamp(tmemOffset + 2048, bytes));
 	}
 
-	if (gDP.otherMode.textureLUT != G_TT_NONE || gSP.textureTile[t]->format == G_IM_FMT_CI) {
-		if (gSP.textureTile[t]->size == G_IM_SIZ_4b)
-			crc = CRC_Calculate( crc, &gDP.paletteCRC16[gSP.textureTile[t]->palette], 4 );
-		else if (gSP.textureTile[t]->size == G_IM_SIZ_8b)
-			crc = CRC_Calculate( crc, &gDP.paletteCRC256, 4 );
+	TileHash & cached = tileHashes[t];
+	if (trackable && cached.valid &&
+		cached.loadStamp == loadStamp &&
+		cached.tmem == pTile->tmem &&
+		cached.line == line &&
+		cached.palette == palette &&
+		memcmp(&cached.params, &_params, sizeof(_params)) == 0)
+		return cached.crc;
+
+	const uint64_t *src = (uint64_t*)&TMEM[pTile->tmem];
+	uint64_t hash = TextureHash64(0, src, bytes);
+
+	if (is32b) {
+		src = (uint64_t*)&TMEM[pTile->tmem + 256];
+		hash = TextureHash64(hash, src, bytes);
 	}
 
-	crc = CRC_Calculate(crc, &_params, sizeof(_params));
+	if (usePalette)
+		hash = TextureHash64(hash, &palette, sizeof(palette));
 
-	return crc;
+	hash = TextureHash64(hash, &_params, sizeof(_params));
+
+	cached.params = _params;
+	cached.tmem = pTile->tmem;
+	cached.line = line;
+	cached.palette = palette;
+	cached.loadStamp = loadStamp;
+	cached.crc = _finishHash(hash);
+	cached.valid = trackable;
+	return cached.crc;
 }
 
 void TextureCache::activateTexture(uint32_t _t, CachedTexture *_pTexture)
@@ -1254,26 +1452,58 @@ void TextureCache::activateMSDummy(uint32_t _t)
 #endif
 }
 
+void TextureCache::_loadFilteredTexture(uint32_t _t, CachedTexture *_pTexture)
+{
+	// The filter thread has not finished while the texture is not in its cache.
+	GHQTexInfo ghqTexInfo;
+	if (txfilter_hirestex((uint64)_pTexture->crc, 0, NULL, &ghqTexInfo) == 0 || ghqTexInfo.data == NULL)
+		return;
+
+	glActiveTexture(GL_TEXTURE0 + _t);
+	glBindTexture(GL_TEXTURE_2D, _pTexture->glName);
+	if (ghqTexInfo.width % 2 != 0 &&
+			ghqTexInfo.format != GL_RGBA &&
+			m_curUnpackAlignment > 1)
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+#ifdef HAVE_OPENGLES2
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+			ghqTexInfo.width, ghqTexInfo.height,
+			0, GL_RGBA, ghqTexInfo.pixel_type,
+			ghqTexInfo.data);
+#else
+	glTexImage2D(GL_TEXTURE_2D, 0, ghqTexInfo.format,
+			ghqTexInfo.width, ghqTexInfo.height,
+			0, ghqTexInfo.texture_format, ghqTexInfo.pixel_type,
+			ghqTexInfo.data);
+#endif
+	if (m_curUnpackAlignment > 1)
+		glPixelStorei(GL_UNPACK_ALIGNMENT, m_curUnpackAlignment);
+
+	m_cachedBytes -= _pTexture->textureBytes;
+	_updateCachedTexture(ghqTexInfo, _pTexture);
+	m_cachedBytes += _pTexture->textureBytes;
+	_pTexture->filterPending = false;
+}
+
 void TextureCache::_updateBackground()
 {
 	uint32_t numBytes = gSP.bgImage.width * gSP.bgImage.height << gSP.bgImage.size >> 1;
-	uint32_t crc;
-
-	crc = CRC_Calculate( 0xFFFFFFFF, &RDRAM[gSP.bgImage.address], numBytes );
+	uint64_t hash = TextureHash64(0, &RDRAM[gSP.bgImage.address], numBytes);
 
 	if (gDP.otherMode.textureLUT != G_TT_NONE || gSP.bgImage.format == G_IM_FMT_CI) {
 		if (gSP.bgImage.size == G_IM_SIZ_4b)
-			crc = CRC_Calculate( crc, &gDP.paletteCRC16[gSP.bgImage.palette], 4 );
+			hash = TextureHash64(hash, &gDP.paletteCRC16[gSP.bgImage.palette], 4);
 		else if (gSP.bgImage.size == G_IM_SIZ_8b)
-			crc = CRC_Calculate( crc, &gDP.paletteCRC256, 4 );
+			hash = TextureHash64(hash, &gDP.paletteCRC256, 4);
 	}
 
 	uint32_t params[4] = {gSP.bgImage.width, gSP.bgImage.height, gSP.bgImage.format, gSP.bgImage.size};
-	crc = CRC_Calculate(crc, params, sizeof(uint32_t)*4);
+	hash = TextureHash64(hash, params, sizeof(uint32_t)*4);
+	const uint32_t crc = _finishHash(hash);
 
-	Texture_Locations::iterator locations_iter = m_lruTextureLocations.find(crc);
-	if (locations_iter != m_lruTextureLocations.end()) {
-		Textures::iterator iter = locations_iter->second;
+	Textures::iterator * location = m_lruTextureLocations.find(crc);
+	if (location != NULL) {
+		Textures::iterator iter = *location;
 		CachedTexture & current = *iter;
 		m_textures.splice(m_textures.begin(), m_textures, iter);
 
@@ -1282,6 +1512,8 @@ void TextureCache::_updateBackground()
 		assert(current.format == gSP.bgImage.format);
 		assert(current.size == gSP.bgImage.size);
 
+		if (current.filterPending)
+			_loadFilteredTexture(0, &current);
 		activateTexture(0, &current);
 		m_hits++;
 		return;
@@ -1431,9 +1663,9 @@ void TextureCache::update(uint32_t _t)
 		return;
 	}
 
-	Texture_Locations::iterator locations_iter = m_lruTextureLocations.find(crc);
-	if (locations_iter != m_lruTextureLocations.end()) {
-		Textures::iterator iter = locations_iter->second;
+	Textures::iterator * location = m_lruTextureLocations.find(crc);
+	if (location != NULL) {
+		Textures::iterator iter = *location;
 		CachedTexture & current = *iter;
 		m_textures.splice(m_textures.begin(), m_textures, iter);
 
@@ -1450,6 +1682,8 @@ void TextureCache::update(uint32_t _t)
 		assert(current.format == gSP.textureTile[_t]->format);
 		assert(current.size == gSP.textureTile[_t]->size);
 
+		if (current.filterPending)
+			_loadFilteredTexture(_t, &current);
 		activateTexture(_t, &current);
 		m_hits++;
 		return;
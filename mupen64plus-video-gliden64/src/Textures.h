@@ -3,7 +3,9 @@
 
 #include <stdint.h>
 
+#include <list>
 #include <map>
+#include <vector>
 
 #include "CRC.h"
 #include "convert.h"
@@ -15,7 +17,7 @@ typedef uint32_t (*GetTexelFunc)( uint64_t *src, uint16_t x, uint16_t i, uint8_t
 
 struct CachedTexture
 {
-	CachedTexture(GLuint _glName) : glName(_glName), max_level(0), frameBufferTexture(fbNone) {}
+	CachedTexture(GLuint _glName) : glName(_glName), max_level(0), frameBufferTexture(fbNone), filterPending(false) {}
 
 	GLuint	glName;
 	uint32_t		crc;
@@ -45,8 +47,111 @@ struct CachedTexture
 		fbOneSample = 1,
 		fbMultiSample = 2
 	} frameBufferTexture;
+	bool filterPending;	// Uploaded unfiltered while GLideNHQ filters it
 };
 
+// Open addressing (linear probing) index from a texture hash to its
+// entry in the texture cache LRU list.
+template <typename T>
+class TextureIndex
+{
+public:
+	TextureIndex() : m_count(0), m_bits(0) {}
+
+	T * find(uint32_t _key)
+	{
+		if (m_slots.empty())
+			return NULL;
+		for (uint32_t i = _home(_key); m_slots[i].used; i = (i + 1) & _mask()) {
+			if (m_slots[i].key == _key)
+				return &m_slots[i].value;
+		}
+		return NULL;
+	}
+
+	void insert(uint32_t _key, const T & _value)
+	{
+		if ((m_count + 1) * 4 > m_slots.size() * 3)
+			_grow();
+		uint32_t i = _home(_key);
+		for (; m_slots[i].used; i = (i + 1) & _mask()) {
+			if (m_slots[i].key == _key)
+				return;
+		}
+		m_slots[i].key = _key;
+		m_slots[i].value = _value;
+		m_slots[i].used = true;
+		++m_count;
+	}
+
+	void erase(uint32_t _key)
+	{
+		if (m_slots.empty())
+			return;
+		uint32_t i = _home(_key);
+		for (; m_slots[i].used; i = (i + 1) & _mask()) {
+			if (m_slots[i].key == _key)
+				break;
+		}
+		if (!m_slots[i].used)
+			return;
+
+		// Backward shift deletion: no tombstones, probe chains stay short.
+		m_slots[i].used = false;
+		--m_count;
+		for (uint32_t j = (i + 1) & _mask(); m_slots[j].used; j = (j + 1) & _mask()) {
+			const uint32_t k = _home(m_slots[j].key);
+			const bool inPlace = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+			if (inPlace)
+				continue;
+			m_slots[i] = m_slots[j];
+			m_slots[j].used = false;
+			i = j;
+		}
+	}
+
+	void clear()
+	{
+		m_slots.clear();
+		m_count = 0;
+	}
+
+	size_t size() const { return m_count; }
+
+private:
+	struct Slot
+	{
+		Slot() : key(0), used(false) {}
+		uint32_t key;
+		bool used;
+		T value;
+	};
+
+	uint32_t _mask() const { return (uint32_t)m_slots.size() - 1; }
+
+	uint32_t _home(uint32_t _key) const
+	{
+		// Fibonacci hashing spreads keys that differ only in high bits.
+		return (_key * 2654435769U) >> (32 - m_bits) & _mask();
+	}
+
+	void _grow()
+	{
+		std::vector<Slot> old;
+		old.swap(m_slots);
+		m_bits = old.empty() ? 8 : m_bits + 1;
+		m_slots.resize(1U << m_bits);
+		m_count = 0;
+		for (typename std::vector<Slot>::const_iterator iter = old.begin(); iter != old.end(); ++iter) {
+			if (iter->used)
+				insert(iter->key, iter->value);
+		}
+	}
+
+	std::vector<Slot> m_slots;
+	size_t m_count;
+	uint32_t m_bits;
+};
 
 struct TextureCache
 {
@@ -79,13 +184,14 @@ private:
 	bool _loadHiresTexture(uint32_t _tile, CachedTexture *_pTexture, uint64_t & _ricecrc);
 	void _loadBackground(CachedTexture *pTexture);
 	bool _loadHiresBackground(CachedTexture *_pTexture);
+	void _loadFilteredTexture(uint32_t _t, CachedTexture *_pTexture);
 	void _updateBackground();
 	void _clear();
 	void _initDummyTexture(CachedTexture * _pDummy);
 	void _getTextureDestData(CachedTexture& tmptex, uint32_t* pDest, GLuint glInternalFormat, GetTexelFunc GetTexel, uint16_t* pLine);
 
 	typedef std::list<CachedTexture> Textures;
-	typedef std::map<uint32_t, Textures::iterator> Texture_Locations;
+	typedef TextureIndex<Textures::iterator> Texture_Locations;
 	typedef std::map<uint32_t, CachedTexture> FBTextures;
 	Textures m_textures;
 	Texture_Locations m_lruTextureLocations;
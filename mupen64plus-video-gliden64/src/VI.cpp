@@ -175,4 +175,7 @@ void VI_UpdateScreen()
 		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 	}
+
+	// Copies the GPU has finished reading back go to RDRAM.
+	FrameBuffer_StartCopies();
 }
@@ -370,11 +370,13 @@ void gln64gDPLoadTile(uint32_t tile, uint32_t uls, uint32_t ult, uint32_t lrs, u
 	if (CheckForFrameBufferTexture(address, bpl2*height2))
 		return;
 
-	if (gDP.loadTile->size == G_IM_SIZ_32b)
+	if (gDP.loadTile->size == G_IM_SIZ_32b) {
+		TMEM_MarkLoaded(0, sizeof(TMEM));
 		gln64gDPLoadTile32b(gDP.loadTile->uls, gDP.loadTile->ult, gDP.loadTile->lrs, gDP.loadTile->lrt);
-	else {
+	} else {
 		uint32_t tmemAddr = gDP.loadTile->tmem;
 		const uint32_t line = gDP.loadTile->line;
+		TMEM_MarkLoaded(tmemAddr << 3, height * bpl);
 		for (uint32_t y = 0; y < height; ++y) {
 			UnswapCopyWrap(gfx_info.RDRAM, address, (uint8_t*)TMEM, tmemAddr << 3, 0xFFF, bpl);
 			if (y & 1)
@@ -474,11 +476,13 @@ void gln64gDPLoadBlock(uint32_t tile, uint32_t uls, uint32_t ult, uint32_t lrs,
 	gDP.loadTile->frameBuffer = NULL;
 	CheckForFrameBufferTexture(address, bytes); // Load data to TMEM even if FB texture is found. See comment to texturedRectDepthBufferCopy
 
-	if (gDP.loadTile->size == G_IM_SIZ_32b)
+	if (gDP.loadTile->size == G_IM_SIZ_32b) {
+		TMEM_MarkLoaded(0, sizeof(TMEM));
 		gln64gDPLoadBlock32(gDP.loadTile->uls, gDP.loadTile->lrs, dxt);
-	else if (gDP.loadTile->format == G_IM_FMT_YUV)
+	} else if (gDP.loadTile->format == G_IM_FMT_YUV) {
+		TMEM_MarkLoaded(0, bytes);
 		memcpy(TMEM, &gfx_info.RDRAM[address], bytes); // HACK!
-	else {
+	} else {
 		uint32_t tmemAddr = gDP.loadTile->tmem;
 
 		if (dxt > 0) {
@@ -486,6 +490,7 @@ void gln64gDPLoadBlock(uint32_t tile, uint32_t uls, uint32_t ult, uint32_t lrs,
 			uint32_t bpl = line << 3;
 			uint32_t height = bytes / bpl;
 
+			TMEM_MarkLoaded(tmemAddr << 3, height * bpl);
 			for (uint32_t y = 0; y < height; ++y) {
 				UnswapCopyWrap(gfx_info.RDRAM, address, (uint8_t*)TMEM, tmemAddr << 3, 0xFFF, bpl);
 				if (y & 1)
@@ -493,8 +498,10 @@ void gln64gDPLoadBlock(uint32_t tile, uint32_t uls, uint32_t ult, uint32_t lrs,
 				address += bpl;
 				tmemAddr += line;
 			}
-		} else
+		} else {
+			TMEM_MarkLoaded(tmemAddr << 3, bytes);
 			UnswapCopyWrap(gfx_info.RDRAM, address, (uint8_t*)TMEM, tmemAddr << 3, 0xFFF, bytes);
+		}
 	}
 }
 
@@ -509,6 +516,7 @@ void gln64gDPLoadTLUT( uint32_t tile, uint32_t uls, uint32_t ult, uint32_t lrs,
 	uint32_t address = gDP.textureImage.address + gDP.tiles[tile].ult * gDP.textureImage.bpl + (gDP.tiles[tile].uls << gDP.textureImage.size >> 1);
 	uint16_t pal = (uint16_t)((gDP.tiles[tile].tmem - 256) >> 4);
 	uint16_t *dest = (uint16_t*)&TMEM[gDP.tiles[tile].tmem];
+	TMEM_MarkLoaded(gDP.tiles[tile].tmem << 3, count << 3);
 
 	int i = 0;
 	while (i < count) {
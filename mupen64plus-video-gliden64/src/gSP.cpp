@@ -25,6 +25,7 @@
 
 #include "../../Graphics/image_convert.h"
 #include "../../Graphics/3dmath.h"
+#include "../../Graphics/vec4f.h"
 
 using namespace std;
 
@@ -114,36 +115,14 @@ void gln64gSP4Triangles(const int32_t v00, const int32_t v01, const int32_t v02,
 
 static void gln64gSPTransformVertex_default(float vtx[4], float mtx[4][4])
 {
-	float x, y, z, w;
-	x = vtx[0];
-	y = vtx[1];
-	z = vtx[2];
-	w = vtx[3];
-
-	vtx[0] = x * mtx[0][0] + y * mtx[1][0] + z * mtx[2][0] + mtx[3][0];
-	vtx[1] = x * mtx[0][1] + y * mtx[1][1] + z * mtx[2][1] + mtx[3][1];
-	vtx[2] = x * mtx[0][2] + y * mtx[1][2] + z * mtx[2][2] + mtx[3][2];
-	vtx[3] = x * mtx[0][3] + y * mtx[1][3] + z * mtx[2][3] + mtx[3][3];
+	TransformVertex(vtx, mtx);
 }
 
 static void gln64gSPLightVertex_default(SPVertex & _vtx)
 {
 	if (!config.generalEmulation.enableHWLighting) {
 		_vtx.HWLight = 0;
-		_vtx.r = gSP.lights[gSP.numLights].r;
-		_vtx.g = gSP.lights[gSP.numLights].g;
-		_vtx.b = gSP.lights[gSP.numLights].b;
-		for (int i = 0; i < gSP.numLights; ++i){
-			float intensity = DotProduct( &_vtx.nx, &gSP.lights[i].x );
-			if (intensity < 0.0f)
-				intensity = 0.0f;
-			_vtx.r += gSP.lights[i].r * intensity;
-			_vtx.g += gSP.lights[i].g * intensity;
-			_vtx.b += gSP.lights[i].b * intensity;
-		}
-		_vtx.r = min(1.0f, _vtx.r);
-		_vtx.g = min(1.0f, _vtx.g);
-		_vtx.b = min(1.0f, _vtx.b);
+		ShadeVertex(&_vtx.r, &_vtx.nx, gSP.lights, gSP.numLights);
 	} else {
 		_vtx.HWLight = gSP.numLights;
 		_vtx.r = _vtx.nx;
@@ -271,12 +250,28 @@ static void gln64gSPBillboardVertex_default(uint32_t v, uint32_t i)
 void gln64gSPClipVertex(uint32_t v)
 {
 	SPVertex & vtx = video().getRender().getVertex(v);
-	vtx.clip = 0;
-	if (vtx.x > +vtx.w) vtx.clip |= CLIP_POSX;
-	if (vtx.x < -vtx.w) vtx.clip |= CLIP_NEGX;
-	if (vtx.y > +vtx.w) vtx.clip |= CLIP_POSY;
-	if (vtx.y < -vtx.w) vtx.clip |= CLIP_NEGY;
-	if (vtx.w < 0.01f)  vtx.clip |= CLIP_Z;
+	const float pos[4] = {vtx.x, vtx.y, vtx.z, vtx.w};
+	vtx.clip = ClipVertexFlags(pos, 0.01f);
+}
+
+static void gln64gSPTextureGenVertex(SPVertex & _vtx)
+{
+	float fLightDir[3] = {_vtx.nx, _vtx.ny, _vtx.nz};
+	float x, y;
+	if (gSP.lookatEnable) {
+		x = DotProduct(&gSP.lookat[0].x, fLightDir);
+		y = DotProduct(&gSP.lookat[1].x, fLightDir);
+	} else {
+		x = fLightDir[0];
+		y = fLightDir[1];
+	}
+	if (gSP.geometryMode & G_TEXTURE_GEN_LINEAR) {
+		_vtx.s = acosf(x) * 325.94931f;
+		_vtx.t = acosf(y) * 325.94931f;
+	} else { // G_TEXTURE_GEN
+		_vtx.s = (x + 1.0f) * 512.0f;
+		_vtx.t = (y + 1.0f) * 512.0f;
+	}
 }
 
 void gln64gSPProcessVertex(uint32_t v)
@@ -313,26 +308,337 @@ void gln64gSPProcessVertex(uint32_t v)
 		else
 			gln64gSPLightVertex(vtx);
 
-		if (GBI.isTextureGen() && (gSP.geometryMode & G_TEXTURE_GEN) != 0) {
-			float fLightDir[3] = {vtx.nx, vtx.ny, vtx.nz};
-			float x, y;
-			if (gSP.lookatEnable) {
-				x = DotProduct(&gSP.lookat[0].x, fLightDir);
-				y = DotProduct(&gSP.lookat[1].x, fLightDir);
-			} else {
-				x = fLightDir[0];
-				y = fLightDir[1];
-			}
-			if (gSP.geometryMode & G_TEXTURE_GEN_LINEAR) {
-				vtx.s = acosf(x) * 325.94931f;
-				vtx.t = acosf(y) * 325.94931f;
-			} else { // G_TEXTURE_GEN
-				vtx.s = (x + 1.0f) * 512.0f;
-				vtx.t = (y + 1.0f) * 512.0f;
-			}
+		if (GBI.isTextureGen() && (gSP.geometryMode & G_TEXTURE_GEN) != 0)
+			gln64gSPTextureGenVertex(vtx);
+	} else
+		vtx.HWLight = 0;
+}
+
+/* Batched vertex processing.
+ * Vertex loads are processed four at a time in SoA form. Every step below
+ * performs the same float operations in the same order as the per-vertex
+ * functions above, so both paths produce identical vertices as long as
+ * neither fuses multiplies and adds; the Makefile builds this file and
+ * Graphics/3dmaths.c with -ffp-contract=off, tools/vertexbatchcheck
+ * checks it. */
+
+struct SPVertex4
+{
+	vec4f x, y, z, w;
+	vec4f nx, ny, nz, pad;
+	vec4f r, g, b, a;
+	vec4f posx, posy, posz;
+	uint8_t HWLight;
+};
+
+static void gln64gSPTransformVertex4(SPVertex4 & _vtx, float mtx[4][4])
+{
+	vec4f out[4];
+	for (int i = 0; i < 4; ++i) {
+		vec4f t = vec4f_mul(_vtx.x, vec4f_set1(mtx[0][i]));
+		t = vec4f_madd(_vtx.y, vec4f_set1(mtx[1][i]), t);
+		t = vec4f_madd(_vtx.z, vec4f_set1(mtx[2][i]), t);
+		out[i] = vec4f_add(t, vec4f_set1(mtx[3][i]));
+	}
+	_vtx.x = out[0];
+	_vtx.y = out[1];
+	_vtx.z = out[2];
+	_vtx.w = out[3];
+}
+
+static void gln64gSPTransformNormalNormalize4(SPVertex4 & _vtx, float mtx[4][4])
+{
+	vec4f out[3];
+	for (int i = 0; i < 3; ++i) {
+		vec4f t = vec4f_mul(vec4f_set1(mtx[0][i]), _vtx.nx);
+		t = vec4f_madd(vec4f_set1(mtx[1][i]), _vtx.ny, t);
+		out[i] = vec4f_madd(vec4f_set1(mtx[2][i]), _vtx.nz, t);
+	}
+	vec4f len = vec4f_mul(out[0], out[0]);
+	len = vec4f_madd(out[1], out[1], len);
+	len = vec4f_madd(out[2], out[2], len);
+	const vec4f nonzero = vec4f_cmpneq(len, vec4f_set1(0.0f));
+	len = vec4f_sqrt(len);
+	_vtx.nx = vec4f_select(nonzero, vec4f_div(out[0], len), out[0]);
+	_vtx.ny = vec4f_select(nonzero, vec4f_div(out[1], len), out[1]);
+	_vtx.nz = vec4f_select(nonzero, vec4f_div(out[2], len), out[2]);
+}
+
+static INLINE vec4f gln64gSPDotNormal4(const SPVertex4 & _vtx, const SPLight & _light)
+{
+	vec4f d = vec4f_mul(_vtx.nx, vec4f_set1(_light.x));
+	d = vec4f_madd(_vtx.ny, vec4f_set1(_light.y), d);
+	return vec4f_madd(_vtx.nz, vec4f_set1(_light.z), d);
+}
+
+static INLINE vec4f gln64gSPLightDistanceCBFD4(const SPVertex4 & _vtx, const SPLight & _light)
+{
+	const vec4f vx = vec4f_sub(vec4f_mul(vec4f_add(_vtx.x, vec4f_set1(gSP.vertexCoordMod[ 8])), vec4f_set1(gSP.vertexCoordMod[12])), vec4f_set1(_light.posx));
+	const vec4f vy = vec4f_sub(vec4f_mul(vec4f_add(_vtx.y, vec4f_set1(gSP.vertexCoordMod[ 9])), vec4f_set1(gSP.vertexCoordMod[13])), vec4f_set1(_light.posy));
+	const vec4f vz = vec4f_sub(vec4f_mul(vec4f_add(_vtx.z, vec4f_set1(gSP.vertexCoordMod[10])), vec4f_set1(gSP.vertexCoordMod[14])), vec4f_set1(_light.posz));
+	const vec4f vw = vec4f_sub(vec4f_mul(vec4f_add(_vtx.w, vec4f_set1(gSP.vertexCoordMod[11])), vec4f_set1(gSP.vertexCoordMod[15])), vec4f_set1(_light.posw));
+	vec4f len = vec4f_mul(vx, vx);
+	len = vec4f_madd(vy, vy, len);
+	len = vec4f_madd(vz, vz, len);
+	len = vec4f_madd(vw, vw, len);
+	return vec4f_div(len, vec4f_set1(65536.0f));
+}
+
+static void gln64gSPLightVertex4_default(SPVertex4 & _vtx)
+{
+	if (config.generalEmulation.enableHWLighting) {
+		_vtx.HWLight = gSP.numLights;
+		_vtx.r = _vtx.nx;
+		_vtx.g = _vtx.ny;
+		_vtx.b = _vtx.nz;
+		return;
+	}
+
+	const vec4f zero = vec4f_set1(0.0f);
+	vec4f r = vec4f_set1(gSP.lights[gSP.numLights].r);
+	vec4f g = vec4f_set1(gSP.lights[gSP.numLights].g);
+	vec4f b = vec4f_set1(gSP.lights[gSP.numLights].b);
+	for (int i = 0; i < gSP.numLights; ++i) {
+		const SPLight & light = gSP.lights[i];
+		const vec4f intensity = vec4f_max(zero, gln64gSPDotNormal4(_vtx, light));
+		r = vec4f_madd(vec4f_set1(light.r), intensity, r);
+		g = vec4f_madd(vec4f_set1(light.g), intensity, g);
+		b = vec4f_madd(vec4f_set1(light.b), intensity, b);
+	}
+	const vec4f one = vec4f_set1(1.0f);
+	_vtx.r = vec4f_min(r, one);
+	_vtx.g = vec4f_min(g, one);
+	_vtx.b = vec4f_min(b, one);
+	_vtx.HWLight = 0;
+}
+
+static void gln64gSPPointLightVertex4_default(SPVertex4 & _vtx)
+{
+	const vec4f zero = vec4f_set1(0.0f);
+	const vec4f one = vec4f_set1(1.0f);
+	const vec4f scale = vec4f_set1(65535.0f);
+	vec4f r = vec4f_set1(gSP.lights[gSP.numLights].r);
+	vec4f g = vec4f_set1(gSP.lights[gSP.numLights].g);
+	vec4f b = vec4f_set1(gSP.lights[gSP.numLights].b);
+	for (int l = 0; l < gSP.numLights; ++l) {
+		const SPLight & light = gSP.lights[l];
+		const vec4f lx = vec4f_sub(vec4f_set1(light.posx), _vtx.posx);
+		const vec4f ly = vec4f_sub(vec4f_set1(light.posy), _vtx.posy);
+		const vec4f lz = vec4f_sub(vec4f_set1(light.posz), _vtx.posz);
+		vec4f len2 = vec4f_mul(lx, lx);
+		len2 = vec4f_madd(ly, ly, len2);
+		len2 = vec4f_madd(lz, lz, len2);
+		const vec4f len = vec4f_sqrt(len2);
+		vec4f at = vec4f_madd(vec4f_div(len, scale), vec4f_set1(light.la), vec4f_set1(light.ca));
+		at = vec4f_madd(vec4f_div(len2, scale), vec4f_set1(light.qa), at);
+		const vec4f intensity = vec4f_select(vec4f_cmpgt(at, zero), vec4f_div(one, at), zero);
+		const vec4f lit = vec4f_cmpgt(intensity, zero);
+		r = vec4f_select(lit, vec4f_madd(vec4f_set1(light.r), intensity, r), r);
+		g = vec4f_select(lit, vec4f_madd(vec4f_set1(light.g), intensity, g), g);
+		b = vec4f_select(lit, vec4f_madd(vec4f_set1(light.b), intensity, b), b);
+	}
+	_vtx.r = vec4f_min(one, r);
+	_vtx.g = vec4f_min(one, g);
+	_vtx.b = vec4f_min(one, b);
+	_vtx.HWLight = 0;
+}
+
+static void gln64gSPLightVertex4_CBFD(SPVertex4 & _vtx)
+{
+	const vec4f one = vec4f_set1(1.0f);
+	vec4f r = vec4f_set1(gSP.lights[gSP.numLights].r);
+	vec4f g = vec4f_set1(gSP.lights[gSP.numLights].g);
+	vec4f b = vec4f_set1(gSP.lights[gSP.numLights].b);
+	for (int l = 0; l < gSP.numLights; ++l) {
+		const SPLight & light = gSP.lights[l];
+		const vec4f len = gln64gSPLightDistanceCBFD4(_vtx, light);
+		const vec4f intensity = vec4f_min(one, vec4f_div(vec4f_set1(light.ca), len));
+		r = vec4f_madd(vec4f_set1(light.r), intensity, r);
+		g = vec4f_madd(vec4f_set1(light.g), intensity, g);
+		b = vec4f_madd(vec4f_set1(light.b), intensity, b);
+	}
+	_vtx.r = vec4f_mul(_vtx.r, vec4f_min(r, one));
+	_vtx.g = vec4f_mul(_vtx.g, vec4f_min(g, one));
+	_vtx.b = vec4f_mul(_vtx.b, vec4f_min(b, one));
+	_vtx.HWLight = 0;
+}
+
+static void gln64gSPPointLightVertex4_CBFD(SPVertex4 & _vtx)
+{
+	const vec4f zero = vec4f_set1(0.0f);
+	const vec4f one = vec4f_set1(1.0f);
+	vec4f r = vec4f_set1(gSP.lights[gSP.numLights].r);
+	vec4f g = vec4f_set1(gSP.lights[gSP.numLights].g);
+	vec4f b = vec4f_set1(gSP.lights[gSP.numLights].b);
+	for (int l = 0; l < gSP.numLights - 1; ++l) {
+		const SPLight & light = gSP.lights[l];
+		vec4f intensity = gln64gSPDotNormal4(_vtx, light);
+		const vec4f skip = vec4f_cmplt(intensity, zero);
+		if (light.ca > 0.0f) {
+			const vec4f len = gln64gSPLightDistanceCBFD4(_vtx, light);
+			const vec4f p_i = vec4f_min(one, vec4f_div(vec4f_set1(light.ca), len));
+			intensity = vec4f_mul(intensity, p_i);
+		}
+		r = vec4f_select(skip, r, vec4f_madd(vec4f_set1(light.r), intensity, r));
+		g = vec4f_select(skip, g, vec4f_madd(vec4f_set1(light.g), intensity, g));
+		b = vec4f_select(skip, b, vec4f_madd(vec4f_set1(light.b), intensity, b));
+	}
+	const SPLight & light = gSP.lights[gSP.numLights-1];
+	const vec4f intensity = gln64gSPDotNormal4(_vtx, light);
+	const vec4f lit = vec4f_cmpgt(intensity, zero);
+	r = vec4f_select(lit, vec4f_madd(vec4f_set1(light.r), intensity, r), r);
+	g = vec4f_select(lit, vec4f_madd(vec4f_set1(light.g), intensity, g), g);
+	b = vec4f_select(lit, vec4f_madd(vec4f_set1(light.b), intensity, b), b);
+
+	_vtx.r = vec4f_mul(_vtx.r, vec4f_min(r, one));
+	_vtx.g = vec4f_mul(_vtx.g, vec4f_min(g, one));
+	_vtx.b = vec4f_mul(_vtx.b, vec4f_min(b, one));
+	_vtx.HWLight = 0;
+}
+
+static void (*gln64gSPLightVertex4)(SPVertex4 & _vtx) = gln64gSPLightVertex4_default;
+static void (*gln64gSPPointLightVertex4)(SPVertex4 & _vtx) = gln64gSPPointLightVertex4_default;
+
+static void gln64gSPBillboardVertex4(SPVertex4 & _vtx, uint32_t v)
+{
+	float pos[4][4];
+	vec4f_store(pos[0], _vtx.x);
+	vec4f_store(pos[1], _vtx.y);
+	vec4f_store(pos[2], _vtx.z);
+	vec4f_store(pos[3], _vtx.w);
+
+	// Vertex 0 is the billboard origin. When it is part of this batch it is
+	// not yet written back, and it gets added to itself first.
+	float origin[4];
+	if (v == 0) {
+		for (int c = 0; c < 4; ++c)
+			origin[c] = pos[c][0] += pos[c][0];
+	} else {
+		const SPVertex & vtx0 = video().getRender().getVertex(0);
+		origin[0] = vtx0.x;
+		origin[1] = vtx0.y;
+		origin[2] = vtx0.z;
+		origin[3] = vtx0.w;
+	}
+
+	for (int c = 0; c < 4; ++c) {
+		for (int j = (v == 0 ? 1 : 0); j < 4; ++j)
+			pos[c][j] += origin[c];
+	}
+
+	_vtx.x = vec4f_load(pos[0]);
+	_vtx.y = vec4f_load(pos[1]);
+	_vtx.z = vec4f_load(pos[2]);
+	_vtx.w = vec4f_load(pos[3]);
+}
+
+static uint32_t gln64gSPClipVertex4(const SPVertex4 & _vtx, uint32_t _clip[4])
+{
+	const vec4f negw = vec4f_neg(_vtx.w);
+	const int posx = vec4f_movemask(vec4f_cmpgt(_vtx.x, _vtx.w));
+	const int negx = vec4f_movemask(vec4f_cmplt(_vtx.x, negw));
+	const int posy = vec4f_movemask(vec4f_cmpgt(_vtx.y, _vtx.w));
+	const int negy = vec4f_movemask(vec4f_cmplt(_vtx.y, negw));
+	const int clipz = vec4f_movemask(vec4f_cmplt(_vtx.w, vec4f_set1(0.01f)));
+	for (int j = 0; j < 4; ++j) {
+		uint32_t clip = 0;
+		if (posx & (1 << j)) clip |= CLIP_POSX;
+		if (negx & (1 << j)) clip |= CLIP_NEGX;
+		if (posy & (1 << j)) clip |= CLIP_POSY;
+		if (negy & (1 << j)) clip |= CLIP_NEGY;
+		if (clipz & (1 << j)) clip |= CLIP_Z;
+		_clip[j] = clip;
+	}
+	return posx | negx | posy | negy | clipz;
+}
+
+static void gln64gSPProcessVertex4(uint32_t v)
+{
+	OGLVideo & ogl = video();
+	OGLRender & render = ogl.getRender();
+	SPVertex * spVtx = &render.getVertex(v);
+
+	SPVertex4 vtx;
+	vtx.x = vec4f_load(&spVtx[0].x);
+	vtx.y = vec4f_load(&spVtx[1].x);
+	vtx.z = vec4f_load(&spVtx[2].x);
+	vtx.w = vec4f_load(&spVtx[3].x);
+	vec4f_transpose(&vtx.x, &vtx.y, &vtx.z, &vtx.w);
+	vtx.posx = vtx.x;
+	vtx.posy = vtx.y;
+	vtx.posz = vtx.z;
+
+	gln64gSPTransformVertex4(vtx, gSP.matrix.combined);
+
+	if (ogl.isAdjustScreen() && (gDP.colorImage.width > VI.width * 98 / 100)) {
+		const vec4f adjustScale = vec4f_set1(ogl.getAdjustScale());
+		vtx.x = vec4f_mul(vtx.x, adjustScale);
+		if (gSP.matrix.projection[3][2] == -1.f)
+			vtx.w = vec4f_mul(vtx.w, adjustScale);
+	}
+
+	if (gSP.viewport.vscale[0] < 0)
+		vtx.x = vec4f_neg(vtx.x);
+
+	if (gSP.matrix.billboard)
+		gln64gSPBillboardVertex4(vtx, v);
+
+	uint32_t clip[4];
+	gln64gSPClipVertex4(vtx, clip);
+
+	const bool lighting = (gSP.geometryMode & G_LIGHTING) != 0;
+	if (lighting) {
+		vtx.nx = vec4f_load(&spVtx[0].nx);
+		vtx.ny = vec4f_load(&spVtx[1].nx);
+		vtx.nz = vec4f_load(&spVtx[2].nx);
+		vtx.pad = vec4f_load(&spVtx[3].nx);
+		vec4f_transpose(&vtx.nx, &vtx.ny, &vtx.nz, &vtx.pad);
+		vtx.r = vec4f_load(&spVtx[0].r);
+		vtx.g = vec4f_load(&spVtx[1].r);
+		vtx.b = vec4f_load(&spVtx[2].r);
+		vtx.a = vec4f_load(&spVtx[3].r);
+		vec4f_transpose(&vtx.r, &vtx.g, &vtx.b, &vtx.a);
+
+		gln64gSPTransformNormalNormalize4(vtx, gSP.matrix.modelView[gSP.matrix.modelViewi]);
+		if (gSP.geometryMode & G_POINT_LIGHTING)
+			gln64gSPPointLightVertex4(vtx);
+		else
+			gln64gSPLightVertex4(vtx);
+
+		vec4f_transpose(&vtx.nx, &vtx.ny, &vtx.nz, &vtx.pad);
+		vec4f_transpose(&vtx.r, &vtx.g, &vtx.b, &vtx.a);
+		const vec4f normals[4] = { vtx.nx, vtx.ny, vtx.nz, vtx.pad };
+		const vec4f colors[4] = { vtx.r, vtx.g, vtx.b, vtx.a };
+		for (int j = 0; j < 4; ++j) {
+			vec4f_store(&spVtx[j].nx, normals[j]);
+			vec4f_store(&spVtx[j].r, colors[j]);
 		}
 	} else
 		vtx.HWLight = 0;
+
+	vec4f_transpose(&vtx.x, &vtx.y, &vtx.z, &vtx.w);
+	const vec4f positions[4] = { vtx.x, vtx.y, vtx.z, vtx.w };
+	for (int j = 0; j < 4; ++j) {
+		SPVertex & dst = spVtx[j];
+		vec4f_store(&dst.x, positions[j]);
+		dst.clip = clip[j];
+		dst.HWLight = vtx.HWLight;
+		if (lighting && GBI.isTextureGen() && (gSP.geometryMode & G_TEXTURE_GEN) != 0)
+			gln64gSPTextureGenVertex(dst);
+	}
+}
+
+void gln64gSPProcessVertexBatch(uint32_t v0, uint32_t n)
+{
+	if (gSP.changed & CHANGED_MATRIX)
+		gln64gSPCombineMatrices();
+
+	uint32_t v = v0;
+	const uint32_t end = v0 + n;
+	for (; v + 4 <= end; v += 4)
+		gln64gSPProcessVertex4(v);
+	for (; v < end; ++v)
+		gln64gSPProcessVertex(v);
 }
 
 void gln64gSPLoadUcodeEx( uint32_t uc_start, uint32_t uc_dstart, uint16_t uc_dsize )
@@ -562,9 +868,9 @@ void gln64gSPVertex( uint32_t a, uint32_t n, uint32_t v0 )
 				vtx.b = vertex->color.b * 0.0039215689f;
 				vtx.a = vertex->color.a * 0.0039215689f;
 			}
-			gln64gSPProcessVertex(v);
 			vertex++;
 		}
+		gln64gSPProcessVertexBatch(v0, n);
 	} else {
 		LOG(LOG_ERROR, "Using Vertex outside buffer v0=%i, n=%i\n", v0, n);
 	}
@@ -604,9 +910,9 @@ void gln64gSPCIVertex( uint32_t a, uint32_t n, uint32_t v0 )
 				vtx.a = color[0] * 0.0039215689f;
 			}
 
-			gln64gSPProcessVertex(v);
 			vertex++;
 		}
+		gln64gSPProcessVertexBatch(v0, n);
 	} else {
 		LOG(LOG_ERROR, "Using Vertex outside buffer v0=%i, n=%i\n", v0, n);
 	}
@@ -641,9 +947,9 @@ void gln64gSPDMAVertex( uint32_t a, uint32_t n, uint32_t v0 )
 				vtx.a = *(uint8_t*)&gfx_info.RDRAM[(address + 9) ^ 3] * 0.0039215689f;
 			}
 
-			gln64gSPProcessVertex(v);
 			address += 10;
 		}
+		gln64gSPProcessVertexBatch(v0, n);
 	} else {
 		LOG(LOG_ERROR, "Using Vertex outside buffer v0=%i, n=%i\n", v0, n);
 	}
@@ -679,9 +985,9 @@ void gln64gSPCBFDVertex( uint32_t a, uint32_t n, uint32_t v0 )
 			vtx.g = vertex->color.g * 0.0039215689f;
 			vtx.b = vertex->color.b * 0.0039215689f;
 			vtx.a = vertex->color.a * 0.0039215689f;
-			gln64gSPProcessVertex(v);
 			vertex++;
 		}
+		gln64gSPProcessVertexBatch(v0, n);
 	} else {
 		LOG(LOG_ERROR, "Using Vertex outside buffer v0=%i, n=%i\n", v0, n);
 	}
@@ -1747,8 +2053,12 @@ void gSPSetupFunctions()
 	if (GBI.getMicrocodeType() != F3DEX2CBFD) {
 		gln64gSPLightVertex       = gln64gSPLightVertex_default;
 		gln64gSPPointLightVertex  = gln64gSPPointLightVertex_default;
+		gln64gSPLightVertex4      = gln64gSPLightVertex4_default;
+		gln64gSPPointLightVertex4 = gln64gSPPointLightVertex4_default;
 		return;
 	}
 		gln64gSPLightVertex       = gln64gSPLightVertex_CBFD;
 		gln64gSPPointLightVertex  = gln64gSPPointLightVertex_CBFD;
+		gln64gSPLightVertex4      = gln64gSPLightVertex4_CBFD;
+		gln64gSPPointLightVertex4 = gln64gSPPointLightVertex4_CBFD;
 }
@@ -60,6 +60,7 @@ void gliden64_config::resetToDefaults()
 	textureFilter.txCacheCompression = 1;
 	textureFilter.txForce16bpp = 0;
 	textureFilter.txSaveCache = 1;
+	textureFilter.txAsyncFilter = 1;
 
 	//api().GetUserDataPath(textureFilter.txPath);
 	gln_wcscat(textureFilter.txPath, wst("/hires_texture"));
@@ -88,6 +88,8 @@ bool Config_SetDefault()
 	assert(res == M64ERR_SUCCESS);
 	res = ConfigSetDefaultBool(g_configVideoGliden64, "txSaveCache", config.textureFilter.txSaveCache, "Save texture cache to hard disk.");
 	assert(res == M64ERR_SUCCESS);
+	res = ConfigSetDefaultBool(g_configVideoGliden64, "txAsyncFilter", config.textureFilter.txAsyncFilter, "Filter textures in the background. Textures show unfiltered until they are done.");
+	assert(res == M64ERR_SUCCESS);
 
 	// Convert to multibyte
 	char txPath[PATH_MAX_LENGTH * 2];
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <limits>
 #include <unordered_map>
 #include <vector>
 
@@ -239,7 +240,8 @@ static void dump_framebuffer(RDP::Renderer *renderer, const char *path)
 		fprintf(stderr, "Failed to write image file: %s\n", path);
 }
 
-static void compare_framebuffer(RDP::Renderer *renderer, const char *path)
+// Returns the number of pixels which differ from the reference.
+static unsigned compare_framebuffer(RDP::Renderer *renderer, const char *path)
 {
 	Image ref_image;
 	Image image;
@@ -255,7 +257,7 @@ static void compare_framebuffer(RDP::Renderer *renderer, const char *path)
 	{
 		fprintf(stderr, "Dimension mismatch, Reference = %u x %u, Source = %u x %u.\n", ref_image.width,
 		        ref_image.height, image.width, image.height);
-		exit(1);
+		return numeric_limits<unsigned>::max();
 	}
 
 	const uint8_t *ref = ref_image.buffer.data();
@@ -285,6 +287,34 @@ static void compare_framebuffer(RDP::Renderer *renderer, const char *path)
 		}
 	}
 	fprintf(stderr, "Correct pixels: %u, Wrong pixels: %u\n", correct, wrong);
+	return wrong;
+}
+
+struct Throughput
+{
+	double primitives_per_second = 0.0;
+	double tiles_per_second = 0.0;
+};
+
+static bool read_baseline(const char *path, Throughput *throughput)
+{
+	FILE *file = fopen(path, "r");
+	if (!file)
+		return false;
+
+	bool ret = fscanf(file, "%lf %lf", &throughput->primitives_per_second, &throughput->tiles_per_second) == 2;
+	fclose(file);
+	return ret;
+}
+
+static bool write_baseline(const char *path, const Throughput &throughput)
+{
+	FILE *file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "%.1f %.1f\n", throughput.primitives_per_second, throughput.tiles_per_second);
+	return fclose(file) == 0;
 }
 
 struct CLIArguments
@@ -292,6 +322,10 @@ struct CLIArguments
 	const char *dump = nullptr;
 	const char *output = nullptr;
 	const char *compare = nullptr;
+	const char *baseline = nullptr;
+	const char *write_baseline = nullptr;
+	unsigned tolerance = 0;
+	double throughput_tolerance = 10.0;
 	bool verbose = false;
 	bool video = false;
 
@@ -301,7 +335,11 @@ struct CLIArguments
 
 static void print_help()
 {
-	fprintf(stderr, "rdp-test [dump] [--output out png] [--compare compare against other png] [--verbose]\n");
+	fprintf(stderr, "rdp-test [dump] [--output out png] [--compare compare against other png] [--verbose]\n"
+	                "         [--tolerance wrong pixels allowed by --compare]\n"
+	                "         [--baseline fail if throughput is below the one stored in file]\n"
+	                "         [--throughput-tolerance percent allowed below --baseline, default 10]\n"
+	                "         [--write-baseline store throughput in file]\n");
 }
 
 static int rdp_dump_main(RDP::Renderer *renderer, Vulkan::Device *device, int argc, char *argv[])
@@ -317,6 +355,11 @@ static int rdp_dump_main(RDP::Renderer *renderer, Vulkan::Device *device, int ar
 	cbs.add("--video", [&args](CLIParser &) { args.video = true; });
 	cbs.add("--compare", [&args](CLIParser &parser) { args.compare = parser.next_string(); });
 	cbs.add("--verbose", [&args](CLIParser &) { args.verbose = true; });
+	cbs.add("--tolerance", [&args](CLIParser &parser) { args.tolerance = parser.next_uint(); });
+	cbs.add("--baseline", [&args](CLIParser &parser) { args.baseline = parser.next_string(); });
+	cbs.add("--throughput-tolerance",
+	        [&args](CLIParser &parser) { args.throughput_tolerance = parser.next_double(); });
+	cbs.add("--write-baseline", [&args](CLIParser &parser) { args.write_baseline = parser.next_string(); });
 	cbs.add("--trace", [&args](CLIParser &parser) {
 		args.trace = true;
 		args.trace_frame = parser.next_uint();
@@ -433,9 +476,32 @@ static int rdp_dump_main(RDP::Renderer *renderer, Vulkan::Device *device, int ar
 
 	renderer->sync_full();
 	double end_time = gettime();
+	double elapsed = end_time - start_time;
 
 	fprintf(stderr, "Rendered %u lists in %.2f seconds (ms / frame: %.3f ms).\n", unsigned(dump.lists.size()),
-	        end_time - start_time, 1000.0 * (end_time - start_time) / double(dump.lists.size()));
+	        elapsed, 1000.0 * elapsed / double(dump.lists.size()));
+
+	auto &stats = renderer->get_render_stats();
+	Throughput throughput;
+	throughput.primitives_per_second = double(stats.primitives) / elapsed;
+	throughput.tiles_per_second = double(stats.tiles) / elapsed;
+	fprintf(stderr, "Primitives: %llu (%.0f / s), 8x8 tiles: %llu (%.0f / s), flushes: %llu\n",
+	        static_cast<unsigned long long>(stats.primitives), throughput.primitives_per_second,
+	        static_cast<unsigned long long>(stats.tiles), throughput.tiles_per_second,
+	        static_cast<unsigned long long>(stats.flushes));
+
+	// Collect the timestamps of every frame still in flight.
+	for (unsigned index = 0; index < device->get_num_frames(); index++)
+		device->begin_index(index);
+
+	auto &timestamps = device->get_timestamp_totals();
+	for (unsigned stage = 0; stage < timestamps.size(); stage++)
+	{
+		fprintf(stderr, "  GPU %-12s %9.3f ms (%.3f ms / frame)\n", RDP::Renderer::get_timestamp_stage_name(stage),
+		        timestamps[stage], timestamps[stage] / double(dump.lists.size()));
+	}
+
+	int ret = 0;
 
 	if (args.output && !args.video)
 	{
@@ -445,11 +511,43 @@ static int rdp_dump_main(RDP::Renderer *renderer, Vulkan::Device *device, int ar
 	if (args.compare)
 	{
 		renderer->sync_full();
-		compare_framebuffer(renderer, args.compare);
+		unsigned wrong = compare_framebuffer(renderer, args.compare);
+		if (wrong > args.tolerance)
+		{
+			fprintf(stderr, "FAIL: %u wrong pixels, %u allowed.\n", wrong, args.tolerance);
+			ret = 1;
+		}
+	}
+
+	if (args.baseline)
+	{
+		Throughput base;
+		if (!read_baseline(args.baseline, &base))
+		{
+			fprintf(stderr, "Failed to read baseline: %s\n", args.baseline);
+			ret = 1;
+		}
+		else
+		{
+			double scale = 1.0 - args.throughput_tolerance / 100.0;
+			if (throughput.primitives_per_second < base.primitives_per_second * scale ||
+			    throughput.tiles_per_second < base.tiles_per_second * scale)
+			{
+				fprintf(stderr, "FAIL: throughput below baseline (%.0f primitives / s, %.0f tiles / s).\n",
+				        base.primitives_per_second, base.tiles_per_second);
+				ret = 1;
+			}
+		}
+	}
+
+	if (args.write_baseline && !write_baseline(args.write_baseline, throughput))
+	{
+		fprintf(stderr, "Failed to write baseline: %s\n", args.write_baseline);
+		ret = 1;
 	}
 
 	fprintf(stderr, "Number of frames: %u\n", i);
-	return 0;
+	return ret;
 }
 
 int main(int argc, char *argv[])
@@ -460,7 +558,10 @@ int main(int argc, char *argv[])
 	auto vulkan_ctx = unique_ptr<Vulkan::VulkanContext>(new Vulkan::VulkanContext);
 	Vulkan::Device vulkan_dev(*vulkan_ctx, 3);
 
+	if (!vulkan_dev.set_timestamps_enabled(true))
+		fprintf(stderr, "GPU timestamps are not supported, stage timings will be missing.\n");
+
 	RDP::Renderer renderer(vulkan_dev);
 	frontend.set_renderer(&renderer, &vulkan_dev);
-	rdp_dump_main(&renderer, &vulkan_dev, argc, argv);
+	return rdp_dump_main(&renderer, &vulkan_dev, argc, argv);
 }
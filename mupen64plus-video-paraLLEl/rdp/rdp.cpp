@@ -1526,14 +1526,14 @@ void Renderer::sync_gpu_to_dram(bool blocking)
 	assert(framebuffer.color_state != FRAMEBUFFER_STALE_GPU);
 	assert(framebuffer.depth_state != FRAMEBUFFER_STALE_GPU);
 
-	fprintf(stderr, "sync_gpu_to_dram()\n");
-
+	device.write_timestamp(vulkan.cmd, -1);
 	vulkan.cmd.begin_readback();
 	if (framebuffer.color_state == FRAMEBUFFER_GPU)
 		vulkan.cmd.sync_buffer_to_cpu(vulkan.framebuffer);
 	if (framebuffer.depth_state == FRAMEBUFFER_GPU)
 		vulkan.cmd.sync_buffer_to_cpu(vulkan.framebuffer_depth);
 	vulkan.cmd.end_readback();
+	device.write_timestamp(vulkan.cmd, TIMESTAMP_READBACK);
 
 	auto sem = device.request_semaphore();
 	CommandBuffer alt_cmd;
@@ -1581,6 +1581,14 @@ void Renderer::sync_gpu_to_dram(bool blocking)
 	framebuffer.depth_state = FRAMEBUFFER_CPU;
 }
 
+const char *Renderer::get_timestamp_stage_name(unsigned stage)
+{
+	static const char *names[TIMESTAMP_STAGE_COUNT] = {
+		"Upload", "Varying", "Texture", "Combiner", "Framebuffer", "Readback",
+	};
+	return stage < TIMESTAMP_STAGE_COUNT ? names[stage] : "Unknown";
+}
+
 void Renderer::sync_full()
 {
 	// Flush out all async framebuffers and synchronize with DRAM.
@@ -1685,6 +1693,11 @@ void Renderer::flush_tile_lists()
 	fprintf(stderr, "Rejection rate: %.3f %%\n",
 	        100.0 * double(reject_tile_count) / double(reject_tile_count + raster_tile_count));
 	begin_command_buffer();
+	device.write_timestamp(vulkan.cmd, -1);
+
+	render_stats.primitives += primitive_data.size();
+	render_stats.tiles += work_data.size();
+	render_stats.flushes++;
 
 	// Allocate descriptor sets.
 	vulkan.lut_set = device.request_rdp_descriptor_set(Vulkan::RDP::DescriptorSetType::LUT);
@@ -1885,6 +1898,7 @@ void Renderer::flush_tile_lists()
 	////
 
 	vulkan.cmd.end_stream();
+	device.write_timestamp(vulkan.cmd, TIMESTAMP_UPLOAD);
 
 	struct PushConstant
 	{
@@ -1910,16 +1924,19 @@ void Renderer::flush_tile_lists()
 
 	vulkan.cmd.dispatch(tile_count, 1, 1);
 	vulkan.cmd.flush_barrier();
+	device.write_timestamp(vulkan.cmd, TIMESTAMP_VARYING);
 
 	// Texture stage.
 	vulkan.cmd.bind_pipeline(device.get_rdp_pipeline(Vulkan::RDP::PipelineType::Texture));
 	vulkan.cmd.dispatch(tile_count, 1, 1);
 	vulkan.cmd.flush_barrier();
+	device.write_timestamp(vulkan.cmd, TIMESTAMP_TEXTURE);
 
 	// Combiners + Pre-Blender for 2-cycle mode.
 	vulkan.cmd.bind_pipeline(device.get_rdp_pipeline(Vulkan::RDP::PipelineType::Combiner));
 	vulkan.cmd.dispatch(tile_count, 1, 1);
 	vulkan.cmd.flush_barrier();
+	device.write_timestamp(vulkan.cmd, TIMESTAMP_COMBINER);
 
 	// Framebuffer pipeline.
 	switch (framebuffer.pixel_size)
@@ -1948,6 +1965,7 @@ void Renderer::flush_tile_lists()
 
 	vulkan.cmd.dispatch(tiles_x, tiles_y, 1);
 	// We want to be able to overlap raster in next batch with Z/blend.
+	device.write_timestamp(vulkan.cmd, TIMESTAMP_FRAMEBUFFER);
 
 	reset_buffers();
 }
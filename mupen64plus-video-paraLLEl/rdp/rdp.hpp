@@ -155,6 +155,31 @@ public:
 
 	void begin_index(unsigned index);
 
+	struct RenderStats
+	{
+		uint64_t primitives = 0;
+		uint64_t tiles = 0;
+		uint64_t flushes = 0;
+	};
+
+	const RenderStats &get_render_stats() const
+	{
+		return render_stats;
+	}
+
+	// Stages timed with Vulkan::Device::write_timestamp() when timestamps are enabled.
+	enum TimestampStage
+	{
+		TIMESTAMP_UPLOAD,
+		TIMESTAMP_VARYING,
+		TIMESTAMP_TEXTURE,
+		TIMESTAMP_COMBINER,
+		TIMESTAMP_FRAMEBUFFER,
+		TIMESTAMP_READBACK,
+		TIMESTAMP_STAGE_COUNT
+	};
+	static const char *get_timestamp_stage_name(unsigned stage);
+
 private:
 	Vulkan::Device &device;
 
@@ -163,6 +188,8 @@ private:
 	void sync_framebuffer_to_cpu(AsyncFramebuffer &async);
 	unsigned current_sync_index = 0;
 
+	RenderStats render_stats;
+
 	struct
 	{
 		Vulkan::CommandBuffer cmd = {};
@@ -0,0 +1,80 @@
+#!/bin/sh
+# Replays every tests/*/dump.rdp with rdp-test.
+#
+#   tests/run.sh [--write-baseline] <rdp-test> <baseline dir> <test dir>...
+#
+# A test directory holds dump.rdp and optionally reference.png, the stored
+# render of the same dump to compare against. The final framebuffer has to match it
+# exactly, unless the directory also has a "tolerance" file with the number of
+# pixels allowed to differ.
+#
+# Throughput depends on the machine, so baselines are not checked in. With
+# --write-baseline the throughput of each test is stored in the baseline dir.
+# Later runs fail if a test gets more than THROUGHPUT_TOLERANCE percent
+# (default 10) slower than its stored baseline.
+#
+# Unless VK_ICD_FILENAMES is set, lavapipe is used if it is installed, so
+# results do not depend on the GPU.
+
+write=0
+if [ "$1" = "--write-baseline" ]; then
+	write=1
+	shift
+fi
+
+rdp_test="$1"
+baselines="$2"
+shift 2
+
+if [ -z "$VK_ICD_FILENAMES" ]; then
+	for icd in /usr/share/vulkan/icd.d/lvp_icd.*.json /usr/local/share/vulkan/icd.d/lvp_icd.*.json \
+		/etc/vulkan/icd.d/lvp_icd.*.json; do
+		if [ -f "$icd" ]; then
+			VK_ICD_FILENAMES="$icd"
+			export VK_ICD_FILENAMES
+			break
+		fi
+	done
+fi
+if [ -z "$VK_ICD_FILENAMES" ]; then
+	echo "lavapipe not found, using the default Vulkan driver."
+fi
+
+mkdir -p "$baselines"
+
+failed=0
+count=0
+for dir in "$@"; do
+	dir="${dir%/}"
+	name="$(basename "$dir")"
+	baseline="$baselines/$name.txt"
+	set -- "$dir/dump.rdp"
+
+	if [ -f "$dir/reference.png" ]; then
+		set -- "$@" --compare "$dir/reference.png"
+		if [ -f "$dir/tolerance" ]; then
+			set -- "$@" --tolerance "$(cat "$dir/tolerance")"
+		fi
+	fi
+
+	if [ $write -eq 1 ]; then
+		set -- "$@" --write-baseline "$baseline"
+	elif [ -f "$baseline" ]; then
+		set -- "$@" --baseline "$baseline" --throughput-tolerance "${THROUGHPUT_TOLERANCE:-10}"
+	fi
+
+	log="$baselines/$name.log"
+	if "$rdp_test" "$@" >"$log" 2>&1; then
+		result=PASS
+	else
+		result=FAIL
+		failed=$((failed + 1))
+	fi
+	count=$((count + 1))
+
+	echo "$result $name"
+	grep -E "^(Primitives|  GPU|Correct pixels|FAIL)" "$log" | sed 's/^/    /'
+done
+
+echo "$((count - failed)) / $count passed."
+[ $failed -eq 0 ]
@@ -52,7 +52,72 @@ void Device::init_per_frame(unsigned num_frames)
 			frame.descriptor_set_rdp_allocator[i].sizes = rdp.descriptor_pool_sizes[i];
 		for (unsigned i = 0; i < Blit::DescriptorSetCount; i++)
 			frame.descriptor_set_blit_allocator[i].sizes = blit.descriptor_pool_sizes[i];
+
+		if (timestamps_enabled)
+		{
+			VkQueryPoolCreateInfo query_info = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+			query_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			query_info.queryCount = MaxTimestamps;
+			V(vkCreateQueryPool(context.get_device(), &query_info, nullptr, &frame.timestamps.pool));
+		}
+	}
+}
+
+bool Device::set_timestamps_enabled(bool enable)
+{
+	if (enable && !context.get_gpu_props().limits.timestampComputeAndGraphics)
+		return false;
+
+	if (enable != timestamps_enabled)
+	{
+		unsigned frames = per_frame.size();
+		deinit_per_frame();
+		timestamps_enabled = enable;
+		init_per_frame(frames);
+	}
+
+	return true;
+}
+
+void Device::write_timestamp(CommandBuffer &cmd, int stage)
+{
+	if (!timestamps_enabled)
+		return;
+
+	auto &timestamps = per_frame[current_index].timestamps;
+	if (timestamps.stages.size() >= MaxTimestamps)
+		return;
+
+	if (timestamps.stages.empty())
+		vkCmdResetQueryPool(cmd.cmd, timestamps.pool, 0, MaxTimestamps);
+
+	vkCmdWriteTimestamp(cmd.cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps.pool, timestamps.stages.size());
+	timestamps.stages.push_back(stage);
+}
+
+void Device::collect_timestamps(PerFrame &frame)
+{
+	auto &timestamps = frame.timestamps;
+	if (timestamps.stages.empty())
+		return;
+
+	vector<uint64_t> ticks(timestamps.stages.size());
+	V(vkGetQueryPoolResults(context.get_device(), timestamps.pool, 0, ticks.size(), ticks.size() * sizeof(uint64_t),
+	                        ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+	double ms_per_tick = context.get_gpu_props().limits.timestampPeriod * 1e-6;
+	for (size_t i = 1; i < ticks.size(); i++)
+	{
+		int stage = timestamps.stages[i];
+		if (stage < 0)
+			continue;
+
+		if (unsigned(stage) >= timestamp_totals.size())
+			timestamp_totals.resize(stage + 1);
+		timestamp_totals[stage] += double(ticks[i] - ticks[i - 1]) * ms_per_tick;
 	}
+
+	timestamps.stages.clear();
 }
 
 void Device::deinit_per_frame()
@@ -93,6 +158,9 @@ void Device::deinit_per_frame()
 		for (auto &alloc : frame.descriptor_set_blit_allocator)
 			for (auto &pool : alloc.pools)
 				vkDestroyDescriptorPool(context.get_device(), pool.pool, nullptr);
+
+		if (frame.timestamps.pool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(context.get_device(), frame.timestamps.pool, nullptr);
 	}
 
 	per_frame.clear();
@@ -142,6 +210,8 @@ void Device::begin_index(unsigned index)
 	}
 	fences.count = 0;
 
+	collect_timestamps(frame);
+
 	// Semaphores are implicitly reset upon signal.
 	frame.semaphore_allocator.count = 0;
 
@@ -2,6 +2,7 @@
 #define VULKAN_UTIL_HPP
 
 #include "vulkan.hpp"
+#include <functional>
 #include <stack>
 #include <stddef.h>
 #include <vector>
@@ -126,6 +127,12 @@ struct CommandPool
 	unsigned count = 0;
 };
 
+struct TimestampPool
+{
+	VkQueryPool pool = VK_NULL_HANDLE;
+	std::vector<int> stages;
+};
+
 struct PerFrame
 {
 	FenceAllocator fence_allocator;
@@ -137,6 +144,8 @@ struct PerFrame
 	DescriptorSetAllocator descriptor_set_rdp_allocator[RDP::DescriptorSetCount];
 	DescriptorSetAllocator descriptor_set_blit_allocator[Blit::DescriptorSetCount];
 
+	TimestampPool timestamps;
+
 	std::vector<std::function<void()>> defers;
 	uint64_t frame_count = 0;
 };
@@ -422,6 +431,19 @@ public:
 	ImageHandle create_image_2d(VkFormat format, unsigned width, unsigned height);
 	ImageHandle create_image_2d_array(VkFormat format, unsigned width, unsigned height, unsigned layers);
 
+	// GPU timestamps for profiling, off by default. Returns false if the queue cannot write them.
+	bool set_timestamps_enabled(bool enable);
+
+	// A timestamp with a negative stage starts a measurement. Any other stage is charged with the time
+	// since the previous timestamp of the frame. Results are collected when the frame index comes round again.
+	void write_timestamp(CommandBuffer &cmd, int stage);
+
+	// Accumulated milliseconds per stage.
+	const std::vector<double> &get_timestamp_totals() const
+	{
+		return timestamp_totals;
+	}
+
 private:
 	const VulkanContext &context;
 	Internal::BufferAllocator cached_allocator;
@@ -459,6 +481,14 @@ private:
 	std::vector<Internal::PerFrame> per_frame;
 	unsigned current_index = 0;
 
+	enum
+	{
+		MaxTimestamps = 1024
+	};
+	bool timestamps_enabled = false;
+	std::vector<double> timestamp_totals;
+	void collect_timestamps(Internal::PerFrame &frame);
+
 	Internal::AllocatedBlock allocate_block(Internal::BufferAllocator &alloc, size_t size);
 	Internal::AllocatedMemory allocate_memory(Internal::MemoryAllocator &alloc, const VkMemoryRequirements &req);
 
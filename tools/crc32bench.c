@@ -0,0 +1,134 @@
+/* crc32bench
+ * Throughput of the shared CRC paths in libretro/crc32_accel.c against the
+ * byte-table loops they replaced, checking that every result matches.
+ *
+ * Usage: crc32bench [megabytes per size]
+ * Run with CRC32_ACCEL_DISABLE=1 to time the portable slicing tables.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "../libretro/crc32_accel.h"
+
+static uint32_t table_ieee[256];
+static uint32_t table_brumme[256];
+static uint32_t table_c[256];
+
+static void build_table(uint32_t *table, uint32_t poly)
+{
+	int i, j;
+	for (i = 0; i < 256; i++)
+	{
+		uint32_t crc = i;
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ ((crc & 1) * poly);
+		table[i] = crc;
+	}
+}
+
+static uint32_t bytewise(const uint32_t *table, uint32_t crc, const uint8_t *p, size_t len)
+{
+	while (len--)
+		crc = (crc >> 8) ^ table[(crc ^ *p++) & 0xFF];
+	return crc;
+}
+
+static uint32_t accel_brumme(uint32_t crc, const uint8_t *p, size_t len)
+{
+	size_t done = crc32_accel_update(CRC32_ACCEL_BRUMME, &crc, p, len);
+	return bytewise(table_brumme, crc, p + done, len - done);
+}
+
+static double now(void)
+{
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char **argv)
+{
+	static const size_t sizes[] = { 64, 256, 2048, 4096, 65536 };
+	size_t total = (argc > 1 ? (size_t)atoi(argv[1]) : 256) << 20;
+	uint8_t *buf = (uint8_t*)malloc(65536 + 16);
+	unsigned features = crc32_accel_features();
+	unsigned s;
+	int failed = 0;
+
+	if (!buf || total == 0)
+		return 1;
+
+	build_table(table_ieee, 0xEDB88320);
+	build_table(table_brumme, 0x04C11DB7);
+	build_table(table_c, 0x82F63B78);
+
+	srand(1);
+	for (s = 0; s < 65536 + 16; s++)
+		buf[s] = (uint8_t)rand();
+
+	printf("features:%s%s%s%s\n",
+		features & CRC32_ACCEL_HAS_PCLMUL ? " pclmul" : "",
+		features & CRC32_ACCEL_HAS_SSE42  ? " sse4.2" : "",
+		features & CRC32_ACCEL_HAS_ARMV8  ? " armv8-crc" : "",
+		features ? "" : " none");
+	printf("%8s %12s %12s %12s %12s %12s\n", "size", "table MB/s", "ieee MB/s",
+		"brumme MB/s", "crc32c MB/s", "crc32c tbl");
+
+	for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+	{
+		const size_t len = sizes[s];
+		const size_t iters = total / len;
+		uint32_t ref = 0, ieee = 0, brumme = 0, refb = 0, c = 0, refc = 0;
+		double t0, t[5];
+		size_t i;
+
+		/* offset by one byte so the unaligned head is timed too */
+		t0 = now();
+		for (i = 0; i < iters; i++)
+			ref = bytewise(table_ieee, ref, buf + 1, len);
+		t[0] = now() - t0;
+
+		t0 = now();
+		for (i = 0; i < iters; i++)
+			ieee = crc32_accel_ieee(ieee, buf + 1, len);
+		t[1] = now() - t0;
+
+		t0 = now();
+		for (i = 0; i < iters; i++)
+			brumme = accel_brumme(brumme, buf + 1, len);
+		t[2] = now() - t0;
+
+		t0 = now();
+		for (i = 0; i < iters; i++)
+			c = crc32_accel_c(c, buf + 1, len);
+		t[3] = now() - t0;
+
+		t0 = now();
+		for (i = 0; i < iters; i++)
+			refc = bytewise(table_c, refc, buf + 1, len);
+		t[4] = now() - t0;
+
+		for (i = 0; i < iters; i++)
+			refb = bytewise(table_brumme, refb, buf + 1, len);
+
+		if (ieee != ref || brumme != refb || c != refc)
+		{
+			printf("%8u MISMATCH ieee %08x/%08x brumme %08x/%08x crc32c %08x/%08x\n",
+				(unsigned)len, ieee, ref, brumme, refb, c, refc);
+			failed = 1;
+			continue;
+		}
+
+		printf("%8u %12.0f %12.0f %12.0f %12.0f %12.0f\n", (unsigned)len,
+			total / 1048576.0 / (t[0] > 0 ? t[0] : 1e-9),
+			total / 1048576.0 / (t[1] > 0 ? t[1] : 1e-9),
+			total / 1048576.0 / (t[2] > 0 ? t[2] : 1e-9),
+			total / 1048576.0 / (t[3] > 0 ? t[3] : 1e-9),
+			total / 1048576.0 / (t[4] > 0 ? t[4] : 1e-9));
+	}
+
+	free(buf);
+	return failed;
+}
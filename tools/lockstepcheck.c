@@ -0,0 +1,362 @@
+/* lockstepcheck
+ * Runs a core built with COMPARE_CORE=1 headless on a generated test ROM,
+ * so the built-in lockstep check of r4300/lockstep.c compares the cached
+ * interpreter or the dynarec against the pure interpreter.
+ *
+ * Usage: lockstepcheck [-n frames] [-c cpucore] mupen64plus_libretro.so
+ *
+ * The ROM boot code copies a loop to RDRAM and jumps to it. The loop mixes
+ * 32 and 64-bit ALU ops, multiplies and divides, loads and stores of every
+ * width, FPU ops, likely and linking branches and a JR return, over a 16 KiB
+ * buffer whose contents feed back into the next iteration. Each iteration
+ * also rewrites an instruction of a subroutine on another page, next to one
+ * that stays the same, and calls both. angrylion and the HLE RSP are
+ * selected so no GL context is needed.
+ *
+ * Fails if the core reports a divergence or compared no blocks.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <dlfcn.h>
+
+#include "api/libretro.h"
+
+#define ROM_SIZE 0x100000
+#define BOOT     0x40       /* copied to SP DMEM and run from 0xa4000040 */
+#define BODY     0x200      /* copied to RDRAM by the boot code */
+#define BODY_ADDR 0x8020    /* upper half of where */
+
+/* registers */
+enum { ZERO = 0, V0 = 2, A0 = 4, T0 = 8, T1, T2, T3, T4, T5, T6, T7,
+       S0 = 16, S1, S2, S3, S4, T8 = 24, T9, RA = 31 };
+
+#define R(rs, rt, rd, sa, fn) (((rs) << 21) | ((rt) << 16) | ((rd) << 11) | ((sa) << 6) | (fn))
+#define I(op, rs, rt, imm)    (((uint32_t)(op) << 26) | ((rs) << 21) | ((rt) << 16) | ((imm) & 0xFFFF))
+#define FR(fmt, ft, fs, fd, fn) ((17u << 26) | ((fmt) << 21) | ((ft) << 16) | ((fs) << 11) | ((fd) << 6) | (fn))
+
+#define LUI(rt, imm)        I(15, 0, rt, imm)
+#define ORI(rt, rs, imm)    I(13, rs, rt, imm)
+#define ANDI(rt, rs, imm)   I(12, rs, rt, imm)
+#define ADDIU(rt, rs, imm)  I(9, rs, rt, imm)
+#define LW(rt, off, base)   I(35, base, rt, off)
+#define LBU(rt, off, base)  I(36, base, rt, off)
+#define LD(rt, off, base)   I(55, base, rt, off)
+#define SW(rt, off, base)   I(43, base, rt, off)
+#define SB(rt, off, base)   I(40, base, rt, off)
+#define SD(rt, off, base)   I(63, base, rt, off)
+#define SWC1(ft, off, base) I(57, base, ft, off)
+#define BEQ(rs, rt, off)    I(4, rs, rt, off)
+#define BNE(rs, rt, off)    I(5, rs, rt, off)
+#define BNEL(rs, rt, off)   I(21, rs, rt, off)
+#define BGEZAL(rs, off)     I(1, rs, 17, off)
+#define NOP                 0
+#define SRA(rd, rt, sa)     R(0, rt, rd, sa, 3)
+#define JR(rs)              R(rs, 0, 0, 0, 8)
+#define JALR(rs)            R(rs, 0, RA, 0, 9)
+#define MFHI(rd)            R(0, 0, rd, 0, 16)
+#define MFLO(rd)            R(0, 0, rd, 0, 18)
+#define MULTU(rs, rt)       R(rs, rt, 0, 0, 25)
+#define DIVU(rs, rt)        R(rs, rt, 0, 0, 27)
+#define DMULTU(rs, rt)      R(rs, rt, 0, 0, 29)
+#define ADDU(rd, rs, rt)    R(rs, rt, rd, 0, 33)
+#define OR(rd, rs, rt)      R(rs, rt, rd, 0, 37)
+#define XOR(rd, rs, rt)     R(rs, rt, rd, 0, 38)
+#define SLT(rd, rs, rt)     R(rs, rt, rd, 0, 42)
+#define SLTU(rd, rs, rt)    R(rs, rt, rd, 0, 43)
+#define DADDU(rd, rs, rt)   R(rs, rt, rd, 0, 45)
+#define DSLL32(rd, rt, sa)  R(0, rt, rd, sa, 60)
+#define DSRL32(rd, rt, sa)  R(0, rt, rd, sa, 62)
+#define MTC1(rt, fs)        ((17u << 26) | (4 << 21) | ((rt) << 16) | ((fs) << 11))
+#define CVT_S_W(fd, fs)     FR(20, 0, fs, fd, 32)
+#define CVT_D_S(fd, fs)     FR(16, 0, fs, fd, 33)
+#define ADD_S(fd, fs, ft)   FR(16, ft, fs, fd, 0)
+#define MUL_S(fd, fs, ft)   FR(16, ft, fs, fd, 2)
+#define ADD_D(fd, fs, ft)   FR(17, ft, fs, fd, 0)
+
+static const uint32_t boot[] = {
+	LUI(T0, 0xA400),
+	ORI(T0, T0, BODY),
+	LUI(T1, BODY_ADDR),
+	ADDIU(T2, ZERO, 0x100),
+	/* copy: */
+	LW(T3, 0, T0),
+	SW(T3, 0, T1),
+	ADDIU(T0, T0, 4),
+	ADDIU(T2, T2, -1),
+	BNE(T2, ZERO, -5),
+	ADDIU(T1, T1, 4),
+	LUI(T0, BODY_ADDR),
+	JR(T0),
+	NOP,
+};
+
+static const uint32_t body[] = {
+	LUI(S0, 0x8010),
+	LUI(S2, 0x1234),
+	ORI(S2, S2, 0x5678),
+	LUI(S4, 0x41C6),
+	ORI(S4, S4, 0x4E6D),
+	ADDIU(S1, ZERO, 0),
+	ADDIU(S3, ZERO, 0),
+	MTC1(ZERO, 4),
+	/* two subroutines on the next page, smc: and fixed: */
+	LUI(A0, 0x8020),
+	ORI(A0, A0, 0x1000),
+	LUI(T0, JR(RA) >> 16),
+	ORI(T0, T0, JR(RA) & 0xFFFF),
+	SW(T0, 4, A0),
+	SW(T0, 16, A0),
+	LUI(T0, ADDU(S1, S1, V0) >> 16),
+	ORI(T0, T0, ADDU(S1, S1, V0) & 0xFFFF),
+	SW(T0, 8, A0),
+	LUI(T0, ADDIU(S3, S3, 1) >> 16),
+	ORI(T0, T0, ADDIU(S3, S3, 1) & 0xFFFF),
+	SW(T0, 20, A0),
+	/* loop: */
+	MULTU(S2, S4),
+	MFLO(S2),
+	ADDIU(S2, S2, 12345),
+	/* rewrite the immediate of smc: and call both */
+	ANDI(T0, S2, 0xFFFF),
+	LUI(T1, ADDIU(V0, ZERO, 0) >> 16),
+	OR(T1, T1, T0),
+	SW(T1, 0, A0),
+	JALR(A0),
+	NOP,
+	ADDIU(T0, A0, 16),
+	JALR(T0),
+	NOP,
+	ANDI(T1, S2, 0x3FF8),
+	ADDU(T2, S0, T1),
+	LD(T3, 0, T2),
+	DSLL32(T4, S2, 0),
+	DADDU(T3, T3, T4),
+	XOR(T3, T3, S1),
+	SD(T3, 0, T2),
+	LW(T5, 4, T2),
+	SRA(T6, T5, 3),
+	SLT(T7, T6, S2),
+	ADDU(S3, S3, T7),
+	ORI(T8, T1, 1),
+	DIVU(T5, T8),
+	MFHI(T9),
+	ADDU(S3, S3, T9),
+	SB(S3, 3, T2),
+	LBU(T5, 1, T2),
+	DMULTU(T3, S2),
+	MFHI(T6),
+	DSRL32(T6, T6, 4),
+	DADDU(S3, S3, T6),
+	MTC1(T5, 0),
+	CVT_S_W(2, 0),
+	ADD_S(4, 4, 2),
+	MUL_S(6, 2, 2),
+	CVT_D_S(8, 6),
+	ADD_D(10, 10, 8),
+	SWC1(4, 8, T2),
+	ANDI(T0, S2, 0x10),
+	BEQ(T0, ZERO, 2),
+	ADDIU(S1, S1, 1),
+	ADDIU(S1, S1, 3),
+	/* skip: */
+	BGEZAL(ZERO, 8),
+	NOP,
+	ANDI(T0, S2, 0x700),
+	BNEL(T0, ZERO, 1),
+	ADDIU(S1, S1, 7),
+	/* L2: */
+	BEQ(ZERO, ZERO, -50),
+	NOP,
+	NOP,
+	NOP,
+	/* sub: */
+	SLTU(V0, S3, S1),
+	ADDU(S1, S1, V0),
+	JR(RA),
+	NOP,
+};
+
+static unsigned divergences, matched;
+static const char *cpucore = "dynamic_recompiler";
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static void RETRO_CALLCONV log_printf(enum retro_log_level level, const char *fmt, ...)
+{
+	char line[1024];
+	const char *p;
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(line, sizeof(line), fmt, ap);
+	va_end(ap);
+
+	if ((p = strstr(line, "Lockstep:")) == NULL)
+		return;
+	fputs(p, stdout);
+	if (strstr(p, "divergence"))
+		divergences++;
+	sscanf(p, "Lockstep: %u blocks matched", &matched);
+}
+
+static bool environment(unsigned cmd, void *data)
+{
+	switch (cmd)
+	{
+	case RETRO_ENVIRONMENT_GET_VARIABLE:
+	{
+		struct retro_variable *var = (struct retro_variable*)data;
+
+		if (!strcmp(var->key, "mupen64-gfxplugin"))
+			var->value = "angrylion";
+		else if (!strcmp(var->key, "mupen64-rspplugin"))
+			var->value = "hle";
+		else if (!strcmp(var->key, "mupen64-cpucore"))
+			var->value = cpucore;
+		else
+			return false;
+		return true;
+	}
+	case RETRO_ENVIRONMENT_GET_LOG_INTERFACE:
+		((struct retro_log_callback*)data)->log = log_printf;
+		return true;
+	case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY:
+	case RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY:
+		*(const char**)data = ".";
+		return true;
+	case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+		return true;
+	}
+	return false;
+}
+
+static void video_refresh(const void *data, unsigned width, unsigned height, size_t pitch)
+{
+}
+
+static void audio_sample(int16_t left, int16_t right)
+{
+}
+
+static size_t audio_sample_batch(const int16_t *data, size_t frames)
+{
+	return frames;
+}
+
+static void input_poll(void)
+{
+}
+
+static int16_t input_state(unsigned port, unsigned device, unsigned index, unsigned id)
+{
+	return 0;
+}
+
+#define SYM(name) \
+	do { if (!(*(void**)&name##_fn = dlsym(core, #name))) { fprintf(stderr, "%s: no %s\n", path, #name); return 1; } } while (0)
+
+int main(int argc, char **argv)
+{
+	void (*retro_set_environment_fn)(retro_environment_t);
+	void (*retro_set_video_refresh_fn)(retro_video_refresh_t);
+	void (*retro_set_audio_sample_fn)(retro_audio_sample_t);
+	void (*retro_set_audio_sample_batch_fn)(retro_audio_sample_batch_t);
+	void (*retro_set_input_poll_fn)(retro_input_poll_t);
+	void (*retro_set_input_state_fn)(retro_input_state_t);
+	void (*retro_init_fn)(void);
+	bool (*retro_load_game_fn)(const struct retro_game_info*);
+	void (*retro_run_fn)(void);
+	void (*retro_unload_game_fn)(void);
+	void (*retro_deinit_fn)(void);
+	struct retro_game_info game;
+	const char *path = NULL;
+	unsigned frames = 120, i;
+	uint8_t *rom;
+	void *core;
+
+	for (i = 1; i < (unsigned)argc; i++)
+	{
+		if (!strcmp(argv[i], "-n") && i + 1 < (unsigned)argc)
+			frames = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-c") && i + 1 < (unsigned)argc)
+			cpucore = argv[++i];
+		else
+			path = argv[i];
+	}
+	if (!path)
+	{
+		fprintf(stderr, "usage: %s [-n frames] [-c dynamic_recompiler|cached_interpreter] mupen64plus_libretro.so\n", argv[0]);
+		return 2;
+	}
+
+	if (!(core = dlopen(path, RTLD_NOW | RTLD_LOCAL)))
+	{
+		fprintf(stderr, "%s\n", dlerror());
+		return 1;
+	}
+	SYM(retro_set_environment);
+	SYM(retro_set_video_refresh);
+	SYM(retro_set_audio_sample);
+	SYM(retro_set_audio_sample_batch);
+	SYM(retro_set_input_poll);
+	SYM(retro_set_input_state);
+	SYM(retro_init);
+	SYM(retro_load_game);
+	SYM(retro_run);
+	SYM(retro_unload_game);
+	SYM(retro_deinit);
+
+	rom = (uint8_t*)calloc(1, ROM_SIZE);
+	put_be32(rom, 0x80371240);
+	put_be32(rom + 4, 15);            /* clock rate */
+	put_be32(rom + 8, 0x80000400);    /* entry point */
+	memcpy(rom + 0x20, "LOCKSTEP CHECK      ", 20);
+	memcpy(rom + 0x3B, "NLCE", 4);
+	for (i = 0; i < sizeof(boot) / 4; i++)
+		put_be32(rom + BOOT + i * 4, boot[i]);
+	for (i = 0; i < sizeof(body) / 4; i++)
+		put_be32(rom + BODY + i * 4, body[i]);
+
+	game.path = "lockstepcheck.z64";
+	game.data = rom;
+	game.size = ROM_SIZE;
+	game.meta = NULL;
+
+	retro_set_environment_fn(environment);
+	retro_set_video_refresh_fn(video_refresh);
+	retro_set_audio_sample_fn(audio_sample);
+	retro_set_audio_sample_batch_fn(audio_sample_batch);
+	retro_set_input_poll_fn(input_poll);
+	retro_set_input_state_fn(input_state);
+	retro_init_fn();
+	if (!retro_load_game_fn(&game))
+	{
+		fprintf(stderr, "%s: could not load the test ROM\n", path);
+		return 1;
+	}
+	for (i = 0; i < frames; i++)
+		retro_run_fn();
+	retro_unload_game_fn();
+	retro_deinit_fn();
+	free(rom);
+
+	if (divergences || !matched)
+	{
+		if (!matched)
+			printf("no blocks compared, is the core built with COMPARE_CORE=1?\n");
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("ok\n");
+	return 0;
+}
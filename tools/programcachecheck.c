@@ -0,0 +1,215 @@
+/* programcachecheck
+ * Exercises the Glitch64 program cache (glide2gl/src/Glitch64/
+ * glitch64_program_cache.c) against a real GL driver through a surfaceless
+ * EGL context, which on Linux works with Mesa's llvmpipe and no display:
+ *
+ *   EGL_PLATFORM=surfaceless LIBGL_ALWAYS_SOFTWARE=1 ./programcachecheck
+ *
+ * Compiles a set of programs, stores their binaries, reopens the cache and
+ * relinks every program from its binary, then checks that a different
+ * driver string keeps only the sources, that a later entry for the same
+ * key replaces the earlier one and that a file cut short is recovered.
+ * Prints the time taken to compile and to load from binaries.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include "../glide2gl/src/Glitch64/glitch64_program_cache.h"
+
+#define PROGRAMS 32
+#define PATH     "programcachecheck.cache"
+
+static const char *vertex_source =
+	"#version 120\n"
+	"attribute vec4 aPosition;\n"
+	"varying vec4 vColor;\n"
+	"void main() { vColor = aPosition.zwxy; gl_Position = aPosition; }\n";
+
+static unsigned failures;
+
+#define CHECK(cond) do { if (!(cond)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static void fragment_source(char *buf, size_t size, int key)
+{
+	snprintf(buf, size,
+		"#version 120\n"
+		"varying vec4 vColor;\n"
+		"void main() { gl_FragColor = vColor * %d.0 + vec4(%d.0 / 255.0); }\n", key + 1, key);
+}
+
+static GLuint compile(const char *fragment)
+{
+	GLuint vs = glCreateShader(GL_VERTEX_SHADER), fs = glCreateShader(GL_FRAGMENT_SHADER);
+	GLuint program = glCreateProgram();
+
+	glShaderSource(vs, 1, &vertex_source, NULL);
+	glCompileShader(vs);
+	glShaderSource(fs, 1, &fragment, NULL);
+	glCompileShader(fs);
+	glAttachShader(program, vs);
+	glAttachShader(program, fs);
+	glBindAttribLocation(program, 0, "aPosition");
+	glLinkProgram(program);
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+	return program;
+}
+
+static int linked(GLuint program)
+{
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	return status == GL_TRUE;
+}
+
+static void add(program_cache_t *cache, int key, GLuint program, const char *source)
+{
+	GLint size = 0;
+	GLenum format = 0;
+	void *binary;
+
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+	binary = malloc(size > 0 ? size : 1);
+	if (size > 0)
+		glGetProgramBinary(program, size, &size, &format, binary);
+	CHECK(program_cache_add(cache, &key, source, format, size > 0 ? binary : NULL, size));
+	free(binary);
+}
+
+static int init_gl(char *driver, size_t size)
+{
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_display =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	EGLint attribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLDisplay display;
+	EGLContext context;
+	EGLConfig config;
+	EGLint count = 0, major, minor;
+	GLint formats = 0;
+
+	display = get_display ? get_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL)
+		: eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (!eglInitialize(display, &major, &minor) || !eglBindAPI(EGL_OPENGL_API))
+		return 0;
+	eglChooseConfig(display, attribs, &config, 1, &count);
+	context = eglCreateContext(display, count ? config : (EGLConfig)0, EGL_NO_CONTEXT, NULL);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+		return 0;
+
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	snprintf(driver, size, "%s / %s / %s", glGetString(GL_VENDOR), glGetString(GL_RENDERER),
+		glGetString(GL_VERSION));
+	printf("%s, %d binary formats\n", driver, formats);
+	return formats > 0;
+}
+
+int main(void)
+{
+	static char sources[PROGRAMS][512];
+	char driver[512];
+	program_cache_t *cache;
+	clock_t t0;
+	double t_compile, t_load;
+	long size;
+	FILE *f;
+	int i;
+
+	if (!init_gl(driver, sizeof(driver)))
+	{
+		printf("no GL context with program binaries\n");
+		return 1;
+	}
+
+	remove(PATH);
+
+	/* empty cache, fill it as the plugin does */
+	cache = program_cache_open(PATH, 1, sizeof(int), driver);
+	CHECK(cache && program_cache_count(cache) == 0);
+	t0 = clock();
+	for (i = 0; i < PROGRAMS; i++)
+	{
+		GLuint program;
+		fragment_source(sources[i], sizeof(sources[i]), i);
+		program = compile(sources[i]);
+		CHECK(linked(program));
+		add(cache, i, program, sources[i]);
+		glDeleteProgram(program);
+	}
+	glFinish();
+	t_compile = (double)(clock() - t0) / CLOCKS_PER_SEC;
+	program_cache_close(cache);
+
+	/* reopen and relink everything from the binaries */
+	cache = program_cache_open(PATH, 1, sizeof(int), driver);
+	CHECK(program_cache_count(cache) == PROGRAMS);
+	t0 = clock();
+	for (i = 0; i < (int)program_cache_count(cache); i++)
+	{
+		const struct program_cache_entry *e = program_cache_get(cache, i);
+		GLuint program = glCreateProgram();
+		int key;
+
+		memcpy(&key, e->key, sizeof(key));
+		CHECK(key == i && strcmp(e->source, sources[i]) == 0 && e->binary != NULL);
+		glProgramBinary(program, e->binary_format, e->binary, (GLsizei)e->binary_size);
+		CHECK(linked(program));
+		CHECK(glGetAttribLocation(program, "aPosition") == 0);
+		glDeleteProgram(program);
+	}
+	glFinish();
+	t_load = (double)(clock() - t0) / CLOCKS_PER_SEC;
+
+	/* a later entry for a key wins */
+	CHECK(program_cache_add(cache, &i, "replaced", 0, NULL, 0));
+	i = 3;
+	CHECK(program_cache_add(cache, &i, "replaced", 0, NULL, 0));
+	program_cache_close(cache);
+	cache = program_cache_open(PATH, 1, sizeof(int), driver);
+	CHECK(program_cache_count(cache) == PROGRAMS + 1);
+	CHECK(strcmp(program_cache_get(cache, 3)->source, "replaced") == 0);
+	CHECK(program_cache_get(cache, 3)->binary == NULL);
+	CHECK(program_cache_get(cache, 4)->binary != NULL);
+	program_cache_close(cache);
+
+	/* another driver keeps the sources only */
+	cache = program_cache_open(PATH, 1, sizeof(int), "other driver");
+	CHECK(program_cache_count(cache) == PROGRAMS + 1);
+	for (i = 0; i < (int)program_cache_count(cache); i++)
+		CHECK(program_cache_get(cache, i)->binary == NULL);
+	program_cache_close(cache);
+	cache = program_cache_open(PATH, 1, sizeof(int), "other driver");
+	CHECK(program_cache_count(cache) == PROGRAMS + 1);
+	program_cache_close(cache);
+
+	/* an entry cut short is dropped, the ones before it are kept */
+	f = fopen(PATH, "rb");
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fclose(f);
+	CHECK(truncate(PATH, size - 3) == 0);
+	cache = program_cache_open(PATH, 1, sizeof(int), "other driver");
+	CHECK(program_cache_count(cache) == PROGRAMS);
+	program_cache_close(cache);
+
+	/* another generator version drops everything */
+	cache = program_cache_open(PATH, 2, sizeof(int), "other driver");
+	CHECK(program_cache_count(cache) == 0);
+	program_cache_close(cache);
+
+	remove(PATH);
+
+	printf("%d programs: %.2f ms each to compile, %.2f ms each from binaries\n",
+		PROGRAMS, t_compile * 1e3 / PROGRAMS, t_load * 1e3 / PROGRAMS);
+	printf(failures ? "FAILED\n" : "ok\n");
+	return failures != 0;
+}
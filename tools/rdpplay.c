@@ -0,0 +1,438 @@
+/* rdpplay
+ * Plays an RDP dump (the RDPDUMP1 files written by
+ * mupen64plus-video-paraLLEl/rdp_dump.c, or by angrylion built with
+ * HAVE_RDP_DUMP) through angrylion's process_RDP_list and VI without an
+ * emulator, for measuring and checking changes to the software renderer.
+ *
+ * Usage: rdpplay [-n loops] [-novi] [-png out.png] dump.rdp
+ *
+ * Each command is handed to process_RDP_list on its own through DMEM, so
+ * the time and the pixels it covers can be put down to its command type.
+ * At every full sync the color image is hashed and, since the dump does not
+ * carry the VI registers, the VI is pointed at that color image with NTSC
+ * timing and run too. Both checksums must stay the same across changes that
+ * are not meant to alter the output.
+ *
+ * -png writes the color image left at the end of the dump the way rdp-test
+ * reads its own back, to compare with rdp-test's output and references.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#define NULL_DEVICE "NUL"
+#else
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
+#endif
+
+#include "api/libretro.h"
+#include "../mupen64plus-video-angrylion/z64.h"
+#include "../mupen64plus-video-angrylion/Gfx #1.3.h"
+#include "../mupen64plus-video-angrylion/vi.h"
+#include "../mupen64plus-video-angrylion/rdp.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../mupen64plus-video-paraLLEl/rdp/stb/stb_image_write.h"
+
+enum
+{
+	DUMP_UPDATE_DRAM = 1,
+	DUMP_BEGIN_COMMAND_LIST = 2,
+	DUMP_END_COMMAND_LIST = 3,
+	DUMP_RDP_COMMAND = 4,
+	DUMP_EOF = 5
+};
+
+#define RDRAM_SIZE 0x800000
+
+/* what the plugin otherwise gets from n64video_main.c and libretro.c */
+GFX_INFO gfx_info;
+retro_log_printf_t log_cb;
+uint32_t *blitter_buf_lock;
+RECT __src, __dst;
+INT32 pitchindwords = PRESCALE_WIDTH;
+
+static uint32_t reg_mi_intr, reg_dpc_start, reg_dpc_end, reg_dpc_current, reg_dpc_status;
+static uint32_t reg_vi_status, reg_vi_origin, reg_vi_width, reg_vi_v_sync, reg_vi_h_start, reg_vi_v_start;
+static uint32_t reg_vi_x_scale, reg_vi_y_scale, reg_unused;
+
+static void check_interrupts(void)
+{
+}
+
+static const char *command_names[64] = {
+	[0x00] = "noop",
+	[0x08] = "tri",              [0x09] = "tri z",
+	[0x0a] = "tri tex",          [0x0b] = "tri tex z",
+	[0x0c] = "tri shade",        [0x0d] = "tri shade z",
+	[0x0e] = "tri shade tex",    [0x0f] = "tri shade tex z",
+	[0x24] = "tex rect",         [0x25] = "tex rect flip",
+	[0x26] = "sync load",        [0x27] = "sync pipe",
+	[0x28] = "sync tile",        [0x29] = "sync full",
+	[0x2a] = "set key gb",       [0x2b] = "set key r",
+	[0x2c] = "set convert",      [0x2d] = "set scissor",
+	[0x2e] = "set prim depth",   [0x2f] = "set other modes",
+	[0x30] = "load tlut",        [0x32] = "set tile size",
+	[0x33] = "load block",       [0x34] = "load tile",
+	[0x35] = "set tile",         [0x36] = "fill rect",
+	[0x37] = "set fill color",   [0x38] = "set fog color",
+	[0x39] = "set blend color",  [0x3a] = "set prim color",
+	[0x3b] = "set env color",    [0x3c] = "set combine",
+	[0x3d] = "set texture image",[0x3e] = "set mask image",
+	[0x3f] = "set color image",
+};
+
+static struct
+{
+	unsigned long count;
+	uint64_t pixels;
+	double seconds;
+} stats[64];
+
+static double vi_seconds;
+static unsigned long frames;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static uint64_t fnv(uint64_t h, const uint8_t *p, size_t len)
+{
+	while (len--)
+		h = (h ^ *p++) * 0x100000001b3ull;
+	return h;
+}
+
+static uint8_t *read_file(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "rb");
+	uint8_t *data = NULL;
+	long len;
+
+	if (!f)
+		return NULL;
+	if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0)
+	{
+		data = malloc(len);
+		if (data && fread(data, 1, len, f) != (size_t)len)
+		{
+			free(data);
+			data = NULL;
+		}
+		*size = len;
+	}
+	fclose(f);
+	return data;
+}
+
+static void init_gfx_info(void)
+{
+	gfx_info.RDRAM = calloc(1, RDRAM_SIZE);
+	gfx_info.DMEM = calloc(1, 0x1000);
+	gfx_info.IMEM = calloc(1, 0x1000);
+	gfx_info.MI_INTR_REG = &reg_mi_intr;
+	gfx_info.DPC_START_REG = &reg_dpc_start;
+	gfx_info.DPC_END_REG = &reg_dpc_end;
+	gfx_info.DPC_CURRENT_REG = &reg_dpc_current;
+	gfx_info.DPC_STATUS_REG = &reg_dpc_status;
+	gfx_info.DPC_CLOCK_REG = gfx_info.DPC_BUFBUSY_REG = &reg_unused;
+	gfx_info.DPC_PIPEBUSY_REG = gfx_info.DPC_TMEM_REG = &reg_unused;
+	gfx_info.VI_STATUS_REG = &reg_vi_status;
+	gfx_info.VI_ORIGIN_REG = &reg_vi_origin;
+	gfx_info.VI_WIDTH_REG = &reg_vi_width;
+	gfx_info.VI_V_SYNC_REG = &reg_vi_v_sync;
+	gfx_info.VI_H_START_REG = &reg_vi_h_start;
+	gfx_info.VI_V_START_REG = &reg_vi_v_start;
+	gfx_info.VI_X_SCALE_REG = &reg_vi_x_scale;
+	gfx_info.VI_Y_SCALE_REG = &reg_vi_y_scale;
+	gfx_info.VI_INTR_REG = gfx_info.VI_V_CURRENT_LINE_REG = gfx_info.VI_TIMING_REG = &reg_unused;
+	gfx_info.VI_H_SYNC_REG = gfx_info.VI_LEAP_REG = gfx_info.VI_V_BURST_REG = &reg_unused;
+	gfx_info.CheckInterrupts = check_interrupts;
+	blitter_buf_lock = calloc(PRESCALE_WIDTH * PRESCALE_HEIGHT, sizeof(uint32_t));
+}
+
+/* angrylion writes its debug output to stderr, which would be timed along
+ * with the commands, so stderr goes to the null device while a dump plays;
+ * returns the descriptor to put back, -1 if it was left alone */
+static int quiet_stderr(void)
+{
+	int null, saved;
+
+	fflush(stderr);
+	null = open(NULL_DEVICE, O_WRONLY);
+	if (null < 0)
+		return -1;
+	saved = dup(fileno(stderr));
+	if (saved >= 0 && dup2(null, fileno(stderr)) < 0)
+	{
+		close(saved);
+		saved = -1;
+	}
+	close(null);
+	return saved;
+}
+
+static void restore_stderr(int saved)
+{
+	if (saved < 0)
+		return;
+	fflush(stderr);
+	dup2(saved, fileno(stderr));
+	close(saved);
+}
+
+/* one command at a time through DMEM, as the RSP would send it */
+static void run_command(unsigned command, const uint8_t *words, uint32_t count)
+{
+	const uint64_t pixels = rdp_pixel_count;
+	double t0;
+
+	memcpy(gfx_info.DMEM, words, count * 4);
+	reg_dpc_current = 0;
+	reg_dpc_end = count * 4;
+	reg_dpc_status = DP_STATUS_XBUS_DMA;
+
+	t0 = now();
+	process_RDP_list();
+	stats[command].seconds += now() - t0;
+	stats[command].pixels += rdp_pixel_count - pixels;
+	stats[command].count++;
+}
+
+/* rows down to the scissor's lower edge, a partly covered last row included */
+static uint32_t color_image_height(void)
+{
+	return ((uint32_t)__clip.yl + 3) >> 2;
+}
+
+static uint64_t hash_color_image(uint64_t h)
+{
+	const uint32_t height = color_image_height();
+	uint32_t size = (fb_width * height << fb_size) >> 1;
+
+	if (fb_address >= RDRAM_SIZE)
+		return h;
+	if (size > RDRAM_SIZE - fb_address)
+		size = RDRAM_SIZE - fb_address;
+	return fnv(h, DRAM + fb_address, size);
+}
+
+/* NTSC timing showing the current color image, 240 lines per field */
+static uint64_t scan_out(uint64_t h)
+{
+	const uint32_t height = color_image_height();
+	double t0;
+
+	reg_vi_status = 0x3118 | (fb_size == 3 ? 3 : 2);
+	reg_vi_origin = fb_address;
+	reg_vi_width = fb_width;
+	reg_vi_v_sync = 0x20d;
+	reg_vi_h_start = 0x006c02ec;
+	reg_vi_v_start = 0x002501ff;
+	reg_vi_x_scale = (fb_width * 1024) / 640;
+	reg_vi_y_scale = ((height ? height : 240) * 1024) / 240;
+
+	t0 = now();
+	rdp_update();
+	vi_seconds += now() - t0;
+	frames++;
+	return fnv(h, (const uint8_t*)blitter_buf_lock, PRESCALE_WIDTH * PRESCALE_HEIGHT * sizeof(uint32_t));
+}
+
+/* RGBA, 5 bit channels widened and 8 bit images as gray, like rdp-test */
+static int write_png(const char *path)
+{
+	const uint32_t width = fb_width, height = color_image_height();
+	const uint32_t bytes = width * height << fb_size >> 1;
+	uint8_t *image, *ptr;
+	uint32_t i;
+	int ok;
+
+	if (!width || !height || fb_address >= RDRAM_SIZE || bytes > RDRAM_SIZE - fb_address)
+		return 0;
+	image = ptr = malloc(width * height * 4);
+	if (!image)
+		return 0;
+	for (i = 0; i < width * height; i++)
+	{
+		if (fb_size == PIXEL_SIZE_32BIT)
+		{
+			const uint32_t pix = rdram[(fb_address >> 2) + i];
+			*ptr++ = pix >> 24;
+			*ptr++ = pix >> 16;
+			*ptr++ = pix >> 8;
+		}
+		else if (fb_size == PIXEL_SIZE_16BIT)
+		{
+			const uint16_t pix = rdram16[((fb_address >> 1) + i) ^ WORD_ADDR_XOR];
+			const uint8_t r = (pix >> 11) & 0x1f, g = (pix >> 6) & 0x1f, b = (pix >> 1) & 0x1f;
+			*ptr++ = (r << 3) | (r >> 2);
+			*ptr++ = (g << 3) | (g >> 2);
+			*ptr++ = (b << 3) | (b >> 2);
+		}
+		else
+		{
+			const uint8_t pix = rdram8[(fb_address + i) ^ BYTE_ADDR_XOR];
+			*ptr++ = pix;
+			*ptr++ = pix;
+			*ptr++ = pix;
+		}
+		*ptr++ = 0xff;
+	}
+	ok = stbi_write_png(path, width, height, 4, image, width * 4);
+	free(image);
+	return ok;
+}
+
+static int play(const uint8_t *p, const uint8_t *end, int vi, uint64_t *fb_hash, uint64_t *vi_hash)
+{
+	uint32_t cmd, v[3];
+
+	memset(DRAM, 0, RDRAM_SIZE);
+	rdp_init();
+	*fb_hash = *vi_hash = 0xcbf29ce484222325ull;
+
+	while (end - p >= 4)
+	{
+		memcpy(&cmd, p, 4);
+		p += 4;
+		switch (cmd)
+		{
+		case DUMP_UPDATE_DRAM:
+			if (end - p < 8)
+				return 0;
+			memcpy(v, p, 8);
+			p += 8;
+			if ((size_t)(end - p) < v[1] || v[0] > RDRAM_SIZE || v[1] > RDRAM_SIZE - v[0])
+				return 0;
+			memcpy(DRAM + v[0], p, v[1]);
+			p += v[1];
+			break;
+
+		case DUMP_BEGIN_COMMAND_LIST:
+			break;
+
+		case DUMP_END_COMMAND_LIST:
+			*fb_hash = hash_color_image(*fb_hash);
+			if (vi)
+				*vi_hash = scan_out(*vi_hash);
+			break;
+
+		case DUMP_RDP_COMMAND:
+			if (end - p < 8)
+				return 0;
+			memcpy(v, p, 8);
+			p += 8;
+			if ((size_t)(end - p) / 4 < v[1] || v[1] * 4 > 0x1000 || v[1] & 1)
+				return 0;
+			run_command(v[0] & 63, p, v[1]);
+			p += v[1] * 4;
+			break;
+
+		case DUMP_EOF:
+			return 1;
+
+		default:
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = NULL, *png = NULL;
+	uint64_t fb_hash = 0, vi_hash = 0, pixels = 0;
+	double seconds = 0.0;
+	int loops = 1, vi = 1, i, saved_stderr;
+	uint32_t dram_size;
+	uint8_t *data;
+	size_t size = 0;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			loops = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-novi"))
+			vi = 0;
+		else if (!strcmp(argv[i], "-png") && i + 1 < argc)
+			png = argv[++i];
+		else
+			path = argv[i];
+	}
+	if (!path || loops < 1)
+	{
+		printf("usage: %s [-n loops] [-novi] [-png out.png] dump.rdp\n", argv[0]);
+		return 1;
+	}
+
+	data = read_file(path, &size);
+	if (!data || size < 12 || memcmp(data, "RDPDUMP1", 8))
+	{
+		fprintf(stderr, "%s: not an RDP dump\n", path);
+		return 1;
+	}
+	memcpy(&dram_size, data + 8, 4);
+	if (dram_size > RDRAM_SIZE)
+		fprintf(stderr, "%s: %u bytes of RDRAM, only the first %u are played\n",
+			path, dram_size, RDRAM_SIZE);
+
+	init_gfx_info();
+	saved_stderr = quiet_stderr();
+	for (i = 0; i < loops; i++)
+	{
+		uint64_t h[2];
+
+		if (!play(data + 12, data + size, vi, &h[0], &h[1]))
+		{
+			restore_stderr(saved_stderr);
+			fprintf(stderr, "%s: truncated or corrupt dump\n", path);
+			return 1;
+		}
+		if (i && (h[0] != fb_hash || h[1] != vi_hash))
+			printf("loop %d gave different checksums\n", i);
+		fb_hash = h[0];
+		vi_hash = h[1];
+	}
+	restore_stderr(saved_stderr);
+
+	printf("%-18s %10s %12s %10s %10s\n", "command", "count", "pixels", "ms", "Mpixels/s");
+	for (i = 0; i < 64; i++)
+	{
+		if (!stats[i].count)
+			continue;
+		printf("%-18s %10lu %12llu %10.2f", command_names[i] ? command_names[i] : "invalid",
+			stats[i].count / loops, (unsigned long long)(stats[i].pixels / loops),
+			stats[i].seconds * 1e3 / loops);
+		if (stats[i].pixels)
+			printf(" %10.2f", stats[i].pixels / stats[i].seconds * 1e-6);
+		printf("\n");
+		pixels += stats[i].pixels;
+		seconds += stats[i].seconds;
+	}
+	printf("%-18s %10s %12llu %10.2f %10.2f\n", "total", "",
+		(unsigned long long)(pixels / loops), seconds * 1e3 / loops,
+		seconds > 0.0 ? pixels / seconds * 1e-6 : 0.0);
+	if (vi)
+		printf("vi: %lu frames, %.2f ms each\n", frames / loops,
+			frames ? vi_seconds * 1e3 / frames : 0.0);
+	printf("framebuffer checksum %016llx\n", (unsigned long long)fb_hash);
+	if (vi)
+		printf("vi checksum          %016llx\n", (unsigned long long)vi_hash);
+	free(data);
+	if (png && !write_png(png))
+	{
+		fprintf(stderr, "%s: could not write the color image\n", png);
+		return 1;
+	}
+	return 0;
+}
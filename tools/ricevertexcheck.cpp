@@ -0,0 +1,255 @@
+/* ricevertexcheck
+ * Checks the four-at-a-time vertex stages of the Rice plugin bit for bit
+ * against the one-vertex ones: every ProcessVertexData variant (plain,
+ * DKR, Conker and Rogue Squadron) runs on random RDRAM contents, matrices,
+ * lights and render states with status.isSIMDEnabled off and then on, and
+ * everything the load leaves behind is compared. Loads have 1 to 32
+ * vertices, so partial groups of 1 to 3 as well, and cover lighting, fog,
+ * texgen, primitive depth, flat shading, the DKR billboard base and the
+ * Zelda MM point lights.
+ *
+ * RenderBase.cpp is built into the check; the rest of the plugin is left
+ * out, so only what the vertex loads read is defined here.
+ */
+
+#include "../gles2rice/src/RenderBase.cpp"
+
+#define ROUNDS 50000
+#define RDRAM_SIZE 0x10000
+
+GlobalOptions options;
+GameSetting g_curRomInfo;
+PluginStatus status;
+GFX_INFO gfx_info;
+FiddledVtx * g_pVtxBase;
+uint32_t dwConkerVtxZAddr;
+XMATRIX reverseXY;
+XMATRIX reverseY;
+struct gSPInfo gSP;
+
+enum { PLAIN, DKR, CONKER, ROGUE };
+static const char *variants[] = { "plain", "DKR", "Conker", "Rogue Squadron" };
+
+static unsigned failures;
+
+static uint32_t seed = 1;
+
+static uint32_t urand(uint32_t n)
+{
+    seed = seed * 1664525 + 1013904223;
+    return (seed >> 8) % n;
+}
+
+static float frand(float scale)
+{
+    seed = seed * 1664525 + 1013904223;
+    return ((float)(seed >> 8) / 8388608.0f - 1.0f) * scale;
+}
+
+static void rand_matrix(Matrix &m, float scale)
+{
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++)
+            m.m[i][j] = frand(scale);
+    /* now and then a w row that puts vertices behind the camera */
+    if (urand(4) == 0)
+        m._44 = -m._44;
+}
+
+static void rand_state(void)
+{
+    static const HACK_FOR_GAMES hacks[] = { NO_HACK_FOR_GAME, HACK_FOR_ZELDA_MM, HACK_FOR_NASCAR };
+
+    rand_matrix(gRSPworldProject, 2.0f);
+    rand_matrix(gRSPmodelViewTop, 2.0f);
+    for (int i = 0; i < 4; i++)
+        rand_matrix(gRSP.DKRMatrixes[i], 2.0f);
+    gRSP.bMatrixIsUpdated = false;
+    gRSP.bCombinedMatrixIsUpdated = false;
+
+    gRSP.bLightingEnable = urand(4) != 0;
+    gRSP.bFogEnabled = urand(2) != 0;
+    gRSP.bTextureGen = urand(4) == 0;
+    gRSP.ucode = (int)urand(7);
+    gSP.geometryMode = (urand(2) ? G_FOG : 0) | (urand(4) ? G_SHADE : 0) | (urand(2) ? G_TEXTURE_GEN_LINEAR : 0);
+
+    gSP.numLights = (int32_t)urand(8);
+    for (int l = 0; l <= gSP.numLights; l++)
+    {
+        XVECTOR3 dir(frand(1.0f), frand(1.0f), frand(1.0f));
+        float len = sqrtf(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+
+        /* point lights keep a position, directional ones a direction */
+        gRSPlights[l].range = urand(3) == 0 ? frand(100.0f) + 200.0f : 0.0f;
+        if (gRSPlights[l].range != 0.0f)
+        {
+            gRSPlights[l].x = frand(2000.0f);
+            gRSPlights[l].y = frand(2000.0f);
+            gRSPlights[l].z = frand(2000.0f);
+        }
+        else
+        {
+            gRSPlights[l].x = dir.x / len;
+            gRSPlights[l].y = dir.y / len;
+            gRSPlights[l].z = dir.z / len;
+        }
+        gRSPlights[l].r = (uint8_t)urand(256);
+        gRSPlights[l].g = (uint8_t)urand(256);
+        gRSPlights[l].b = (uint8_t)urand(256);
+        gRSPlights[l].fr = (float)gRSPlights[l].r;
+        gRSPlights[l].fg = (float)gRSPlights[l].g;
+        gRSPlights[l].fb = (float)gRSPlights[l].b;
+    }
+    gRSP.ambientLightColor = urand(0x1000000);
+    gRSP.fAmbientLightR = (float)urand(256);
+    gRSP.fAmbientLightG = (float)urand(256);
+    gRSP.fAmbientLightB = (float)urand(256);
+
+    gRSPfFogMin = frand(1.0f);
+    gRDP.fPrimitiveDepth = frand(1.0f) + 1.0f;
+    gRDP.otherMode.depth_source = urand(2);
+    gRDP.primitiveColor = urand(0x1000000) | 0x80000000;
+    g_curRomInfo.bPrimaryDepthHack = urand(4) == 0;
+    options.enableHackForGames = hacks[urand(3)];
+    options.bWinFrameMode = urand(8) == 0;
+
+    gRSP.DKRCMatrixIndex = (int)urand(4);
+    gRSP.DKRBillBoard = urand(2) != 0;
+    gRSP.DKRVtxCount = urand(2) ? 0 : (int)urand(8);
+    gRSP.DKRBaseVec.x = frand(1000.0f);
+    gRSP.DKRBaseVec.y = frand(1000.0f);
+    gRSP.DKRBaseVec.z = frand(1000.0f);
+    gRSP.DKRBaseVec.w = frand(4.0f);
+}
+
+static void clear_outputs(void)
+{
+    memset((void*)g_vtxNonTransformed, 0, sizeof(g_vtxNonTransformed));
+    for (int i = 0; i < MAX_VERTS; i++)
+        g_vtxNonTransformed[i].w = 1;
+    memset((void*)g_vtxTransformed, 0, sizeof(g_vtxTransformed));
+    memset((void*)g_vecProjected, 0, sizeof(g_vecProjected));
+    memset((void*)g_vtxNormal, 0, sizeof(g_vtxNormal));
+    memset((void*)&g_normal, 0, sizeof(g_normal));
+    memset((void*)g_fVtxTxtCoords, 0, sizeof(g_fVtxTxtCoords));
+    memset(g_fFogCoord, 0, sizeof(g_fFogCoord));
+    memset(g_dwVtxDifColor, 0, sizeof(g_dwVtxDifColor));
+    memset(g_clipFlag, 0, sizeof(g_clipFlag));
+    memset(g_clipFlag2, 0, sizeof(g_clipFlag2));
+}
+
+struct outputs
+{
+    XVECTOR4 nonTransformed[MAX_VERTS];
+    XVECTOR4 transformed[MAX_VERTS];
+    XVECTOR4 projected[MAX_VERTS];
+    XVECTOR4 normals[MAX_VERTS];
+    XVECTOR4 normal;
+    VECTOR2 txtCoords[MAX_VERTS];
+    float fogCoord[MAX_VERTS];
+    uint32_t difColor[MAX_VERTS];
+    uint32_t clipFlag[MAX_VERTS];
+    uint32_t clipFlag2[MAX_VERTS];
+    XVECTOR4 DKRBaseVec;
+    int DKRVtxCount;
+};
+
+static void save_outputs(outputs &out)
+{
+    memcpy(out.nonTransformed, g_vtxNonTransformed, sizeof(out.nonTransformed));
+    memcpy(out.transformed, g_vtxTransformed, sizeof(out.transformed));
+    memcpy(out.projected, g_vecProjected, sizeof(out.projected));
+    memcpy(out.normals, g_vtxNormal, sizeof(out.normals));
+    memcpy(&out.normal, &g_normal, sizeof(out.normal));
+    memcpy(out.txtCoords, g_fVtxTxtCoords, sizeof(out.txtCoords));
+    memcpy(out.fogCoord, g_fFogCoord, sizeof(out.fogCoord));
+    memcpy(out.difColor, g_dwVtxDifColor, sizeof(out.difColor));
+    memcpy(out.clipFlag, g_clipFlag, sizeof(out.clipFlag));
+    memcpy(out.clipFlag2, g_clipFlag2, sizeof(out.clipFlag2));
+    memcpy(&out.DKRBaseVec, &gRSP.DKRBaseVec, sizeof(out.DKRBaseVec));
+    out.DKRVtxCount = gRSP.DKRVtxCount;
+}
+
+#define DIFFERS(field) (memcmp(&a.field, &b.field, sizeof(a.field)) != 0 ? #field : NULL)
+
+static const char *compare_outputs(const outputs &a, const outputs &b)
+{
+    const char *what = NULL;
+    if (!what) what = DIFFERS(nonTransformed);
+    if (!what) what = DIFFERS(transformed);
+    if (!what) what = DIFFERS(projected);
+    if (!what) what = DIFFERS(normals);
+    if (!what) what = DIFFERS(normal);
+    if (!what) what = DIFFERS(txtCoords);
+    if (!what) what = DIFFERS(fogCoord);
+    if (!what) what = DIFFERS(difColor);
+    if (!what) what = DIFFERS(clipFlag);
+    if (!what) what = DIFFERS(clipFlag2);
+    if (!what) what = DIFFERS(DKRBaseVec);
+    if (!what && a.DKRVtxCount != b.DKRVtxCount) what = "DKRVtxCount";
+    return what;
+}
+
+static void run(int variant, uint32_t addr, uint32_t v0, uint32_t n)
+{
+    switch (variant)
+    {
+    case PLAIN:
+        ProcessVertexDataNoSSE(addr, v0, n);
+        break;
+    case DKR:
+        ProcessVertexDataDKR(addr, v0, n);
+        break;
+    case CONKER:
+        ProcessVertexDataConker(addr, v0, n);
+        break;
+    case ROGUE:
+        /* vertex colors and normals 0x400 bytes after the positions */
+        ProcessVertexData_Rogue_Squadron(addr, addr + 0x400, n << 10, 0);
+        break;
+    }
+}
+
+int main(void)
+{
+    static ALIGN(16, uint8_t rdram[RDRAM_SIZE]);
+    static outputs single, simd;
+    unsigned groups = 0;
+
+    gfx_info.RDRAM = rdram;
+
+    for (unsigned i = 0; i < ROUNDS; i++)
+    {
+        const int variant = (int)(i % 4);
+        const uint32_t n = 1 + urand(32);
+        const uint32_t v0 = variant == ROGUE ? 0 : urand(MAX_VERTS - n + 1);
+        const uint32_t addr = urand(RDRAM_SIZE / 2) & ~7;
+
+        /* zero words now and then, for zero normals */
+        for (uint32_t j = 0; j < RDRAM_SIZE; j += 4)
+            *(uint32_t*)&rdram[j] = urand(16) == 0 ? 0 : urand(0x1000000) | (urand(256) << 24);
+        dwConkerVtxZAddr = urand(RDRAM_SIZE / 2) & ~3;
+        rand_state();
+        const RSP_Options rsp = gRSP;
+
+        for (int pass = 0; pass < 2; pass++)
+        {
+            status.isSIMDEnabled = pass != 0;
+            gRSP = rsp;
+            clear_outputs();
+            run(variant, addr, v0, n);
+            save_outputs(pass ? simd : single);
+        }
+        groups += n / 4;
+
+        const char *what = compare_outputs(single, simd);
+        if (what && failures++ < 10)
+            printf("round %u: %s load of %u at %u, %s differs (lighting %d, fog %d, texgen %d, %d lights, hack %d)\n",
+                    i, variants[variant], n, v0, what, rsp.bLightingEnable, rsp.bFogEnabled, rsp.bTextureGen,
+                    gSP.numLights, options.enableHackForGames);
+    }
+    printf("%u rounds, %u groups of four\n", ROUNDS, groups);
+
+    printf(failures ? "FAILED\n" : "ok\n");
+    return failures != 0;
+}
@@ -0,0 +1,234 @@
+/* texconvcheck
+ * Exhaustive bit-exactness check of Graphics/texture_convert.c against
+ * per-texel references written like the plugin code it replaces, over
+ * every input value, swizzle, start offset and row length up to 80.
+ * Also prints row throughput for each format.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "../Graphics/texture_convert.h"
+
+/* GLideN64 convert.h */
+static const uint8_t Five2Eight[32] =
+{
+	  0,   8,  16,  25,  33,  41,  49,  58,  66,  74,  82,  90,  99, 107, 115, 123,
+	132, 140, 148, 156, 165, 173, 181, 189, 197, 206, 214, 222, 230, 239, 247, 255
+};
+/* gles2rice ConvertImage.h */
+static const uint8_t FiveToEight[32] =
+{
+	0x00, 0x08, 0x10, 0x18, 0x21, 0x29, 0x31, 0x39, 0x42, 0x4a, 0x52, 0x5a, 0x63, 0x6b, 0x73, 0x7b,
+	0x84, 0x8c, 0x94, 0x9c, 0xa5, 0xad, 0xb5, 0xbd, 0xc6, 0xce, 0xd6, 0xde, 0xe7, 0xef, 0xf7, 0xff
+};
+static const uint8_t Three2Eight[8] = { 0, 36, 73, 109, 146, 182, 219, 255 };
+
+static uint32_t ref_i4(uint32_t n)   { uint32_t c = n * 17; return (c << 24) | (c << 16) | (c << 8) | c; }
+static uint32_t ref_ia31(uint32_t n) { uint32_t i = Three2Eight[n >> 1], a = (n & 1) ? 0xFF : 0; return (a << 24) | (i << 16) | (i << 8) | i; }
+static uint32_t ref_i8(uint32_t b)   { return (b << 24) | (b << 16) | (b << 8) | b; }
+static uint32_t ref_ia44(uint32_t b) { uint32_t i = (b >> 4) * 17, a = (b & 15) * 17; return (a << 24) | (i << 16) | (i << 8) | i; }
+static uint32_t ref_ia88(uint32_t w) { uint32_t i = w >> 8, a = w & 0xFF; return (a << 24) | (i << 16) | (i << 8) | i; }
+
+static uint32_t ref_5551(uint32_t c, unsigned flags)
+{
+	const uint8_t *t = (flags & TC_5BIT_REPLICATE) ? FiveToEight : Five2Eight;
+	uint32_t r = t[c >> 11], g = t[(c >> 6) & 31], b = t[(c >> 1) & 31], a = (c & 1) ? 0xFF : 0;
+	if (flags & TC_BGRA)
+		return (a << 24) | (r << 16) | (g << 8) | b;
+	return (a << 24) | (b << 16) | (g << 8) | r;
+}
+
+static uint32_t ref_8888(const uint8_t *c, unsigned flags)
+{
+	if (flags & TC_BGRA)
+		return ((uint32_t)c[3] << 24) | (c[0] << 16) | (c[1] << 8) | c[2];
+	return ((uint32_t)c[3] << 24) | (c[2] << 16) | (c[1] << 8) | c[0];
+}
+
+/* GLideN64 Textures.cpp YUV_RGBA8888 */
+static uint32_t ref_yuv(uint8_t y, uint8_t u, uint8_t v)
+{
+	int32_t r = (int32_t)(y + (1.370705f * (v - 128)));
+	int32_t g = (int32_t)((y - (0.698001f * (v - 128)) - (0.337633f * (u - 128))));
+	int32_t b = (int32_t)(y + (1.732446f * (u - 128)));
+	if (r > 255) r = 255;
+	if (g > 255) g = 255;
+	if (b > 255) b = 255;
+	if (r < 0) r = 0;
+	if (g < 0) g = 0;
+	if (b < 0) b = 0;
+	return (0xffu << 24) | (b << 16) | (g << 8) | r;
+}
+
+enum { F_I4, F_IA31, F_CI4, F_I8, F_IA44, F_CI8, F_IA88, F_5551, F_5551R, F_5551B, F_8888, F_8888B, F_YUV, F_COUNT };
+static const char *names[F_COUNT] = { "i4", "ia31", "ci4", "i8", "ia44", "ci8", "ia88", "rgba5551",
+	"rgba5551 rice", "rgba5551 bgra", "rgba8888", "rgba8888 bgra", "yuv" };
+static const unsigned bits[F_COUNT] = { 4, 4, 4, 8, 8, 8, 16, 16, 16, 16, 32, 32, 16 };
+
+static uint32_t palette[256];
+
+/* N64-order byte n of the row */
+static uint8_t n64(const uint8_t *base, uint32_t n, uint32_t swizzle)
+{
+	return base[n ^ swizzle];
+}
+
+static uint32_t reference(int f, const uint8_t *base, uint32_t offset, uint32_t swizzle, unsigned x)
+{
+	uint32_t a4 = offset + (x >> 1), a8 = offset + x, a16 = offset + x * 2, a32 = offset + x * 4;
+	uint32_t nib = (x & 1) ? (n64(base, a4, swizzle) & 15) : (n64(base, a4, swizzle) >> 4);
+	uint32_t w = (n64(base, a16, swizzle) << 8) | n64(base, a16 + 1, swizzle);
+	uint8_t c[4];
+
+	switch (f)
+	{
+	case F_I4:    return ref_i4(nib);
+	case F_IA31:  return ref_ia31(nib);
+	case F_CI4:   return palette[nib];
+	case F_I8:    return ref_i8(n64(base, a8, swizzle));
+	case F_IA44:  return ref_ia44(n64(base, a8, swizzle));
+	case F_CI8:   return palette[n64(base, a8, swizzle)];
+	case F_IA88:  return ref_ia88(w);
+	case F_5551:  return ref_5551(w, 0);
+	case F_5551R: return ref_5551(w, TC_BGRA | TC_5BIT_REPLICATE);
+	case F_5551B: return ref_5551(w, TC_BGRA);
+	case F_8888:
+	case F_8888B:
+		c[0] = n64(base, a32, swizzle);
+		c[1] = n64(base, a32 + 1, swizzle);
+		c[2] = n64(base, a32 + 2, swizzle);
+		c[3] = n64(base, a32 + 3, swizzle);
+		return ref_8888(c, f == F_8888B ? TC_BGRA : 0);
+	case F_YUV:
+	{
+		uint32_t p = offset + (x >> 1) * 4;
+		uint8_t u = n64(base, p, swizzle), v = n64(base, p + 2, swizzle);
+		return ref_yuv(n64(base, p + 1 + ((x & 1) << 1), swizzle), u, v);
+	}
+	}
+	return 0;
+}
+
+static void convert(int f, uint32_t *dst, const uint8_t *base, uint32_t offset, uint32_t swizzle, unsigned count)
+{
+	switch (f)
+	{
+	case F_I4:    tc_row_i4(dst, base, offset, swizzle, count); break;
+	case F_IA31:  tc_row_ia31(dst, base, offset, swizzle, count); break;
+	case F_CI4:   tc_row_ci4(dst, base, offset, swizzle, count, palette); break;
+	case F_I8:    tc_row_i8(dst, base, offset, swizzle, count); break;
+	case F_IA44:  tc_row_ia44(dst, base, offset, swizzle, count); break;
+	case F_CI8:   tc_row_ci8(dst, base, offset, swizzle, count, palette); break;
+	case F_IA88:  tc_row_ia88(dst, base, offset, swizzle, count); break;
+	case F_5551:  tc_row_rgba5551(dst, base, offset, swizzle, count, 0); break;
+	case F_5551R: tc_row_rgba5551(dst, base, offset, swizzle, count, TC_BGRA | TC_5BIT_REPLICATE); break;
+	case F_5551B: tc_row_rgba5551(dst, base, offset, swizzle, count, TC_BGRA); break;
+	case F_8888:  tc_row_rgba8888(dst, base, offset, swizzle, count, 0); break;
+	case F_8888B: tc_row_rgba8888(dst, base, offset, swizzle, count, TC_BGRA); break;
+	case F_YUV:   tc_row_yuv(dst, base, offset, swizzle, count); break;
+	}
+}
+
+#define BUF_BYTES (1 << 19)
+
+static int check(int f, const uint8_t *base, uint32_t offset, uint32_t swizzle, unsigned count, uint32_t *out)
+{
+	unsigned x, n = (f == F_YUV) ? (count & ~1u) : count;
+	out[n] = 0xDEADBEEF;
+	convert(f, out, base, offset, swizzle, count);
+	if (out[n] != 0xDEADBEEF)
+	{
+		printf("%s: wrote past %u texels (offset %u swizzle %u)\n", names[f], n, offset, swizzle);
+		return 1;
+	}
+	for (x = 0; x < n; x++)
+	{
+		uint32_t ref = reference(f, base, offset, swizzle, x);
+		if (out[x] != ref)
+		{
+			printf("%s: texel %u of %u (offset %u swizzle %u): %08x, expected %08x\n",
+				names[f], x, count, offset, swizzle, out[x], ref);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int main(void)
+{
+	uint8_t *buf = (uint8_t*)malloc(BUF_BYTES + 64);
+	uint32_t *out = (uint32_t*)malloc(sizeof(uint32_t) * (BUF_BYTES * 2 + 64));
+	unsigned i, f, failed = 0;
+
+	srand(1);
+	for (i = 0; i < 256; i++)
+		palette[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+
+	for (f = 0; f < F_COUNT && !failed; f++)
+	{
+		uint32_t swizzle, offset, count;
+
+		/* every head/tail shape over random data */
+		for (i = 0; i < BUF_BYTES + 64; i++)
+			buf[i] = (uint8_t)rand();
+		for (swizzle = 0; swizzle < 8 && !failed; swizzle++)
+			for (offset = 0; offset < 16 && !failed; offset += (bits[f] == 32 ? 4 : bits[f] == 16 ? 2 : 1))
+				for (count = 0; count <= 80 && !failed; count++)
+					failed |= check(f, buf + 16, offset, swizzle, count, out);
+
+		/* every input value: all bytes, all halfwords, all YUV triples */
+		if (!failed && f == F_YUV)
+		{
+			uint32_t uv;
+			for (uv = 0; uv < 65536 && !failed; uv++)
+			{
+				for (i = 0; i < 128; i++)
+				{
+					buf[i * 4 + 0] = (uint8_t)uv;
+					buf[i * 4 + 1] = (uint8_t)(i * 2);
+					buf[i * 4 + 2] = (uint8_t)(uv >> 8);
+					buf[i * 4 + 3] = (uint8_t)(i * 2 + 1);
+				}
+				failed |= check(f, buf, 0, 0, 256, out);
+			}
+		}
+		else if (!failed && bits[f] <= 8)
+		{
+			for (i = 0; i < 256; i++)
+				buf[i] = (uint8_t)i;
+			failed |= check(f, buf, 0, 0, 256 * 8 / bits[f], out);
+		}
+		else if (!failed && bits[f] == 16)
+		{
+			for (i = 0; i < 65536; i++)
+			{
+				buf[i * 2 + 0] = (uint8_t)(i >> 8);
+				buf[i * 2 + 1] = (uint8_t)i;
+			}
+			failed |= check(f, buf, 0, 0, 65536, out);
+		}
+		if (!failed)
+			printf("%-14s ok\n", names[f]);
+	}
+
+	/* throughput over a 4 KiB (TMEM sized) row */
+	for (f = 0; f < F_COUNT && !failed; f++)
+	{
+		const unsigned texels = 4096 * 8 / bits[f];
+		const unsigned iters = 20000;
+		clock_t t0 = clock();
+		double secs;
+		for (i = 0; i < iters; i++)
+			convert(f, out, buf, 0, i & 4, texels);
+		secs = (double)(clock() - t0) / CLOCKS_PER_SEC;
+		printf("%-14s %8.0f Mtexels/s\n", names[f], (double)texels * iters / 1e6 / (secs > 0 ? secs : 1e-9));
+	}
+
+	free(buf);
+	free(out);
+	return failed;
+}
@@ -0,0 +1,241 @@
+/* vertexbatchcheck
+ * Checks gln64gSPProcessVertexBatch of the GLideN64 plugin bit for bit
+ * against running gln64gSPProcessVertex on each vertex, over random loads
+ * of 1 to 16 vertices (so partial groups of 1 to 3 as well), with default
+ * and CBFD lighting, directional and point lights, hardware lighting,
+ * texgen, billboard, screen adjustment, a flipped viewport and vertices on
+ * the clip planes. Both the C and the SIMD versions of the shared vertex
+ * math are used for the per-vertex path.
+ *
+ * gSP.cpp is built into the check; the rest of the plugin is left out, so
+ * only what the vertex path reads is defined here.
+ */
+
+#include "../mupen64plus-video-gliden64/src/gSP.cpp"
+
+#define ROUNDS 200000
+
+gliden64_config config;
+GBIInfo GBI;
+VIInfo VI;
+struct gSPInfo gSP;
+struct gDPInfo gDP;
+
+class CheckVideo : public OGLVideo
+{
+public:
+	void setAdjustScreen(bool _on, float _scale)
+	{
+		m_bAdjustScreen = _on;
+		m_adjustScale = _scale;
+	}
+
+private:
+	bool _start() { return true; }
+	void _stop() {}
+	void _swapBuffers() {}
+	void _changeWindow() {}
+	bool _resizeWindow() { return true; }
+};
+
+static CheckVideo checkVideo;
+
+OGLVideo & OGLVideo::get()
+{
+	return checkVideo;
+}
+
+static unsigned failures;
+
+static uint32_t seed = 1;
+
+static uint32_t urand(uint32_t n)
+{
+	seed = seed * 1664525 + 1013904223;
+	return (seed >> 8) % n;
+}
+
+static float frand(float scale)
+{
+	seed = seed * 1664525 + 1013904223;
+	return ((float)(seed >> 8) / 8388608.0f - 1.0f) * scale;
+}
+
+static void rand_matrix(float m[4][4], float scale)
+{
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			m[i][j] = frand(scale);
+}
+
+static void rand_state(bool cbfd)
+{
+	gSP.matrix.modelViewi = urand(4);
+	rand_matrix(gSP.matrix.modelView[gSP.matrix.modelViewi], 2.0f);
+	rand_matrix(gSP.matrix.projection, 2.0f);
+	if (urand(2))
+		gSP.matrix.projection[3][2] = -1.0f;
+	if (urand(4) == 0) {
+		/* vertices at the origin end up on or next to the clip planes */
+		float (*mv)[4] = gSP.matrix.modelView[gSP.matrix.modelViewi];
+		mv[3][0] = mv[3][1] = mv[3][2] = 0.0f;
+		mv[3][3] = 1.0f;
+		gSP.matrix.projection[3][3] = 0.005f * (float)urand(4);
+		gSP.matrix.projection[3][0] = gSP.matrix.projection[3][3];
+		gSP.matrix.projection[3][1] = -gSP.matrix.projection[3][3];
+	}
+	gSP.changed |= CHANGED_MATRIX;
+	gSP.matrix.billboard = urand(4) == 0;
+
+	gSP.geometryMode = 0;
+	if (urand(4) != 0)
+		gSP.geometryMode |= G_LIGHTING;
+	if (urand(2))
+		gSP.geometryMode |= G_POINT_LIGHTING;
+	if (urand(3) == 0)
+		gSP.geometryMode |= G_TEXTURE_GEN;
+	if (urand(2))
+		gSP.geometryMode |= G_TEXTURE_GEN_LINEAR;
+
+	/* the CBFD point light path always has its directional light last */
+	gSP.numLights = (int32_t)urand(8) + (cbfd ? 1 : 0);
+	for (int l = 0; l <= gSP.numLights; ++l) {
+		SPLight & light = gSP.lights[l];
+		float dir[3] = { frand(1.0f), frand(1.0f), frand(1.0f) };
+		NormalizeVector(dir);
+		light.r = frand(0.5f) + 0.5f;
+		light.g = frand(0.5f) + 0.5f;
+		light.b = frand(0.5f) + 0.5f;
+		light.x = dir[0];
+		light.y = dir[1];
+		light.z = dir[2];
+		light.posx = frand(2000.0f);
+		light.posy = frand(2000.0f);
+		light.posz = frand(2000.0f);
+		light.posw = frand(2000.0f);
+		/* some lights attenuated to nothing, some not at all */
+		light.ca = urand(8) == 0 ? -1.0f : frand(8.0f) + 8.0f;
+		light.la = frand(4.0f) + 4.0f;
+		light.qa = urand(4) == 0 ? 0.0f : frand(2.0f) + 2.0f;
+	}
+	for (int i = 0; i < 2; ++i) {
+		float dir[3] = { frand(1.0f), frand(1.0f), frand(1.0f) };
+		NormalizeVector(dir);
+		gSP.lookat[i].x = dir[0];
+		gSP.lookat[i].y = dir[1];
+		gSP.lookat[i].z = dir[2];
+	}
+	gSP.lookatEnable = urand(2) != 0;
+
+	for (int i = 0; i < 8; ++i)
+		gSP.vertexCoordMod[i] = 0.0f;
+	for (int i = 8; i < 12; ++i)
+		gSP.vertexCoordMod[i] = frand(64.0f);
+	for (int i = 12; i < 16; ++i)
+		gSP.vertexCoordMod[i] = frand(2.0f);
+
+	gSP.viewport.vscale[0] = urand(2) ? 160.0f : -160.0f;
+	config.generalEmulation.enableHWLighting = !cbfd && urand(4) == 0;
+	VI.width = 320;
+	gDP.colorImage.width = urand(2) ? 320 : 240;
+	checkVideo.setAdjustScreen(urand(2) != 0, 0.75f);
+}
+
+static void rand_vertex(SPVertex & _vtx)
+{
+	if (urand(4) == 0) {
+		_vtx.x = _vtx.y = _vtx.z = 0.0f;
+	} else {
+		_vtx.x = (float)(int16_t)urand(65536);
+		_vtx.y = (float)(int16_t)urand(65536);
+		_vtx.z = (float)(int16_t)urand(65536);
+	}
+	_vtx.w = frand(4.0f);
+	/* the normals are signed bytes, zero now and then */
+	if (urand(32) == 0) {
+		_vtx.nx = _vtx.ny = _vtx.nz = 0.0f;
+	} else {
+		_vtx.nx = (float)(int8_t)urand(256);
+		_vtx.ny = (float)(int8_t)urand(256);
+		_vtx.nz = (float)(int8_t)urand(256);
+	}
+	_vtx.r = (float)urand(256) * 0.0039215689f;
+	_vtx.g = (float)urand(256) * 0.0039215689f;
+	_vtx.b = (float)urand(256) * 0.0039215689f;
+	_vtx.a = (float)urand(256) * 0.0039215689f;
+	_vtx.s = frand(1024.0f);
+	_vtx.t = frand(1024.0f);
+	_vtx.HWLight = (uint8_t)urand(256);
+	_vtx.clip = urand(32);
+}
+
+static void use_cbfd(bool cbfd)
+{
+	gln64gSPLightVertex       = cbfd ? gln64gSPLightVertex_CBFD       : gln64gSPLightVertex_default;
+	gln64gSPPointLightVertex  = cbfd ? gln64gSPPointLightVertex_CBFD  : gln64gSPPointLightVertex_default;
+	gln64gSPLightVertex4      = cbfd ? gln64gSPLightVertex4_CBFD      : gln64gSPLightVertex4_default;
+	gln64gSPPointLightVertex4 = cbfd ? gln64gSPPointLightVertex4_CBFD : gln64gSPPointLightVertex4_default;
+}
+
+int main(void)
+{
+	static SPVertex input[VERTBUFF_SIZE], single[VERTBUFF_SIZE];
+	OGLRender & render = video().getRender();
+	SPVertex * const vertices = &render.getVertex(0);
+	const gSPInfo state = gSP;
+	unsigned batches = 0;
+	bool has_simd = false;
+
+	for (unsigned i = 0; i < ROUNDS; ++i) {
+		const bool cbfd = (i & 1) != 0;
+		const uint32_t n = 1 + urand(16);
+		/* vertex 0, the billboard origin, is in the load now and then */
+		const uint32_t v0 = urand(4) == 0 ? 0 : urand(32);
+
+		gSP = state;
+		rand_state(cbfd);
+		use_cbfd(cbfd);
+		for (uint32_t v = 0; v < v0 + n; ++v)
+			rand_vertex(input[v]);
+		const gSPInfo loaded = gSP;
+
+		/* per vertex, once with each version of the shared math */
+		for (int simd = 0; simd < 2; ++simd) {
+			if (simd) {
+				has_simd = MathInit(true);
+				if (!has_simd)
+					break;
+			} else
+				MathInit(false);
+
+			gSP = loaded;
+			memcpy(vertices, input, sizeof(input));
+			for (uint32_t v = v0; v < v0 + n; ++v)
+				gln64gSPProcessVertex(v);
+			if (!simd)
+				memcpy(single, vertices, sizeof(single));
+			else if (memcmp(single, vertices, sizeof(single)) != 0 && failures++ < 10)
+				printf("round %u: per vertex C and SIMD math differ\n", i);
+		}
+
+		gSP = loaded;
+		memcpy(vertices, input, sizeof(input));
+		gln64gSPProcessVertexBatch(v0, n);
+		batches += n / 4;
+
+		for (uint32_t v = 0; v < VERTBUFF_SIZE; ++v) {
+			if (memcmp(&single[v], &vertices[v], sizeof(SPVertex)) == 0)
+				continue;
+			if (failures++ < 10)
+				printf("round %u: vertex %u of %u..%u differs (%s lighting, mode %08x, %d lights%s)\n",
+						i, v, v0, v0 + n - 1, cbfd ? "CBFD" : "default", gSP.geometryMode,
+						gSP.numLights, gSP.matrix.billboard ? ", billboard" : "");
+			break;
+		}
+	}
+	printf("%u rounds, %u groups of four, per vertex path with %s math\n",
+			ROUNDS, batches, has_simd ? "C and SIMD" : "C");
+
+	printf(failures ? "FAILED\n" : "ok\n");
+	return failures != 0;
+}
@@ -0,0 +1,300 @@
+/* vertexmathcheck
+ * Checks the vertex math of Graphics/3dmaths.c: the C versions against
+ * references written like the plugin code they replace, and the SSE2/NEON
+ * versions bit for bit against the C ones, over random matrices, vertices,
+ * normals and lights plus the edge cases of each function (aliased matrix
+ * arguments, zero normals, back facing lights, colors past 1, vertices on
+ * the clip planes). Also prints the time per call of both versions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "../Graphics/3dmath.h"
+#include "../Graphics/RSP/gSP_state.h"
+
+#define ROUNDS 100000
+
+static unsigned failures;
+
+#define CHECK(cond, what) do { if (!(cond)) { if (failures++ < 10) printf("%s: %s\n", what, #cond); } } while (0)
+
+static uint32_t seed = 1;
+
+static float frand(float scale)
+{
+	seed = seed * 1664525 + 1013904223;
+	return ((float)(seed >> 8) / 8388608.0f - 1.0f) * scale;
+}
+
+static void rand_matrix(float m[4][4], float scale)
+{
+	unsigned i, j;
+	for (i = 0; i < 4; i++)
+		for (j = 0; j < 4; j++)
+			m[i][j] = frand(scale);
+}
+
+static void rand_lights(struct SPLight *lights, unsigned n)
+{
+	unsigned i;
+	for (i = 0; i <= n; i++)
+	{
+		float dir[3];
+		dir[0] = frand(1.0f);
+		dir[1] = frand(1.0f);
+		dir[2] = frand(1.0f);
+		NormalizeVector(dir);
+		lights[i].r = frand(0.5f) + 0.5f;
+		lights[i].g = frand(0.5f) + 0.5f;
+		lights[i].b = frand(0.5f) + 0.5f;
+		lights[i].x = dir[0];
+		lights[i].y = dir[1];
+		lights[i].z = dir[2];
+	}
+}
+
+/* glide64 glide64_3dmath.c MulMatrices */
+static void ref_mul_matrices(float m0[4][4], float m1[4][4], float dest[4][4])
+{
+	float row[4][4];
+	unsigned i, j;
+
+	for (i = 0; i < 4; i++)
+		for (j = 0; j < 4; j++)
+			row[i][j] = m1[i][j];
+	for (i = 0; i < 4; i++)
+	{
+		float summand[4][4];
+
+		for (j = 0; j < 4; j++)
+		{
+			summand[0][j] = m0[i][0] * row[0][j];
+			summand[1][j] = m0[i][1] * row[1][j];
+			summand[2][j] = m0[i][2] * row[2][j];
+			summand[3][j] = m0[i][3] * row[3][j];
+		}
+		for (j = 0; j < 4; j++)
+			dest[i][j] = summand[0][j] + summand[1][j] + summand[2][j] + summand[3][j];
+	}
+}
+
+/* gles2n64 gSP_gles2n64.c gln64gSPTransformVertex_default */
+static void ref_transform_vertex(float vtx[4], float mtx[4][4])
+{
+	float x = vtx[0], y = vtx[1], z = vtx[2];
+
+	vtx[0] = x * mtx[0][0] + y * mtx[1][0] + z * mtx[2][0] + mtx[3][0];
+	vtx[1] = x * mtx[0][1] + y * mtx[1][1] + z * mtx[2][1] + mtx[3][1];
+	vtx[2] = x * mtx[0][2] + y * mtx[1][2] + z * mtx[2][2] + mtx[3][2];
+	vtx[3] = x * mtx[0][3] + y * mtx[1][3] + z * mtx[2][3] + mtx[3][3];
+}
+
+/* gles2n64 gSP_gles2n64.c gln64gSPLightVertex_default */
+static void ref_light_vertex(struct SPVertex *vtx, const struct SPLight *lights, uint32_t numLights)
+{
+	uint32_t i;
+
+	vtx->r = lights[numLights].r;
+	vtx->g = lights[numLights].g;
+	vtx->b = lights[numLights].b;
+
+	for (i = 0; i < numLights; i++)
+	{
+		float intensity = DotProduct(&vtx->nx, &lights[i].x);
+		if (intensity < 0.0f)
+			intensity = 0.0f;
+		vtx->r += lights[i].r * intensity;
+		vtx->g += lights[i].g * intensity;
+		vtx->b += lights[i].b * intensity;
+	}
+
+	vtx->r = MIN(1.0f, vtx->r);
+	vtx->g = MIN(1.0f, vtx->g);
+	vtx->b = MIN(1.0f, vtx->b);
+}
+
+/* glide64 glide64_gSP.c glide64gSPClipVertex */
+static uint32_t ref_clip(const float v[4], float wmin)
+{
+	uint32_t scr_off = 0;
+	if (v[0] > +v[3])   scr_off |= 2;
+	if (v[0] < -v[3])   scr_off |= 1;
+	if (v[1] > +v[3])   scr_off |= 8;
+	if (v[1] < -v[3])   scr_off |= 4;
+	if (v[3] < wmin)    scr_off |= 16;
+	return scr_off;
+}
+
+/* Runs one round of every function with the versions MathInit picked */
+struct results
+{
+	float mult[4][4], mult_alias0[4][4], mult_alias1[4][4];
+	float vtx[4], normal[3], color[3];
+	uint32_t clip[4];
+};
+
+static void run(struct results *r, float m0[4][4], float m1[4][4], const float pos[4],
+		const float normal[3], const struct SPLight *lights, uint32_t numLights)
+{
+	float clipv[4];
+
+	MultMatrix(m0, m1, r->mult);
+	memcpy(r->mult_alias0, m0, sizeof(r->mult_alias0));
+	MultMatrix(r->mult_alias0, m1, r->mult_alias0);
+	memcpy(r->mult_alias1, m1, sizeof(r->mult_alias1));
+	MultMatrix(m0, r->mult_alias1, r->mult_alias1);
+
+	memcpy(r->vtx, pos, sizeof(r->vtx));
+	TransformVertex(r->vtx, m0);
+
+	memcpy(r->normal, normal, sizeof(r->normal));
+	TransformVectorNormalize(r->normal, m1);
+	ShadeVertex(r->color, r->normal, lights, numLights);
+
+	r->clip[0] = ClipVertexFlags(r->vtx, 0.01f);
+	r->clip[1] = ClipVertexFlags(r->vtx, 0.1f);
+	/* exactly on the planes */
+	clipv[3] = fabsf(r->vtx[3]);
+	clipv[0] = clipv[3];
+	clipv[1] = -clipv[3];
+	clipv[2] = 0.0f;
+	r->clip[2] = ClipVertexFlags(clipv, clipv[3]);
+	clipv[0] = -clipv[3];
+	clipv[1] = clipv[3];
+	r->clip[3] = ClipVertexFlags(clipv, 0.0f);
+}
+
+static void check_reference(const struct results *r, float m0[4][4], float m1[4][4],
+		const float pos[4], const float normal[3], const struct SPLight *lights, uint32_t numLights)
+{
+	float ref[4][4], v[4];
+	struct SPVertex vtx;
+
+	ref_mul_matrices(m1, m0, ref);
+	CHECK(!memcmp(ref, r->mult, sizeof(ref)), "MultMatrix");
+	CHECK(!memcmp(ref, r->mult_alias0, sizeof(ref)), "MultMatrix, dest is m0");
+	CHECK(!memcmp(ref, r->mult_alias1, sizeof(ref)), "MultMatrix, dest is m1");
+
+	memcpy(v, pos, sizeof(v));
+	ref_transform_vertex(v, m0);
+	CHECK(!memcmp(v, r->vtx, sizeof(v)), "TransformVertex");
+
+	memset(&vtx, 0, sizeof(vtx));
+	memcpy(&vtx.nx, r->normal, sizeof(r->normal));
+	ref_light_vertex(&vtx, lights, numLights);
+	CHECK(vtx.r == r->color[0] && vtx.g == r->color[1] && vtx.b == r->color[2], "ShadeVertex");
+
+	CHECK(ref_clip(r->vtx, 0.01f) == r->clip[0], "ClipVertexFlags");
+	CHECK(ref_clip(r->vtx, 0.1f) == r->clip[1], "ClipVertexFlags");
+	CHECK(r->clip[2] == 0 && r->clip[3] == 0, "ClipVertexFlags on the planes");
+}
+
+int main(void)
+{
+	static struct SPLight lights[12];
+	struct results c, simd;
+	float m0[4][4], m1[4][4], pos[4], normal[3];
+	bool has_simd;
+	unsigned i;
+
+	for (i = 0; i < ROUNDS; i++)
+	{
+		uint32_t numLights = i % 8;
+		float scale = (i & 1) ? 1.0f : 1000.0f;
+
+		rand_matrix(m0, scale);
+		rand_matrix(m1, 2.0f);
+		rand_lights(lights, numLights);
+		pos[0] = frand(32768.0f);
+		pos[1] = frand(32768.0f);
+		pos[2] = frand(32768.0f);
+		pos[3] = frand(1.0f);
+		normal[0] = frand(1.0f);
+		normal[1] = frand(1.0f);
+		normal[2] = frand(1.0f);
+		if (i % 97 == 0)
+			normal[0] = normal[1] = normal[2] = 0.0f;
+		if (i % 89 == 0)
+			lights[numLights].r = 3.0f;
+
+		MathInit(false);
+		run(&c, m0, m1, pos, normal, lights, numLights);
+		check_reference(&c, m0, m1, pos, normal, lights, numLights);
+
+		has_simd = MathInit(true);
+		if (has_simd)
+		{
+			run(&simd, m0, m1, pos, normal, lights, numLights);
+			CHECK(!memcmp(&c, &simd, sizeof(c)), "SIMD and C differ");
+		}
+	}
+	printf(has_simd ? "C and SIMD versions: %u rounds\n" : "C versions only: %u rounds\n", ROUNDS);
+
+	/* time per call */
+	for (i = 0; i < 2; i++)
+	{
+		const unsigned iters = 10000000;
+		float acc = 0.0f, v[4], color[3], out[4][4];
+		double secs[4];
+		clock_t t0;
+		unsigned n;
+
+		if (MathInit(i != 0) != (i != 0))
+			break;
+
+		rand_matrix(m0, 1.0f);
+		rand_matrix(m1, 1.0f);
+		rand_lights(lights, 2);
+
+		t0 = clock();
+		for (n = 0; n < iters; n++)
+		{
+			m0[0][0] = (float)n;
+			MultMatrix(m0, m1, out);
+			acc += out[3][3];
+		}
+		secs[0] = (double)(clock() - t0) / CLOCKS_PER_SEC;
+
+		t0 = clock();
+		for (n = 0; n < iters; n++)
+		{
+			v[0] = (float)n;
+			v[1] = v[2] = 1.0f;
+			TransformVertex(v, m0);
+			acc += v[3];
+		}
+		secs[1] = (double)(clock() - t0) / CLOCKS_PER_SEC;
+
+		t0 = clock();
+		for (n = 0; n < iters; n++)
+		{
+			v[0] = (float)n;
+			v[1] = v[2] = 1.0f;
+			TransformVectorNormalize(v, m0);
+			acc += v[2];
+		}
+		secs[2] = (double)(clock() - t0) / CLOCKS_PER_SEC;
+
+		t0 = clock();
+		for (n = 0; n < iters; n++)
+		{
+			v[0] = (float)(n & 255) / 255.0f;
+			v[1] = v[2] = 0.5f;
+			ShadeVertex(color, v, lights, 2);
+			acc += color[1];
+		}
+		secs[3] = (double)(clock() - t0) / CLOCKS_PER_SEC;
+
+		printf("%-5s MultMatrix %5.1f ns, TransformVertex %5.1f ns, TransformVectorNormalize %5.1f ns, "
+				"ShadeVertex (2 lights) %5.1f ns (%g)\n",
+				i ? "SIMD" : "C", secs[0] * 1e9 / iters, secs[1] * 1e9 / iters, secs[2] * 1e9 / iters,
+				secs[3] * 1e9 / iters, acc);
+	}
+
+	printf(failures ? "FAILED\n" : "ok\n");
+	return failures != 0;
+}